@@ -0,0 +1,66 @@
+import taichi as ti
+
+# Large generated kernels whose compilation time is dominated by the dataflow
+# analyses of cfg_optimization. See "compilation_time" in the results.
+
+
+@ti.test(arch=ti.cpu)
+def benchmark_unrolled_matrix_products():
+    n = 8
+    a = ti.Matrix.field(n, n, dtype=ti.f32, shape=16)
+    b = ti.Matrix.field(n, n, dtype=ti.f32, shape=16)
+
+    @ti.kernel
+    def task():
+        for i in a:
+            m = a[i]
+            for _ in ti.static(range(4)):
+                m = m @ a[i] + m.transpose()
+                if m[0, 0] > 1:
+                    m *= 0.5
+            b[i] = m
+
+    return ti.benchmark(task, repeat=1)
+
+
+@ti.test(arch=ti.cpu)
+def benchmark_unrolled_local_branches():
+    x = ti.field(dtype=ti.f32, shape=16)
+
+    @ti.kernel
+    def task():
+        for i in x:
+            v = [0.0] * 64
+            for j in ti.static(range(64)):
+                if x[i] > j:
+                    v[j] = x[i] * j
+                else:
+                    v[(j * 7) % 64] += 1
+            s = 0.0
+            for j in ti.static(range(64)):
+                s += v[j]
+            x[i] = s
+
+    return ti.benchmark(task, repeat=1)
+
+
+@ti.test(arch=ti.cpu)
+def benchmark_autodiff_unrolled_loops():
+    n = 16
+    x = ti.field(dtype=ti.f32, shape=n, needs_grad=True)
+    loss = ti.field(dtype=ti.f32, shape=(), needs_grad=True)
+
+    @ti.kernel
+    def compute_loss():
+        for i in x:
+            v = x[i]
+            for j in range(8):
+                for _ in ti.static(range(16)):
+                    v = ti.sin(v) * v + 0.5
+            loss[None] += v
+
+    def task():
+        with ti.Tape(loss):
+            compute_loss()
+
+    return ti.benchmark(task, repeat=1)
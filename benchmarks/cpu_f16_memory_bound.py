@@ -0,0 +1,64 @@
+import taichi as ti
+
+# Memory-bound kernels on f16 fields versus f32 fields on CPUs. f16 values are
+# loaded into f32 for computation, so f16 halves the traffic at the cost of
+# the conversions.
+
+N = 1024**3 // 4
+
+
+def memset(dtype):
+    @ti.test(arch=ti.cpu)
+    def body():
+        a = ti.field(dtype=dtype, shape=N)
+
+        @ti.kernel
+        def task():
+            for i in a:
+                a[i] = 1.0
+
+        return ti.benchmark(task, repeat=10)
+
+    return body
+
+
+def saxpy(dtype):
+    @ti.test(arch=ti.cpu)
+    def body():
+        x = ti.field(dtype=dtype, shape=N)
+        y = ti.field(dtype=dtype, shape=N)
+        z = ti.field(dtype=dtype, shape=N)
+
+        @ti.kernel
+        def task():
+            for i in x:
+                a = 123
+                z[i] = a * x[i] + y[i]
+
+        return ti.benchmark(task, repeat=10)
+
+    return body
+
+
+def reduction(dtype):
+    @ti.test(arch=ti.cpu)
+    def body():
+        a = ti.field(dtype=dtype, shape=N)
+        s = ti.field(dtype=ti.f32, shape=())
+
+        @ti.kernel
+        def task():
+            for i in a:
+                s[None] += a[i]
+
+        return ti.benchmark(task, repeat=10)
+
+    return body
+
+
+benchmark_memset_f16 = memset(ti.f16)
+benchmark_memset_f32 = memset(ti.f32)
+benchmark_saxpy_f16 = saxpy(ti.f16)
+benchmark_saxpy_f32 = saxpy(ti.f32)
+benchmark_reduction_f16 = reduction(ti.f16)
+benchmark_reduction_f32 = reduction(ti.f32)
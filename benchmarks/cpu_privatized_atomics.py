@@ -0,0 +1,63 @@
+import taichi as ti
+
+# Atomics scattered into small dense fields on CPUs, e.g., histograms. With
+# cpu_privatize_atomics=True, each thread accumulates into its own copy of the
+# field, and the copies are combined once per kernel launch instead of
+# contending on the cache lines of the field.
+
+N = 1024**2 * 16
+
+
+def histogram(num_bins, privatize):
+    @ti.test(arch=ti.cpu, cpu_privatize_atomics=privatize)
+    def body():
+        x = ti.field(dtype=ti.i32, shape=N)
+        hist = ti.field(dtype=ti.i32, shape=num_bins)
+
+        @ti.kernel
+        def fill():
+            for i in x:
+                x[i] = (i * 7919) % 100003
+
+        @ti.kernel
+        def count():
+            for i in x:
+                hist[x[i] % num_bins] += 1
+
+        fill()
+        return ti.benchmark(count, repeat=10)
+
+    return body
+
+
+def p2g(n_grid, privatize):
+    @ti.test(arch=ti.cpu, cpu_privatize_atomics=privatize)
+    def body():
+        n_particles = N // 4
+        x = ti.Vector.field(2, dtype=ti.f32, shape=n_particles)
+        grid_m = ti.field(dtype=ti.f32, shape=(n_grid, n_grid))
+
+        @ti.kernel
+        def init():
+            for i in x:
+                x[i] = [ti.random() * 0.8 + 0.1, ti.random() * 0.8 + 0.1]
+
+        @ti.kernel
+        def scatter():
+            for p in x:
+                base = ti.cast(x[p] * n_grid - 0.5, ti.i32)
+                for i, j in ti.static(ti.ndrange(3, 3)):
+                    grid_m[base + ti.Vector([i, j])] += 1.0
+
+        init()
+        return ti.benchmark(scatter, repeat=10)
+
+    return body
+
+
+benchmark_histogram_16_privatized = histogram(16, True)
+benchmark_histogram_16_global_atomics = histogram(16, False)
+benchmark_histogram_4096_privatized = histogram(4096, True)
+benchmark_histogram_4096_global_atomics = histogram(4096, False)
+benchmark_p2g_64_privatized = p2g(64, True)
+benchmark_p2g_64_global_atomics = p2g(64, False)
@@ -0,0 +1,81 @@
+import taichi as ti
+
+# Compares CPU range-fors emitted as one function per block of iterations
+# (cpu_block_range_for=True) against calling the loop body once per iteration.
+
+N = 1024**2 * 64  # 256 MB per f32 buffer
+
+
+def fill(block_range_for):
+    @ti.test(arch=ti.cpu, cpu_block_range_for=block_range_for)
+    def body():
+        a = ti.field(dtype=ti.f32, shape=N)
+
+        @ti.kernel
+        def fill():
+            for i in range(N):
+                a[i] = 2.0
+
+        return ti.benchmark(fill, repeat=20)
+
+    return body
+
+
+def saxpy(block_range_for):
+    @ti.test(arch=ti.cpu, cpu_block_range_for=block_range_for)
+    def body():
+        x = ti.field(dtype=ti.f32, shape=N)
+        y = ti.field(dtype=ti.f32, shape=N)
+
+        @ti.kernel
+        def saxpy(a: ti.f32):
+            for i in range(N):
+                y[i] = a * x[i] + y[i]
+
+        return ti.benchmark(saxpy, repeat=20, args=(2.0, ))
+
+    return body
+
+
+def stencil_1d(block_range_for):
+    @ti.test(arch=ti.cpu, cpu_block_range_for=block_range_for)
+    def body():
+        x = ti.field(dtype=ti.f32, shape=N)
+        y = ti.field(dtype=ti.f32, shape=N)
+
+        @ti.kernel
+        def stencil():
+            for i in range(1, N - 1):
+                y[i] = (x[i - 1] + x[i] + x[i + 1]) * (1.0 / 3)
+
+        return ti.benchmark(stencil, repeat=20)
+
+    return body
+
+
+def stencil_2d(block_range_for):
+    @ti.test(arch=ti.cpu, cpu_block_range_for=block_range_for)
+    def body():
+        M = 1024 * 8
+        x = ti.field(dtype=ti.f32, shape=(M, M))
+        y = ti.field(dtype=ti.f32, shape=(M, M))
+
+        @ti.kernel
+        def stencil():
+            for i, j in ti.ndrange((1, M - 1), (1, M - 1)):
+                y[i, j] = 0.25 * (x[i - 1, j] + x[i + 1, j] + x[i, j - 1] +
+                                  x[i, j + 1])
+
+        return ti.benchmark(stencil, repeat=10)
+
+    return body
+
+
+benchmark_fill_block = fill(True)
+benchmark_fill_per_iteration = fill(False)
+benchmark_saxpy_block = saxpy(True)
+benchmark_saxpy_per_iteration = saxpy(False)
+benchmark_stencil_1d_block = stencil_1d(True)
+benchmark_stencil_1d_per_iteration = stencil_1d(False)
+benchmark_stencil_2d_block = stencil_2d(True)
+benchmark_stencil_2d_per_iteration = stencil_2d(False)
@@ -0,0 +1,64 @@
+import taichi as ti
+
+# Reductions in CPU struct-fors over many small blocks. With thread-local
+# storage (make_thread_local=True), each thread accumulates into its own TLS
+# buffer and flushes it to the global result once, instead of once per block
+# or (without TLS) once per iteration.
+
+N = 1024**2 * 16
+block_size = 4
+
+
+def reduction(make_thread_local):
+    @ti.test(arch=ti.cpu, make_thread_local=make_thread_local)
+    def body():
+        x = ti.field(dtype=ti.f32)
+        ti.root.pointer(ti.i, N // block_size).dense(ti.i,
+                                                      block_size).place(x)
+        s = ti.field(dtype=ti.f32, shape=())
+
+        @ti.kernel
+        def activate():
+            for i in range(N):
+                x[i] = 1
+
+        @ti.kernel
+        def reduce():
+            for i in x:
+                s[None] += x[i]
+
+        activate()
+        return ti.benchmark(reduce, repeat=20)
+
+    return body
+
+
+def max_reduction(make_thread_local):
+    @ti.test(arch=ti.cpu, make_thread_local=make_thread_local)
+    def body():
+        x = ti.field(dtype=ti.i32)
+        ti.root.pointer(ti.i, N // block_size).bitmasked(ti.i,
+                                                          block_size).place(x)
+        m = ti.field(dtype=ti.i32, shape=())
+
+        @ti.kernel
+        def activate():
+            for i in range(N):
+                if i % 3 == 0:
+                    x[i] = i
+
+        @ti.kernel
+        def reduce():
+            for i in x:
+                ti.atomic_max(m[None], x[i])
+
+        activate()
+        return ti.benchmark(reduce, repeat=20)
+
+    return body
+
+
+benchmark_sum_tls = reduction(True)
+benchmark_sum_global_atomics = reduction(False)
+benchmark_max_tls = max_reduction(True)
+benchmark_max_global_atomics = max_reduction(False)
@@ -0,0 +1,51 @@
+import numpy as np
+
+import taichi as ti
+
+# Solves the 5-point Poisson problem on an N x N grid with CG. Every case
+# factorizes and solves a few times with the same pattern, which reuses the
+# workspaces set up by analyze_pattern.
+
+N = 256
+
+
+def cg(preconditioner):
+    @ti.test(arch=ti.cpu)
+    def body():
+        n = N * N
+
+        @ti.kernel
+        def fill(A: ti.sparse_matrix_builder()):
+            for i, j in ti.ndrange(N, N):
+                row = i * N + j
+                A[row, row] += 4.0
+                if i > 0:
+                    A[row, row - N] -= 1.0
+                if i < N - 1:
+                    A[row, row + N] -= 1.0
+                if j > 0:
+                    A[row, row - 1] -= 1.0
+                if j < N - 1:
+                    A[row, row + 1] -= 1.0
+
+        builder = ti.SparseMatrixBuilder(n, n, max_num_triplets=n * 5)
+        fill(builder)
+        A = builder.build()
+        b = np.ones(n, dtype=np.float32)
+        solver = ti.SparseSolver(solver_type="CG",
+                                 preconditioner=preconditioner,
+                                 max_iterations=10000)
+        solver.analyze_pattern(A)
+
+        def solve():
+            solver.factorize(A)
+            solver.solve(b)
+
+        return ti.benchmark(solve, repeat=3)
+
+    return body
+
+
+benchmark_cg = cg("none")
+benchmark_cg_jacobi = cg("jacobi")
+benchmark_cg_ic0 = cg("ic0")
@@ -0,0 +1,46 @@
+import taichi as ti
+
+# Assembly of the 5-point Laplacian on an N x N grid, i.e., N^2 rows and
+# about 5 N^2 triplets, with duplicates since every edge contributes to the
+# diagonals of both its endpoints.
+
+N = 1024
+
+
+def assembly(dtype):
+    @ti.test(arch=ti.cpu)
+    def body():
+        n = N * N
+
+        @ti.kernel
+        def fill(A: ti.sparse_matrix_builder()):
+            for i, j in ti.ndrange(N, N):
+                row = i * N + j
+                if i > 0:
+                    A[row, row - N] -= 1.0
+                    A[row, row] += 1.0
+                if i < N - 1:
+                    A[row, row + N] -= 1.0
+                    A[row, row] += 1.0
+                if j > 0:
+                    A[row, row - 1] -= 1.0
+                    A[row, row] += 1.0
+                if j < N - 1:
+                    A[row, row + 1] -= 1.0
+                    A[row, row] += 1.0
+
+        def assemble():
+            builder = ti.SparseMatrixBuilder(n,
+                                             n,
+                                             max_num_triplets=n * 8,
+                                             dtype=dtype)
+            fill(builder)
+            builder.build()
+
+        return ti.benchmark(assemble, repeat=5)
+
+    return body
+
+
+benchmark_assembly_f32 = assembly(ti.f32)
+benchmark_assembly_f64 = assembly(ti.f64)
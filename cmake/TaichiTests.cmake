@@ -16,6 +16,7 @@ file(GLOB_RECURSE TAICHI_TESTS_SOURCE
         "tests/cpp/common/*.cpp"
         "tests/cpp/ir/*.cpp"
         "tests/cpp/program/*.cpp"
+        "tests/cpp/system/*.cpp"
         "tests/cpp/transforms/*.cpp")
 
 include_directories(
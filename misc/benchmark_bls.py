@@ -6,7 +6,9 @@ sys.path.append('../tests/python/')
 
 from bls_test_template import bls_test_template
 
-ti.init(arch=ti.gpu,
+# Pass e.g. `cpu` to benchmark BLS on another backend.
+arch = getattr(ti, sys.argv[1]) if len(sys.argv) > 1 else ti.gpu
+ti.init(arch=arch,
         print_ir=True,
         kernel_profiler=True,
         demote_dense_struct_fors=False)
@@ -0,0 +1,41 @@
+import taichi as ti
+
+ti.init(arch=ti.cpu, async_mode=True)
+
+n = 1024
+x = ti.field(dtype=ti.f32, shape=n)
+y = ti.field(dtype=ti.f32, shape=n)
+s = ti.field(dtype=ti.f32, shape=())
+
+
+@ti.kernel
+def small():
+    s[None] += 1
+
+
+@ti.kernel
+def stencil():
+    for i in range(1, n - 1):
+        y[i] = (x[i - 1] + x[i] + x[i + 1]) / 3
+
+
+@ti.kernel
+def branchy(k: ti.i32):
+    for i in x:
+        if x[i] > k:
+            x[i] -= k
+        else:
+            t = 0.0
+            for j in range(4):
+                t += ti.sin(x[i] * j)
+            x[i] = t
+        s[None] += x[i]
+
+
+for i in range(10):
+    small()
+    stencil()
+    branchy(i)
+ti.sync()
+
+ti.get_runtime().prog.benchmark_ir_hash()
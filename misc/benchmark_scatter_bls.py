@@ -6,7 +6,9 @@ sys.path.append('../tests/python/')
 
 from bls_test_template import bls_particle_grid
 
-ti.init(arch=ti.cuda, kernel_profiler=True)
+# Pass e.g. `cpu` to benchmark BLS on another backend.
+arch = getattr(ti, sys.argv[1]) if len(sys.argv) > 1 else ti.cuda
+ti.init(arch=arch, kernel_profiler=True)
 bls_particle_grid(N=512,
                   ppc=10,
                   block_size=16,
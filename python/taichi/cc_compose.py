@@ -1,5 +1,4 @@
 import sys
-import warnings
 
 import yaml
 
@@ -98,12 +97,28 @@ class ComposerCC(ComposerBase):
         self.emit('Ti_i32 Ti_earg[8 * 8];')
         self.emit('')
 
+        # There is no thread pool outside of Taichi, so the range-for tasks run
+        # serially on the calling thread, which is thread 0.
+        self.emit('static void Ti_serial_for(void *thread_pool, Ti_i32 splits,')
+        self.emit('                          Ti_i32 num_threads, void *arg,')
+        self.emit('                          void (*func)(void *, Ti_i32, Ti_i32)) {')
+        self.emit('  Ti_i32 i;')
+        self.emit('  for (i = 0; i < splits; i++) {')
+        self.emit('    func(arg, 0, i);')
+        self.emit('  }')
+        self.emit('}')
+        self.emit('')
+        # The erand48() state of thread 0, seeded as with random_seed=0.
+        self.emit('Ti_u16 Ti_rand_states[3] = {0x330e, 0, 0};')
+        self.emit('')
+
         if self.emscripten:
             self.emit('EMSCRIPTEN_KEEPALIVE')
         self.emit_header('extern struct Ti_Context Ti_ctx;')
         self.emit_header('')
         self.emit('struct Ti_Context Ti_ctx = {')
         self.emit('  &Ti_root, Ti_gtmp, Ti_args, Ti_earg,')
+        self.emit('  1, 0, Ti_serial_for, Ti_rand_states,')
         self.emit('};')
         self.emit('')
 
@@ -111,11 +126,15 @@ class ComposerCC(ComposerBase):
         name = e['kernel_name']
         source = e['kernel_source']
 
+        # The source starts with the static functions of the range-for tasks,
+        # so look for the entry point of the kernel itself.
+        entry = source.index(f'void Tk_{name}(')
+        self.emit(source[:entry])
         if self.emscripten:
             self.emit('EMSCRIPTEN_KEEPALIVE')
-        self.emit(source)
+        self.emit(source[entry:])
         self.emit('')
-        declaration = source.split('{', 1)[0].strip()
+        declaration = source[entry:].split('{', 1)[0].strip()
         self.emit_header(f'extern {declaration};')
 
     def do_config(self, e):
@@ -137,8 +156,7 @@ class ComposerCC(ComposerBase):
 
 def main(fin_name, fout_name, hdrout_name, emscripten=False):
     with open(fin_name, 'r') as fin:
-        warnings.filterwarnings('ignore')
-        obj = yaml.load(fin)
+        obj = yaml.safe_load(fin)
 
     with open(hdrout_name, 'w') as hdrout:
         with open(fout_name, 'w') as fout:
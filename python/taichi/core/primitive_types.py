@@ -2,12 +2,14 @@ from taichi.core.util import ti_core as _ti_core
 
 # Real types
 
+float16 = _ti_core.DataType_f16
+f16 = float16
 float32 = _ti_core.DataType_f32
 f32 = float32
 float64 = _ti_core.DataType_f64
 f64 = float64
 
-real_types = [f32, f64, float]
+real_types = [f16, f32, f64, float]
 real_type_ids = [id(t) for t in real_types]
 
 # Integer types
@@ -37,6 +39,8 @@ types = real_types + integer_types
 type_ids = [id(t) for t in types]
 
 __all__ = [
+    'float16',
+    'f16',
     'float32',
     'f32',
     'float64',
@@ -11,7 +11,9 @@ from taichi.lang.impl import *
 from taichi.lang.kernel_arguments import (any_arr, ext_arr,
                                           sparse_matrix_builder, template)
 from taichi.lang.kernel_impl import (KernelArgError, KernelDefError,
-                                     data_oriented, func, kernel, pyfunc)
+                                     compile_kernels, data_oriented, func,
+                                     kernel, pyfunc)
+from taichi.lang.launch_graph import LaunchGraph
 from taichi.lang.matrix import Matrix, Vector
 from taichi.lang.ndrange import GroupedNDRange, ndrange
 from taichi.lang.ops import *
@@ -74,6 +76,26 @@ timeline_save = lambda fn: impl.get_runtime().prog.timeline_save(fn)
 type_factory_ = _ti_core.get_type_factory_instance()
 
 
+def compile_profile_clear():
+    """Clears the compile-time profile of the kernels compiled so far."""
+    impl.get_runtime().prog.compile_profile_clear()
+
+
+def compile_profile_save(filename):
+    """Saves the compile-time profile of the kernels as JSON.
+
+    To enable this profiler, set `compile_profiler=True` in `ti.init`. For each
+    kernel, the report lists the time spent in every IR pass, along with the
+    number of statements before and after it, and in the LLVM phases. If
+    `timeline=True` is also set, these events are included in the Chrome trace
+    saved by :func:`timeline_save`.
+
+    Args:
+        filename (str): The path of the JSON file.
+    """
+    impl.get_runtime().prog.compile_profile_save(filename)
+
+
 @deprecated('kernel_profiler_print()', 'print_kernel_profile_info()')
 def kernel_profiler_print():
     return print_kernel_profile_info()
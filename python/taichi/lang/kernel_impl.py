@@ -735,6 +735,40 @@ class _BoundedDifferentiableMethod:
         return self._adjoint(self._kernel_owner, *args, **kwargs)
 
 
+def compile_kernels(*kernels):
+    """Compiles Taichi kernels ahead of their first launches.
+
+    On LLVM backends, the kernels are compiled concurrently on
+    ``num_compile_threads`` threads (see :func:`~taichi.lang.init`), so that a
+    program can warm up at startup instead of stalling on compilation in the
+    middle of a run.
+
+    Args:
+        *kernels: Taichi kernels. A kernel taking arguments must be given as a
+            tuple ``(kernel, *args)``, where ``args`` are the arguments it will
+            be launched with, since they determine the instantiation of the
+            kernel.
+
+    Example::
+
+        >>> ti.compile_kernels(init, (substep, 1e-3), render)
+    """
+    cpp_kernels = []
+    for kernel in kernels:
+        args = ()
+        if isinstance(kernel, tuple):
+            kernel, *args = kernel
+        if isinstance(kernel, _BoundedDifferentiableMethod):
+            args = (kernel._kernel_owner, *args)
+        primal = kernel._primal
+        num_instances = len(primal.compiled_functions)
+        primal.ensure_compiled(*args)
+        # Instances materialized earlier have been launched and compiled.
+        if len(primal.compiled_functions) > num_instances:
+            cpp_kernels.append(primal.kernel_cpp)
+    impl.get_runtime().prog.compile_kernels(cpp_kernels)
+
+
 def data_oriented(cls):
     """Marks a class as Taichi compatible.
 
@@ -0,0 +1,56 @@
+from contextlib import contextmanager
+
+from taichi.core.util import ti_core as _ti_core
+from taichi.lang import impl
+
+
+class LaunchGraph:
+    """A sequence of kernel launches captured once and replayed from C++.
+
+    Replaying a captured graph skips the Python overhead of each kernel call,
+    which dominates when a time step launches many small kernels. The kernels
+    still run while being captured. Kernels taking external arrays or
+    returning values cannot be captured.
+
+    Example::
+
+        >>> graph = ti.LaunchGraph()
+        >>> with graph.capture():
+        >>>     substep(0.1)
+        >>>     update()
+        >>> for i in range(100):
+        >>>     graph.set_arg(0, 0, 0.1 * i)  # The argument of substep
+        >>>     graph.replay()
+    """
+    def __init__(self):
+        impl.get_runtime().materialize()
+        self.graph = _ti_core.LaunchGraph(impl.get_runtime().prog)
+
+    @contextmanager
+    def capture(self):
+        """Records the kernels launched in the `with` block."""
+        self.graph.begin_capture()
+        try:
+            yield self
+        finally:
+            self.graph.end_capture()
+
+    def replay(self):
+        """Launches the captured kernels again, in the captured order."""
+        self.graph.run()
+
+    def set_arg(self, launch_id, arg_id, value):
+        """Changes a scalar argument of a captured launch.
+
+        Args:
+            launch_id (int): The index of the launch in the graph.
+            arg_id (int): The index of the argument of the kernel.
+            value (Union[int, float]): The new value of the argument.
+        """
+        if isinstance(value, int):
+            self.graph.set_arg_int(launch_id, arg_id, value)
+        else:
+            self.graph.set_arg_float(launch_id, arg_id, float(value))
+
+    def __len__(self):
+        return self.graph.num_launches()
@@ -58,13 +58,31 @@ class SNode:
             self.ptr.pointer(axes, dimensions,
                              impl.current_cfg().packed))
 
-    def hash(self, axes, dimensions):
-        """Not supported."""
-        raise RuntimeError('hash not yet supported')
+    def hash(self, axes, dimensions, capacity=None):
+        """Adds a hash SNode as a child component of `self`.
+
+        Only the active cells are stored, in a hash table, so `dimensions` can
+        be much larger than with a pointer SNode. Only supported on CPUs.
+
+        Args:
+            axes (List[Axis]): Axes to activate.
+            dimensions (Union[List[int], int]): Shape of each axis.
+            capacity (int, optional): Maximum number of cells active at the
+                same time in each container. Deactivated cells free their
+                slots. Defaults to the number of cells, capped at 65536. The
+                writes to cells that do not fit are dropped, which is reported
+                as a warning, or as an error in debug mode.
+
+        Returns:
+            The added :class:`~taichi.lang.SNode` instance.
+        """
         if isinstance(dimensions, int):
             dimensions = [dimensions] * len(axes)
-        return SNode(self.ptr.hash(axes, dimensions,
-                                   impl.current_cfg().packed))
+        if capacity is None:
+            capacity = 0
+        return SNode(
+            self.ptr.hash(axes, dimensions, capacity,
+                          impl.current_cfg().packed))
 
     def dynamic(self, axis, dimension, chunk_size=None):
         """Adds a dynamic SNode as a child component of `self`.
@@ -311,7 +329,8 @@ class SNode:
             c.deactivate_all()
         SNodeType = _ti_core.SNodeType
         from taichi.lang import meta
-        if self.ptr.type == SNodeType.pointer or self.ptr.type == SNodeType.bitmasked:
+        if self.ptr.type in (SNodeType.pointer, SNodeType.bitmasked,
+                             SNodeType.hash):
             meta.snode_deactivate(self)
         if self.ptr.type == SNodeType.dynamic:
             # Note that dynamic nodes are different from other sparse nodes:
@@ -1,10 +1,15 @@
+from taichi.core.primitive_types import f32
+
+
 class SparseMatrix:
-    def __init__(self, n=None, m=None, sm=None):
+    def __init__(self, n=None, m=None, sm=None, dtype=f32):
         if sm is None:
             self.n = n
             self.m = m if m else n
             from taichi.core.util import ti_core as _ti_core
-            self.matrix = _ti_core.create_sparse_matrix(n, m)
+            from taichi.lang.util import cook_dtype
+            self.matrix = _ti_core.create_sparse_matrix(
+                n, self.m, cook_dtype(dtype))
         else:
             self.n = sm.num_rows()
             self.m = sm.num_cols()
@@ -56,6 +61,14 @@ class SparseMatrix:
         else:
             assert False, f"Sparse matrix-matrix/vector multiplication does not support {type(other)} for now. Supported types are SparseMatrix, ti.field, and numpy.ndarray."
 
+    def pattern_fingerprint(self):
+        """A hash of the shape and the positions of the stored entries.
+
+        Solvers skip the symbolic analysis of a matrix whose fingerprint
+        matches the one analyzed last.
+        """
+        return self.matrix.pattern_fingerprint()
+
     def __getitem__(self, indices):
         return self.matrix.get_element(indices[0], indices[1])
 
@@ -67,13 +80,18 @@ class SparseMatrix:
 
 
 class SparseMatrixBuilder:
-    def __init__(self, num_rows=None, num_cols=None, max_num_triplets=0):
+    def __init__(self,
+                 num_rows=None,
+                 num_cols=None,
+                 max_num_triplets=0,
+                 dtype=f32):
         self.num_rows = num_rows
         self.num_cols = num_cols if num_cols else num_rows
         if num_rows is not None:
             from taichi.core.util import ti_core as _ti_core
+            from taichi.lang.util import cook_dtype
             self.ptr = _ti_core.create_sparse_matrix_builder(
-                num_rows, num_cols, max_num_triplets)
+                num_rows, self.num_cols, max_num_triplets, cook_dtype(dtype))
 
     def get_addr(self):
         return self.ptr.get_addr()
@@ -84,3 +102,18 @@ class SparseMatrixBuilder:
     def build(self):
         sm = self.ptr.build()
         return SparseMatrix(sm=sm)
+
+    def refill(self, sparse_matrix):
+        """Writes the triplets into the values of a matrix built before.
+
+        The structure of `sparse_matrix` is kept, so every triplet must be
+        at one of its stored entries. This is cheaper than build(), and keeps
+        the pattern fingerprint so that solvers skip the symbolic analysis.
+        """
+        assert isinstance(sparse_matrix, SparseMatrix), f"Cannot refill {type(sparse_matrix)}."
+        self.ptr.refill(sparse_matrix.matrix)
+        return sparse_matrix
+
+    def reset(self):
+        """Discards the triplets so that kernels can fill the builder again."""
+        self.ptr.reset()
@@ -1,15 +1,48 @@
+from taichi.core.primitive_types import f32
 from taichi.lang.sparse_matrix import SparseMatrix
 
 
 class SparseSolver:
-    def __init__(self, solver_type="LLT"):
-        solver_type_list = ["LLT", "LDLT", "LU"]
+    """Linear solver of sparse matrices.
+
+    The direct solvers ("LLT", "LDLT" and "LU") factorize the matrix. The
+    iterative solvers ("CG" for symmetric positive definite matrices and
+    "BICGSTAB" for general ones) take the following extra options:
+
+    Args:
+        preconditioner (str): "none", "jacobi" or "ic0" (CG only).
+        max_iterations (int): Maximum number of iterations of a solve.
+        tolerance (float): Stop when |b - Ax| <= tolerance * |b|.
+        warm_start (bool): Start each solve from the previous solution.
+    """
+    def __init__(self,
+                 solver_type="LLT",
+                 dtype=f32,
+                 preconditioner="none",
+                 max_iterations=None,
+                 tolerance=None,
+                 warm_start=False):
+        direct_solver_types = ["LLT", "LDLT", "LU"]
+        iterative_solver_types = ["CG", "BICGSTAB"]
+        solver_type_list = direct_solver_types + iterative_solver_types
+        self.is_iterative = solver_type in iterative_solver_types
         if solver_type in solver_type_list:
             from taichi.core.util import ti_core as _ti_core
+            from taichi.lang.util import cook_dtype
             from taichi.lang.impl import get_runtime
             taichi_arch = get_runtime().prog.config.arch
             assert taichi_arch == _ti_core.Arch.x64 or taichi_arch == _ti_core.Arch.arm64, "SparseSolver only supports CPU for now."
-            self.solver = _ti_core.get_sparse_solver(solver_type)
+            self.solver = _ti_core.get_sparse_solver(solver_type,
+                                                     cook_dtype(dtype))
+            if self.is_iterative:
+                self.solver.set_preconditioner(preconditioner)
+                if max_iterations is not None:
+                    self.solver.set_max_iterations(max_iterations)
+                if tolerance is not None:
+                    self.solver.set_tolerance(tolerance)
+                self.solver.set_warm_start(warm_start)
+            else:
+                assert preconditioner == "none" and max_iterations is None and tolerance is None and not warm_start, f"Iterative solver options are not supported by {solver_type}."
         else:
             assert False, f"The solver type {solver_type} is not support for now. Only {solver_type_list} are supported."
 
@@ -47,3 +80,17 @@ class SparseSolver:
 
     def info(self):
         return self.solver.info()
+
+    def num_pattern_analyses(self):
+        """Number of times the symbolic analysis actually ran."""
+        return self.solver.get_num_pattern_analyses()
+
+    def num_iterations(self):
+        """Number of iterations of the last solve of an iterative solver."""
+        assert self.is_iterative, "Only iterative solvers have iterations."
+        return self.solver.get_num_iterations()
+
+    def relative_residual(self):
+        """|b - Ax| / |b| after the last solve of an iterative solver."""
+        assert self.is_iterative, "Only iterative solvers have residuals."
+        return self.solver.get_relative_residual()
@@ -52,6 +52,8 @@ def to_numpy_type(dt):
         return np.float32
     elif dt == ti.f64:
         return np.float64
+    elif dt == ti.f16:
+        return np.float16
     elif dt == ti.i32:
         return np.int32
     elif dt == ti.i64:
@@ -86,6 +88,8 @@ def to_pytorch_type(dt):
         return torch.float32
     elif dt == ti.f64:
         return torch.float64
+    elif dt == ti.f16:
+        return torch.float16
     elif dt == ti.i32:
         return torch.int32
     elif dt == ti.i64:
@@ -123,6 +127,8 @@ def to_taichi_type(dt):
         return ti.f32
     elif dt == np.float64:
         return ti.f64
+    elif dt == np.float16:
+        return ti.f16
     elif dt == np.int32:
         return ti.i32
     elif dt == np.int64:
@@ -145,6 +151,8 @@ def to_taichi_type(dt):
             return ti.f32
         elif dt == torch.float64:
             return ti.f64
+        elif dt == torch.float16:
+            return ti.f16
         elif dt == torch.int32:
             return ti.i32
         elif dt == torch.int64:
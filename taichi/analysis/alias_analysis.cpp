@@ -63,6 +63,20 @@ AliasResult alias_analysis(Stmt *var1, Stmt *var2) {
                : AliasResult::different;
   }
 
+  // Elements of per-thread copies of fields. See make_thread_local.
+  auto is_thread_local_element = [](Stmt *var) {
+    return var->is<PtrOffsetStmt>() &&
+           var->as<PtrOffsetStmt>()->is_thread_local_ptr();
+  };
+  if (is_thread_local_element(var1) || is_thread_local_element(var2)) {
+    auto is_thread_local = [&](Stmt *var) {
+      return var->is<ThreadLocalPtrStmt>() || is_thread_local_element(var);
+    };
+    if (!is_thread_local(var1) || !is_thread_local(var2))
+      return AliasResult::different;
+    return AliasResult::uncertain;
+  }
+
   if (var1->is<ThreadLocalPtrStmt>() || var2->is<ThreadLocalPtrStmt>()) {
     if (!var1->is<ThreadLocalPtrStmt>() || !var2->is<ThreadLocalPtrStmt>())
       return AliasResult::different;
@@ -238,6 +238,9 @@ gather_uniquely_accessed_pointers(IRNode *root) {
 void gather_uniquely_accessed_bit_structs(IRNode *root, AnalysisManager *amgr) {
   amgr->put_pass_result<GatherUniquelyAccessedBitStructsPass>(
       {UniquelyAccessedBitStructGatherer::run(root)});
+  // The result is keyed by offloaded tasks, and is used by
+  // optimize_bit_struct_stores after the tasks are lowered.
+  amgr->preserve<GatherUniquelyAccessedBitStructsPass>();
 }
 }  // namespace irpass::analysis
 
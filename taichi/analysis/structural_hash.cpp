@@ -0,0 +1,161 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/visitors.h"
+
+#include <typeinfo>
+#include <unordered_map>
+
+TLANG_NAMESPACE_BEGIN
+
+// Hashes the structure of an IRNode without printing it.
+//
+// A statement is hashed by its class, its registered fields, its return type
+// and its operands. An operand inside the root is encoded by its relative
+// position to the user, i.e., (how many blocks up, index in that block), so
+// that the result does not depend on statement ids. Operands outside the root
+// are identified by their ids, as in same_statements().
+//
+// The hash of a Block does not depend on where the Block is, so it can be
+// cached across calls when the IR is not modified in between.
+class StructuralHasher : public IRVisitor {
+ public:
+  using BlockHashCache = std::unordered_map<const Block *, uint64>;
+
+ private:
+  // Maps a statement to (depth of its block, index in its block).
+  std::unordered_map<const Stmt *, std::pair<int, int>> position_;
+  int depth_{0};
+  uint64 result_{0};
+  BlockHashCache *block_hash_cache_;
+
+  explicit StructuralHasher(BlockHashCache *block_hash_cache)
+      : block_hash_cache_(block_hash_cache) {
+    allow_undefined_visitor = true;
+    invoke_default_visitor = true;
+  }
+
+  static uint64 combine(uint64 seed, uint64 value) {
+    return seed * 100000007UL + value;
+  }
+
+  uint64 hash_operand(const Stmt *operand) const {
+    if (operand == nullptr) {
+      return 1;
+    }
+    auto it = position_.find(operand);
+    if (it == position_.end()) {
+      return combine(2, (uint64)operand->id);
+    }
+    return combine(combine(3, (uint64)(depth_ - it->second.first)),
+                   (uint64)it->second.second);
+  }
+
+  uint64 hash_block(Block *block) {
+    if (block == nullptr) {
+      return 0;
+    }
+    block->accept(this);
+    return result_;
+  }
+
+  uint64 basic_hash(Stmt *stmt) const {
+    uint64 ret = typeid(*stmt).hash_code();
+    ret = combine(ret, stmt->field_manager.hash());
+    ret = combine(ret, std::hash<const Type *>{}(stmt->ret_type));
+    ret = combine(ret, stmt->num_operands());
+    for (int i = 0; i < stmt->num_operands(); i++) {
+      ret = combine(ret, hash_operand(stmt->operand(i)));
+    }
+    return ret;
+  }
+
+ public:
+  void visit(Block *block) override {
+    if (block_hash_cache_) {
+      auto it = block_hash_cache_->find(block);
+      if (it != block_hash_cache_->end()) {
+        result_ = it->second;
+        return;
+      }
+    }
+    depth_++;
+    uint64 ret = block->size();
+    for (int i = 0; i < (int)block->size(); i++) {
+      auto stmt = block->statements[i].get();
+      position_[stmt] = std::make_pair(depth_, i);
+      stmt->accept(this);
+      ret = combine(ret, result_);
+    }
+    depth_--;
+    if (block_hash_cache_) {
+      (*block_hash_cache_)[block] = ret;
+    }
+    result_ = ret;
+  }
+
+  void visit(Stmt *stmt) override {
+    result_ = basic_hash(stmt);
+  }
+
+  void visit(IfStmt *if_stmt) override {
+    auto ret = basic_hash(if_stmt);
+    ret = combine(ret, hash_block(if_stmt->true_statements.get()));
+    ret = combine(ret, hash_block(if_stmt->false_statements.get()));
+    result_ = ret;
+  }
+
+  void visit(WhileStmt *stmt) override {
+    result_ = combine(basic_hash(stmt), hash_block(stmt->body.get()));
+  }
+
+  void visit(RangeForStmt *stmt) override {
+    result_ = combine(basic_hash(stmt), hash_block(stmt->body.get()));
+  }
+
+  void visit(StructForStmt *stmt) override {
+    result_ = combine(basic_hash(stmt), hash_block(stmt->body.get()));
+  }
+
+  void visit(FuncBodyStmt *stmt) override {
+    result_ = combine(basic_hash(stmt), hash_block(stmt->body.get()));
+  }
+
+  void visit(OffloadedStmt *stmt) override {
+    auto ret = basic_hash(stmt);
+    ret = combine(ret, stmt->tls_size);
+    ret = combine(ret, stmt->bls_size);
+    for (const auto &reduction : stmt->tls_reductions) {
+      ret = combine(ret, reduction.offset);
+      ret = combine(ret, reduction.num_elements);
+      ret = combine(ret, std::hash<const Type *>{}(reduction.dt));
+      ret = combine(ret, (uint64)reduction.op);
+    }
+    ret = combine(ret, hash_block(stmt->tls_prologue.get()));
+    ret = combine(ret, hash_block(stmt->bls_prologue.get()));
+    ret = combine(ret, hash_block(stmt->body.get()));
+    ret = combine(ret, hash_block(stmt->bls_epilogue.get()));
+    ret = combine(ret, hash_block(stmt->tls_epilogue.get()));
+    result_ = ret;
+  }
+
+  static uint64 run(IRNode *root, BlockHashCache *block_hash_cache) {
+    StructuralHasher hasher(block_hash_cache);
+    if (auto stmt = dynamic_cast<Stmt *>(root)) {
+      hasher.position_[stmt] = std::make_pair(0, 0);
+    }
+    root->accept(&hasher);
+    return hasher.result_;
+  }
+};
+
+namespace irpass::analysis {
+uint64 structural_hash(
+    IRNode *root,
+    std::unordered_map<const Block *, uint64> *block_hash_cache) {
+  TI_ASSERT(root);
+  return StructuralHasher::run(root, block_hash_cache);
+}
+}  // namespace irpass::analysis
+
+TLANG_NAMESPACE_END
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "taichi/lang_util.h"
+#include "taichi/system/dynamic_loader.h"
+#include <memory>
 #include <set>
 
 TLANG_NAMESPACE_BEGIN
@@ -10,6 +12,7 @@ class Kernel;
 namespace cccp {
 
 class CCProgram;
+struct CCContext;
 
 class CCKernel {
  public:
@@ -20,6 +23,8 @@ class CCKernel {
       : program(program), kernel(kernel), name(name), source(source) {
   }
 
+  // Builds a shared object of its own for the kernel, so that adding a kernel
+  // never relinks the others.
   void compile();
   void launch(Context *ctx);
   std::string get_object() {
@@ -33,8 +38,10 @@ class CCKernel {
   std::string name;
   std::string source;
 
-  std::string src_path;
   std::string obj_path;
+  std::string dll_path;
+  std::unique_ptr<DynamicLoader> dll;
+  void (*entry)(CCContext *){nullptr};
 };
 
 }  // namespace cccp
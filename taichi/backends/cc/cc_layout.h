@@ -23,7 +23,6 @@ class CCLayout {
  private:
   CCProgram *program;
 
-  std::string src_path;
   std::string obj_path;
 };
 
@@ -2,7 +2,9 @@
 #include "taichi/program/kernel.h"
 #include "taichi/program/program.h"
 #include "taichi/system/dynamic_loader.h"
+#include "taichi/system/std_filesystem.h"
 #include "taichi/util/action_recorder.h"
+#include "taichi/util/str.h"
 #include "struct_cc.h"
 #include "cc_program.h"
 #include "cc_runtime.h"
@@ -13,6 +15,47 @@
 
 TLANG_NAMESPACE_BEGIN
 namespace cccp {
+namespace {
+
+std::string get_cache_dir(const CompileConfig &config) {
+  if (!config.offline_cache) {
+    return runtime_tmp_dir;
+  }
+  auto path = config.offline_cache_file_path;
+  if (path.empty()) {
+    path = (stdfs::path(get_repo_dir()) / "ticache").string();
+  }
+  return (stdfs::path(path) / "cc").string();
+}
+
+bool is_cached(const std::string &path) {
+  std::error_code ec;
+  if (stdfs::exists(path, ec)) {
+    // Mark the file as recently used, see CCProgram::evict_cache().
+    stdfs::last_write_time(path, stdfs::file_time_type::clock::now(), ec);
+    TI_TRACE("[cc] cache hit: {}", path);
+    return true;
+  }
+  return false;
+}
+
+// Runs |cmd| to build |output| from |inputs|. The output is written to a
+// temporary file first, so that other processes sharing the cache never see
+// a partially written one.
+void build_cached(const std::string &cmd,
+                  const std::string &output,
+                  const std::string &inputs) {
+  const auto tmp_path = fmt::format("{}.{}.tmp", output, PID::get_pid());
+  const int ret = execute(cmd, tmp_path, inputs);
+  TI_ERROR_IF(ret != 0, "[cc] failed to build {}, exit status {}", output,
+              ret);
+  std::error_code ec;
+  stdfs::rename(tmp_path, output, ec);
+  TI_ERROR_IF(ec, "[cc] failed to move {} to {}: {}", tmp_path, output,
+              ec.message());
+}
+
+}  // namespace
 
 void CCKernel::compile() {
   if (!kernel->is_evaluator)
@@ -22,14 +65,20 @@ void CCKernel::compile() {
                               ActionArg("kernel_source", source),
                           });
 
-  obj_path = fmt::format("{}/{}.o", runtime_tmp_dir, name);
-  src_path = fmt::format("{}/{}.c", runtime_tmp_dir, name);
+  TI_DEBUG("[cc] compiling [{}]:\n{}\n", name, source);
+  obj_path = program->compile_object(
+      name, program->get_runtime()->header + "\n" +
+                program->get_layout()->source + "\n" + source);
+  dll_path = program->link_shared_object(
+      name, {program->get_runtime()->get_object(), obj_path});
 
-  std::ofstream(src_path) << program->get_runtime()->header << "\n"
-                          << program->get_layout()->source << "\n"
-                          << source;
-  TI_DEBUG("[cc] compiling [{}] -> [{}]:\n{}\n", name, obj_path, source);
-  execute(program->program->config.cc_compile_cmd, obj_path, src_path);
+  TI_DEBUG("[cc] loading shared object: {}", dll_path);
+  dll = std::make_unique<DynamicLoader>(dll_path);
+  TI_ASSERT_INFO(dll->loaded(), "[cc] could not load shared object: {}",
+                 dll_path);
+  entry = reinterpret_cast<CCFuncEntryType *>(
+      dll->load_function("Tk_" + name));
+  TI_ASSERT(entry);
 }
 
 void CCKernel::launch(Context *ctx) {
@@ -39,10 +88,7 @@ void CCKernel::launch(Context *ctx) {
                                               ActionArg("kernel_name", name),
                                           });
 
-  program->relink();
   TI_TRACE("[cc] entering kernel [{}]", name);
-  auto entry = program->load_kernel(name);
-  TI_ASSERT(entry);
   auto *context = program->update_context(ctx);
   (*entry)(context);
   program->context_to_result_buffer();
@@ -55,21 +101,13 @@ size_t CCLayout::compile() {
                                             ActionArg("layout_source", source),
                                         });
 
-  obj_path = fmt::format("{}/_rti_root.o", runtime_tmp_dir);
-  src_path = fmt::format("{}/_rti_root.c", runtime_tmp_dir);
-  auto dll_path = fmt::format("{}/libti_roottest.so", runtime_tmp_dir);
-
-  std::ofstream(src_path) << program->get_runtime()->header << "\n"
-                          << source << "\n"
-                          << "void *Ti_get_root_size(void) { \n"
-                          << "  return (void *) sizeof(struct Ti_S0root);\n"
-                          << "}\n";
-
-  TI_DEBUG("[cc] compiling root struct -> [{}]:\n{}\n", obj_path, source);
-  execute(program->program->config.cc_compile_cmd, obj_path, src_path);
-
-  TI_DEBUG("[cc] linking root struct object [{}] -> [{}]", obj_path, dll_path);
-  execute(program->program->config.cc_link_cmd, dll_path, obj_path);
+  TI_DEBUG("[cc] compiling root struct:\n{}\n", source);
+  obj_path = program->compile_object(
+      "_rti_root", program->get_runtime()->header + "\n" + source + "\n" +
+                       "void *Ti_get_root_size(void) { \n"
+                       "  return (void *) sizeof(struct Ti_S0root);\n"
+                       "}\n");
+  auto dll_path = program->link_shared_object("_rti_root", {obj_path});
 
   TI_DEBUG("[cc] loading root struct object: {}", dll_path);
   DynamicLoader dll(dll_path);
@@ -90,37 +128,95 @@ void CCRuntime::compile() {
                                             ActionArg("runtime_source", source),
                                         });
 
-  obj_path = fmt::format("{}/_rti_runtime.o", runtime_tmp_dir);
-  src_path = fmt::format("{}/_rti_runtime.c", runtime_tmp_dir);
-
-  std::ofstream(src_path) << header << "\n" << source;
-  TI_DEBUG("[cc] compiling runtime -> [{}]:\n{}\n", obj_path, source);
-  execute(program->program->config.cc_compile_cmd, obj_path, src_path);
+  TI_DEBUG("[cc] compiling runtime:\n{}\n", source);
+  obj_path = program->compile_object("_rti_runtime", header + "\n" + source);
 }
 
-void CCProgram::relink() {
-  if (!need_relink)
-    return;
-
-  dll_path = fmt::format("{}/libti_program.so", runtime_tmp_dir);
-
-  std::vector<std::string> objects;
-  objects.push_back(runtime->get_object());
-  for (auto const &ker : kernels) {
-    objects.push_back(ker->get_object());
+std::string CCProgram::compile_object(std::string const &name,
+                                      std::string const &source) {
+  const auto &cmd = program->config.cc_compile_cmd;
+  const auto key = content_digest(cmd + "\n" + source);
+  const auto obj_path = fmt::format("{}/{}_{}.o", cache_dir, name, key);
+  if (!is_cached(obj_path)) {
+    const auto src_path = fmt::format("{}/{}.c", runtime_tmp_dir, name);
+    std::ofstream(src_path) << source;
+    TI_DEBUG("[cc] compiling [{}] -> [{}]", src_path, obj_path);
+    build_cached(cmd, obj_path, src_path);
+    evict_cache(obj_path);
   }
+  return obj_path;
+}
 
-  TI_DEBUG("[cc] linking shared object [{}] with [{}]", dll_path,
-           fmt::join(objects, "] ["));
-  execute(program->config.cc_link_cmd, dll_path, fmt::join(objects, "' '"));
-
-  dll = nullptr;
-  TI_DEBUG("[cc] loading shared object: {}", dll_path);
-  dll = std::make_unique<DynamicLoader>(dll_path);
-  TI_ASSERT_INFO(dll->loaded(), "[cc] could not load shared object: {}",
-                 dll_path);
+std::string CCProgram::link_shared_object(
+    std::string const &name,
+    std::vector<std::string> const &objects) {
+  const auto &cmd = program->config.cc_link_cmd;
+  // The paths of the objects contain the digests of their contents.
+  const auto key =
+      content_digest(fmt::format("{}\n{}", cmd, fmt::join(objects, "\n")));
+  const auto dll_path = fmt::format("{}/lib{}_{}.so", cache_dir, name, key);
+  if (!is_cached(dll_path)) {
+    TI_DEBUG("[cc] linking shared object [{}] with [{}]", dll_path,
+             fmt::join(objects, "] ["));
+    build_cached(cmd, dll_path,
+                 fmt::format("{}", fmt::join(objects, "' '")));
+    evict_cache(dll_path);
+  }
+  return dll_path;
+}
 
-  need_relink = false;
+void CCProgram::evict_cache(std::string const &output) {
+  if (!program->config.offline_cache) {
+    return;
+  }
+  const auto max_size_bytes =
+      std::size_t(program->config.offline_cache_max_size_GB * (1UL << 30));
+  struct CachedFile {
+    stdfs::path path;
+    std::size_t size;
+    stdfs::file_time_type last_used;
+  };
+  std::vector<CachedFile> files;
+  std::size_t total_size = 0;
+  std::error_code ec;
+  for (auto it = stdfs::directory_iterator(cache_dir, ec);
+       !ec && it != stdfs::directory_iterator(); it.increment(ec)) {
+    const auto ext = it->path().extension();
+    if (ext != ".o" && ext != ".so")
+      continue;
+    std::error_code file_ec;
+    CachedFile file;
+    file.path = it->path();
+    file.size = (std::size_t)stdfs::file_size(file.path, file_ec);
+    file.last_used = stdfs::last_write_time(file.path, file_ec);
+    if (file_ec)
+      continue;
+    total_size += file.size;
+    files.push_back(std::move(file));
+  }
+  if (total_size <= max_size_bytes)
+    return;
+  std::sort(files.begin(), files.end(),
+            [](const CachedFile &a, const CachedFile &b) {
+              return a.last_used < b.last_used;
+            });
+  // |output| is about to be linked or loaded, and the runtime object is
+  // linked into every kernel of this program.
+  const stdfs::path keep[] = {
+      output, runtime ? runtime->get_object() : std::string()};
+  for (const auto &file : files) {
+    if (total_size <= max_size_bytes)
+      break;
+    if (std::find(std::begin(keep), std::end(keep), file.path) !=
+        std::end(keep))
+      continue;
+    // Another process may have removed the file already.
+    std::error_code file_ec;
+    if (stdfs::remove(file.path, file_ec)) {
+      TI_TRACE("[cc] evicted {}", file.path.string());
+    }
+    total_size -= file.size;
+  }
 }
 
 void CCProgram::compile_layout(SNode *root) {
@@ -150,7 +246,6 @@ void CCProgram::compile_layout(SNode *root) {
 
 void CCProgram::add_kernel(std::unique_ptr<CCKernel> kernel) {
   kernels.push_back(std::move(kernel));
-  need_relink = true;
 }
 
 void CCProgram::init_runtime() {
@@ -162,14 +257,36 @@ void CCProgram::init_runtime() {
   runtime->compile();
 }
 
-CCFuncEntryType *CCProgram::load_kernel(std::string const &name) {
-  return reinterpret_cast<CCFuncEntryType *>(dll->load_function("Tk_" + name));
-}
-
 CCProgram::CCProgram(Program *program) : program(program) {
+  cache_dir = get_cache_dir(program->config);
+  std::error_code ec;
+  stdfs::create_directories(cache_dir, ec);
+  if (ec) {
+    TI_WARN("[cc] failed to create the cache directory {}: {}", cache_dir,
+            ec.message());
+  }
   init_runtime();
 
+  const int num_threads = program->config.cpu_max_num_threads;
+  thread_pool = std::make_unique<ThreadPool>(num_threads);
+  rand_states.resize(3 * num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    // The same seeding as the random states of the LLVM runtime, laid out
+    // like srand48() does.
+    const uint32 seed = uint32(program->config.random_seed) * 1048576u + i;
+    rand_states[3 * i] = 0x330e;
+    rand_states[3 * i + 1] = uint16(seed);
+    rand_states[3 * i + 2] = uint16(seed >> 16);
+  }
+
   context = std::make_unique<CCContext>();
+  context->num_threads = num_threads;
+  context->thread_pool = thread_pool.get();
+  context->parallel_for = [](void *thread_pool, int splits, int num_threads,
+                             void *arg, RangeForTaskFunc *func) {
+    ((ThreadPool *)thread_pool)->run(splits, num_threads, arg, func);
+  };
+  context->rand_states = rand_states.data();
 }
 
 CCContext *CCProgram::update_context(Context *ctx) {
@@ -1,13 +1,10 @@
 #pragma once
 
 #include "taichi/lang_util.h"
+#include "taichi/system/threading.h"
 #include <vector>
 #include <memory>
 
-TI_NAMESPACE_BEGIN
-class DynamicLoader;
-TI_NAMESPACE_END
-
 TLANG_NAMESPACE_BEGIN
 
 class SNode;
@@ -29,10 +26,19 @@ class CCProgram {
   ~CCProgram();
 
   void add_kernel(std::unique_ptr<CCKernel> kernel);
-  CCFuncEntryType *load_kernel(std::string const &name);
   void compile_layout(SNode *root);
   void init_runtime();
-  void relink();
+
+  // Compiles |source| with cc_compile_cmd. The objects are cached by a digest
+  // of the source and the command, so identical sources are compiled once.
+  // Returns the path of the object file.
+  std::string compile_object(std::string const &name,
+                             std::string const &source);
+
+  // Links |objects| with cc_link_cmd into a shared object, cached like
+  // compile_object(). Returns the path of the shared object.
+  std::string link_shared_object(std::string const &name,
+                                 std::vector<std::string> const &objects);
 
   CCLayout *get_layout() {
     return layout.get();
@@ -48,16 +54,24 @@ class CCProgram {
   Program *const program;
 
  private:
+  // Removes the least recently used files of the cache directory until it is
+  // within CompileConfig::offline_cache_max_size_GB, like LlvmOfflineCache.
+  // |output| and the runtime object are kept, since they are still needed.
+  void evict_cache(std::string const &output);
+
   std::vector<char> args_buf;
   std::vector<char> root_buf;
   std::vector<char> gtmp_buf;
+  // Runs the range-for tasks of the kernels, see Ti_parallel_range_for.
+  std::unique_ptr<ThreadPool> thread_pool;
+  std::vector<uint16> rand_states;
   std::vector<std::unique_ptr<CCKernel>> kernels;
   std::unique_ptr<CCContext> context;
   std::unique_ptr<CCRuntime> runtime;
   std::unique_ptr<CCLayout> layout;
-  std::unique_ptr<DynamicLoader> dll;
-  std::string dll_path;
-  bool need_relink{true};
+  // Where the compiled objects are cached. It is shared by all processes if
+  // CompileConfig::offline_cache is on.
+  std::string cache_dir;
 };
 
 }  // namespace cccp
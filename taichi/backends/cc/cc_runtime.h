@@ -25,9 +25,8 @@ class CCRuntime {
   std::string source;
 
  private:
-  [[maybe_unused]] CCProgram *program;
+  CCProgram *program;
 
-  std::string src_path;
   std::string obj_path;
 };
 
@@ -36,6 +36,25 @@ inline std::string cc_atomic_op_type_symbol(AtomicOpType op) {
   }
 }
 
+// The suffix of the GCC __atomic_fetch_* builtin of an integral |op|.
+inline std::string cc_atomic_op_type_builtin_name(AtomicOpType op) {
+  switch (op) {
+    case AtomicOpType::add:
+      return "add";
+    case AtomicOpType::sub:
+      return "sub";
+    case AtomicOpType::bit_or:
+      return "or";
+    case AtomicOpType::bit_xor:
+      return "xor";
+    case AtomicOpType::bit_and:
+      return "and";
+    default:
+      TI_ERROR("Unsupported AtomicOpType={} on C backend",
+               atomic_op_type_name(op));
+  }
+}
+
 inline bool cc_is_binary_op_infix(BinaryOpType op) {
   switch (op) {
     case BinaryOpType::max:
@@ -26,7 +26,11 @@ class CCTransformer : public IRVisitor {
 
   LineAppender line_appender;
   LineAppender line_appender_header;
+  // The functions of the parallel range-for tasks, defined before the kernel.
+  std::string tasks_source;
+  int num_tasks{0};
   bool is_top_level{true};
+  bool is_parallel_task{false};
   GetRootStmt *root_stmt;
 
  public:
@@ -54,7 +58,7 @@ class CCTransformer : public IRVisitor {
   }
 
   std::string get_source() {
-    return line_appender_header.lines() + line_appender.lines();
+    return tasks_source + line_appender_header.lines() + line_appender.lines();
   }
 
  private:
@@ -382,6 +386,10 @@ class CCTransformer : public IRVisitor {
     const auto op = cc_atomic_op_type_symbol(stmt->op_type);
     const auto type = stmt->dest->element_type().ptr_removed();
     auto var = define_var(cc_data_type_name(type), stmt->raw_name());
+    if (is_parallel_task) {
+      emit_parallel_atomic(stmt, var);
+      return;
+    }
     emit("{} = *{};", var, dest_ptr);
     if (stmt->op_type == AtomicOpType::max ||
         stmt->op_type == AtomicOpType::min) {
@@ -392,6 +400,40 @@ class CCTransformer : public IRVisitor {
     }
   }
 
+  // Other threads of the range-for may update |stmt->dest| concurrently.
+  void emit_parallel_atomic(AtomicOpStmt *stmt, const std::string &var) {
+    const auto dest_ptr = stmt->dest->raw_name();
+    const auto src_name = stmt->val->raw_name();
+    const auto type = stmt->dest->element_type().ptr_removed();
+    if (is_integral(type) && stmt->op_type != AtomicOpType::max &&
+        stmt->op_type != AtomicOpType::min) {
+      emit("{} = __atomic_fetch_{}({}, {}, __ATOMIC_SEQ_CST);", var,
+           cc_atomic_op_type_builtin_name(stmt->op_type), dest_ptr,
+           src_name);
+      return;
+    }
+    // Floats, as well as max and min, need a compare-and-swap loop.
+    const auto old_name = stmt->raw_name();
+    const auto new_name = stmt->raw_name() + "_new_";
+    emit("{} = *{};", var, dest_ptr);
+    emit("{} {};", cc_data_type_name(type), new_name);
+    std::string new_val;
+    if (stmt->op_type == AtomicOpType::max ||
+        stmt->op_type == AtomicOpType::min) {
+      new_val = invoke_libc(cc_atomic_op_type_symbol(stmt->op_type), type,
+                            "{}, {}", old_name, src_name);
+    } else {
+      new_val = fmt::format("{} {} {}", old_name,
+                            cc_atomic_op_type_symbol(stmt->op_type), src_name);
+    }
+    emit("do {{");
+    emit("  {} = {};", new_name, new_val);
+    emit(
+        "}} while (!__atomic_compare_exchange({}, &{}, &{}, 0, "
+        "__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));",
+        dest_ptr, old_name, new_name);
+  }
+
   void visit(PrintStmt *stmt) override {
     std::string format;
     std::vector<std::string> values;
@@ -419,39 +461,50 @@ class CCTransformer : public IRVisitor {
     stmt->body->accept(this);
   }
 
+  // Emits the body of a range-for into its own function, which the runtime
+  // calls on several threads, each time with a chunk of the range.
   void generate_range_for_kernel(OffloadedStmt *stmt) {
-    if (stmt->const_begin && stmt->const_end) {
-      ScopedIndent _s(line_appender);
-      auto begin_value = stmt->begin_value;
-      auto end_value = stmt->end_value;
-      auto var = define_var("Ti_i32", stmt->raw_name());
-      emit("for ({} = {}; {} < {}; {} += {}) {{", var, begin_value,
-           stmt->raw_name(), end_value, stmt->raw_name(), 1 /* stmt->step? */);
-      stmt->body->accept(this);
-      emit("}}");
+    std::string begin_expr, end_expr;
+    if (stmt->const_begin) {
+      begin_expr = std::to_string(stmt->begin_value);
     } else {
+      begin_expr = "tmp_begin_" + stmt->raw_name();
+      emit("{} = *(Ti_i32 *) (ti_ctx->gtmp + {});",
+           define_var("Ti_i32", begin_expr), stmt->begin_offset);
+    }
+    if (stmt->const_end) {
+      end_expr = std::to_string(stmt->end_value);
+    } else {
+      end_expr = "tmp_end_" + stmt->raw_name();
+      emit("{} = *(Ti_i32 *) (ti_ctx->gtmp + {});",
+           define_var("Ti_i32", end_expr), stmt->end_offset);
+    }
+    const auto task_name =
+        fmt::format("Tk_{}_task{}", kernel->name, num_tasks++);
+    emit("Ti_parallel_range_for(ti_ctx, {}, {}, {}, {});", begin_expr,
+         end_expr, stmt->block_dim, task_name);
+
+    LineAppender kernel_appender, kernel_appender_header;
+    std::swap(line_appender, kernel_appender);
+    std::swap(line_appender_header, kernel_appender_header);
+    is_parallel_task = true;
+    emit_header(
+        "static void {}(struct Ti_Context *ti_ctx, Ti_i32 ti_thread_id, "
+        "Ti_i32 ti_begin, Ti_i32 ti_end) {{",
+        task_name);
+    {
+      ScopedIndent _s(line_appender);
       auto var = define_var("Ti_i32", stmt->raw_name());
-      auto begin_expr = "tmp_begin_" + stmt->raw_name();
-      auto end_expr = "tmp_end_" + stmt->raw_name();
-      auto begin_var = define_var("Ti_i32", begin_expr);
-      auto end_var = define_var("Ti_i32", end_expr);
-      if (!stmt->const_begin) {
-        emit("{} = *(Ti_i32 *) (ti_ctx->gtmp + {});", begin_var,
-             stmt->begin_offset);
-      } else {
-        emit("{} = {};", begin_var, stmt->begin_value);
-      }
-      if (!stmt->const_end) {
-        emit("{} = *(Ti_i32 *) (ti_ctx->gtmp + {});", end_var,
-             stmt->end_offset);
-      } else {
-        emit("{} = {};", end_var, stmt->end_value);
-      }
-      emit("for ({} = {}; {} < {}; {} += {}) {{", var, begin_expr,
-           stmt->raw_name(), end_expr, stmt->raw_name(), 1 /* stmt->step? */);
+      emit("for ({} = ti_begin; {} < ti_end; {} += {}) {{", var,
+           stmt->raw_name(), stmt->raw_name(), 1 /* stmt->step? */);
       stmt->body->accept(this);
       emit("}}");
     }
+    emit("}}");
+    tasks_source += line_appender_header.lines() + line_appender.lines();
+    is_parallel_task = false;
+    std::swap(line_appender, kernel_appender);
+    std::swap(line_appender_header, kernel_appender_header);
   }
 
   void visit(OffloadedStmt *stmt) override {
@@ -528,7 +581,11 @@ class CCTransformer : public IRVisitor {
 
   void visit(RandStmt *stmt) override {
     auto var = define_var(cc_data_type_name(stmt->ret_type), stmt->raw_name());
-    emit("{} = Ti_rand_{}();", var, data_type_name(stmt->ret_type));
+    // Each thread of a range-for has its own state, and a serial kernel runs
+    // on thread 0.
+    emit("{} = Ti_rand_{}(ti_ctx->rand_states + 3 * {});", var,
+         data_type_name(stmt->ret_type),
+         is_parallel_task ? "ti_thread_id" : "0");
   }
 
   void visit(AdStackAllocaStmt *stmt) override {
@@ -33,7 +33,30 @@ struct Ti_Context {
 
   union Ti_BitCast *args;
   int *earg;
+  Ti_i32 num_threads;
+  // A taichi::ThreadPool of |num_threads| threads, driven by |parallel_for|.
+  void *thread_pool;
+  void (*parallel_for)(void *thread_pool,
+                       Ti_i32 splits,
+                       Ti_i32 num_threads,
+                       void *arg,
+                       void (*func)(void *arg, Ti_i32 thread_id, Ti_i32 i));
+  // The erand48() states of the threads, 3 per thread.
+  Ti_u16 *rand_states;
 };
+
+typedef void (*Ti_RangeForTask)(struct Ti_Context *ti_ctx,
+                                Ti_i32 thread_id,
+                                Ti_i32 begin,
+                                Ti_i32 end);
+
+// Runs |task| on the chunks of |grain| iterations of [begin, end), on at most
+// |ti_ctx->num_threads| threads including the calling one, which is thread 0.
+void Ti_parallel_range_for(struct Ti_Context *ti_ctx,
+                           Ti_i32 begin,
+                           Ti_i32 end,
+                           Ti_i32 grain,
+                           Ti_RangeForTask task);
 )
 
 // clang-format on
@@ -52,6 +75,14 @@ struct CCContext {
 
   uint64_t *args;
   int *earg;
+  int num_threads;
+  void *thread_pool;
+  void (*parallel_for)(void *thread_pool,
+                       int splits,
+                       int num_threads,
+                       void *arg,
+                       RangeForTaskFunc *func);
+  uint16 *rand_states;
 };
 
 };  // namespace cccp
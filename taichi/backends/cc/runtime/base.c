@@ -2,4 +2,60 @@
 // clang-format off
 #include "taichi/util/macros.h"
 STR(
+
+struct Ti_RangeForShared {
+  struct Ti_Context *ti_ctx;
+  Ti_RangeForTask task;
+  Ti_i32 begin;
+  Ti_i32 end;
+  Ti_i32 grain;
+};
+
+static void Ti_range_for_chunk(void *arg, Ti_i32 thread_id, Ti_i32 chunk) {
+  struct Ti_RangeForShared *shared = (struct Ti_RangeForShared *)arg;
+  Ti_i64 begin = shared->begin + (Ti_i64)chunk * shared->grain;
+  shared->task(shared->ti_ctx, thread_id, (Ti_i32)begin,
+               (Ti_i32)Ti_llmin(begin + shared->grain, shared->end));
+}
+
+void Ti_parallel_range_for(struct Ti_Context *ti_ctx,
+                           Ti_i32 begin,
+                           Ti_i32 end,
+                           Ti_i32 grain,
+                           Ti_RangeForTask task) {
+  struct Ti_RangeForShared shared;
+  Ti_i64 num_chunks;
+  Ti_i32 num_threads;
+
+  if (grain < 1) {
+    grain = 1;
+  }
+  num_chunks = ((Ti_i64)end - begin + grain - 1) / grain;
+  num_threads = ti_ctx->num_threads;
+  if (num_chunks < num_threads) {
+    num_threads = (Ti_i32)num_chunks;
+  }
+  if (num_threads <= 1) {
+    if (begin < end) {
+      task(ti_ctx, 0, begin, end);
+    }
+    return;
+  }
+  // Keep the number of chunks within Ti_i32.
+  while (num_chunks > 0x7fffffff) {
+    grain *= 2;
+    num_chunks = ((Ti_i64)end - begin + grain - 1) / grain;
+  }
+
+  shared.ti_ctx = ti_ctx;
+  shared.task = task;
+  shared.begin = begin;
+  shared.end = end;
+  shared.grain = grain;
+  // The chunks run on the persistent thread pool of the host program, which
+  // balances them between the threads.
+  ti_ctx->parallel_for(ti_ctx->thread_pool, (Ti_i32)num_chunks, num_threads,
+                       &shared, Ti_range_for_chunk);
+}
+
 )
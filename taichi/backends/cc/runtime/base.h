@@ -67,20 +67,23 @@ static inline Ti_f64 Ti_rsqrt(Ti_f64 x) {
 
 ) "\n" STR(
 
-static inline Ti_i32 Ti_rand_i32(void) {
-  return mrand48();  // includes negative
+// |state| is the erand48() state of the calling thread, see
+// Ti_Context::rand_states. The drand48() family shares a global state, which
+// races between the threads of a range-for.
+static inline Ti_i32 Ti_rand_i32(Ti_u16 *state) {
+  return jrand48(state);  // includes negative
 }
 
-static inline Ti_i64 Ti_rand_i64(void) {
-  return ((Ti_i64) mrand48() << 32) | mrand48();
+static inline Ti_i64 Ti_rand_i64(Ti_u16 *state) {
+  return ((Ti_i64) jrand48(state) << 32) | (Ti_u32) jrand48(state);
 }
 
-static inline Ti_f64 Ti_rand_f64(void) {
-  return drand48();  // [0.0, 1.0)
+static inline Ti_f64 Ti_rand_f64(Ti_u16 *state) {
+  return erand48(state);  // [0.0, 1.0)
 }
 
-static inline Ti_f32 Ti_rand_f32(void) {
-  return (Ti_f32) drand48();  // [0.0, 1.0)
+static inline Ti_f32 Ti_rand_f32(Ti_u16 *state) {
+  return (Ti_f32) erand48(state);  // [0.0, 1.0)
 }
 
 // Copied from Metal:
@@ -8,6 +8,8 @@
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
 #include "taichi/util/statistics.h"
+#include "taichi/llvm/llvm_offline_cache.h"
+#include "taichi/llvm/llvm_program.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -20,6 +22,11 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
   }
 
   void create_offload_range_for(OffloadedStmt *stmt) override {
+    if (prog->config.cpu_block_range_for) {
+      create_offload_range_for_block(stmt);
+      return;
+    }
+
     int step = 1;
 
     // In parallel for-loops reversing the order doesn't make sense.
@@ -37,7 +44,7 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
       auto guard = get_function_creation_guard(
           {llvm::PointerType::get(get_runtime_type("Context"), 0),
            llvm::Type::getInt8PtrTy(*llvm_context),
-           tlctx->get_data_type<int>()});
+           tlctx->get_data_type<int>(), get_thread_id_type()});
 
       auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
       loop_vars_llvm[stmt].push_back(loop_var);
@@ -48,13 +55,96 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
     }
 
     llvm::Value *epilogue = create_xlogue(stmt->tls_epilogue);
+    auto *tls_combine = create_tls_combine(stmt);
 
     auto [begin, end] = get_range_for_bounds(stmt);
-    create_call(
-        "cpu_parallel_range_for",
-        {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin, end,
-         tlctx->get_constant(step), tlctx->get_constant(stmt->block_dim),
-         tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size)});
+    create_call("cpu_parallel_range_for",
+                {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin,
+                 end, tlctx->get_constant(step),
+                 tlctx->get_constant(stmt->block_dim), tls_prologue, body,
+                 epilogue, tls_combine, tlctx->get_constant(stmt->tls_size)});
+  }
+
+  // Emits a function running the iterations [block_begin, block_end) of
+  // |stmt|. Compared to calling
+  // the loop body once per iteration, this allows LLVM to vectorize the loop
+  // and to hoist loop invariants out of it.
+  void create_offload_range_for_block(OffloadedStmt *stmt) {
+    using namespace llvm;
+    auto *tls_prologue = create_xlogue(stmt->tls_prologue);
+
+    llvm::Function *body;
+    {
+      auto guard = get_function_creation_guard(
+          {llvm::PointerType::get(get_runtime_type("Context"), 0),
+           llvm::Type::getInt8PtrTy(*llvm_context),
+           tlctx->get_data_type<int>(), tlctx->get_data_type<int>(),
+           get_thread_id_type()});
+
+      auto block_begin = get_arg(2);
+      auto block_end = get_arg(3);
+
+      BasicBlock *loop_test =
+          BasicBlock::Create(*llvm_context, "block_loop_test", func);
+      BasicBlock *loop_body =
+          BasicBlock::Create(*llvm_context, "block_loop_body", func);
+      BasicBlock *loop_inc =
+          BasicBlock::Create(*llvm_context, "block_loop_inc", func);
+      BasicBlock *after_loop =
+          BasicBlock::Create(*llvm_context, "after_block_loop", func);
+
+      auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
+      loop_vars_llvm[stmt].push_back(loop_var);
+      // In parallel for-loops reversing the order doesn't make sense.
+      // However, we may need to support serial offloaded range for's in the
+      // future, so it still makes sense to reverse the order here.
+      if (!stmt->reversed) {
+        builder->CreateStore(block_begin, loop_var);
+      } else {
+        builder->CreateStore(
+            builder->CreateSub(block_end, tlctx->get_constant(1)), loop_var);
+      }
+      builder->CreateBr(loop_test);
+
+      builder->SetInsertPoint(loop_test);
+      llvm::Value *cond;
+      if (!stmt->reversed) {
+        cond = builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SLT,
+                                   builder->CreateLoad(loop_var), block_end);
+      } else {
+        cond = builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SGE,
+                                   builder->CreateLoad(loop_var), block_begin);
+      }
+      builder->CreateCondBr(cond, loop_body, after_loop);
+
+      {
+        // A top-level continue moves on to the next iteration instead of
+        // returning from the task function.
+        auto *saved_reentry = offloaded_loop_reentry;
+        offloaded_loop_reentry = loop_inc;
+        builder->SetInsertPoint(loop_body);
+        stmt->body->accept(this);
+        offloaded_loop_reentry = saved_reentry;
+      }
+      builder->CreateBr(loop_inc);
+
+      builder->SetInsertPoint(loop_inc);
+      create_increment(loop_var, tlctx->get_constant(stmt->reversed ? -1 : 1));
+      builder->CreateBr(loop_test);
+
+      builder->SetInsertPoint(after_loop);
+
+      body = guard.body;
+    }
+
+    llvm::Value *epilogue = create_xlogue(stmt->tls_epilogue);
+    auto *tls_combine = create_tls_combine(stmt);
+
+    auto [begin, end] = get_range_for_bounds(stmt);
+    create_call("cpu_parallel_range_for_block",
+                {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin,
+                 end, tlctx->get_constant(stmt->block_dim), tls_prologue, body,
+                 epilogue, tls_combine, tlctx->get_constant(stmt->tls_size)});
   }
 
   void visit(OffloadedStmt *stmt) override {
@@ -122,7 +212,36 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
 
 FunctionType CodeGenCPU::codegen() {
   TI_AUTO_PROF
-  return CodeGenLLVMCPU(kernel, ir).gen();
+  auto *cache = prog->get_llvm_program_impl()->get_offline_cache();
+  if (cache == nullptr || !LlvmOfflineCache::is_cacheable(ir)) {
+    return CodeGenLLVMCPU(kernel, ir).gen();
+  }
+
+  LlvmOfflineCache::Entry entry;
+  const auto key = cache->make_key(kernel, ir);
+  auto *tlctx = prog->get_llvm_program_impl()->get_llvm_context(kernel->arch);
+  if (!cache->load(key, entry)) {
+    CodeGenLLVMCPU gen(kernel, ir);
+    gen.emit_to_module();
+    gen.eliminate_unused_functions();
+    entry.key = key;
+    for (auto &task : gen.offloaded_tasks) {
+      entry.task_names.push_back(task.name);
+    }
+    entry.object_code =
+        tlctx->jit->compile_module_to_object(std::move(gen.module));
+    cache->store(entry);
+  }
+
+  auto *jit_module = tlctx->jit->add_object(entry.object_code);
+  std::vector<OffloadedTask> tasks;
+  for (auto &name : entry.task_names) {
+    OffloadedTask task(/*codegen=*/nullptr);
+    task.begin(name);
+    tasks.push_back(task);
+  }
+  return CodeGenLLVM::link_offloaded_tasks(
+      kernel->name + "_kernel", tlctx->jit->acquire_module(jit_module), tasks);
 }
 
 TLANG_NAMESPACE_END
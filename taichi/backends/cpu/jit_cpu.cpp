@@ -1,5 +1,6 @@
 // A LLVM JIT compiler for CPU archs wrapper
 
+#include <algorithm>
 #include <memory>
 
 #include "llvm/Analysis/TargetTransformInfo.h"
@@ -25,6 +26,7 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
@@ -34,6 +36,7 @@
 #include "llvm/Transforms/IPO.h"
 
 #include "taichi/lang_util.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/program.h"
 #include "taichi/jit/jit_session.h"
 #include "taichi/util/file_sequence_writer.h"
@@ -66,14 +69,88 @@ std::pair<JITTargetMachineBuilder, llvm::DataLayout> get_host_target_info() {
 
 class JITSessionCPU;
 
+// The code and data sections of the objects linked into a JIT module.
+class JITModuleMemory {
+ public:
+  std::unique_ptr<SectionMemoryManager> manager{
+      std::make_unique<SectionMemoryManager>()};
+  std::size_t num_bytes{0};
+
+  void release() {
+    if (manager) {
+      manager->deregisterEHFrames();
+      manager = nullptr;
+      num_bytes = 0;
+    }
+  }
+};
+
+// RTDyldObjectLinkingLayer keeps the memory managers of all the objects it
+// has linked until it is destroyed, and LLVM 10 has no way to remove a
+// JITDylib from an ExecutionSession. So the layer gets a thin forwarding
+// manager, while the memory it allocates belongs to the JITModuleMemory of the
+// module being linked, which is freed when the module is removed.
+class ForwardingMemoryManager : public RuntimeDyld::MemoryManager {
+ private:
+  std::shared_ptr<JITModuleMemory> memory;
+
+ public:
+  explicit ForwardingMemoryManager(std::shared_ptr<JITModuleMemory> memory)
+      : memory(std::move(memory)) {
+  }
+
+  uint8_t *allocateCodeSection(uintptr_t size,
+                               unsigned alignment,
+                               unsigned section_id,
+                               StringRef section_name) override {
+    TI_ASSERT(memory->manager);
+    memory->num_bytes += size;
+    return memory->manager->allocateCodeSection(size, alignment, section_id,
+                                                section_name);
+  }
+
+  uint8_t *allocateDataSection(uintptr_t size,
+                               unsigned alignment,
+                               unsigned section_id,
+                               StringRef section_name,
+                               bool is_read_only) override {
+    TI_ASSERT(memory->manager);
+    memory->num_bytes += size;
+    return memory->manager->allocateDataSection(size, alignment, section_id,
+                                                section_name, is_read_only);
+  }
+
+  void registerEHFrames(uint8_t *addr,
+                        uint64_t load_addr,
+                        size_t size) override {
+    if (memory->manager)
+      memory->manager->registerEHFrames(addr, load_addr, size);
+  }
+
+  void deregisterEHFrames() override {
+    if (memory->manager)
+      memory->manager->deregisterEHFrames();
+  }
+
+  bool finalizeMemory(std::string *error_message) override {
+    TI_ASSERT(memory->manager);
+    return memory->manager->finalizeMemory(error_message);
+  }
+};
+
 class JITModuleCPU : public JITModule {
  private:
   JITSessionCPU *session;
   JITDylib *dylib;
+  std::shared_ptr<JITModuleMemory> memory;
+
+  friend class JITSessionCPU;
 
  public:
   JITModuleCPU(JITSessionCPU *session, JITDylib *dylib)
-      : session(session), dylib(dylib) {
+      : session(session),
+        dylib(dylib),
+        memory(std::make_shared<JITModuleMemory>()) {
   }
 
   void *lookup_function(const std::string &name) override;
@@ -85,6 +162,7 @@ class JITModuleCPU : public JITModule {
 
 class JITSessionCPU : public JITSession {
  private:
+  JITTargetMachineBuilder JTMB;
   ExecutionSession ES;
   RTDyldObjectLinkingLayer object_layer;
   IRCompileLayer compile_layer;
@@ -93,15 +171,21 @@ class JITSessionCPU : public JITSession {
   std::mutex mut;
   std::vector<llvm::orc::JITDylib *> all_libs;
   int module_counter;
-  SectionMemoryManager *memory_manager;
+  // The memory of the module being linked, or nullptr if the object is linked
+  // by a lookup in all the modules.
+  std::shared_ptr<JITModuleMemory> linking_memory;
+  // Memory of the objects linked by lookup(), which is never freed.
+  std::shared_ptr<JITModuleMemory> shared_memory;
 
  public:
   JITSessionCPU(JITTargetMachineBuilder JTMB, DataLayout DL)
-      : object_layer(ES,
+      : JTMB(JTMB),
+        object_layer(ES,
                      [&]() {
-                       auto smgr = std::make_unique<SectionMemoryManager>();
-                       memory_manager = smgr.get();
-                       return smgr;
+                       // Called with |mut| held, by the lookup that triggers
+                       // the linking.
+                       return std::make_unique<ForwardingMemoryManager>(
+                           linking_memory ? linking_memory : shared_memory);
                      }),
         compile_layer(ES,
                       object_layer,
@@ -109,7 +193,7 @@ class JITSessionCPU : public JITSession {
         DL(DL),
         Mangle(ES, this->DL),
         module_counter(0),
-        memory_manager(nullptr) {
+        shared_memory(std::make_shared<JITModuleMemory>()) {
     if (JTMB.getTargetTriple().isOSBinFormatCOFF()) {
       object_layer.setOverrideObjectFlagsWithResponsibilityFlags(true);
       object_layer.setAutoClaimResponsibilityForObjectSymbols(true);
@@ -118,8 +202,10 @@ class JITSessionCPU : public JITSession {
 
   ~JITSessionCPU() {
     std::lock_guard<std::mutex> _(mut);
-    if (memory_manager)
-      memory_manager->deregisterEHFrames();
+    for (auto &module : modules) {
+      static_cast<JITModuleCPU *>(module.get())->memory->release();
+    }
+    shared_memory->release();
   }
 
   DataLayout get_data_layout() override {
@@ -135,22 +221,47 @@ class JITSessionCPU : public JITSession {
     TI_ASSERT(M);
     global_optimize_module_cpu(M.get());
     std::lock_guard<std::mutex> _(mut);
-    auto &dylib = ES.createJITDylib(fmt::format("{}", module_counter));
-    dylib.addGenerator(
-        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-            DL.getGlobalPrefix())));
+    auto &dylib = create_dylib();
     auto *thread_safe_context = get_current_program()
                                     .get_llvm_program_impl()
                                     ->get_llvm_context(host_arch())
                                     ->get_this_thread_thread_safe_context();
     cantFail(compile_layer.add(dylib, llvm::orc::ThreadSafeModule(
                                           std::move(M), *thread_safe_context)));
-    all_libs.push_back(&dylib);
-    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
-    auto new_module_raw_ptr = new_module.get();
-    modules.push_back(std::move(new_module));
-    module_counter++;
-    return new_module_raw_ptr;
+    return register_dylib(dylib);
+  }
+
+  std::string compile_module_to_object(
+      std::unique_ptr<llvm::Module> M) override {
+    TI_AUTO_PROF
+    TI_ASSERT(M);
+    global_optimize_module_cpu(M.get());
+    // Use the same target machine as the ConcurrentIRCompiler in
+    // |compile_layer|, so that cached objects match freshly JIT'ed ones.
+    auto target_machine = cantFail(JTMB.createTargetMachine());
+    M->setDataLayout(target_machine->createDataLayout());
+    llvm::SmallVector<char, 0> object_buffer;
+    {
+      TI_PROFILER("llvm_emit_object");
+      CompileProfiler::PhaseGuard _("llvm_emit_object", "llvm");
+      llvm::raw_svector_ostream object_stream(object_buffer);
+      legacy::PassManager pass_manager;
+      if (target_machine->addPassesToEmitFile(pass_manager, object_stream,
+                                              nullptr, CGFT_ObjectFile)) {
+        TI_ERROR("The target machine cannot emit object files.");
+      }
+      pass_manager.run(*M);
+    }
+    return std::string(object_buffer.begin(), object_buffer.end());
+  }
+
+  JITModule *add_object(const std::string &object_code) override {
+    std::lock_guard<std::mutex> _(mut);
+    auto &dylib = create_dylib();
+    cantFail(object_layer.add(
+        dylib, llvm::MemoryBuffer::getMemBufferCopy(
+                   object_code, fmt::format("object_{}", module_counter))));
+    return register_dylib(dylib);
   }
 
   void *lookup(const std::string Name) override {
@@ -165,24 +276,77 @@ class JITSessionCPU : public JITSession {
     return (void *)(symbol->getAddress());
   }
 
-  void *lookup_in_module(JITDylib *lib, const std::string Name) {
+  void *lookup_in_module(JITModuleCPU *module, const std::string Name) {
     std::lock_guard<std::mutex> _(mut);
+    // The first lookup in a module links it on this thread.
+    linking_memory = module->memory;
 #ifdef __APPLE__
-    auto symbol = ES.lookup({lib}, Mangle(Name));
+    auto symbol = ES.lookup({module->dylib}, Mangle(Name));
 #else
-    auto symbol = ES.lookup({lib}, ES.intern(Name));
+    auto symbol = ES.lookup({module->dylib}, ES.intern(Name));
 #endif
+    linking_memory = nullptr;
     if (!symbol)
       TI_ERROR("Function \"{}\" not found", Name);
     return (void *)(symbol->getAddress());
   }
 
+  ModuleStats get_module_stats() override {
+    std::lock_guard<std::mutex> _(mut);
+    ModuleStats stats;
+    stats.num_modules = modules.size();
+    stats.num_bytes = shared_memory->num_bytes;
+    for (auto &module : modules) {
+      stats.num_bytes +=
+          static_cast<JITModuleCPU *>(module.get())->memory->num_bytes;
+    }
+    return stats;
+  }
+
+ protected:
+  void remove_module(JITModule *module) override {
+    std::lock_guard<std::mutex> _(mut);
+    auto *module_cpu = static_cast<JITModuleCPU *>(module);
+    // The (now empty) JITDylib itself cannot be removed with LLVM 10. Taking
+    // it out of |all_libs| makes sure that its symbols are never resolved
+    // again.
+    all_libs.erase(
+        std::find(all_libs.begin(), all_libs.end(), module_cpu->dylib));
+    module_cpu->memory->release();
+    auto it = std::find_if(
+        modules.begin(), modules.end(),
+        [module](const std::unique_ptr<JITModule> &m) {
+          return m.get() == module;
+        });
+    TI_ASSERT(it != modules.end());
+    modules.erase(it);
+  }
+
  private:
+  // Note: |mut| must be held by the caller.
+  JITDylib &create_dylib() {
+    auto &dylib = ES.createJITDylib(fmt::format("{}", module_counter));
+    dylib.addGenerator(
+        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            DL.getGlobalPrefix())));
+    return dylib;
+  }
+
+  // Note: |mut| must be held by the caller.
+  JITModule *register_dylib(JITDylib &dylib) {
+    all_libs.push_back(&dylib);
+    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
+    auto new_module_raw_ptr = new_module.get();
+    modules.push_back(std::move(new_module));
+    module_counter++;
+    return new_module_raw_ptr;
+  }
+
   static void global_optimize_module_cpu(llvm::Module *module);
 };
 
 void *JITModuleCPU::lookup_function(const std::string &name) {
-  return session->lookup_in_module(dylib, name);
+  return session->lookup_in_module(this, name);
 }
 
 void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
@@ -248,6 +412,7 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
 
   {
     TI_PROFILER("llvm_function_pass");
+    CompileProfiler::PhaseGuard _("llvm_function_pass", "llvm");
     function_pass_manager.doInitialization();
     for (llvm::Module::iterator i = module->begin(); i != module->end(); i++)
       function_pass_manager.run(*i);
@@ -257,6 +422,7 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
 
   {
     TI_PROFILER("llvm_module_pass");
+    CompileProfiler::PhaseGuard _("llvm_module_pass", "llvm");
     module_pass_manager.run(*module);
   }
 
@@ -91,6 +91,8 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
         CUDADriver::get_instance().stream_synchronize(nullptr);
       }
 
+      // The tasks may post memory requests to the queue served by the pool.
+      kernel->program->memory_pool->wake();
       for (auto task : offloaded_local) {
         TI_TRACE("Launching kernel {}<<<{}, {}>>>", task.name, task.grid_dim,
                  task.block_dim);
@@ -394,7 +396,8 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
     {
       auto guard = get_function_creation_guard(
           {llvm::PointerType::get(get_runtime_type("Context"), 0),
-           get_tls_buffer_type(), tlctx->get_data_type<int>()});
+           get_tls_buffer_type(), tlctx->get_data_type<int>(),
+           get_thread_id_type()});
 
       auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
       loop_vars_llvm[stmt].push_back(loop_var);
@@ -492,6 +495,15 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
           } else {
             TI_NOT_IMPLEMENTED;
           }
+        } else if (ptr_type->get_pointee_type()->is_primitive(
+                       PrimitiveTypeID::f16)) {
+          // Loads the bits through the read-only data cache, and converts
+          // them to f32 like CodeGenLLVM::visit(GlobalLoadStmt *).
+          auto data_ptr = builder->CreateBitCast(
+              llvm_val[stmt->src], llvm_ptr_type(PrimitiveType::u16));
+          auto data = create_intrinsic_load(PrimitiveType::u16, data_ptr);
+          llvm_val[stmt] = create_f16_to_f32(builder->CreateBitCast(
+              data, tlctx->get_data_type(PrimitiveType::f16)));
         } else {
           // Byte pointer case.
           // Issue an CUDA "__ldg" instruction so that data are cached in
@@ -509,11 +521,12 @@ class CodeGenLLVMCUDA : public CodeGenLLVM {
   void create_bls_buffer(OffloadedStmt *stmt) {
     auto type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
                                      stmt->bls_size);
-    bls_buffer = new GlobalVariable(
+    auto buffer = new GlobalVariable(
         *module, type, false, llvm::GlobalValue::ExternalLinkage, nullptr,
         "bls_buffer", nullptr, llvm::GlobalVariable::NotThreadLocal,
         3 /*addrspace=shared*/);
-    bls_buffer->setAlignment(llvm::MaybeAlign(8));
+    buffer->setAlignment(llvm::MaybeAlign(8));
+    bls_buffer = buffer;
   }
 
   void visit(OffloadedStmt *stmt) override {
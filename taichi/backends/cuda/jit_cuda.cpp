@@ -1,5 +1,7 @@
 #include "taichi/backends/cuda/jit_cuda.h"
 
+#include "taichi/program/compile_profiler.h"
+
 TLANG_NAMESPACE_BEGIN
 
 #if defined(TI_WITH_CUDA)
@@ -197,6 +199,7 @@ std::string JITSessionCUDA::compile_module_to_ptx(
 
   {
     TI_PROFILER("llvm_function_pass");
+    CompileProfiler::PhaseGuard _("llvm_function_pass", "llvm");
     function_pass_manager.doInitialization();
     for (llvm::Module::iterator i = module->begin(); i != module->end(); i++)
       function_pass_manager.run(*i);
@@ -206,6 +209,7 @@ std::string JITSessionCUDA::compile_module_to_ptx(
 
   {
     TI_PROFILER("llvm_module_pass");
+    CompileProfiler::PhaseGuard _("llvm_module_pass", "llvm");
     module_pass_manager.run(*module);
   }
 
@@ -10,6 +10,7 @@
 #endif
 #include "taichi/system/timer.h"
 #include "taichi/ir/analysis.h"
+#include "taichi/program/compile_profiler.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -30,6 +31,7 @@ KernelCodeGen::KernelCodeGen(Kernel *kernel, IRNode *ir)
 
 FunctionType KernelCodeGen::compile() {
   TI_AUTO_PROF;
+  CompileProfiler::KernelGuard _(kernel->get_name());
   return codegen();
 }
 
@@ -1,11 +1,34 @@
 #include "taichi/codegen/codegen_llvm.h"
 
 #include "taichi/ir/statements.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/struct/struct_llvm.h"
 #include "taichi/util/file_sequence_writer.h"
 
+#include "llvm/Support/Host.h"
+
 TLANG_NAMESPACE_BEGIN
 
+namespace {
+
+// Without conversion instructions, LLVM would lower f16 conversions to library
+// calls that the JIT cannot resolve.
+bool has_f16_conversion_instructions(Arch arch, const CompileConfig &config) {
+  if (arch_is_cpu(arch) && config.cpu_software_f16_conversion) {
+    return false;
+  }
+  if (arch != Arch::x64) {
+    return true;
+  }
+  static const bool has_f16c = [] {
+    llvm::StringMap<bool> features;
+    return llvm::sys::getHostCPUFeatures(features) && features.lookup("f16c");
+  }();
+  return has_f16c;
+}
+
+}  // namespace
+
 // TODO: sort function definitions to match declaration order in header
 
 // OffloadedTask
@@ -27,9 +50,9 @@ void OffloadedTask::operator()(Context *context) {
   func(context);
 }
 
-void OffloadedTask::compile() {
+void OffloadedTask::compile(JITModule *module) {
   TI_ASSERT(!func);
-  auto kernel_symbol = codegen->tlctx->lookup_function_pointer(name);
+  auto kernel_symbol = module->lookup_function(name);
   TI_ASSERT_INFO(kernel_symbol, "Function not found");
 
   func = (task_fp_type)kernel_symbol;
@@ -40,6 +63,7 @@ FunctionCreationGuard::FunctionCreationGuard(
     CodeGenLLVM *mb,
     std::vector<llvm::Type *> arguments)
     : mb(mb) {
+  TI_ASSERT(!arguments.empty());
   // Create the loop body function
   auto body_function_type = llvm::FunctionType::get(
       llvm::Type::getVoidTy(*mb->llvm_context), arguments, false);
@@ -50,6 +74,8 @@ FunctionCreationGuard::FunctionCreationGuard(
   old_func = mb->func;
   // emit into loop body function
   mb->func = body;
+  old_thread_id = mb->current_thread_id;
+  mb->current_thread_id = body->arg_end() - 1;
 
   allocas = llvm::BasicBlock::Create(*mb->llvm_context, "allocs", body);
   old_entry = mb->entry_block;
@@ -69,6 +95,7 @@ FunctionCreationGuard::FunctionCreationGuard(
 FunctionCreationGuard::~FunctionCreationGuard() {
   mb->builder->CreateRetVoid();
   mb->func = old_func;
+  mb->current_thread_id = old_thread_id;
   mb->builder->restoreIP(ip);
 
   {
@@ -120,7 +147,7 @@ CodeGenStmtGuard make_while_after_loop_guard(CodeGenLLVM *cg) {
 
 // CodeGenLLVM
 
-uint64 CodeGenLLVM::task_counter = 0;
+std::atomic<uint64> CodeGenLLVM::task_counter = 0;
 
 void CodeGenLLVM::visit(Block *stmt_list) {
   for (auto &stmt : stmt_list->statements) {
@@ -160,7 +187,8 @@ void CodeGenLLVM::visit(AllocaStmt *stmt) {
 
 void CodeGenLLVM::visit(RandStmt *stmt) {
   llvm_val[stmt] = create_call(
-      fmt::format("rand_{}", data_type_name(stmt->ret_type)), {get_context()});
+      fmt::format("rand_{}", data_type_name(stmt->ret_type)),
+      {get_context(), get_thread_id()});
 }
 
 void CodeGenLLVM::emit_extra_unary(UnaryOpStmt *stmt) {
@@ -229,6 +257,10 @@ std::unique_ptr<RuntimeObject> CodeGenLLVM::emit_struct_meta_object(
     meta =
         std::make_unique<RuntimeObject>("BitmaskedMeta", this, builder.get());
     emit_struct_meta_base("Bitmasked", meta->ptr, snode);
+  } else if (snode->type == SNodeType::hash) {
+    meta = std::make_unique<RuntimeObject>("HashMeta", this, builder.get());
+    emit_struct_meta_base("Hash", meta->ptr, snode);
+    meta->call("set_num_slots", tlctx->get_constant(snode->hash_table_size));
   } else {
     TI_P(snode_type_name(snode->type));
     TI_NOT_IMPLEMENTED;
@@ -246,7 +278,8 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
         StructCompilerLLVM::get_llvm_body_type(module.get(), snode);
     auto element_ty = body_type->getArrayElementType();
     element_size = tlctx->get_type_size(element_ty);
-  } else if (snode->type == SNodeType::pointer) {
+  } else if (snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash) {
     auto element_ty = StructCompilerLLVM::get_llvm_node_type(
         module.get(), snode->ch[0].get());
     element_size = tlctx->get_type_size(element_ty);
@@ -260,6 +293,7 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
   common.set("max_num_elements",
              tlctx->get_constant(snode->max_num_elements()));
   common.set("context", get_context());
+  common.set("thread_id", get_thread_id());
 
   /*
   uint8 *(*lookup_element)(uint8 *, int i);
@@ -274,8 +308,25 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
   std::vector<std::string> functions = {"lookup_element", "is_active",
                                         "get_num_elements"};
 
-  for (auto const &f : functions)
-    common.set(f, get_runtime_function(fmt::format("{}_{}", name, f)));
+  if (snode->type == SNodeType::hash) {
+    // Listgen iterates over the slots of the hash table, so it takes the
+    // slot versions of these functions.
+    common.set("lookup_element", get_runtime_function("Hash_lookup_slot"));
+    common.set("is_active", get_runtime_function("Hash_is_slot_active"));
+    common.set("get_num_elements",
+               get_runtime_function("Hash_get_num_elements"));
+    common.set("get_element_index",
+               get_runtime_function("Hash_get_element_index"));
+  } else {
+    for (auto const &f : functions)
+      common.set(f, get_runtime_function(fmt::format("{}_{}", name, f)));
+    auto setter = common.get_func("set_get_element_index");
+    common.set("get_element_index",
+               llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(
+                   llvm::cast<llvm::Function>(setter)
+                       ->getFunctionType()
+                       ->getParamType(1))));
+  }
 
   // "from_parent_element", "refine_coordinates" are different for different
   // snodes, even if they have the same type.
@@ -334,6 +385,25 @@ llvm::Value *CodeGenLLVM::cast_int(llvm::Value *input_val,
   }
 }
 
+llvm::Value *CodeGenLLVM::create_f16_to_f32(llvm::Value *value) {
+  if (has_f16_conversion_instructions(kernel->arch, prog->config)) {
+    return builder->CreateFPExt(value,
+                                tlctx->get_data_type(PrimitiveType::f32));
+  }
+  return create_call(
+      "f16_to_f32",
+      {builder->CreateBitCast(value, tlctx->get_data_type(PrimitiveType::u16))});
+}
+
+llvm::Value *CodeGenLLVM::create_f32_to_f16(llvm::Value *value) {
+  if (has_f16_conversion_instructions(kernel->arch, prog->config)) {
+    return builder->CreateFPTrunc(value,
+                                  tlctx->get_data_type(PrimitiveType::f16));
+  }
+  return builder->CreateBitCast(create_call("f32_to_f16", {value}),
+                                tlctx->get_data_type(PrimitiveType::f16));
+}
+
 void CodeGenLLVM::visit(UnaryOpStmt *stmt) {
   auto input = llvm_val[stmt->operand];
   auto input_type = input->getType();
@@ -350,6 +420,29 @@ void CodeGenLLVM::visit(UnaryOpStmt *stmt) {
     auto to = stmt->cast_type;
     if (from == to) {
       llvm_val[stmt] = llvm_val[stmt->operand];
+    } else if (from->is_primitive(PrimitiveTypeID::f16) ||
+               to->is_primitive(PrimitiveTypeID::f16)) {
+      // Convert through f32.
+      auto value = llvm_val[stmt->operand];
+      if (from->is_primitive(PrimitiveTypeID::f16)) {
+        value = create_f16_to_f32(value);
+        from = PrimitiveType::f32;
+      }
+      const DataType target =
+          to->is_primitive(PrimitiveTypeID::f16) ? PrimitiveType::f32 : to;
+      if (is_integral(from)) {
+        value = builder->CreateSIToFP(value, tlctx->get_data_type(target));
+      } else if (is_integral(target)) {
+        value = builder->CreateFPToSI(value, tlctx->get_data_type(target));
+      } else if (data_type_size(from) < data_type_size(target)) {
+        value = builder->CreateFPExt(value, tlctx->get_data_type(target));
+      } else if (data_type_size(from) > data_type_size(target)) {
+        value = builder->CreateFPTrunc(value, tlctx->get_data_type(target));
+      }
+      if (to->is_primitive(PrimitiveTypeID::f16)) {
+        value = create_f32_to_f16(value);
+      }
+      llvm_val[stmt] = value;
     } else if (is_real(from) != is_real(to)) {
       if (is_real(from) && is_integral(to)) {
         cast_op = llvm::Instruction::CastOps::FPToSI;
@@ -738,11 +831,16 @@ void CodeGenLLVM::visit(PrintStmt *stmt) {
     if (std::holds_alternative<Stmt *>(content)) {
       auto arg_stmt = std::get<Stmt *>(content);
       auto value = llvm_val[arg_stmt];
-      if (arg_stmt->ret_type->is_primitive(PrimitiveTypeID::f32))
+      auto dt = arg_stmt->ret_type;
+      if (dt->is_primitive(PrimitiveTypeID::f16)) {
+        value = create_f16_to_f32(value);
+        dt = PrimitiveType::f32;
+      }
+      if (dt->is_primitive(PrimitiveTypeID::f32))
         value = builder->CreateFPExt(value,
                                      tlctx->get_data_type(PrimitiveType::f64));
       args.push_back(value);
-      formats += data_type_format(arg_stmt->ret_type);
+      formats += data_type_format(dt);
     } else {
       auto arg_str = std::get<std::string>(content);
       auto value = builder->CreateGlobalStringPtr(arg_str, "content_string");
@@ -799,7 +897,11 @@ void CodeGenLLVM::visit(WhileControlStmt *stmt) {
 void CodeGenLLVM::visit(ContinueStmt *stmt) {
   using namespace llvm;
   if (stmt->as_return()) {
-    builder->CreateRetVoid();
+    if (offloaded_loop_reentry != nullptr) {
+      builder->CreateBr(offloaded_loop_reentry);
+    } else {
+      builder->CreateRetVoid();
+    }
   } else {
     TI_ASSERT(current_loop_reentry != nullptr);
     builder->CreateBr(current_loop_reentry);
@@ -848,7 +950,8 @@ void CodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
     // more parallelism.
     call("element_listgen_root", get_runtime(), meta_parent, meta_child);
   } else {
-    call("element_listgen_nonroot", get_runtime(), meta_parent, meta_child);
+    call("element_listgen_nonroot", get_runtime(), meta_parent, meta_child,
+         tlctx->get_constant(listgen->num_cpu_threads));
   }
 }
 
@@ -1078,7 +1181,21 @@ void CodeGenLLVM::visit(AtomicOpStmt *stmt) {
   TI_ASSERT(stmt->width() == 1);
   for (int l = 0; l < stmt->width(); l++) {
     llvm::Value *old_value;
-    if (stmt->op_type == AtomicOpType::add) {
+    if (stmt->dest->ret_type.ptr_removed()->is_primitive(
+            PrimitiveTypeID::f16)) {
+      // The value is an f32, see type_check.
+      if (stmt->op_type != AtomicOpType::add &&
+          stmt->op_type != AtomicOpType::min &&
+          stmt->op_type != AtomicOpType::max) {
+        TI_NOT_IMPLEMENTED
+      }
+      auto dest = builder->CreateBitCast(
+          llvm_val[stmt->dest], llvm_ptr_type(PrimitiveType::u16));
+      old_value = builder->CreateCall(
+          get_runtime_function(fmt::format(
+              "atomic_{}_f16", atomic_op_type_name(stmt->op_type))),
+          {dest, llvm_val[stmt->val]});
+    } else if (stmt->op_type == AtomicOpType::add) {
       auto dst_type =
           stmt->dest->ret_type->as<PointerType>()->get_pointee_type();
       if (dst_type->is<PrimitiveType>() && is_integral(stmt->val->ret_type)) {
@@ -1205,6 +1322,11 @@ void CodeGenLLVM::visit(GlobalLoadStmt *stmt) {
     } else {
       TI_NOT_IMPLEMENTED
     }
+  } else if (ptr_type->get_pointee_type()->is_primitive(
+                 PrimitiveTypeID::f16)) {
+    // Loads f16 values into f32, see PrimitiveType::get_compute_type().
+    llvm_val[stmt] = create_f16_to_f32(builder->CreateLoad(
+        tlctx->get_data_type(PrimitiveType::f16), llvm_val[stmt->src]));
   } else {
     llvm_val[stmt] = builder->CreateLoad(tlctx->get_data_type(stmt->ret_type),
                                          llvm_val[stmt->src]);
@@ -1365,6 +1487,13 @@ void CodeGenLLVM::visit(SNodeLookupStmt *stmt) {
     }
     llvm_val[stmt] = call(snode, llvm_val[stmt->input_snode], "lookup_element",
                           {llvm_val[stmt->input_index]});
+  } else if (snode->type == SNodeType::hash) {
+    // Activation and lookup are fused, so that the writes to a cell that does
+    // not fit into a full table do not go to the ambient element.
+    llvm_val[stmt] = call(
+        snode, llvm_val[stmt->input_snode],
+        stmt->activate ? "activate_and_lookup_element" : "lookup_element",
+        {llvm_val[stmt->input_index]});
   } else if (snode->type == SNodeType::bit_struct) {
     llvm_val[stmt] = parent;
   } else if (snode->type == SNodeType::bit_array) {
@@ -1457,9 +1586,8 @@ std::string CodeGenLLVM::init_offloaded_task_function(OffloadedStmt *stmt,
       llvm::FunctionType::get(llvm::Type::getVoidTy(*llvm_context),
                               {llvm::PointerType::get(context_ty, 0)}, false);
 
-  auto task_kernel_name = fmt::format("{}_{}_{}{}", kernel_name, task_counter,
-                                      stmt->task_name(), suffix);
-  task_counter += 1;
+  auto task_kernel_name = fmt::format("{}_{}_{}{}", kernel_name,
+                                      task_counter++, stmt->task_name(), suffix);
   func = llvm::Function::Create(task_function_type,
                                 llvm::Function::ExternalLinkage,
                                 task_kernel_name, module.get());
@@ -1546,6 +1674,17 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     }
   }
 
+  // On CPUs, the TLS lives with the threads instead of the blocks, so the
+  // TLS prologue and epilogue run once per thread. See parallel_struct_for.
+  llvm::Value *tls_prologue = llvm::ConstantPointerNull::get(
+      llvm::PointerType::get(get_xlogue_function_type(), 0));
+  llvm::Value *tls_epilogue = tls_prologue;
+  llvm::Value *tls_combine = llvm::ConstantPointerNull::get(
+      llvm::PointerType::get(get_tls_combine_function_type(), 0));
+  if (!spmd) {
+    tls_prologue = create_xlogue(stmt->tls_prologue);
+  }
+
   {
     // Create the loop body function
     auto guard = get_function_creation_guard({
@@ -1554,6 +1693,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
         llvm::PointerType::get(get_runtime_type("Element"), 0),
         tlctx->get_data_type<int>(),
         tlctx->get_data_type<int>(),
+        get_thread_id_type(),
     });
 
     body = guard.body;
@@ -1562,7 +1702,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
      *
      * function_body (entry):
      *   loop_index = lower_bound;
-     *   tls_prologue()
+     *   tls_prologue() (GPU only)
      *   bls_prologue()
      *   goto loop_test
      *
@@ -1589,7 +1729,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
      *
      * func_exit:
      *   bls_epilogue()
-     *   tls_epilogue()
+     *   tls_epilogue() (GPU only)
      *   return
      */
 
@@ -1614,11 +1754,17 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     create_call(refine, {parent_coordinates, block_corner_coordinates,
                          tlctx->get_constant(0)});
 
-    if (stmt->tls_prologue) {
+    if (spmd && stmt->tls_prologue) {
       stmt->tls_prologue->accept(this);
     }
 
     if (stmt->bls_prologue) {
+      if (!spmd) {
+        bls_buffer = create_entry_block_alloca(
+            llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
+                                 stmt->bls_size),
+            /*alignment=*/8);
+      }
       call("block_barrier");  // "__syncthreads()"
       stmt->bls_prologue->accept(this);
       call("block_barrier");  // "__syncthreads()"
@@ -1668,8 +1814,13 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     // initialize the coordinates
     auto new_coordinates = create_entry_block_alloca(physical_coordinate_ty);
 
-    create_call(refine, {parent_coordinates, new_coordinates,
-                         builder->CreateLoad(loop_index)});
+    llvm::Value *element_index = builder->CreateLoad(loop_index);
+    if (leaf_block->type == SNodeType::hash) {
+      // The loop runs over the slots of the hash table.
+      element_index = call(leaf_block, element.get("element"),
+                           "get_element_index", {element_index});
+    }
+    create_call(refine, {parent_coordinates, new_coordinates, element_index});
 
     // One more refine step is needed for bit_arrays to make final coordinates
     // non-consecutive, since each thread will process multiple
@@ -1729,6 +1880,12 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       is_active =
           builder->CreateTrunc(is_active, llvm::Type::getInt1Ty(*llvm_context));
       exec_cond = builder->CreateAnd(exec_cond, is_active);
+    } else if (snode->type == SNodeType::hash) {
+      auto is_active = call(snode, element.get("element"), "is_slot_active",
+                            {builder->CreateLoad(loop_index)});
+      is_active =
+          builder->CreateTrunc(is_active, llvm::Type::getInt1Ty(*llvm_context));
+      exec_cond = builder->CreateAnd(exec_cond, is_active);
     }
 
     builder->CreateCondBr(exec_cond, struct_for_body_bb, body_tail_bb);
@@ -1762,14 +1919,28 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       call("block_barrier");  // "__syncthreads()"
     }
 
-    if (stmt->tls_epilogue) {
+    if (spmd && stmt->tls_epilogue) {
       stmt->tls_epilogue->accept(this);
     }
   }
 
-  int list_element_size = std::min(leaf_block->max_num_elements(),
-                                   (int64)taichi_listgen_max_element_size);
+  if (!spmd) {
+    tls_epilogue = create_xlogue(stmt->tls_epilogue);
+    tls_combine = create_tls_combine(stmt);
+  }
+
+  // The elements of a hash node are its slots.
+  const int64 leaf_num_elements = leaf_block->type == SNodeType::hash
+                                      ? leaf_block->hash_table_size
+                                      : leaf_block->max_num_elements();
+  int list_element_size =
+      std::min(leaf_num_elements, (int64)taichi_listgen_max_element_size);
   int num_splits = std::max(1, list_element_size / stmt->block_dim);
+  if (!spmd && stmt->bls_prologue) {
+    // The BLS is filled once per element, so each element must be processed
+    // by a single task.
+    num_splits = 1;
+  }
 
   auto struct_for_func = get_runtime_function("parallel_struct_for");
 
@@ -1816,13 +1987,15 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       struct_for_func,
       {get_context(), tlctx->get_constant(leaf_block->id),
        tlctx->get_constant(list_element_size), tlctx->get_constant(num_splits),
-       body, tlctx->get_constant(stmt->tls_size),
+       body, tls_prologue, tls_epilogue, tls_combine,
+       tlctx->get_constant(stmt->tls_size),
        tlctx->get_constant(stmt->num_cpu_threads)});
   // TODO: why do we need num_cpu_threads on GPUs?
 
   current_coordinates = nullptr;
   parent_coordinates = nullptr;
   block_corner_coordinates = nullptr;
+  bls_buffer = nullptr;
 }
 
 void CodeGenLLVM::visit(LoopIndexStmt *stmt) {
@@ -1920,6 +2093,13 @@ void CodeGenLLVM::visit(InternalFuncStmt *stmt) {
   for (auto s : stmt->args) {
     args.push_back(llvm_val[s]);
   }
+  // These internal functions take the thread id as the last argument, like
+  // task functions.
+  static const std::unordered_set<std::string> funcs_taking_thread_id = {
+      "insert_triplet"};
+  if (funcs_taking_thread_id.count(stmt->func_name)) {
+    args.push_back(get_thread_id());
+  }
   llvm_val[stmt] = create_call(stmt->func_name, args);
 }
 
@@ -2006,16 +2186,27 @@ FunctionType CodeGenLLVM::compile_module_to_executable() {
   TI_AUTO_PROF
   eliminate_unused_functions();
 
-  tlctx->add_module(std::move(module));
+  auto *jit_module = tlctx->add_module(std::move(module));
+  return link_offloaded_tasks(
+      kernel_name, tlctx->jit->acquire_module(jit_module), offloaded_tasks);
+}
 
-  for (auto &task : offloaded_tasks) {
-    task.compile();
+FunctionType CodeGenLLVM::link_offloaded_tasks(
+    const std::string &kernel_name,
+    JITModuleRef module,
+    std::vector<OffloadedTask> tasks) {
+  {
+    // On CPUs, the module is compiled to machine code when its functions are
+    // looked up for the first time.
+    CompileProfiler::PhaseGuard _("llvm_jit_link", "llvm");
+    for (auto &task : tasks) {
+      task.compile(module.get());
+    }
   }
-  auto offloaded_tasks_local = offloaded_tasks;
-  auto kernel_name_ = kernel_name;
-  return [=](Context &context) {
-    TI_TRACE("Launching kernel {}", kernel_name_);
-    for (auto task : offloaded_tasks_local) {
+  // |module| is captured so that it is unloaded along with the function.
+  return [kernel_name, module, tasks](Context &context) {
+    TI_TRACE("Launching kernel {}", kernel_name);
+    for (auto task : tasks) {
       task(&context);
     }
   };
@@ -2048,13 +2239,25 @@ llvm::Value *CodeGenLLVM::get_tls_base_ptr() {
   return get_arg(1);
 }
 
+llvm::Value *CodeGenLLVM::get_thread_id() {
+  if (current_thread_id) {
+    return current_thread_id;
+  }
+  // Serial tasks run on the first thread of their thread pool.
+  return create_call("Context_get_cpu_thread_id_offset", {get_context()});
+}
+
+llvm::Type *CodeGenLLVM::get_thread_id_type() {
+  return tlctx->get_data_type<int>();
+}
+
 llvm::Type *CodeGenLLVM::get_tls_buffer_type() {
   return llvm::Type::getInt8PtrTy(*llvm_context);
 }
 
 std::vector<llvm::Type *> CodeGenLLVM::get_xlogue_argument_types() {
   return {llvm::PointerType::get(get_runtime_type("Context"), 0),
-          get_tls_buffer_type()};
+          get_tls_buffer_type(), get_thread_id_type()};
 }
 
 llvm::Type *CodeGenLLVM::get_xlogue_function_type() {
@@ -2062,6 +2265,16 @@ llvm::Type *CodeGenLLVM::get_xlogue_function_type() {
                                  get_xlogue_argument_types(), false);
 }
 
+std::vector<llvm::Type *> CodeGenLLVM::get_tls_combine_argument_types() {
+  return {llvm::PointerType::get(get_runtime_type("Context"), 0),
+          get_tls_buffer_type(), get_tls_buffer_type(), get_thread_id_type()};
+}
+
+llvm::Type *CodeGenLLVM::get_tls_combine_function_type() {
+  return llvm::FunctionType::get(llvm::Type::getVoidTy(*llvm_context),
+                                 get_tls_combine_argument_types(), false);
+}
+
 llvm::Value *CodeGenLLVM::get_root(int snode_tree_id) {
   return create_call("LLVMRuntime_get_roots",
                      {get_runtime(), tlctx->get_constant(snode_tree_id)});
@@ -2081,6 +2294,7 @@ llvm::Value *CodeGenLLVM::emit_struct_meta(SNode *snode) {
 
 void CodeGenLLVM::emit_to_module() {
   TI_AUTO_PROF
+  CompileProfiler::PhaseGuard _("llvm_emit_ir", "llvm");
   ir->accept(this);
 }
 
@@ -2106,4 +2320,94 @@ llvm::Value *CodeGenLLVM::create_xlogue(std::unique_ptr<Block> &block) {
   return xlogue;
 }
 
+llvm::Value *CodeGenLLVM::create_reduction_op(AtomicOpType op,
+                                              DataType dt,
+                                              llvm::Value *a,
+                                              llvm::Value *b) {
+  if (op == AtomicOpType::add) {
+    return is_real(dt) ? builder->CreateFAdd(a, b) : builder->CreateAdd(a, b);
+  } else if (op == AtomicOpType::min || op == AtomicOpType::max) {
+    bool is_min = op == AtomicOpType::min;
+    if (is_real(dt)) {
+      return is_min ? builder->CreateMinNum(a, b) : builder->CreateMaxNum(a, b);
+    }
+    llvm::Value *cond;
+    if (is_signed(dt)) {
+      cond = is_min ? builder->CreateICmpSLT(a, b)
+                    : builder->CreateICmpSGT(a, b);
+    } else {
+      cond = is_min ? builder->CreateICmpULT(a, b)
+                    : builder->CreateICmpUGT(a, b);
+    }
+    return builder->CreateSelect(cond, a, b);
+  } else if (op == AtomicOpType::bit_and) {
+    return builder->CreateAnd(a, b);
+  } else if (op == AtomicOpType::bit_or) {
+    return builder->CreateOr(a, b);
+  } else if (op == AtomicOpType::bit_xor) {
+    return builder->CreateXor(a, b);
+  } else {
+    TI_NOT_IMPLEMENTED
+  }
+}
+
+llvm::Value *CodeGenLLVM::create_tls_combine(OffloadedStmt *stmt) {
+  // Scalar reductions are cheap enough to be flushed once per thread.
+  bool has_privatized_fields = false;
+  for (const auto &reduction : stmt->tls_reductions) {
+    if (reduction.num_elements > 1)
+      has_privatized_fields = true;
+  }
+  if (!has_privatized_fields) {
+    return llvm::ConstantPointerNull::get(
+        llvm::PointerType::get(get_tls_combine_function_type(), 0));
+  }
+
+  auto guard = get_function_creation_guard(get_tls_combine_argument_types());
+  auto dst_buffer = get_arg(1);
+  auto src_buffer = get_arg(2);
+  // dst[i] = op(dst[i], src[i]) for each element of each reduction. Only the
+  // epilogue of the combined buffer runs, so the scalar reductions have to be
+  // combined as well.
+  for (const auto &reduction : stmt->tls_reductions) {
+    auto element_ptr_type =
+        llvm::PointerType::get(tlctx->get_data_type(reduction.dt), 0);
+    auto offset = tlctx->get_constant((int64)reduction.offset);
+    auto dst = builder->CreateBitCast(
+        builder->CreateGEP(dst_buffer, offset), element_ptr_type);
+    auto src = builder->CreateBitCast(
+        builder->CreateGEP(src_buffer, offset), element_ptr_type);
+
+    auto loop_test =
+        llvm::BasicBlock::Create(*llvm_context, "combine_test", func);
+    auto loop_body =
+        llvm::BasicBlock::Create(*llvm_context, "combine_body", func);
+    auto after_loop =
+        llvm::BasicBlock::Create(*llvm_context, "after_combine", func);
+    auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
+    builder->CreateStore(tlctx->get_constant(0), loop_var);
+    builder->CreateBr(loop_test);
+
+    builder->SetInsertPoint(loop_test);
+    auto i = builder->CreateLoad(loop_var);
+    builder->CreateCondBr(
+        builder->CreateICmpSLT(i, tlctx->get_constant(reduction.num_elements)),
+        loop_body, after_loop);
+
+    builder->SetInsertPoint(loop_body);
+    auto dst_ptr = builder->CreateGEP(dst, i);
+    auto src_ptr = builder->CreateGEP(src, i);
+    builder->CreateStore(
+        create_reduction_op(reduction.op, reduction.dt,
+                            builder->CreateLoad(dst_ptr),
+                            builder->CreateLoad(src_ptr)),
+        dst_ptr);
+    create_increment(loop_var, tlctx->get_constant(1));
+    builder->CreateBr(loop_test);
+
+    builder->SetInsertPoint(after_loop);
+  }
+  return guard.body;
+}
+
 TLANG_NAMESPACE_END
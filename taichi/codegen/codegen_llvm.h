@@ -1,6 +1,7 @@
 // The LLVM backend for CPUs/NVPTX/AMDGPU
 #pragma once
 
+#include <atomic>
 #include <set>
 #include <unordered_map>
 
@@ -29,15 +30,22 @@ class OffloadedTask {
 
   void end();
 
-  void compile();
+  // Resolves the task function in |module|. Task names are only unique within
+  // a process, so looking them up in the JIT session globally could pick a
+  // function loaded from the offline cache.
+  void compile(JITModule *module);
 
   void operator()(Context *context);
 };
 
+// Emits a function called by the runtime, e.g., the body of a parallel loop.
+// The last argument of the function must be the id of the thread running it,
+// which is available through CodeGenLLVM::get_thread_id() inside the function.
 class FunctionCreationGuard {
  public:
   CodeGenLLVM *mb;
   llvm::Function *old_func;
+  llvm::Value *old_thread_id;
   llvm::Function *body;
   llvm::BasicBlock *old_entry, *allocas, *entry;
   llvm::IRBuilder<>::InsertPoint ip;
@@ -49,7 +57,8 @@ class FunctionCreationGuard {
 
 class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
  public:
-  static uint64 task_counter;
+  // Kernels may be compiled concurrently. See Program::compile_kernels().
+  static std::atomic<uint64> task_counter;
 
   Kernel *kernel;
   IRNode *ir;
@@ -61,14 +70,22 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
   llvm::Value *current_coordinates;
   llvm::Value *parent_coordinates{nullptr};
   llvm::Value *block_corner_coordinates{nullptr};
-  llvm::GlobalVariable *bls_buffer{nullptr};
+  // A pointer to an i8 array holding the BLS of the current block. It lives
+  // in shared memory on CUDA, and on the stack of the block function on CPUs.
+  llvm::Value *bls_buffer{nullptr};
   // Mainly for supporting continue stmt
   llvm::BasicBlock *current_loop_reentry;
   // Mainly for supporting break stmt
   llvm::BasicBlock *current_while_after_loop;
+  // Set when the loop of an offloaded task is emitted inside the task function
+  // itself, where a top-level continue jumps here instead of returning.
+  llvm::BasicBlock *offloaded_loop_reentry{nullptr};
   llvm::FunctionType *task_function_type;
   std::unordered_map<Stmt *, llvm::Value *> llvm_val;
   llvm::Function *func;
+  // The thread id argument of |func|, or nullptr if |func| is an offloaded
+  // task function.
+  llvm::Value *current_thread_id{nullptr};
   OffloadedStmt *current_offload{nullptr};
   std::unique_ptr<OffloadedTask> current_task;
   std::vector<OffloadedTask> offloaded_tasks;
@@ -95,12 +112,22 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   llvm::Value *get_tls_base_ptr();
 
+  // Returns the id of the CPU thread running the current function, which is 0
+  // in serial tasks. It is not meaningful on GPUs.
+  llvm::Value *get_thread_id();
+
+  llvm::Type *get_thread_id_type();
+
   llvm::Type *get_tls_buffer_type();
 
   std::vector<llvm::Type *> get_xlogue_argument_types();
 
   llvm::Type *get_xlogue_function_type();
 
+  std::vector<llvm::Type *> get_tls_combine_argument_types();
+
+  llvm::Type *get_tls_combine_function_type();
+
   llvm::Value *get_root(int snode_tree_id);
 
   llvm::Value *get_runtime();
@@ -119,6 +146,13 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   virtual FunctionType compile_module_to_executable();
 
+  // Wraps the offloaded tasks of a kernel, which have been added to the JIT
+  // session as |module|, into a single launchable function. The function keeps
+  // |module| resident.
+  static FunctionType link_offloaded_tasks(const std::string &kernel_name,
+                                           JITModuleRef module,
+                                           std::vector<OffloadedTask> tasks);
+
   virtual FunctionType gen();
 
   // For debugging only
@@ -165,6 +199,12 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   llvm::Value *cast_int(llvm::Value *input_val, Type *from, Type *to);
 
+  // Conversions between f16 and f32 values. They use F16C instructions on x64
+  // hosts having them, and the software conversions in the runtime otherwise.
+  llvm::Value *create_f16_to_f32(llvm::Value *value);
+
+  llvm::Value *create_f32_to_f16(llvm::Value *value);
+
   virtual void emit_extra_unary(UnaryOpStmt *stmt);
 
   void visit(UnaryOpStmt *stmt) override;
@@ -347,6 +387,16 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   llvm::Value *create_xlogue(std::unique_ptr<Block> &block);
 
+  // Creates the function combining two TLS buffers of |stmt| on CPUs, or
+  // returns null if the TLS holds no per-thread copies of fields. See
+  // cpu_thread_local_storage in the runtime.
+  llvm::Value *create_tls_combine(OffloadedStmt *stmt);
+
+  llvm::Value *create_reduction_op(AtomicOpType op,
+                                   DataType dt,
+                                   llvm::Value *a,
+                                   llvm::Value *b);
+
   llvm::Value *extract_exponent_from_float(llvm::Value *f);
 
   llvm::Value *extract_digits_from_float(llvm::Value *f, bool full);
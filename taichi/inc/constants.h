@@ -26,6 +26,9 @@ constexpr std::size_t taichi_result_buffer_runtime_query_id = 2;
 
 constexpr int taichi_listgen_max_element_size = 1024;
 
+constexpr int taichi_sparse_matrix_chunk_size = 1024;
+constexpr int taichi_sparse_matrix_thread_chunk_stride = 8;
+
 template <typename T, typename G>
 T taichi_union_cast_with_different_sizes(G g) {
   union {
@@ -197,6 +197,23 @@ bool same_value(
     Stmt *stmt2,
     const std::optional<std::unordered_map<int, int>> &id_map = std::nullopt);
 
+/**
+ * Hashes the structure of root, i.e., the types, fields and operands of the
+ * statements in it. Statements that are same_statements() have the same hash,
+ * regardless of their ids.
+ *
+ * @param root
+ *   The root to hash.
+ *
+ * @param block_hash_cache
+ *   If not nullptr, the hashes of the Blocks in root are looked up in and
+ *   stored to it. The caller must make sure that the cached Blocks are not
+ *   modified between calls.
+ */
+uint64 structural_hash(
+    IRNode *root,
+    std::unordered_map<const Block *, uint64> *block_hash_cache = nullptr);
+
 DiffRange value_diff_loop_index(Stmt *stmt, Stmt *loop, int index_id);
 
 /**
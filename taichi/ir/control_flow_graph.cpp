@@ -10,6 +10,62 @@
 namespace taichi {
 namespace lang {
 
+namespace {
+
+bool is_local_variable(const Stmt *var) {
+  return var->is<AllocaStmt>() || var->is<AdStackAllocaStmt>();
+}
+
+template <typename StmtSet>
+bool may_contain_variable_impl(const StmtSet &var_set, Stmt *var) {
+  if (var_set.count(var))
+    return true;
+  if (is_local_variable(var))
+    return false;
+  // TODO: How to optimize this?
+  return std::any_of(var_set.begin(), var_set.end(), [&](Stmt *set_var) {
+    return irpass::analysis::maybe_same_address(var, set_var);
+  });
+}
+
+}  // namespace
+
+int StmtNumbering::insert(Stmt *stmt) {
+  auto [it, inserted] = ids_.emplace(stmt, (int)stmts_.size());
+  if (inserted) {
+    stmts_.push_back(stmt);
+  }
+  return it->second;
+}
+
+int StmtNumbering::find(const Stmt *stmt) const {
+  auto it = ids_.find(stmt);
+  return it == ids_.end() ? -1 : it->second;
+}
+
+void StmtNumbering::clear() {
+  ids_.clear();
+  stmts_.clear();
+}
+
+StmtBitSet::StmtBitSet(const StmtNumbering *numbering)
+    : numbering_(numbering), bits_(numbering->size()) {
+}
+
+void StmtBitSet::insert(Stmt *stmt) {
+  auto id = numbering_->find(stmt);
+  TI_ASSERT(id != -1);
+  bits_[id] = true;
+}
+
+std::size_t StmtBitSet::count(const Stmt *stmt) const {
+  if (!numbering_) {
+    return 0;
+  }
+  auto id = numbering_->find(stmt);
+  return id != -1 && bits_.test(id);
+}
+
 CFGNode::CFGNode(Block *block,
                  int begin_location,
                  int end_location,
@@ -85,7 +141,7 @@ void CFGNode::replace_with(int location,
 
 bool CFGNode::contain_variable(const std::unordered_set<Stmt *> &var_set,
                                Stmt *var) {
-  if (var->is<AllocaStmt>() || var->is<AdStackAllocaStmt>()) {
+  if (is_local_variable(var)) {
     return var_set.find(var) != var_set.end();
   } else {
     // TODO: How to optimize this?
@@ -99,16 +155,11 @@ bool CFGNode::contain_variable(const std::unordered_set<Stmt *> &var_set,
 
 bool CFGNode::may_contain_variable(const std::unordered_set<Stmt *> &var_set,
                                    Stmt *var) {
-  if (var->is<AllocaStmt>() || var->is<AdStackAllocaStmt>()) {
-    return var_set.find(var) != var_set.end();
-  } else {
-    // TODO: How to optimize this?
-    if (var_set.find(var) != var_set.end())
-      return true;
-    return std::any_of(var_set.begin(), var_set.end(), [&](Stmt *set_var) {
-      return irpass::analysis::maybe_same_address(var, set_var);
-    });
-  }
+  return may_contain_variable_impl(var_set, var);
+}
+
+bool CFGNode::may_contain_variable(const StmtBitSet &var_set, Stmt *var) {
+  return may_contain_variable_impl(var_set, var);
 }
 
 bool CFGNode::reach_kill_variable(Stmt *var) const {
@@ -360,7 +411,7 @@ void CFGNode::gather_loaded_snodes(std::unordered_set<SNode *> &snodes) const {
         if (already_loaded) {
           continue;
         }
-        if (reach_in.find(global_ptr) != reach_in.end() &&
+        if (reach_in.count(global_ptr) &&
             !contain_variable(killed_in_this_node, global_ptr)) {
           // The UD-chain contains the value before this offloaded task.
           for (auto &snode : global_ptr->snodes.data) {
@@ -617,11 +668,25 @@ void ControlFlowGraph::print_graph_structure() const {
   }
 }
 
+std::pair<std::vector<std::vector<int>>, std::vector<std::vector<int>>>
+ControlFlowGraph::get_edge_ids() const {
+  const int num_nodes = size();
+  std::unordered_map<CFGNode *, int> node_ids;
+  for (int i = 0; i < num_nodes; i++)
+    node_ids[nodes[i].get()] = i;
+  std::vector<std::vector<int>> prev_ids(num_nodes), next_ids(num_nodes);
+  for (int i = 0; i < num_nodes; i++) {
+    for (auto prev_node : nodes[i]->prev)
+      prev_ids[i].push_back(node_ids[prev_node]);
+    for (auto next_node : nodes[i]->next)
+      next_ids[i].push_back(node_ids[next_node]);
+  }
+  return {std::move(prev_ids), std::move(next_ids)};
+}
+
 void ControlFlowGraph::reaching_definition_analysis(bool after_lower_access) {
   TI_AUTO_PROF;
   const int num_nodes = size();
-  std::queue<CFGNode *> to_visit;
-  std::unordered_map<CFGNode *, bool> in_queue;
   TI_ASSERT(nodes[start_node]->empty());
   nodes[start_node]->reach_gen.clear();
   nodes[start_node]->reach_kill.clear();
@@ -635,7 +700,9 @@ void ControlFlowGraph::reaching_definition_analysis(bool after_lower_access) {
             (stmt->is<PtrOffsetStmt>() &&
              stmt->cast<PtrOffsetStmt>()->origin->is<GlobalTemporaryStmt>()) ||
             (stmt->is<PtrOffsetStmt>() &&
-             stmt->cast<PtrOffsetStmt>()->is_unlowered_global_ptr())) {
+             stmt->cast<PtrOffsetStmt>()->is_unlowered_global_ptr()) ||
+            (stmt->is<PtrOffsetStmt>() &&
+             stmt->cast<PtrOffsetStmt>()->is_thread_local_ptr())) {
           // TODO: unify them
           // A global pointer that may contain some data before this kernel.
           nodes[start_node]->reach_gen.insert(stmt);
@@ -647,49 +714,94 @@ void ControlFlowGraph::reaching_definition_analysis(bool after_lower_access) {
     if (i != start_node) {
       nodes[i]->reaching_definition_analysis(after_lower_access);
     }
-    nodes[i]->reach_in.clear();
-    nodes[i]->reach_out = nodes[i]->reach_gen;
-    to_visit.push(nodes[i].get());
-    in_queue[nodes[i].get()] = true;
   }
 
-  // The worklist algorithm.
-  while (!to_visit.empty()) {
-    auto now = to_visit.front();
-    to_visit.pop();
-    in_queue[now] = false;
-
-    now->reach_in.clear();
-    for (auto prev_node : now->prev) {
-      now->reach_in.insert(prev_node->reach_out.begin(),
-                           prev_node->reach_out.end());
-    }
-    auto old_out = std::move(now->reach_out);
-    now->reach_out = now->reach_gen;
-    for (auto stmt : now->reach_in) {
+  // Number the definitions. A definition is killed by a node if all the
+  // variables it stores to are killed. The definitions storing to a single
+  // local variable are indexed by the variable, so that their kills are
+  // hash lookups; the others are checked one by one.
+  reach_stmts_.clear();
+  std::unordered_map<Stmt *, std::vector<int>> local_definitions;
+  std::vector<std::pair<int, std::vector<Stmt *>>> other_definitions;
+  for (int i = 0; i < num_nodes; i++) {
+    for (auto stmt : nodes[i]->reach_gen) {
+      const int num_stmts = reach_stmts_.size();
+      const int id = reach_stmts_.insert(stmt);
+      if (id != num_stmts) {
+        continue;  // already numbered
+      }
       auto store_ptrs = irpass::analysis::get_store_destination(stmt);
-      bool killed;
       if (store_ptrs.empty()) {  // the case of a global pointer
-        killed = now->reach_kill_variable(stmt);
+        store_ptrs.push_back(stmt);
+      }
+      if (store_ptrs.size() == 1 && is_local_variable(store_ptrs[0])) {
+        local_definitions[store_ptrs[0]].push_back(id);
       } else {
-        killed = true;
-        for (auto store_ptr : store_ptrs) {
-          if (!now->reach_kill_variable(store_ptr)) {
-            killed = false;
-            break;
+        other_definitions.emplace_back(id, std::move(store_ptrs));
+      }
+    }
+  }
+  const int num_definitions = reach_stmts_.size();
+
+  std::vector<bit::Bitset> gen(num_nodes), preserved(num_nodes);
+  for (int i = 0; i < num_nodes; i++) {
+    auto now = nodes[i].get();
+    StmtBitSet now_gen(&reach_stmts_);
+    for (auto stmt : now->reach_gen) {
+      now_gen.insert(stmt);
+    }
+    gen[i] = std::move(now_gen.bits());
+    preserved[i] = ~bit::Bitset(num_definitions);
+    if (!now->reach_kill.empty()) {
+      for (auto var : now->reach_kill) {
+        auto it = local_definitions.find(var);
+        if (it != local_definitions.end()) {
+          for (auto id : it->second) {
+            preserved[i][id] = false;
           }
         }
       }
-      if (!killed) {
-        now->reach_out.insert(stmt);
+      for (auto &[id, store_ptrs] : other_definitions) {
+        if (std::all_of(store_ptrs.begin(), store_ptrs.end(),
+                        [&](Stmt *store_ptr) {
+                          return now->reach_kill_variable(store_ptr);
+                        })) {
+          preserved[i][id] = false;
+        }
       }
     }
-    if (now->reach_out != old_out) {
+    now->reach_in = StmtBitSet(&reach_stmts_);
+    now->reach_out = StmtBitSet(&reach_stmts_);
+    now->reach_out.bits() = gen[i];
+  }
+
+  // The worklist algorithm.
+  auto [prev_ids, next_ids] = get_edge_ids();
+  std::queue<int> to_visit;
+  std::vector<bool> in_queue(num_nodes, true);
+  for (int i = 0; i < num_nodes; i++) {
+    to_visit.push(i);
+  }
+  while (!to_visit.empty()) {
+    const int i = to_visit.front();
+    to_visit.pop();
+    in_queue[i] = false;
+    auto now = nodes[i].get();
+
+    auto &reach_in = now->reach_in.bits();
+    reach_in.reset();
+    for (auto prev_id : prev_ids[i]) {
+      reach_in |= nodes[prev_id]->reach_out.bits();
+    }
+    auto reach_out = reach_in & preserved[i];
+    reach_out |= gen[i];
+    if (reach_out != now->reach_out.bits()) {
       // changed
-      for (auto next_node : now->next) {
-        if (!in_queue[next_node]) {
-          to_visit.push(next_node);
-          in_queue[next_node] = true;
+      now->reach_out.bits() = std::move(reach_out);
+      for (auto next_id : next_ids[i]) {
+        if (!in_queue[next_id]) {
+          to_visit.push(next_id);
+          in_queue[next_id] = true;
         }
       }
     }
@@ -701,8 +813,6 @@ void ControlFlowGraph::live_variable_analysis(
     const std::optional<LiveVarAnalysisConfig> &config_opt) {
   TI_AUTO_PROF;
   const int num_nodes = size();
-  std::queue<CFGNode *> to_visit;
-  std::unordered_map<CFGNode *, bool> in_queue;
   TI_ASSERT(nodes[final_node]->empty());
   nodes[final_node]->live_gen.clear();
   nodes[final_node]->live_kill.clear();
@@ -733,41 +843,82 @@ void ControlFlowGraph::live_variable_analysis(
       }
     }
   }
-  for (int i = num_nodes - 1; i >= 0; i--) {
-    // push into the queue in reversed order to make it slightly faster
+  for (int i = 0; i < num_nodes; i++) {
     if (i != final_node) {
       nodes[i]->live_variable_analysis(after_lower_access);
     }
-    nodes[i]->live_out.clear();
-    nodes[i]->live_in = nodes[i]->live_gen;
-    to_visit.push(nodes[i].get());
-    in_queue[nodes[i].get()] = true;
+  }
+
+  // Number the variables. Only the variables in some live_gen can be live.
+  live_stmts_.clear();
+  std::vector<Stmt *> non_local_variables;
+  for (int i = 0; i < num_nodes; i++) {
+    for (auto stmt : nodes[i]->live_gen) {
+      const int num_stmts = live_stmts_.size();
+      if (live_stmts_.insert(stmt) == num_stmts && !is_local_variable(stmt)) {
+        non_local_variables.push_back(stmt);
+      }
+    }
+  }
+  const int num_variables = live_stmts_.size();
+
+  std::vector<bit::Bitset> gen(num_nodes), preserved(num_nodes);
+  for (int i = 0; i < num_nodes; i++) {
+    auto now = nodes[i].get();
+    StmtBitSet now_gen(&live_stmts_);
+    for (auto stmt : now->live_gen) {
+      now_gen.insert(stmt);
+    }
+    gen[i] = std::move(now_gen.bits());
+    preserved[i] = ~bit::Bitset(num_variables);
+    if (!now->live_kill.empty()) {
+      for (auto var : now->live_kill) {
+        // Local variables are killed only by themselves.
+        if (is_local_variable(var)) {
+          if (auto id = live_stmts_.find(var); id != -1) {
+            preserved[i][id] = false;
+          }
+        }
+      }
+      for (auto var : non_local_variables) {
+        if (CFGNode::contain_variable(now->live_kill, var)) {
+          preserved[i][live_stmts_.find(var)] = false;
+        }
+      }
+    }
+    now->live_out = StmtBitSet(&live_stmts_);
+    now->live_in = StmtBitSet(&live_stmts_);
+    now->live_in.bits() = gen[i];
   }
 
   // The worklist algorithm.
+  auto [prev_ids, next_ids] = get_edge_ids();
+  std::queue<int> to_visit;
+  std::vector<bool> in_queue(num_nodes, true);
+  for (int i = num_nodes - 1; i >= 0; i--) {
+    // push into the queue in reversed order to make it slightly faster
+    to_visit.push(i);
+  }
   while (!to_visit.empty()) {
-    auto now = to_visit.front();
+    const int i = to_visit.front();
     to_visit.pop();
-    in_queue[now] = false;
+    in_queue[i] = false;
+    auto now = nodes[i].get();
 
-    now->live_out.clear();
-    for (auto next_node : now->next) {
-      now->live_out.insert(next_node->live_in.begin(),
-                           next_node->live_in.end());
-    }
-    auto old_in = std::move(now->live_in);
-    now->live_in = now->live_gen;
-    for (auto stmt : now->live_out) {
-      if (!CFGNode::contain_variable(now->live_kill, stmt)) {
-        now->live_in.insert(stmt);
-      }
+    auto &live_out = now->live_out.bits();
+    live_out.reset();
+    for (auto next_id : next_ids[i]) {
+      live_out |= nodes[next_id]->live_in.bits();
     }
-    if (now->live_in != old_in) {
+    auto live_in = live_out & preserved[i];
+    live_in |= gen[i];
+    if (live_in != now->live_in.bits()) {
       // changed
-      for (auto prev_node : now->prev) {
-        if (!in_queue[prev_node]) {
-          to_visit.push(prev_node);
-          in_queue[prev_node] = true;
+      now->live_in.bits() = std::move(live_in);
+      for (auto prev_id : prev_ids[i]) {
+        if (!in_queue[prev_id]) {
+          to_visit.push(prev_id);
+          in_queue[prev_id] = true;
         }
       }
     }
@@ -879,7 +1030,7 @@ std::unordered_set<SNode *> ControlFlowGraph::gather_loaded_snodes() {
   // output_value_state = merge(input_value_state, written_part)
   //
   // Therefore we include the nodes[final_node]->reach_in in snodes.
-  for (auto &stmt : nodes[final_node]->reach_in) {
+  for (auto stmt : nodes[final_node]->reach_in) {
     if (auto global_ptr = stmt->cast<GlobalPtrStmt>()) {
       for (auto &snode : global_ptr->snodes.data) {
         snodes.insert(snode);
@@ -1,13 +1,121 @@
 #pragma once
 
+#include <iterator>
 #include <optional>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "taichi/ir/ir.h"
+#include "taichi/util/bit.h"
 
 namespace taichi {
 namespace lang {
 
+/**
+ * Dense ids of the statements taking part in a dataflow analysis, so that
+ * sets of them can be stored as bit vectors.
+ */
+class StmtNumbering {
+ public:
+  // Returns the id of |stmt|, numbering it if it is new.
+  int insert(Stmt *stmt);
+
+  // Returns the id of |stmt|, or -1 if it is not numbered.
+  int find(const Stmt *stmt) const;
+
+  Stmt *operator[](int id) const {
+    return stmts_[id];
+  }
+
+  int size() const {
+    return (int)stmts_.size();
+  }
+
+  void clear();
+
+ private:
+  std::unordered_map<const Stmt *, int> ids_;
+  std::vector<Stmt *> stmts_;
+};
+
+/**
+ * A set of statements numbered by a StmtNumbering, stored as a bit vector.
+ * Iteration follows the order of the ids.
+ */
+class StmtBitSet {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Stmt *;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Stmt *const *;
+    using reference = Stmt *;
+
+    iterator(const StmtBitSet *set, int id) : set_(set), id_(id) {
+    }
+
+    Stmt *operator*() const {
+      return (*set_->numbering_)[id_];
+    }
+
+    iterator &operator++() {
+      id_ = set_->bits_.lower_bound(id_ + 1);
+      return *this;
+    }
+
+    bool operator==(const iterator &other) const {
+      return id_ == other.id_;
+    }
+
+    bool operator!=(const iterator &other) const {
+      return id_ != other.id_;
+    }
+
+   private:
+    const StmtBitSet *set_;
+    int id_;
+  };
+
+  StmtBitSet() = default;
+
+  // An empty set which can hold any statement in |numbering|.
+  explicit StmtBitSet(const StmtNumbering *numbering);
+
+  // |stmt| must be numbered.
+  void insert(Stmt *stmt);
+
+  std::size_t count(const Stmt *stmt) const;
+
+  bool empty() const {
+    return bits_.none();
+  }
+
+  void clear() {
+    bits_.reset();
+  }
+
+  iterator begin() const {
+    return iterator(this, bits_.lower_bound(0));
+  }
+
+  iterator end() const {
+    return iterator(this, -1);
+  }
+
+  bit::Bitset &bits() {
+    return bits_;
+  }
+
+  const bit::Bitset &bits() const {
+    return bits_;
+  }
+
+ private:
+  const StmtNumbering *numbering_{nullptr};
+  bit::Bitset bits_;
+};
+
 /**
  * A basic block in control-flow graph.
  * A CFGNode contains a reference to a part of the CHI IR, or more precisely,
@@ -38,11 +146,13 @@ class CFGNode {
 
   // Reaching definition analysis
   // https://en.wikipedia.org/wiki/Reaching_definition
-  std::unordered_set<Stmt *> reach_gen, reach_kill, reach_in, reach_out;
+  std::unordered_set<Stmt *> reach_gen, reach_kill;
+  StmtBitSet reach_in, reach_out;
 
   // Live variable analysis
   // https://en.wikipedia.org/wiki/Live_variable_analysis
-  std::unordered_set<Stmt *> live_gen, live_kill, live_in, live_out;
+  std::unordered_set<Stmt *> live_gen, live_kill;
+  StmtBitSet live_in, live_out;
 
   CFGNode(Block *block,
           int begin_location,
@@ -71,6 +181,7 @@ class CFGNode {
                                Stmt *var);
   static bool may_contain_variable(const std::unordered_set<Stmt *> &var_set,
                                    Stmt *var);
+  static bool may_contain_variable(const StmtBitSet &var_set, Stmt *var);
   bool reach_kill_variable(Stmt *var) const;
   Stmt *get_store_forwarding_data(Stmt *var, int position) const;
 
@@ -87,6 +198,13 @@ class ControlFlowGraph {
   // Erase an empty node.
   void erase(int node_id);
 
+  // Returns the ids of the predecessors and the successors of each node.
+  std::pair<std::vector<std::vector<int>>, std::vector<std::vector<int>>>
+  get_edge_ids() const;
+
+  // The statements in CFGNode::reach_* and CFGNode::live_* respectively.
+  StmtNumbering reach_stmts_, live_stmts_;
+
  public:
   struct LiveVarAnalysisConfig {
     // This is mostly useful for SFG task-level dead store elimination. SFG may
@@ -111,7 +229,8 @@ class ControlFlowGraph {
 
   /**
    * Perform reaching definition analysis using the worklist algorithm,
-   * and store the results in CFGNodes.
+   * and store the results in CFGNodes. The definitions are numbered densely,
+   * so that the iterations only operate on bit vectors.
    * https://en.wikipedia.org/wiki/Reaching_definition
    *
    * @param after_lower_access
@@ -121,7 +240,8 @@ class ControlFlowGraph {
 
   /**
    * Perform live variable analysis using the worklist algorithm,
-   * and store the results in CFGNodes.
+   * and store the results in CFGNodes. The variables are numbered densely,
+   * so that the iterations only operate on bit vectors.
    * https://en.wikipedia.org/wiki/Live_variable_analysis
    *
    * @param after_lower_access
@@ -96,6 +96,10 @@ bool StmtFieldSNode::equal(const StmtField *other_generic) const {
   }
 }
 
+std::size_t StmtFieldSNode::hash() const {
+  return std::hash<int>{}(get_snode_id(snode));
+}
+
 bool StmtFieldMemoryAccessOptions::equal(const StmtField *other_generic) const {
   if (auto other =
           dynamic_cast<const StmtFieldMemoryAccessOptions *>(other_generic)) {
@@ -106,6 +110,21 @@ bool StmtFieldMemoryAccessOptions::equal(const StmtField *other_generic) const {
   }
 }
 
+std::size_t StmtFieldMemoryAccessOptions::hash() const {
+  // Independent of the iteration order of the unordered containers.
+  std::size_t ret = 0;
+  for (const auto &[snode, flags] : opt_.get_all()) {
+    // The flags are stored in the lowest bits.
+    std::size_t snode_hash =
+        (std::size_t)(StmtFieldSNode::get_snode_id(snode) + 1) << 8;
+    for (auto flag : flags) {
+      snode_hash |= (std::size_t)1 << (int)flag;
+    }
+    ret += std::hash<std::size_t>{}(snode_hash) * 100000007UL;
+  }
+  return ret;
+}
+
 bool StmtFieldManager::equal(StmtFieldManager &other) const {
   if (fields.size() != other.fields.size()) {
     return false;
@@ -119,6 +138,14 @@ bool StmtFieldManager::equal(StmtFieldManager &other) const {
   return true;
 }
 
+std::size_t StmtFieldManager::hash() const {
+  std::size_t ret = fields.size();
+  for (const auto &field : fields) {
+    ret = ret * 100000007UL + field->hash();
+  }
+  return ret;
+}
+
 std::atomic<int> Stmt::instance_id_counter(0);
 
 Stmt::Stmt() : field_manager(this), fields_registered(false) {
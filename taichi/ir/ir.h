@@ -388,9 +388,35 @@ class StmtField {
 
   virtual bool equal(const StmtField *other) const = 0;
 
+  // Fields that are equal() must have the same hash.
+  virtual std::size_t hash() const = 0;
+
   virtual ~StmtField() = default;
 };
 
+template <typename T>
+std::size_t hash_stmt_field_value(const T &value) {
+  if constexpr (std::is_enum<T>::value) {
+    return std::hash<std::underlying_type_t<T>>{}(
+        (std::underlying_type_t<T>)value);
+  } else if constexpr (std::is_same<T, DataType>::value) {
+    // Types are uniqued by TypeFactory, so DataType::operator== compares
+    // pointers.
+    return std::hash<const Type *>{}(value);
+  } else if constexpr (std::is_same<T, TypedConstant>::value) {
+    return value.hash();
+  } else if constexpr (is_specialization<T, std::unordered_set>::value) {
+    // Independent of the iteration order.
+    std::size_t ret = value.size();
+    for (const auto &element : value) {
+      ret += hash_stmt_field_value(element);
+    }
+    return ret;
+  } else {
+    return std::hash<T>{}(value);
+  }
+}
+
 template <typename T>
 class StmtFieldNumeric final : public StmtField {
  private:
@@ -422,6 +448,14 @@ class StmtFieldNumeric final : public StmtField {
       return false;
     }
   }
+
+  std::size_t hash() const override {
+    if (std::holds_alternative<T *>(value)) {
+      return hash_stmt_field_value(*std::get<T *>(value));
+    } else {
+      return hash_stmt_field_value(std::get<T>(value));
+    }
+  }
 };
 
 class StmtFieldSNode final : public StmtField {
@@ -435,6 +469,8 @@ class StmtFieldSNode final : public StmtField {
   static int get_snode_id(SNode *snode);
 
   bool equal(const StmtField *other_generic) const override;
+
+  std::size_t hash() const override;
 };
 
 class StmtFieldMemoryAccessOptions final : public StmtField {
@@ -447,6 +483,8 @@ class StmtFieldMemoryAccessOptions final : public StmtField {
   }
 
   bool equal(const StmtField *other_generic) const override;
+
+  std::size_t hash() const override;
 };
 
 class StmtFieldManager {
@@ -474,6 +512,8 @@ class StmtFieldManager {
   }
 
   bool equal(StmtFieldManager &other) const;
+
+  std::size_t hash() const;
 };
 
 #define TI_STMT_DEF_FIELDS(...) TI_IO_DEF(__VA_ARGS__)
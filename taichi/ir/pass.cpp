@@ -1,9 +1,103 @@
 #include "taichi/ir/pass.h"
 
+#include <map>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/system/timer.h"
+
 namespace taichi {
 namespace lang {
 
 const PassID Pass::id = "undefined";
 
+void AnalysisManager::invalidate() {
+  for (auto it = result_.begin(); it != result_.end();) {
+    if (preserved_.count(it->first)) {
+      ++it;
+    } else {
+      it = result_.erase(it);
+    }
+  }
+}
+
+bool PassManager::run_impl(const PassID &name,
+                           bool skip_if_unmodified,
+                           const std::function<bool()> &pass) {
+  PassRecord record;
+  record.name = name;
+  if (skip_if_unmodified) {
+    auto it = version_after_pass_.find(name);
+    if (it != version_after_pass_.end() && it->second == ir_version_) {
+      record.begin = Time::get_time();
+      record.skipped = true;
+      records_.push_back(record);
+      return false;
+    }
+  }
+  if (profiled_ir_) {
+    record.stmts_before = count_profiled_ir_statements();
+  }
+  record.begin = Time::get_time();
+  record.modified = pass();
+  record.seconds = Time::get_time() - record.begin;
+  if (record.modified) {
+    invalidate();
+  }
+  if (profiled_ir_) {
+    record.stmts_after = count_profiled_ir_statements();
+  }
+  records_.push_back(record);
+  version_after_pass_[name] = ir_version_;
+  return record.modified;
+}
+
+int PassManager::count_profiled_ir_statements() {
+  if (counted_ir_version_ != ir_version_) {
+    num_stmts_ = irpass::analysis::count_statements(profiled_ir_);
+    counted_ir_version_ = ir_version_;
+  }
+  return num_stmts_;
+}
+
+void PassManager::run_analysis(const PassID &name,
+                               const std::function<void()> &analysis) {
+  run_impl(name, /*skip_if_unmodified=*/true, [&analysis]() {
+    analysis();
+    return false;
+  });
+}
+
+void PassManager::invalidate() {
+  ir_version_++;
+  amgr_.invalidate();
+}
+
+std::string PassManager::get_timing_summary() const {
+  struct Summary {
+    double seconds{0};
+    int runs{0};
+    int skipped{0};
+  };
+  std::map<PassID, Summary> summaries;
+  double total = 0;
+  for (const auto &record : records_) {
+    auto &summary = summaries[record.name];
+    summary.seconds += record.seconds;
+    summary.runs++;
+    summary.skipped += record.skipped;
+    total += record.seconds;
+  }
+  std::string result =
+      fmt::format("[{}] {:.3f} ms in passes:", name_, total * 1000);
+  for (const auto &[name, summary] : summaries) {
+    result += fmt::format("\n  {:>32}: {:9.3f} ms, {} runs", name,
+                          summary.seconds * 1000, summary.runs);
+    if (summary.skipped) {
+      result += fmt::format(" ({} skipped)", summary.skipped);
+    }
+  }
+  return result;
+}
+
 }  // namespace lang
 }  // namespace taichi
@@ -3,7 +3,10 @@
 #include "taichi/ir/ir.h"
 #include "taichi/program/compile_config.h"
 
+#include <functional>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <typeindex>
 #include <utility>
 
@@ -79,8 +82,120 @@ class AnalysisManager {
     result_[PassT::id] = std::make_unique<ResultModelT>(std::move(result));
   }
 
+  // Keeps the result of PassT in invalidate(). This is for the results which
+  // are meant to be used after the IR is modified, e.g., the ones keyed by
+  // offloaded tasks.
+  template <typename PassT>
+  void preserve() {
+    preserved_.insert(PassT::id);
+  }
+
+  // Discards the results which may be out of date after the IR is modified.
+  void invalidate();
+
  private:
   std::unordered_map<PassID, std::unique_ptr<AnalysisResultConcept>> result_;
+  std::unordered_set<PassID> preserved_;
+};
+
+/**
+ * Runs the passes of a compilation pipeline on an IR, and tracks whether they
+ * modify it. Every modification bumps the version of the IR and invalidates
+ * the cached analyses, so that idempotent passes (e.g., full_simplify) and
+ * analyses (e.g., verify) can be skipped when the IR has not changed since
+ * they last ran. The time spent in each pass is recorded.
+ */
+class PassManager {
+ public:
+  struct PassRecord {
+    PassID name;
+    double begin{0};
+    double seconds{0};
+    bool skipped{false};
+    bool modified{false};
+    // The number of statements of the IR, -1 if not counted. See
+    // set_profiled_ir().
+    int stmts_before{-1};
+    int stmts_after{-1};
+  };
+
+  explicit PassManager(const std::string &name) : name_(name) {
+  }
+
+  // Runs |pass|. A pass returning a bool tells whether it modified the IR; a
+  // pass returning void is assumed to modify the IR.
+  template <typename Func>
+  bool run(const PassID &name, const Func &pass) {
+    return run_impl(name, /*skip_if_unmodified=*/false, to_status(pass));
+  }
+
+  // Same as run(), but skips |pass| if the IR has not been modified since
+  // |pass| last ran. |pass| must reach a fixed point, i.e., running it twice
+  // in a row must not modify the IR the second time.
+  template <typename Func>
+  bool run_if_modified(const PassID &name, const Func &pass) {
+    return run_impl(name, /*skip_if_unmodified=*/true, to_status(pass));
+  }
+
+  // Runs |analysis|, which must not modify the IR, unless the IR has not been
+  // modified since |analysis| last ran.
+  void run_analysis(const PassID &name, const std::function<void()> &analysis);
+
+  // Counts the statements of |ir| before and after each pass. This is for
+  // profiling only, since counting takes time linear in the size of the IR.
+  void set_profiled_ir(IRNode *ir) {
+    profiled_ir_ = ir;
+  }
+
+  // Must be called after modifying the IR outside the passes run by this
+  // manager.
+  void invalidate();
+
+  const std::string &get_name() const {
+    return name_;
+  }
+
+  AnalysisManager *get_analysis_manager() {
+    return &amgr_;
+  }
+
+  const std::vector<PassRecord> &get_records() const {
+    return records_;
+  }
+
+  // The time, the number of runs and the number of skipped runs of each pass.
+  std::string get_timing_summary() const;
+
+ private:
+  template <typename Func>
+  static std::function<bool()> to_status(const Func &pass) {
+    if constexpr (std::is_void_v<std::invoke_result_t<const Func &>>) {
+      return [&pass]() {
+        pass();
+        return true;
+      };
+    } else {
+      return [&pass]() -> bool { return pass(); };
+    }
+  }
+
+  bool run_impl(const PassID &name,
+                bool skip_if_unmodified,
+                const std::function<bool()> &pass);
+
+  int count_profiled_ir_statements();
+
+  std::string name_;
+  AnalysisManager amgr_;
+  // Increases whenever the IR is modified.
+  int64 ir_version_{0};
+  // The version of the IR after each pass last ran.
+  std::unordered_map<PassID, int64> version_after_pass_;
+  std::vector<PassRecord> records_;
+  IRNode *profiled_ir_{nullptr};
+  // The number of statements of |profiled_ir_| at |counted_ir_version_|.
+  int num_stmts_{-1};
+  int64 counted_ir_version_{-1};
 };
 
 }  // namespace lang
@@ -39,11 +39,6 @@ SNode &SNode::create_node(std::vector<Axis> axes,
     sizes = std::vector<int>(axes.size(), sizes[0]);
   }
 
-  if (type == SNodeType::hash)
-    TI_ASSERT_INFO(depth == 0,
-                   "hashed node must be child of root due to initialization "
-                   "memset limitation.");
-
   auto &new_node = insert_children(type);
   for (int i = 0; i < (int)axes.size(); i++) {
     TI_ASSERT(sizes[i] > 0);
@@ -121,6 +116,23 @@ SNode &SNode::dynamic(const Axis &expr, int n, int chunk_size, bool packed) {
   return snode;
 }
 
+SNode &SNode::hash(const std::vector<Axis> &axes,
+                   const std::vector<int> &sizes,
+                   int capacity,
+                   bool packed) {
+  auto &snode = create_node(axes, sizes, SNodeType::hash, packed);
+  if (capacity <= 0) {
+    capacity = (int)std::min(snode.max_num_elements(), (int64)65536);
+  }
+  constexpr int kMaxHashTableSize = 1 << 30;
+  TI_ERROR_IF(capacity > kMaxHashTableSize / 2,
+              "Hash SNode capacity {} exceeded limit={}.", capacity,
+              kMaxHashTableSize / 2);
+  // Keep the load factor of the table at most 0.5 for short probes.
+  snode.hash_table_size = (int)bit::least_pot_bound(2 * capacity);
+  return snode;
+}
+
 SNode &SNode::bit_struct(int num_bits, bool packed) {
   auto &snode = create_node({}, {}, SNodeType::bit_struct, packed);
   snode.physical_type =
@@ -118,6 +118,7 @@ class SNode {
   int total_num_bits{0};
   int total_bit_start{0};
   int chunk_size{0};
+  int hash_table_size{0};  // Number of slots, for hash only
   std::size_t cell_size_bytes{0};
   PrimitiveType *physical_type{nullptr};  // for bit_struct and bit_array only
   DataType dt;
@@ -212,18 +213,22 @@ class SNode {
     return SNode::bitmasked(std::vector<Axis>{axis}, size, packed);
   }
 
+  // |capacity| is the maximum number of active children per container.
+  // Non-positive values mean the number of cells, capped at 65536.
   SNode &hash(const std::vector<Axis> &axes,
               const std::vector<int> &sizes,
-              bool packed) {
-    return create_node(axes, sizes, SNodeType::hash, packed);
-  }
+              int capacity,
+              bool packed);
 
-  SNode &hash(const std::vector<Axis> &axes, int sizes, bool packed) {
-    return create_node(axes, std::vector<int>{sizes}, SNodeType::hash, packed);
+  SNode &hash(const std::vector<Axis> &axes,
+              int sizes,
+              int capacity,
+              bool packed) {
+    return hash(axes, std::vector<int>{sizes}, capacity, packed);
   }
 
-  SNode &hash(const Axis &axis, int size, bool packed) {
-    return hash(std::vector<Axis>{axis}, size, packed);
+  SNode &hash(const Axis &axis, int size, int capacity, bool packed) {
+    return hash(std::vector<Axis>{axis}, size, capacity, packed);
   }
 
   std::string type_name() {
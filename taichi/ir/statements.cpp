@@ -115,14 +115,20 @@ PtrOffsetStmt::PtrOffsetStmt(Stmt *origin_input, Stmt *offset_input) {
     element_type().set_is_pointer(true);
   } else if (origin->is<GlobalPtrStmt>()) {
     element_type() = origin->cast<GlobalPtrStmt>()->ret_type;
+  } else if (origin->is<ThreadLocalPtrStmt>()) {
+    element_type() = origin->cast<ThreadLocalPtrStmt>()->ret_type;
   } else {
     TI_ERROR(
         "PtrOffsetStmt must be used for AllocaStmt / GlobalTemporaryStmt "
-        "(locally) or GlobalPtrStmt (globally).")
+        "(locally), GlobalPtrStmt (globally) or ThreadLocalPtrStmt.")
   }
   TI_STMT_REG_FIELDS;
 }
 
+bool PtrOffsetStmt::is_thread_local_ptr() const {
+  return origin->is<ThreadLocalPtrStmt>();
+}
+
 SNodeOpStmt::SNodeOpStmt(SNodeOpType op_type,
                          SNode *snode,
                          Stmt *ptr,
@@ -401,6 +407,7 @@ std::unique_ptr<Stmt> OffloadedStmt::clone() const {
   }
   new_stmt->tls_size = tls_size;
   new_stmt->bls_size = bls_size;
+  new_stmt->tls_reductions = tls_reductions;
   new_stmt->mem_access_opt = mem_access_opt;
   return new_stmt;
 }
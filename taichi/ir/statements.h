@@ -330,6 +330,8 @@ class PtrOffsetStmt : public Stmt {
     return origin->is<GlobalPtrStmt>();
   }
 
+  bool is_thread_local_ptr() const;
+
   bool is_lowered_global_ptr() const {
     return !is_local_ptr() && !is_unlowered_global_ptr();
   }
@@ -1070,6 +1072,19 @@ class OffloadedStmt : public Stmt {
   std::size_t bls_size{0};
   MemoryAccessOptions mem_access_opt;
 
+  // A reduction of |num_elements| consecutive values of type |dt| at |offset|
+  // in the TLS buffer.
+  struct TLSReduction {
+    std::size_t offset;
+    int num_elements;
+    DataType dt;
+    AtomicOpType op;
+  };
+  // The reductions covering the whole TLS buffer, if the TLS buffers of
+  // different threads can be combined before running the TLS epilogue once.
+  // See make_thread_local.
+  std::vector<TLSReduction> tls_reductions;
+
   OffloadedStmt(TaskType task_type, Arch arch);
 
   std::string task_name() const;
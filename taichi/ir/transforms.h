@@ -26,7 +26,7 @@ class Function;
 namespace irpass {
 
 void re_id(IRNode *root);
-void flag_access(IRNode *root);
+bool flag_access(IRNode *root);
 bool die(IRNode *root);
 bool simplify(IRNode *root, const CompileConfig &config);
 bool cfg_optimization(
@@ -42,12 +42,12 @@ void variable_optimization(IRNode *root, bool after_lower_access);
 bool extract_constant(IRNode *root, const CompileConfig &config);
 bool unreachable_code_elimination(IRNode *root);
 bool loop_invariant_code_motion(IRNode *root, const CompileConfig &config);
-void full_simplify(IRNode *root,
+bool full_simplify(IRNode *root,
                    const CompileConfig &config,
                    const FullSimplifyPass::Args &args);
 void print(IRNode *root, std::string *output = nullptr);
 void lower_ast(IRNode *root);
-void type_check(IRNode *root, const CompileConfig &config);
+bool type_check(IRNode *root, const CompileConfig &config);
 bool inlining(IRNode *root,
               const CompileConfig &config,
               const InliningPass::Args &args);
@@ -140,7 +140,8 @@ void compile_to_offloads(IRNode *ir,
                          bool vectorize,
                          bool grad,
                          bool ad_use_stack,
-                         bool start_from_ast);
+                         bool start_from_ast,
+                         PassManager *pass_manager = nullptr);
 
 void offload_to_executable(IRNode *ir,
                            const CompileConfig &config,
@@ -149,7 +150,8 @@ void offload_to_executable(IRNode *ir,
                            bool determine_ad_stack_size,
                            bool lower_global_access,
                            bool make_thread_local,
-                           bool make_block_local);
+                           bool make_block_local,
+                           PassManager *pass_manager = nullptr);
 // compile_to_executable fully covers compile_to_offloads, and also does
 // additional optimizations so that |ir| can be directly fed into codegen.
 void compile_to_executable(IRNode *ir,
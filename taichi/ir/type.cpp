@@ -68,6 +68,13 @@ std::string PrimitiveType::to_string() const {
   return data_type_name(DataType(const_cast<PrimitiveType *>(this)));
 }
 
+Type *PrimitiveType::get_compute_type() {
+  if (type == PrimitiveTypeID::f16) {
+    return PrimitiveType::f32;
+  }
+  return this;
+}
+
 std::string PointerType::to_string() const {
   if (is_bit_pointer_) {
     // "^" for bit-level pointers
@@ -272,6 +279,29 @@ bool TypedConstant::equal_type_and_value(const TypedConstant &o) const {
   }
 }
 
+std::size_t TypedConstant::hash() const {
+  std::size_t ret = std::hash<const Type *>{}(dt);
+  // Hash the raw bits within the size of the type, so that every type,
+  // including f16, is covered and bits left over from a wider value in the
+  // union do not matter.
+  uint64 bits = value_bits;
+  if (dt->is<PrimitiveType>()) {
+    const int size = data_type_size(dt);
+    if (size <= 0) {
+      bits = 0;
+    } else if (size < (int)sizeof(uint64)) {
+      bits &= (uint64(1) << (size * 8)) - 1;
+    }
+  }
+  // +0.0 and -0.0 compare equal in equal_type_and_value().
+  if ((dt->is_primitive(PrimitiveTypeID::f32) && val_f32 == 0) ||
+      (dt->is_primitive(PrimitiveTypeID::f64) && val_f64 == 0)) {
+    bits = 0;
+  }
+  ret ^= std::hash<uint64>{}(bits);
+  return ret;
+}
+
 int32 &TypedConstant::val_int32() {
   TI_ASSERT(get_data_type<int32>() == dt);
   return val_i32;
@@ -121,9 +121,8 @@ class PrimitiveType : public Type {
 
   std::string to_string() const override;
 
-  virtual Type *get_compute_type() override {
-    return this;
-  }
+  // f16 is a storage type: its values are loaded into f32 for computation.
+  virtual Type *get_compute_type() override;
 
   static DataType get(PrimitiveTypeID type);
 };
@@ -423,6 +422,9 @@ class TypedConstant {
 
   bool equal_type_and_value(const TypedConstant &o) const;
 
+  // Consistent with equal_type_and_value().
+  std::size_t hash() const;
+
   bool operator==(const TypedConstant &o) const {
     return equal_type_and_value(o);
   }
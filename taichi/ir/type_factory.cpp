@@ -158,6 +158,19 @@ class TypePromotionMapping {
     TRY_FIRST(uint16);
     TRY_FIRST(uint32);
     TRY_FIRST(uint64);
+
+    // f16 takes part in arithmetic as f32.
+    const auto f16 = PrimitiveTypeID::f16;
+    const auto f32 = PrimitiveTypeID::f32;
+    for (const auto &[key, result] : std::map(mapping)) {
+      if (key.first == f32) {
+        mapping[std::make_pair(f16, key.second)] = result;
+      }
+      if (key.second == f32) {
+        mapping[std::make_pair(key.first, f16)] = result;
+      }
+    }
+    mapping[std::make_pair(f16, f16)] = f32;
   }
   DataType query(DataType x, DataType y) {
     auto primitive =
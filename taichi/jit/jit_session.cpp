@@ -20,6 +20,39 @@ std::unique_ptr<JITSession> JITSession::create(Arch arch) {
     TI_NOT_IMPLEMENTED
 }
 
+JITModuleRef JITSession::acquire_module(JITModule *module) {
+  TI_ASSERT(module);
+  {
+    std::lock_guard<std::mutex> _(module_refs_mut_);
+    module_refs_[module]++;
+  }
+  std::weak_ptr<bool> alive = alive_;
+  return JITModuleRef(module, [this, alive](JITModule *module) {
+    if (!alive.expired()) {
+      release_module(module);
+    }
+  });
+}
+
+void JITSession::release_module(JITModule *module) {
+  {
+    std::lock_guard<std::mutex> _(module_refs_mut_);
+    auto it = module_refs_.find(module);
+    TI_ASSERT(it != module_refs_.end());
+    if (--it->second > 0) {
+      return;
+    }
+    module_refs_.erase(it);
+  }
+  remove_module(module);
+}
+
+JITSession::ModuleStats JITSession::get_module_stats() {
+  ModuleStats stats;
+  stats.num_modules = modules.size();
+  return stats;
+}
+
 std::size_t JITSession::get_type_size(llvm::Type *type) {
   return get_data_layout().getTypeAllocSize(type);
 }
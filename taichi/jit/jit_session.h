@@ -2,6 +2,8 @@
 
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <unordered_map>
 
 #include "taichi/llvm/llvm_fwd.h"
 #include "taichi/lang_util.h"
@@ -9,6 +11,10 @@
 
 TLANG_NAMESPACE_BEGIN
 
+// A reference that keeps a JITModule resident, see
+// JITSession::acquire_module().
+using JITModuleRef = std::shared_ptr<JITModule>;
+
 // Backend JIT compiler for all archs
 
 class JITSession {
@@ -16,13 +22,40 @@ class JITSession {
   std::vector<std::unique_ptr<JITModule>> modules;
 
  public:
+  struct ModuleStats {
+    std::size_t num_modules{0};
+    // Bytes of code and data of the modules, if tracked by the backend.
+    std::size_t num_bytes{0};
+  };
+
   JITSession() {
   }
 
   virtual JITModule *add_module(std::unique_ptr<llvm::Module> M,
                                 int max_reg = 0) = 0;
 
-  // virtual void remove_module(JITModule *module) = 0;
+  /**
+   * Returns a reference that keeps @param module resident.
+   *
+   * The module is removed from the session once all the references acquired
+   * on it are dropped. Modules that are never acquired stay resident until
+   * the session is destroyed. References may outlive the session, in which
+   * case dropping them does nothing.
+   */
+  JITModuleRef acquire_module(JITModule *module);
+
+  virtual ModuleStats get_module_stats();
+
+  // Optimizes |M| and compiles it to a relocatable object file, so that the
+  // result can be persisted and later loaded with add_object().
+  virtual std::string compile_module_to_object(
+      std::unique_ptr<llvm::Module> M) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  virtual JITModule *add_object(const std::string &object_code) {
+    TI_NOT_IMPLEMENTED
+  }
 
   virtual void *lookup(const std::string Name) {
     TI_NOT_IMPLEMENTED
@@ -38,6 +71,20 @@ class JITSession {
   }
 
   virtual ~JITSession() = default;
+
+ protected:
+  // Removes |module| from |modules| and frees its code. Backends that cannot
+  // unload code keep the module resident.
+  virtual void remove_module(JITModule *module) {
+  }
+
+ private:
+  void release_module(JITModule *module);
+
+  std::mutex module_refs_mut_;
+  std::unordered_map<JITModule *, int> module_refs_;
+  // Expires with the session, see acquire_module().
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
 };
 
 TLANG_NAMESPACE_END
@@ -112,6 +112,8 @@ llvm::Type *TaichiLLVMContext::get_data_type(DataType dt) {
     return llvm::Type::getFloatTy(*ctx);
   } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
     return llvm::Type::getDoubleTy(*ctx);
+  } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
+    return llvm::Type::getHalfTy(*ctx);
   } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
     return llvm::Type::getInt8Ty(*ctx);
   } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
@@ -463,6 +465,8 @@ llvm::Value *TaichiLLVMContext::get_constant(DataType dt, T t) {
     return llvm::ConstantFP::get(*ctx, llvm::APFloat((float32)t));
   } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
     return llvm::ConstantFP::get(*ctx, llvm::APFloat((float64)t));
+  } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
+    return llvm::ConstantFP::get(llvm::Type::getHalfTy(*ctx), (float64)t);
   } else if (is_integral(dt)) {
     if (is_signed(dt)) {
       return llvm::ConstantInt::get(
@@ -725,6 +729,7 @@ void TaichiLLVMContext::update_runtime_jit_module(
            starts_with(func_name, "LLVMRuntime_");
   });
   runtime_jit_module = add_module(std::move(module));
+  runtime_jit_module_ref = jit->acquire_module(runtime_jit_module);
 }
 
 TI_REGISTER_TASK(make_slim_libdevice);
@@ -144,6 +144,10 @@ class TaichiLLVMContext {
 
   void update_runtime_jit_module(std::unique_ptr<llvm::Module> module);
 
+  // Keeps |runtime_jit_module| resident. Each new SNode tree supersedes the
+  // runtime module, and the previous one is unloaded.
+  JITModuleRef runtime_jit_module_ref;
+
   std::unordered_map<std::thread::id, std::unique_ptr<ThreadLocalData>>
       per_thread_data;
 
@@ -0,0 +1,196 @@
+#include "taichi/llvm/llvm_offline_cache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/program/kernel.h"
+#include "taichi/program/program.h"
+#include "taichi/system/std_filesystem.h"
+#include "taichi/util/str.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+void fingerprint_snode(SNode *snode, std::string &output) {
+  output += fmt::format("{}:{}:{}:{}:{}:{}:{}:{}:", snode->id,
+                        snode_type_name(snode->type), snode->n,
+                        snode->chunk_size, snode->hash_table_size,
+                        snode->cell_size_bytes, snode->bit_offset,
+                        snode->dt.to_string());
+  for (const auto &e : snode->extractors) {
+    output += fmt::format("{},{},{},{};", e.shape, e.num_bits, e.acc_offset,
+                          e.active);
+  }
+  output += "[";
+  for (const auto &ch : snode->ch) {
+    fingerprint_snode(ch.get(), output);
+  }
+  output += "]";
+}
+
+}  // namespace
+
+LlvmOfflineCache::LlvmOfflineCache(const std::string &path,
+                                   std::size_t max_size_bytes,
+                                   const std::string &environment_fingerprint)
+    : path_(path),
+      max_size_bytes_(max_size_bytes),
+      environment_fingerprint_(environment_fingerprint) {
+  std::error_code ec;
+  stdfs::create_directories(path_, ec);
+  if (ec) {
+    TI_WARN("Failed to create the offline cache directory {}: {}", path_,
+            ec.message());
+  }
+}
+
+bool LlvmOfflineCache::is_cacheable(IRNode *ir) {
+  return irpass::analysis::gather_statements(ir, [](Stmt *stmt) {
+           return stmt->is<ExternalFuncCallStmt>();
+         }).empty();
+}
+
+std::string LlvmOfflineCache::make_key(Kernel *kernel, IRNode *ir) const {
+  TI_AUTO_PROF
+  const auto &config = kernel->program->config;
+  std::string key = environment_fingerprint_;
+  key += fmt::format(
+      "|arch={};debug={};fast_math={};kernel_profiler={};"
+      "check_out_of_bound={};cpu_max_num_threads={};cpu_block_range_for={};"
+      "packed={};cpu_software_f16_conversion={}|",
+      arch_name(kernel->arch), config.debug, config.fast_math,
+      config.kernel_profiler, config.check_out_of_bound,
+      config.cpu_max_num_threads, config.cpu_block_range_for, config.packed,
+      config.cpu_software_f16_conversion);
+  key += kernel->name + "|";
+
+  // The SNode layout is compiled into the kernel through the struct module.
+  std::vector<SNode *> roots;
+  for (auto &[id, snode] : kernel->program->snodes) {
+    if (snode->parent == nullptr) {
+      roots.push_back(snode);
+    }
+  }
+  std::sort(roots.begin(), roots.end(),
+            [](SNode *a, SNode *b) { return a->id < b->id; });
+  for (auto *root : roots) {
+    fingerprint_snode(root, key);
+  }
+  key += "|";
+
+  // Statement IDs depend on the compilation history of this process, so we
+  // renumber a copy of the IR before printing it.
+  auto cloned = irpass::analysis::clone(ir, kernel);
+  irpass::re_id(cloned.get());
+  std::string ir_text;
+  irpass::print(cloned.get(), &ir_text);
+  key += ir_text;
+  return content_digest(key);
+}
+
+std::string LlvmOfflineCache::get_entry_path(const std::string &key) const {
+  return (stdfs::path(path_) / fmt::format("{}.tcb", key)).string();
+}
+
+bool LlvmOfflineCache::load(const std::string &key, Entry &entry) {
+  TI_AUTO_PROF
+  const auto entry_path = get_entry_path(key);
+  std::error_code ec;
+  if (!stdfs::exists(entry_path, ec)) {
+    num_misses_++;
+    return false;
+  }
+  read_from_binary_file(entry, entry_path);
+  if (entry.key != key || entry.object_code.empty()) {
+    TI_WARN("Ignoring corrupted offline cache entry {}", entry_path);
+    num_misses_++;
+    return false;
+  }
+  // Mark the entry as recently used.
+  stdfs::last_write_time(entry_path, stdfs::file_time_type::clock::now(), ec);
+  num_hits_++;
+  TI_TRACE("Offline cache hit: {}", entry_path);
+  return true;
+}
+
+void LlvmOfflineCache::store(const Entry &entry) {
+  TI_AUTO_PROF
+  std::lock_guard<std::mutex> _(mut_);
+  const auto entry_path = get_entry_path(entry.key);
+  // Write to a temporary file first, so that other processes never observe a
+  // partially written entry.
+  const auto tmp_path =
+      (stdfs::path(path_) /
+       fmt::format("{}.{}.tmp.tcb", entry.key, PID::get_pid()))
+          .string();
+  write_to_binary_file(entry, tmp_path);
+  std::error_code ec;
+  stdfs::rename(tmp_path, entry_path, ec);
+  if (ec) {
+    TI_WARN("Failed to store offline cache entry {}: {}", entry_path,
+            ec.message());
+    stdfs::remove(tmp_path, ec);
+    return;
+  }
+  evict();
+}
+
+void LlvmOfflineCache::evict() {
+  struct CachedFile {
+    stdfs::path path;
+    std::size_t size;
+    stdfs::file_time_type last_used;
+  };
+  std::vector<CachedFile> files;
+  std::size_t total_size = 0;
+  std::error_code ec;
+  for (auto it = stdfs::directory_iterator(path_, ec);
+       !ec && it != stdfs::directory_iterator(); it.increment(ec)) {
+    if (it->path().extension() != ".tcb")
+      continue;
+    std::error_code file_ec;
+    CachedFile file;
+    file.path = it->path();
+    file.size = (std::size_t)stdfs::file_size(file.path, file_ec);
+    file.last_used = stdfs::last_write_time(file.path, file_ec);
+    if (file_ec)
+      continue;
+    total_size += file.size;
+    files.push_back(std::move(file));
+  }
+  if (total_size <= max_size_bytes_)
+    return;
+  std::sort(files.begin(), files.end(),
+            [](const CachedFile &a, const CachedFile &b) {
+              return a.last_used < b.last_used;
+            });
+  for (const auto &file : files) {
+    if (total_size <= max_size_bytes_)
+      break;
+    // Another process may have removed the file already.
+    std::error_code file_ec;
+    if (stdfs::remove(file.path, file_ec)) {
+      TI_TRACE("Evicted offline cache entry {}", file.path.string());
+    }
+    total_size -= file.size;
+  }
+}
+
+std::string LlvmOfflineCache::hash_file(const std::string &file_name) {
+  std::ifstream ifs(file_name, std::ios::binary);
+  if (!ifs) {
+    return "";
+  }
+  std::string content(std::istreambuf_iterator<char>(ifs), {});
+  return content_digest(content);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "taichi/lang_util.h"
+
+namespace taichi {
+namespace lang {
+
+class IRNode;
+class Kernel;
+
+/**
+ * A persistent, on-disk cache of compiled LLVM CPU kernels.
+ *
+ * Each entry stores the optimized object code of one kernel together with the
+ * names of its offloaded tasks, so that a hit skips both codegen and the LLVM
+ * pipeline and goes straight to the ORC JIT linker.
+ *
+ * Entries are keyed by a digest of
+ *  - the offloaded CHI IR of the kernel,
+ *  - the CompileConfig fields that affect codegen,
+ *  - the SNode layout of the program,
+ *  - the host CPU and the runtime bitcode (see |environment_fingerprint|).
+ *
+ * When the cache directory grows beyond |max_size_bytes|, the least recently
+ * used entries are removed. The access time of an entry is tracked by its
+ * modification time, which is refreshed on every hit.
+ */
+class LlvmOfflineCache {
+ public:
+  struct Entry {
+    std::string key;
+    std::vector<std::string> task_names;
+    std::string object_code;
+
+    TI_IO_DEF(key, task_names, object_code);
+  };
+
+  LlvmOfflineCache(const std::string &path,
+                   std::size_t max_size_bytes,
+                   const std::string &environment_fingerprint);
+
+  /**
+   * Checks if the compiled code of @param ir can be reused by other processes.
+   *
+   * Kernels calling external functions are not cacheable, since the
+   * generated code embeds the host addresses of these functions.
+   */
+  static bool is_cacheable(IRNode *ir);
+
+  /**
+   * Computes the cache key of a kernel.
+   *
+   * @param kernel The kernel to be compiled.
+   * @param ir The (offloaded) IR to be compiled, which may be a single
+   * offloaded task in async mode.
+   * @return The key.
+   */
+  std::string make_key(Kernel *kernel, IRNode *ir) const;
+
+  bool load(const std::string &key, Entry &entry);
+
+  void store(const Entry &entry);
+
+  std::size_t get_num_hits() const {
+    return num_hits_;
+  }
+
+  std::size_t get_num_misses() const {
+    return num_misses_;
+  }
+
+  // Returns a hex digest of the contents of @param file_name.
+  static std::string hash_file(const std::string &file_name);
+
+ private:
+  std::string get_entry_path(const std::string &key) const;
+
+  // Removes the least recently used entries until the size of the cache
+  // directory is within |max_size_bytes_|.
+  void evict();
+
+  std::string path_;
+  std::size_t max_size_bytes_;
+  std::string environment_fingerprint_;
+  std::atomic<std::size_t> num_hits_{0};
+  std::atomic<std::size_t> num_misses_{0};
+  std::mutex mut_;
+};
+
+}  // namespace lang
+}  // namespace taichi
@@ -8,6 +8,9 @@
 #include "taichi/util/str.h"
 #include "taichi/codegen/codegen.h"
 #include "taichi/ir/statements.h"
+#include "taichi/system/std_filesystem.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Host.h"
 #if defined(TI_WITH_CUDA)
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/backends/cuda/codegen_cuda.h"
@@ -16,11 +19,37 @@
 
 namespace taichi {
 namespace lang {
+
+std::string get_runtime_fn(Arch arch);
+
 namespace {
 void assert_failed_host(const char *msg) {
   TI_ERROR("Assertion failure: {}", msg);
 }
 
+// Everything outside of the kernel itself that determines the generated
+// machine code: the Taichi build, the runtime bitcode and the host CPU.
+std::string get_offline_cache_environment_fingerprint() {
+  std::string features;
+  llvm::StringMap<bool> host_features;
+  if (llvm::sys::getHostCPUFeatures(host_features)) {
+    std::vector<std::string> enabled;
+    for (auto &feature : host_features) {
+      if (feature.second)
+        enabled.push_back(feature.first().str());
+    }
+    std::sort(enabled.begin(), enabled.end());
+    for (auto &f : enabled)
+      features += "+" + f;
+  }
+  const auto runtime_path =
+      fmt::format("{}/{}", runtime_lib_dir(), get_runtime_fn(host_arch()));
+  return fmt::format("version={};commit={};runtime={};cpu={};features={}",
+                     get_version_string(), get_commit_hash(),
+                     LlvmOfflineCache::hash_file(runtime_path),
+                     llvm::sys::getHostCPUName().str(), features);
+}
+
 void *taichi_allocate_aligned(MemoryPool *memory_pool,
                               std::size_t size,
                               std::size_t alignment) {
@@ -54,6 +83,16 @@ LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
 
   thread_pool = std::make_unique<ThreadPool>(config->cpu_max_num_threads);
 
+  if (config_.offline_cache && arch_is_cpu(config_.arch)) {
+    auto path = config_.offline_cache_file_path;
+    if (path.empty()) {
+      path = (stdfs::path(get_repo_dir()) / "ticache" / "llvm").string();
+    }
+    offline_cache = std::make_unique<LlvmOfflineCache>(
+        path, std::size_t(config_.offline_cache_max_size_GB * (1UL << 30)),
+        get_offline_cache_environment_fingerprint());
+  }
+
   preallocated_device_buffer = nullptr;
   llvm_runtime = nullptr;
   llvm_context_host = std::make_unique<TaichiLLVMContext>(host_arch());
@@ -169,8 +208,9 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
     if (is_gc_able(snodes[i]->type)) {
       std::size_t node_size;
       auto element_size = snodes[i]->cell_size_bytes;
-      if (snodes[i]->type == SNodeType::pointer) {
-        // pointer. Allocators are for single elements
+      if (snodes[i]->type == SNodeType::pointer ||
+          snodes[i]->type == SNodeType::hash) {
+        // pointer and hash. Allocators are for single elements
         node_size = element_size;
       } else {
         // dynamic. Allocators are for the chunks
@@ -185,6 +225,12 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
                snodes[i]->id, node_size);
       runtime_jit->call<void *, int>("runtime_allocate_ambient", rt, i,
                                      node_size);
+      if (snodes[i]->type == SNodeType::hash) {
+        has_hash_snodes = true;
+        runtime_jit->call<void *, int, std::size_t>(
+            "runtime_allocate_hash_overflow_element", rt, snodes[i]->id,
+            node_size);
+      }
     }
   }
 }
@@ -293,6 +339,7 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
                                           KernelProfilerBase *profiler,
                                           uint64 **result_buffer_ptr) {
   maybe_initialize_cuda_llvm_context();
+  this->memory_pool = memory_pool;
 
   std::size_t prealloc_size = 0;
   TaichiLLVMContext *tlctx = nullptr;
@@ -362,7 +409,9 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
                                       *result_buffer_ptr);
   TI_TRACE("LLVMRuntime pointer fetched");
 
-  if (arch_use_host_memory(config->arch) || config->use_unified_memory) {
+  // CPU kernels call the memory pool directly, so only CUDA kernels need the
+  // request queue.
+  if (config->arch == Arch::cuda && config->use_unified_memory) {
     runtime_jit->call<void *>("runtime_get_mem_req_queue", llvm_runtime);
     auto mem_req_queue = fetch_result<void *>(taichi_result_buffer_ret_value_id,
                                               *result_buffer_ptr);
@@ -370,9 +419,9 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   }
 
   if (arch_use_host_memory(config->arch)) {
-    runtime_jit->call<void *, void *, void *>(
+    runtime_jit->call<void *, void *, void *, int>(
         "LLVMRuntime_initialize_thread_pool", llvm_runtime, thread_pool.get(),
-        (void *)ThreadPool::static_run);
+        (void *)ThreadPool::static_run, config->cpu_max_num_threads);
 
     runtime_jit->call<void *, void *>("LLVMRuntime_set_assert_failed",
                                       llvm_runtime, (void *)assert_failed_host);
@@ -438,6 +487,25 @@ void LlvmProgramImpl::check_runtime_error(uint64 *result_buffer) {
   }
 }
 
+void LlvmProgramImpl::check_hash_overflow(uint64 *result_buffer) {
+  if (!has_hash_snodes)
+    return;
+  auto tlctx = llvm_context_host.get();
+  if (llvm_context_device) {
+    tlctx = llvm_context_device.get();
+  }
+  tlctx->runtime_jit_module->call<void *>(
+      "runtime_retrieve_and_reset_hash_overflows", llvm_runtime);
+  auto num_overflows =
+      fetch_result<int64>(taichi_result_buffer_runtime_query_id, result_buffer);
+  if (num_overflows) {
+    TI_WARN(
+        "{} write(s) to hash SNodes were dropped, since the hash tables were "
+        "full. Consider a larger capacity.",
+        num_overflows);
+  }
+}
+
 void LlvmProgramImpl::finalize() {
   if (runtime_mem_info)
     runtime_mem_info->set_profiler(nullptr);
@@ -499,6 +567,20 @@ void LlvmProgramImpl::print_memory_profiler_info(
               "  Allocated elements={:n}; free list length={:n}; recycled list "
               "length={:n}\n",
               free_list_used, free_list_len, recycled_list_len);
+
+          auto query_thread_cache_stat = [&](const std::string &name) {
+            return runtime_query<int64>("NodeManager_get_" + name,
+                                        result_buffer, node_allocator);
+          };
+          fmt::print(
+              "  Thread caches: allocations={:n}; recycles={:n}; batches={:n}; "
+              "contentions={:n}; cached free={:n}; cached recycled={:n}\n",
+              query_thread_cache_stat("num_allocations"),
+              query_thread_cache_stat("num_recycles"),
+              query_thread_cache_stat("num_batches"),
+              query_thread_cache_stat("num_contentions"),
+              query_thread_cache_stat("num_free"),
+              query_thread_cache_stat("num_recycled"));
         }
       }
     }
@@ -517,6 +599,33 @@ void LlvmProgramImpl::print_memory_profiler_info(
   fmt::print(
       "Total requested dynamic memory (excluding alignment padding): {:n} B\n",
       total_requested_memory);
+
+  if (memory_pool) {
+    const auto stats = memory_pool->get_stats();
+    fmt::print(
+        "Memory pool: {:n} requests, {:n} B; latency avg={:.3f} us "
+        "max={:.3f} us\n",
+        stats.num_requests, stats.num_bytes,
+        stats.num_requests ? 1e6 * stats.total_latency / stats.num_requests
+                           : 0.0,
+        1e6 * stats.max_latency);
+  }
+
+  const auto jit_stats = get_jit_module_stats();
+  fmt::print("JIT modules: {:n} resident, {:n} B\n", jit_stats.num_modules,
+             jit_stats.num_bytes);
+}
+
+JITSession::ModuleStats LlvmProgramImpl::get_jit_module_stats() {
+  JITSession::ModuleStats stats;
+  for (auto *tlctx : {llvm_context_host.get(), llvm_context_device.get()}) {
+    if (tlctx) {
+      const auto s = tlctx->jit->get_module_stats();
+      stats.num_modules += s.num_modules;
+      stats.num_bytes += s.num_bytes;
+    }
+  }
+  return stats;
 }
 }  // namespace lang
 }  // namespace taichi
@@ -12,6 +12,7 @@
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/system/memory_pool.h"
 #include "taichi/program/program_impl.h"
+#include "taichi/llvm/llvm_offline_cache.h"
 #define TI_RUNTIME_HOST
 #include "taichi/program/context.h"
 #undef TI_RUNTIME_HOST
@@ -47,6 +48,22 @@ class LlvmProgramImpl : public ProgramImpl {
     return static_cast<LLVMRuntime *>(llvm_runtime);
   }
 
+  /**
+   * Returns the on-disk cache of compiled CPU kernels, or nullptr if
+   * CompileConfig#offline_cache is off.
+   */
+  LlvmOfflineCache *get_offline_cache() {
+    return offline_cache.get();
+  }
+
+  /**
+   * Returns the pool running parallel CPU tasks. Host code may use it between
+   * kernel launches, e.g., to assemble sparse matrices.
+   */
+  ThreadPool *get_thread_pool() {
+    return thread_pool.get();
+  }
+
   FunctionType compile(Kernel *kernel, OffloadedStmt *offloaded) override;
 
   void materialize_snode_tree(
@@ -81,10 +98,22 @@ class LlvmProgramImpl : public ProgramImpl {
       std::vector<std::unique_ptr<SNodeTree>> &snode_trees_,
       uint64 *result_buffer);
 
+  /**
+   * Returns the number and size of the JIT modules resident in the host and
+   * device JIT sessions.
+   */
+  JITSession::ModuleStats get_jit_module_stats();
+
   void synchronize() override;
 
   void check_runtime_error(uint64 *result_buffer);
 
+  /**
+   * Warns about the writes dropped by full hash SNodes since the last check.
+   * Unlike check_runtime_error(), this also works outside debug mode.
+   */
+  void check_hash_overflow(uint64 *result_buffer);
+
   void finalize();
 
  private:
@@ -137,8 +166,11 @@ class LlvmProgramImpl : public ProgramImpl {
   std::unique_ptr<ThreadPool> thread_pool{nullptr};
   std::unique_ptr<Runtime> runtime_mem_info{nullptr};
   std::unique_ptr<SNodeTreeBufferManager> snode_tree_buffer_manager{nullptr};
+  std::unique_ptr<LlvmOfflineCache> offline_cache{nullptr};
   void *llvm_runtime{nullptr};
+  bool has_hash_snodes{false};
   void *preallocated_device_buffer{nullptr};  // TODO: move to memory allocator
+  MemoryPool *memory_pool{nullptr};
 };
 }  // namespace lang
 }  // namespace taichi
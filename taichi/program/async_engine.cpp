@@ -1,9 +1,11 @@
 #include "taichi/program/async_engine.h"
 
 #include <memory>
+#include <optional>
 
 #include "taichi/program/kernel.h"
 #include "taichi/system/timeline.h"
+#include "taichi/system/timer.h"
 #include "taichi/backends/cpu/codegen_cpu.h"
 #include "taichi/util/testing.h"
 #include "taichi/util/statistics.h"
@@ -118,7 +120,116 @@ void ParallelExecutor::worker_loop() {
   }
 }
 
-void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
+DagExecutor::DagExecutor(const std::string &name,
+                         int num_slots,
+                         int num_threads_per_slot)
+    : name_(name) {
+  TI_ASSERT(num_slots >= 1);
+  if (num_threads_per_slot > 0) {
+    for (int i = 0; i < num_slots; i++) {
+      thread_pools_.push_back(std::make_unique<ThreadPool>(
+          num_threads_per_slot, /*thread_id_offset=*/i * num_threads_per_slot));
+    }
+  }
+  for (int i = 0; i < num_slots; i++) {
+    slots_.emplace_back([this, i]() { this->worker_loop(i); });
+  }
+}
+
+DagExecutor::~DagExecutor() {
+  {
+    std::lock_guard<std::mutex> _(mut_);
+    exiting_ = true;
+  }
+  worker_cv_.notify_all();
+  for (auto &th : slots_) {
+    th.join();
+  }
+}
+
+void DagExecutor::run(std::vector<Task> tasks) {
+  if (tasks.empty())
+    return;
+  const auto start = Time::get_time();
+  std::unique_lock<std::mutex> lock(mut_);
+  TI_ASSERT(num_unfinished_tasks_ == 0);
+  tasks_ = std::move(tasks);
+  const int n = tasks_.size();
+  num_pending_deps_.assign(n, 0);
+  dependents_.assign(n, {});
+  for (int i = 0; i < n; i++) {
+    for (int dep : tasks_[i].deps) {
+      TI_ASSERT(0 <= dep && dep < i);
+      dependents_[dep].push_back(i);
+    }
+    num_pending_deps_[i] = tasks_[i].deps.size();
+    if (num_pending_deps_[i] == 0) {
+      ready_tasks_.push_back(i);
+    }
+  }
+  num_unfinished_tasks_ = n;
+  peak_concurrency_ = 0;
+  worker_cv_.notify_all();
+  done_cv_.wait(lock, [this]() { return num_unfinished_tasks_ == 0; });
+  tasks_.clear();
+
+  // Shows the achieved concurrency of the batch on the timeline.
+  auto &timeline = Timeline::get_this_thread_instance();
+  const auto name =
+      fmt::format("{}: {} tasks, peak concurrency {}", name_, n,
+                  peak_concurrency_);
+  timeline.insert_event({name, true, start, timeline.get_name()});
+  timeline.insert_event({name, false, Time::get_time(), timeline.get_name()});
+}
+
+void DagExecutor::worker_loop(int slot) {
+  Timeline::get_this_thread_instance().set_name(
+      fmt::format("{}_{}", name_, slot));
+  std::optional<ThreadPool::LaunchGuard> launch_guard;
+  if (!thread_pools_.empty()) {
+    launch_guard.emplace(thread_pools_[slot].get());
+  }
+
+  std::unique_lock<std::mutex> lock(mut_);
+  while (true) {
+    worker_cv_.wait(lock,
+                    [this]() { return !ready_tasks_.empty() || exiting_; });
+    if (ready_tasks_.empty()) {
+      // Exiting
+      break;
+    }
+    const int id = ready_tasks_.front();
+    ready_tasks_.pop_front();
+    num_running_tasks_++;
+    peak_concurrency_ = std::max(peak_concurrency_, num_running_tasks_);
+    const auto &task = tasks_[id];
+    lock.unlock();
+
+    {
+      TI_TIMELINE(task.name);
+      task.func();
+    }
+
+    lock.lock();
+    num_running_tasks_--;
+    int num_new_ready_tasks = 0;
+    for (int dependent : dependents_[id]) {
+      if (--num_pending_deps_[dependent] == 0) {
+        ready_tasks_.push_back(dependent);
+        num_new_ready_tasks++;
+      }
+    }
+    if (--num_unfinished_tasks_ == 0) {
+      done_cv_.notify_one();
+    } else if (num_new_ready_tasks > 1) {
+      // This slot takes one of them.
+      worker_cv_.notify_all();
+    }
+  }
+}
+
+ExecutionQueue::AsyncCompiledFunc *ExecutionQueue::compile(
+    const TaskLaunchRecord &ker) {
   auto h = ker.ir_handle.hash();
   auto *stmt = ker.stmt();
   auto kernel = ker.kernel;
@@ -164,15 +275,47 @@ void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
         });
     ir_bank_->insert_to_trash_bin(std::move(cloned_stmt));
   }
+  return async_func;
+}
 
+void ExecutionQueue::enqueue(const TaskLaunchRecord &ker) {
+  auto *async_func = compile(ker);
   launch_worker.enqueue(
-      [kernel_name, async_func, context = ker.context]() mutable {
+      [kernel_name = ker.kernel->name, async_func,
+       context = ker.context]() mutable {
         TI_TIMELINE(kernel_name);
         auto func = async_func->get();
         func(context);
       });
 }
 
+void ExecutionQueue::enqueue(const std::vector<TaskLaunchRecord> &tasks,
+                             const std::vector<std::vector<int>> &dependencies) {
+  TI_ASSERT(dag_executor);
+  TI_ASSERT(tasks.size() == dependencies.size());
+  std::vector<DagExecutor::Task> dag_tasks;
+  dag_tasks.reserve(tasks.size());
+  for (int i = 0; i < (int)tasks.size(); i++) {
+    auto *async_func = compile(tasks[i]);
+    DagExecutor::Task task;
+    task.name = tasks[i].kernel->name;
+    task.func = [async_func, context = tasks[i].context]() mutable {
+      auto func = async_func->get();
+      // Serial tasks of different slots must not share per-thread states.
+      context.cpu_thread_id_offset = ThreadPool::get_launch_thread_id_offset();
+      func(context);
+    };
+    task.deps = dependencies[i];
+    dag_tasks.push_back(std::move(task));
+  }
+  // The batches run one after another, since the tasks may depend on the ones
+  // of the previous batch.
+  launch_worker.enqueue(
+      [this, dag_tasks = std::move(dag_tasks)]() mutable {
+        dag_executor->run(std::move(dag_tasks));
+      });
+}
+
 void ExecutionQueue::synchronize() {
   TI_AUTO_PROF;
   launch_worker.flush();
@@ -195,6 +338,17 @@ AsyncEngine::AsyncEngine(const CompileConfig *const config,
       sfg(std::make_unique<StateFlowGraph>(this, &ir_bank_, config, snodes)) {
   Timeline::get_this_thread_instance().set_name("host");
   ir_bank_.set_sfg(sfg.get());
+  // Only the CPU backends can give each concurrent task its own threads.
+  if (arch_is_cpu(config->arch) && config->async_max_concurrent_tasks > 1) {
+    // The slots get disjoint thread ids below cpu_max_num_threads, which is
+    // the number of the per-thread states of the runtime, e.g., the random
+    // states and the TLS buffers.
+    const int num_slots = std::min(config->async_max_concurrent_tasks,
+                                   std::max(config->cpu_max_num_threads, 1));
+    queue.dag_executor = std::make_unique<DagExecutor>(
+        "dag_launcher", num_slots,
+        std::max(config->cpu_max_num_threads / num_slots, 1));
+  }
 }
 
 void AsyncEngine::launch(Kernel *kernel, Context &context) {
@@ -214,7 +368,6 @@ void AsyncEngine::launch(Kernel *kernel, Context &context) {
       TI_ASSERT(kmeta.ir_handle_cached.size() == i);
       IRHandle tmp_ir_handle(offloads[i].get(), 0);
       auto cloned_offs = tmp_ir_handle.clone();
-      irpass::re_id(cloned_offs.get());
       auto h = ir_bank_.get_hash(cloned_offs.get());
       kmeta.ir_handle_cached.emplace_back(cloned_offs.get(), h);
       ir_bank_.insert(std::move(cloned_offs), h);
@@ -294,10 +447,17 @@ void AsyncEngine::flush() {
   debug_sfg("final");
   {
     TI_TIMELINE("enqueue");
-    auto tasks = sfg->extract_to_execute();
-    TI_TRACE("Ended up with {} nodes", tasks.size());
-    for (auto &task : tasks) {
-      queue.enqueue(task);
+    if (queue.dag_executor) {
+      std::vector<std::vector<int>> dependencies;
+      auto tasks = sfg->extract_to_execute(dependencies);
+      TI_TRACE("Ended up with {} nodes", tasks.size());
+      queue.enqueue(tasks, dependencies);
+    } else {
+      auto tasks = sfg->extract_to_execute();
+      TI_TRACE("Ended up with {} nodes", tasks.size());
+      for (auto &task : tasks) {
+        queue.enqueue(task);
+      }
     }
   }
   flush_counter_++;
@@ -15,6 +15,7 @@
 #include "taichi/program/async_utils.h"
 #include "taichi/program/ir_bank.h"
 #include "taichi/program/state_flow_graph.h"
+#include "taichi/system/threading.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -72,23 +73,86 @@ class ParallelExecutor {
   std::condition_variable flush_cv_;
 };
 
+// Runs batches of tasks with dependencies between them. A task is dispatched
+// as soon as the tasks it depends on have finished, so that up to |num_slots|
+// independent tasks run at the same time. Each slot can have its own
+// partition of the CPU threads for the kernels it launches, see
+// ThreadPool::LaunchGuard.
+class DagExecutor {
+ public:
+  struct Task {
+    std::string name;
+    std::function<void()> func;
+    // The indices of the earlier tasks in the batch to wait for.
+    std::vector<int> deps;
+  };
+
+  // With |num_threads_per_slot| > 0, slot i launches kernels on threads
+  // [i * num_threads_per_slot, (i + 1) * num_threads_per_slot).
+  DagExecutor(const std::string &name, int num_slots, int num_threads_per_slot);
+  ~DagExecutor();
+
+  // Runs |tasks| and blocks until all of them have finished.
+  void run(std::vector<Task> tasks);
+
+  int get_num_slots() const {
+    return (int)slots_.size();
+  }
+
+  // The largest number of tasks that ran at the same time in the last batch.
+  int get_peak_concurrency() const {
+    return peak_concurrency_;
+  }
+
+ private:
+  void worker_loop(int slot);
+
+  std::string name_;
+  std::vector<std::thread> slots_;
+  std::vector<std::unique_ptr<ThreadPool>> thread_pools_;
+
+  std::mutex mut_;
+  // All guarded by |mut_|
+  bool exiting_{false};
+  std::vector<Task> tasks_;
+  std::vector<int> num_pending_deps_;
+  std::vector<std::vector<int>> dependents_;
+  std::deque<int> ready_tasks_;
+  int num_unfinished_tasks_{0};
+  int num_running_tasks_{0};
+  int peak_concurrency_{0};
+
+  // Signals the slots that a task is ready, or that they need to shut down.
+  std::condition_variable worker_cv_;
+  // Signals run() that all the tasks have finished.
+  std::condition_variable done_cv_;
+};
+
 // Compiles the offloaded and optimized IR to the target backend's executable.
 using BackendExecCompilationFunc =
     std::function<FunctionType(Kernel &, OffloadedStmt *)>;
 
-// In charge of (parallel) compilation to binary and (serial) kernel launching
+// In charge of (parallel) compilation to binary and kernel launching. The
+// launches are serial, unless a DagExecutor is used for concurrent launching.
 class ExecutionQueue {
  public:
   std::mutex mut;
 
   ParallelExecutor compilation_workers;  // parallel compilation
   ParallelExecutor launch_worker;        // serial launching
+  // Concurrent launching of independent tasks, nullptr if disabled.
+  std::unique_ptr<DagExecutor> dag_executor;
 
   explicit ExecutionQueue(IRBank *ir_bank,
                           const BackendExecCompilationFunc &compile_to_backend);
 
   void enqueue(const TaskLaunchRecord &ker);
 
+  // Launches |tasks| on |dag_executor|, where |dependencies| are the indices
+  // of the earlier tasks that each task has to wait for.
+  void enqueue(const std::vector<TaskLaunchRecord> &tasks,
+               const std::vector<std::vector<int>> &dependencies);
+
   void compile_task() {
   }
 
@@ -123,6 +187,9 @@ class ExecutionQueue {
   };
   std::unordered_map<uint64, AsyncCompiledFunc> compiled_funcs_;
 
+  // Starts compiling |ker| if it is not compiled yet.
+  AsyncCompiledFunc *compile(const TaskLaunchRecord &ker);
+
   IRBank *ir_bank_;  // not owned
   BackendExecCompilationFunc compile_to_backend_;
 };
@@ -154,6 +221,10 @@ class AsyncEngine {
 
   void debug_sfg(const std::string &suffix);
 
+  void benchmark_ir_hash() {
+    ir_bank_.benchmark_hash();
+  }
+
  private:
   IRBank ir_bank_;
 
@@ -45,6 +45,11 @@ CompileConfig::CompileConfig() {
   saturating_grid_dim = 0;
   max_block_dim = 0;
   cpu_max_num_threads = std::thread::hardware_concurrency();
+  cpu_block_range_for = true;
+  cpu_privatize_atomics = false;
+  cpu_privatize_atomics_max_bytes = 32 * 1024;
+  cpu_software_f16_conversion = false;
+  num_compile_threads = std::thread::hardware_concurrency();
   random_seed = 0;
 
   // LLVM backend options:
@@ -52,6 +57,9 @@ CompileConfig::CompileConfig() {
   print_kernel_llvm_ir = false;
   print_kernel_nvptx = false;
   print_kernel_llvm_ir_optimized = false;
+  offline_cache = false;
+  offline_cache_file_path = "";
+  offline_cache_max_size_GB = 1;
 
   // CUDA backend options:
 #if defined(TI_PLATFORM_WINDOWS) or defined(TI_PLATFORM_OSX)
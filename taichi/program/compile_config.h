@@ -30,6 +30,7 @@ struct CompileConfig {
   bool verbose_kernel_launches;
   bool kernel_profiler;
   bool timeline{false};
+  bool compile_profiler{false};
   bool verbose;
   bool fast_math;
   bool async_mode;
@@ -52,6 +53,19 @@ struct CompileConfig {
   int saturating_grid_dim;
   int max_block_dim;
   int cpu_max_num_threads;
+  // Emit each CPU range-for task as one function looping over a block of
+  // iterations, instead of calling the loop body once per iteration.
+  bool cpu_block_range_for;
+  // Accumulate atomics scattered into small dense fields into per-thread
+  // copies of the fields on CPUs. See make_thread_local.
+  bool cpu_privatize_atomics;
+  // The max size of the per-thread copies of an offloaded task.
+  int cpu_privatize_atomics_max_bytes;
+  // Convert between f16 and f32 with runtime functions even if the CPU has
+  // conversion instructions. Mainly for testing these functions.
+  bool cpu_software_f16_conversion;
+  // The number of threads used by Program::compile_kernels().
+  int num_compile_threads;
   int random_seed;
 
   // LLVM backend options:
@@ -59,6 +73,14 @@ struct CompileConfig {
   bool print_kernel_llvm_ir;
   bool print_kernel_llvm_ir_optimized;
   bool print_kernel_nvptx;
+  // Persist compiled CPU kernels on disk and reuse them across processes.
+  // Also shares the object files of the C backend across processes.
+  bool offline_cache;
+  // An empty path means "{repo_dir}/ticache/llvm". The C backend uses
+  // "{repo_dir}/ticache/cc", or the "cc" subdirectory of a given path.
+  std::string offline_cache_file_path;
+  // Applies to the "llvm" and the "cc" cache directories separately.
+  float64 offline_cache_max_size_GB;
 
   // CUDA backend options:
   bool use_unified_memory;
@@ -82,6 +104,9 @@ struct CompileConfig {
   int async_flush_every{50};
   // Setting 0 effectively means unlimited
   int async_max_fuse_per_task{1};
+  // The number of independent tasks launched at the same time on CPUs, each
+  // on its own share of the cpu_max_num_threads threads. 1 means serial.
+  int async_max_concurrent_tasks{1};
 
   bool quant_opt_store_fusion{true};
   bool quant_opt_atomic_demotion{true};
@@ -0,0 +1,123 @@
+#include "taichi/program/compile_profiler.h"
+
+#include <fstream>
+#include <unordered_map>
+
+#include "taichi/system/timeline.h"
+#include "taichi/system/timer.h"
+#include "taichi/util/str.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+std::string &current_kernel() {
+  thread_local std::string kernel;
+  return kernel;
+}
+
+}  // namespace
+
+CompileProfiler &CompileProfiler::get_instance() {
+  static auto instance = new CompileProfiler();
+  return *instance;
+}
+
+void CompileProfiler::insert_event(const Event &event) {
+  if (!enabled_)
+    return;
+  if (!event.skipped) {
+    // Timeline::insert_event does nothing if the timeline is not enabled.
+    auto &timeline = Timeline::get_this_thread_instance();
+    const auto name = fmt::format("{}:{}", event.kernel, event.name);
+    timeline.insert_event({name, true, event.begin, timeline.get_name()});
+    timeline.insert_event(
+        {name, false, event.begin + event.seconds, timeline.get_name()});
+  }
+  std::lock_guard<std::mutex> _(mut_);
+  events_.push_back(event);
+}
+
+std::vector<CompileProfiler::Event> CompileProfiler::get_events() {
+  std::lock_guard<std::mutex> _(mut_);
+  return events_;
+}
+
+void CompileProfiler::clear() {
+  std::lock_guard<std::mutex> _(mut_);
+  events_.clear();
+}
+
+void CompileProfiler::save(const std::string &filename) {
+  std::vector<std::string> kernels;
+  std::unordered_map<std::string, std::vector<Event>> kernel_events;
+  for (auto &event : get_events()) {
+    auto &events = kernel_events[event.kernel];
+    if (events.empty()) {
+      kernels.push_back(event.kernel);
+    }
+    events.push_back(event);
+  }
+
+  std::ofstream fout(filename);
+  if (!fout) {
+    TI_ERROR("Cannot open {} to save the compile profile.", filename);
+  }
+  fout << "{\"kernels\":[";
+  for (int i = 0; i < (int)kernels.size(); i++) {
+    const auto &events = kernel_events[kernels[i]];
+    float64 total = 0;
+    for (auto &event : events) {
+      total += event.seconds;
+    }
+    fout << (i ? "," : "") << "\n"
+         << fmt::format("{{\"name\":{},\"seconds\":{},\"events\":[",
+                        json_quoted(kernels[i]), total);
+    for (int j = 0; j < (int)events.size(); j++) {
+      const auto &event = events[j];
+      fout << (j ? "," : "") << "\n  "
+           << fmt::format(
+                  "{{\"name\":{},\"category\":{},\"begin\":{},"
+                  "\"seconds\":{},\"stmts_before\":{},\"stmts_after\":{},"
+                  "\"skipped\":{}}}",
+                  json_quoted(event.name), json_quoted(event.category),
+                  event.begin, event.seconds, event.stmts_before,
+                  event.stmts_after, event.skipped ? "true" : "false");
+    }
+    fout << "]}";
+  }
+  fout << "\n]}\n";
+}
+
+CompileProfiler::KernelGuard::KernelGuard(const std::string &kernel)
+    : old_kernel_(current_kernel()) {
+  current_kernel() = kernel;
+}
+
+CompileProfiler::KernelGuard::~KernelGuard() {
+  current_kernel() = old_kernel_;
+}
+
+CompileProfiler::PhaseGuard::PhaseGuard(const std::string &name,
+                                        const std::string &category)
+    : enabled_(CompileProfiler::get_instance().get_enabled()) {
+  if (enabled_) {
+    name_ = name;
+    category_ = category;
+    begin_ = Time::get_time();
+  }
+}
+
+CompileProfiler::PhaseGuard::~PhaseGuard() {
+  if (enabled_) {
+    Event event;
+    event.kernel = current_kernel();
+    event.name = name_;
+    event.category = category_;
+    event.begin = begin_;
+    event.seconds = Time::get_time() - begin_;
+    CompileProfiler::get_instance().insert_event(event);
+  }
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+
+TLANG_NAMESPACE_BEGIN
+
+/**
+ * Collects where the compile time of each kernel goes, when
+ * CompileConfig::compile_profiler is on: the IR passes, along with the number
+ * of statements before and after each of them, and the LLVM phases.
+ *
+ * The report can be saved as JSON. If the timeline is enabled too, the events
+ * are also added to it, so that Timelines::save exports them as a Chrome trace.
+ */
+class CompileProfiler {
+ public:
+  struct Event {
+    std::string kernel;
+    std::string name;
+    // "ir_pass" or "llvm".
+    std::string category;
+    float64 begin{0};
+    float64 seconds{0};
+    // The number of statements of the IR, -1 if not counted.
+    int stmts_before{-1};
+    int stmts_after{-1};
+    bool skipped{false};
+  };
+
+  static CompileProfiler &get_instance();
+
+  bool get_enabled() const {
+    return enabled_;
+  }
+
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+  }
+
+  void insert_event(const Event &event);
+
+  std::vector<Event> get_events();
+
+  void clear();
+
+  // Saves the events grouped by kernel, in the order they happened.
+  void save(const std::string &filename);
+
+  // Names the kernel whose phases are recorded by PhaseGuard on this thread.
+  class KernelGuard {
+   public:
+    explicit KernelGuard(const std::string &kernel);
+
+    ~KernelGuard();
+
+   private:
+    std::string old_kernel_;
+  };
+
+  // Records the time spent in its scope as a phase of the kernel being
+  // compiled on this thread.
+  class PhaseGuard {
+   public:
+    PhaseGuard(const std::string &name, const std::string &category);
+
+    ~PhaseGuard();
+
+   private:
+    bool enabled_{false};
+    std::string name_;
+    std::string category_;
+    float64 begin_{0};
+  };
+
+ private:
+  bool enabled_{false};
+  std::mutex mut_;
+  std::vector<Event> events_;
+};
+
+TLANG_NAMESPACE_END
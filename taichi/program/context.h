@@ -11,12 +11,17 @@ namespace lang {
 struct LLVMRuntime;
 
 // "Context" holds necessary data for kernel body execution, such as a pointer
-// to the LLVMRuntime struct, kernel arguments, and the thread id (if on CPU).
+// to the LLVMRuntime struct and kernel arguments. It is shared by all threads
+// running a kernel and is read-only during the execution. Per-thread data,
+// such as the thread id on CPUs, is passed to task functions separately.
 struct Context {
   LLVMRuntime *runtime;
   uint64 args[taichi_max_num_args_total];
   int32 extra_args[taichi_max_num_args_extra][taichi_max_num_indices];
-  int32 cpu_thread_id;
+  // The thread id of serial tasks on CPUs. It is the id of the first thread of
+  // the thread pool running the kernel, which is not 0 for the pools of the
+  // async engine. See ThreadPool::get_launch_thread_id_offset.
+  int32 cpu_thread_id_offset{0};
 
   static constexpr size_t extra_args_size = sizeof(extra_args);
 
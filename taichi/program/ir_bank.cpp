@@ -6,6 +6,7 @@
 #include "taichi/ir/analysis.h"
 #include "taichi/program/kernel.h"
 #include "taichi/program/state_flow_graph.h"
+#include "taichi/system/timer.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -13,15 +14,25 @@ namespace {
 
 uint64 hash(IRNode *stmt) {
   TI_ASSERT(stmt);
-  // TODO: upgrade this using IR comparisons
+  uint64 ret = irpass::analysis::structural_hash(stmt);
+
+  // TODO: separate kernel from IR template
+  auto *kernel = stmt->get_kernel();
+  if (!kernel->args.empty()) {
+    // We need to record the kernel's name if it has arguments.
+    ret = ret * 100000007UL + std::hash<std::string>{}(kernel->name);
+  }
+  return ret;
+}
+
+// The hash used before structural_hash(). Only kept for benchmarking.
+uint64 hash_by_printing(IRNode *stmt) {
   std::string serialized;
   irpass::re_id(stmt);
   irpass::print(stmt, &serialized);
 
-  // TODO: separate kernel from IR template
   auto *kernel = stmt->get_kernel();
   if (!kernel->args.empty()) {
-    // We need to record the kernel's name if it has arguments.
     serialized += stmt->get_kernel()->name;
   }
 
@@ -48,6 +59,33 @@ void IRBank::set_hash(IRNode *ir, uint64 hash) {
   hash_bank_[ir] = hash;
 }
 
+void IRBank::benchmark_hash() {
+  constexpr int kRepeats = 100;
+  double print_time = 0, structural_time = 0;
+  std::size_t num_statements = 0;
+  for (auto &[handle, ir] : ir_bank_) {
+    num_statements += irpass::analysis::count_statements(ir.get());
+    // hash_by_printing() renumbers the IR, so work on a copy.
+    auto cloned = handle.clone();
+    auto t = Time::get_time();
+    for (int i = 0; i < kRepeats; i++) {
+      hash_by_printing(cloned.get());
+    }
+    print_time += Time::get_time() - t;
+    t = Time::get_time();
+    for (int i = 0; i < kRepeats; i++) {
+      hash(ir.get());
+    }
+    structural_time += Time::get_time() - t;
+  }
+  const auto num_tasks = std::max<std::size_t>(ir_bank_.size(), 1);
+  TI_INFO(
+      "{} tasks ({} statements): per task, printing {:.3f} us, structural "
+      "hashing {:.3f} us",
+      ir_bank_.size(), num_statements, print_time * 1e6 / kRepeats / num_tasks,
+      structural_time * 1e6 / kRepeats / num_tasks);
+}
+
 bool IRBank::insert(std::unique_ptr<IRNode> &&ir, uint64 hash) {
   IRHandle handle(ir.get(), hash);
   auto insert_place = ir_bank_.find(handle);
@@ -114,9 +152,6 @@ IRHandle IRBank::fuse(IRHandle handle_a, IRHandle handle_b, Kernel *kernel) {
 
   irpass::full_simplify(task_a, kernel->program->config,
                         {/*after_lower_access=*/false, kernel->program});
-  // For now, re_id is necessary for the hash to be correct.
-  irpass::re_id(task_a);
-
   auto h = get_hash(task_a);
   result = IRHandle(task_a, h);
   insert(std::move(cloned_task_a), h);
@@ -13,6 +13,10 @@ class IRBank {
   uint64 get_hash(IRNode *ir);
   void set_hash(IRNode *ir, uint64 hash);
 
+  // Compares the per-task cost of hashing by printing the IR against that of
+  // irpass::analysis::structural_hash() on all the IRs in the bank.
+  void benchmark_hash();
+
   bool insert(std::unique_ptr<IRNode> &&ir, uint64 hash);
   void insert_to_trash_bin(std::unique_ptr<IRNode> &&ir);
   IRNode *find(IRHandle ir_handle);
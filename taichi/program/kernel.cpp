@@ -113,6 +113,10 @@ void Kernel::lower(bool to_executable) {
 }
 
 void Kernel::operator()(LaunchContextBuilder &ctx_builder) {
+  if (program->capturing_launch_graph && !is_accessor && !is_evaluator) {
+    program->capturing_launch_graph->add_launch(this,
+                                                ctx_builder.get_context());
+  }
   if (!program->config.async_mode || this->is_evaluator) {
     if (!compiled_) {
       compile();
@@ -125,6 +129,10 @@ void Kernel::operator()(LaunchContextBuilder &ctx_builder) {
     compiled_(ctx_builder.get_context());
 
     program->sync = (program->sync && arch_is_cpu(arch));
+    if (program->sync) {
+      // Otherwise checked by the next Program::synchronize().
+      program->check_hash_overflow();
+    }
     // Note that Kernel::arch may be different from program.config.arch
     if (program->config.debug && (arch_is_cpu(program->config.arch) ||
                                   program->config.arch == Arch::cuda)) {
@@ -348,6 +356,9 @@ void Kernel::account_for_offloaded(OffloadedStmt *stmt) {
   } else if (task_type == OffloadedStmt::TaskType::struct_for) {
     stat.add("launched_tasks_compute", 1.0);
     stat.add("launched_tasks_struct_for", 1.0);
+    if (stmt->bls_size > 0) {
+      stat.add("launched_tasks_bls", 1.0);
+    }
   } else if (task_type == OffloadedStmt::TaskType::gc) {
     stat.add("launched_tasks_garbage_collect", 1.0);
   }
@@ -69,6 +69,10 @@ class Kernel : public Callable {
     return lowered_;
   }
 
+  bool compiled() const {
+    return compiled_ != nullptr;
+  }
+
   void compile();
 
   /**
@@ -109,6 +113,11 @@ class Kernel : public Callable {
   // lower inital AST all the way down to a bunch of
   // OffloadedStmt for async execution
   bool lowered_{false};
+
+  // Sets |compiled_| in Program::compile_kernels().
+  friend class Program;
+  // Reads |compiled_| to replay the captured launches.
+  friend class LaunchGraph;
 };
 
 TLANG_NAMESPACE_END
@@ -0,0 +1,117 @@
+#include "taichi/program/launch_graph.h"
+
+#include "taichi/program/async_engine.h"
+#include "taichi/program/kernel.h"
+#include "taichi/program/program.h"
+
+TLANG_NAMESPACE_BEGIN
+
+LaunchGraph::LaunchGraph(Program *program) : program_(program) {
+}
+
+LaunchGraph::~LaunchGraph() {
+  if (capturing_) {
+    program_->capturing_launch_graph = nullptr;
+  }
+}
+
+void LaunchGraph::check_program_alive() const {
+  // The captured kernels and their compiled functions are released along
+  // with the runtime, e.g. by ti.reset().
+  TI_ERROR_IF(program_->is_finalized(),
+              "The program of the launch graph has been finalized.");
+}
+
+void LaunchGraph::begin_capture() {
+  check_program_alive();
+  TI_ERROR_IF(capturing_, "The launch graph is already capturing.");
+  TI_ERROR_IF(program_->capturing_launch_graph != nullptr,
+              "Another launch graph is capturing.");
+  launches_.clear();
+  capturing_ = true;
+  program_->capturing_launch_graph = this;
+}
+
+void LaunchGraph::end_capture() {
+  TI_ERROR_IF(!capturing_, "The launch graph is not capturing.");
+  capturing_ = false;
+  program_->capturing_launch_graph = nullptr;
+  check_program_alive();
+  if (program_->config.async_mode) {
+    // The AsyncEngine compiles the launches itself.
+    return;
+  }
+  for (auto &launch : launches_) {
+    if (!launch.kernel->compiled_) {
+      launch.kernel->compile();
+    }
+    launch.func = launch.kernel->compiled_;
+  }
+}
+
+void LaunchGraph::add_launch(Kernel *kernel, const Context &context) {
+  TI_ASSERT(capturing_);
+  for (auto &arg : kernel->args) {
+    // The external arrays may be freed or reallocated before a replay.
+    TI_ERROR_IF(arg.is_external_array,
+                "Kernel {} takes an external array, which cannot be captured "
+                "in a launch graph.",
+                kernel->get_name());
+  }
+  TI_ERROR_IF(!kernel->rets.empty(),
+              "Kernel {} returns a value, which cannot be captured in a launch "
+              "graph.",
+              kernel->get_name());
+  launches_.push_back({kernel, context, nullptr});
+}
+
+LaunchGraph::Launch &LaunchGraph::get_launch(int launch_id) {
+  TI_ERROR_IF(launch_id < 0 || launch_id >= (int)launches_.size(),
+              "Launch {} out of range [0, {}).", launch_id, launches_.size());
+  return launches_[launch_id];
+}
+
+void LaunchGraph::set_arg_int(int launch_id, int arg_id, int64 value) {
+  auto &launch = get_launch(launch_id);
+  TI_ERROR_IF(arg_id < 0 || arg_id >= (int)launch.kernel->args.size(),
+              "Argument {} out of range [0, {}) for kernel {}.", arg_id,
+              launch.kernel->args.size(), launch.kernel->get_name());
+  Kernel::LaunchContextBuilder(launch.kernel, &launch.context)
+      .set_arg_int(arg_id, value);
+}
+
+void LaunchGraph::set_arg_float(int launch_id, int arg_id, float64 value) {
+  auto &launch = get_launch(launch_id);
+  TI_ERROR_IF(arg_id < 0 || arg_id >= (int)launch.kernel->args.size(),
+              "Argument {} out of range [0, {}) for kernel {}.", arg_id,
+              launch.kernel->args.size(), launch.kernel->get_name());
+  Kernel::LaunchContextBuilder(launch.kernel, &launch.context)
+      .set_arg_float(arg_id, value);
+}
+
+void LaunchGraph::run() {
+  check_program_alive();
+  TI_ERROR_IF(capturing_, "Cannot replay a launch graph while capturing.");
+  if (launches_.empty()) {
+    return;
+  }
+  if (program_->config.async_mode) {
+    program_->sync = false;
+    for (auto &launch : launches_) {
+      program_->async_engine->launch(launch.kernel, launch.context);
+    }
+    return;
+  }
+  bool host_only = true;
+  for (auto &launch : launches_) {
+    launch.func(launch.context);
+    host_only = host_only && arch_is_cpu(launch.kernel->arch);
+  }
+  program_->sync = program_->sync && host_only;
+  if (program_->config.debug && (arch_is_cpu(program_->config.arch) ||
+                                 program_->config.arch == Arch::cuda)) {
+    program_->check_runtime_error();
+  }
+}
+
+TLANG_NAMESPACE_END
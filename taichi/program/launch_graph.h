@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+#include "taichi/lang_util.h"
+#define TI_RUNTIME_HOST
+#include "taichi/program/context.h"
+#undef TI_RUNTIME_HOST
+
+TLANG_NAMESPACE_BEGIN
+
+class Kernel;
+class Program;
+
+/**
+ * A sequence of kernel launches that is recorded once, along with the
+ * arguments of each launch, and then replayed from C++. A replay skips the
+ * Python launch path and the per-launch checks of Kernel::operator(), so it
+ * only costs an indirect call per launch. The scalar arguments of a launch
+ * can be patched between replays.
+ *
+ * The kernels are compiled at the end of the capture. In async mode, a replay
+ * hands the launches to the AsyncEngine instead, so that the StateFlowGraph
+ * optimizations (fusion, listgen elimination, DSE) still apply to them.
+ */
+class LaunchGraph {
+ public:
+  explicit LaunchGraph(Program *program);
+
+  ~LaunchGraph();
+
+  LaunchGraph(const LaunchGraph &) = delete;
+  LaunchGraph &operator=(const LaunchGraph &) = delete;
+
+  // Records the kernels launched on |program| until end_capture(). The
+  // kernels still run while being recorded.
+  void begin_capture();
+
+  void end_capture();
+
+  bool is_capturing() const {
+    return capturing_;
+  }
+
+  // Called by Kernel::operator() during a capture.
+  void add_launch(Kernel *kernel, const Context &context);
+
+  int num_launches() const {
+    return (int)launches_.size();
+  }
+
+  // Patches the |arg_id|-th argument of the |launch_id|-th launch.
+  void set_arg_int(int launch_id, int arg_id, int64 value);
+
+  void set_arg_float(int launch_id, int arg_id, float64 value);
+
+  void run();
+
+ private:
+  struct Launch {
+    Kernel *kernel;
+    Context context;
+    FunctionType func;
+  };
+
+  Launch &get_launch(int launch_id);
+
+  void check_program_alive() const;
+
+  Program *program_;
+  bool capturing_{false};
+  std::vector<Launch> launches_;
+};
+
+TLANG_NAMESPACE_END
@@ -16,6 +16,7 @@
 #include "taichi/ir/snode.h"
 #include "taichi/ir/frontend_ir.h"
 #include "taichi/program/async_engine.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/util/statistics.h"
 #include "taichi/math/arithmetic.h"
@@ -148,6 +149,7 @@ Program::Program(Arch desired_arch) : snode_rw_accessors_bank_(this) {
   stat.clear();
 
   Timelines::get_instance().set_enabled(config.timeline);
+  CompileProfiler::get_instance().set_enabled(config.compile_profiler);
 
   TI_TRACE("Program ({}) arch={} initialized.", fmt::ptr(this),
            arch_name(config.arch));
@@ -174,7 +176,7 @@ FunctionType Program::compile(Kernel &kernel, OffloadedStmt *offloaded) {
   FunctionType ret = nullptr;
   if (arch_uses_llvm(config.arch) || kernel.arch == Arch::metal ||
       kernel.arch == Arch::vulkan || kernel.arch == Arch::opengl) {
-    return program_impl_->compile(&kernel, offloaded);
+    ret = program_impl_->compile(&kernel, offloaded);
 #ifdef TI_WITH_CC
   } else if (kernel.arch == Arch::cc) {
     ret = cccp::compile_kernel(&kernel);
@@ -183,10 +185,69 @@ FunctionType Program::compile(Kernel &kernel, OffloadedStmt *offloaded) {
     TI_NOT_IMPLEMENTED;
   }
   TI_ASSERT(ret);
+  std::lock_guard<std::mutex> _(compilation_time_mut_);
   total_compilation_time_ += Time::get_time() - start_t;
   return ret;
 }
 
+void Program::compile_kernels(const std::vector<Kernel *> &kernels) {
+  TI_AUTO_PROF;
+  if (config.async_mode) {
+    return;
+  }
+  std::vector<Kernel *> kernels_to_compile;
+  for (auto *kernel : kernels) {
+    if (!kernel->compiled()) {
+      kernels_to_compile.push_back(kernel);
+    }
+  }
+  if (!arch_uses_llvm(config.arch) || config.num_compile_threads <= 1 ||
+      kernels_to_compile.size() <= 1) {
+    for (auto *kernel : kernels_to_compile) {
+      kernel->compile();
+    }
+    return;
+  }
+
+  // Lowering switches |current_callable|, so it cannot run concurrently. It
+  // is only read by the frontend, so codegen below runs without the
+  // CurrentCallableGuard that Kernel::compile() would take.
+  for (auto *kernel : kernels_to_compile) {
+    if (!kernel->lowered()) {
+      kernel->lower();
+    }
+  }
+
+  if (!compilation_workers_) {
+    compilation_workers_ = std::make_unique<ParallelExecutor>(
+        "kernel_compiler", config.num_compile_threads);
+  }
+  std::vector<FunctionType> funcs(kernels_to_compile.size());
+  std::mutex error_mut;
+  std::exception_ptr error;
+  for (int i = 0; i < (int)kernels_to_compile.size(); i++) {
+    compilation_workers_->enqueue([&, i]() {
+      auto *kernel = kernels_to_compile[i];
+      TI_TIMELINE(kernel->name);
+      try {
+        funcs[i] = compile(*kernel);
+      } catch (...) {
+        std::lock_guard<std::mutex> _(error_mut);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    });
+  }
+  compilation_workers_->flush();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  for (int i = 0; i < (int)kernels_to_compile.size(); i++) {
+    kernels_to_compile[i]->compiled_ = std::move(funcs[i]);
+  }
+}
+
 void Program::materialize_runtime() {
   if (arch_uses_llvm(config.arch) || config.arch == Arch::metal ||
       config.arch == Arch::vulkan || config.arch == Arch::opengl) {
@@ -230,6 +291,12 @@ void Program::materialize_snode_tree(SNodeTree *tree) {
   }
 }
 
+void Program::check_hash_overflow() {
+  if (arch_uses_llvm(config.arch)) {
+    get_llvm_program_impl()->check_hash_overflow(result_buffer);
+  }
+}
+
 void Program::check_runtime_error() {
   TI_ASSERT(arch_uses_llvm(config.arch));
   static_cast<LlvmProgramImpl *>(program_impl_.get())
@@ -248,6 +315,7 @@ void Program::synchronize() {
         config.arch == Arch::vulkan) {
       program_impl_->synchronize();
     }
+    check_hash_overflow();
     sync = true;
   }
 }
@@ -418,6 +486,7 @@ void Program::finalize() {
   if (async_engine)
     async_engine = nullptr;  // Finalize the async engine threads before
                              // anything else gets destoried.
+  compilation_workers_ = nullptr;
   TI_TRACE("Program finalizing...");
   if (config.print_benchmark_stat) {
     const char *current_test = std::getenv("PYTEST_CURRENT_TEST");
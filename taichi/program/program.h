@@ -5,6 +5,7 @@
 #include <functional>
 #include <optional>
 #include <atomic>
+#include <mutex>
 
 #define TI_RUNTIME_HOST
 #include "taichi/ir/ir.h"
@@ -19,6 +20,7 @@
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
 #include "taichi/program/kernel_profiler.h"
+#include "taichi/program/launch_graph.h"
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/program/snode_rw_accessors_bank.h"
 #include "taichi/program/context.h"
@@ -83,6 +85,7 @@ TI_FORCE_INLINE Program &get_current_program() {
 class StructCompiler;
 
 class AsyncEngine;
+class ParallelExecutor;
 
 /**
  * Note [Backend-specific ProgramImpl]
@@ -111,6 +114,9 @@ class Program {
 
   std::unique_ptr<AsyncEngine> async_engine{nullptr};
 
+  // Records the kernel launches while not null. See LaunchGraph.
+  LaunchGraph *capturing_launch_graph{nullptr};
+
   std::vector<std::unique_ptr<Kernel>> kernels;
 
   std::unique_ptr<KernelProfilerBase> profiler{nullptr};
@@ -215,8 +221,20 @@ class Program {
   // future.
   FunctionType compile(Kernel &kernel, OffloadedStmt *offloaded = nullptr);
 
+  /**
+   * Compiles the kernels in @param kernels that are not compiled yet, so that
+   * their first launches do not stall on compilation.
+   *
+   * The kernels are lowered on the calling thread. On LLVM backends, their
+   * codegen then runs concurrently on |config.num_compile_threads| threads.
+   * This is a no-op in async mode, where kernels are compiled per task.
+   */
+  void compile_kernels(const std::vector<Kernel *> &kernels);
+
   void check_runtime_error();
 
+  void check_hash_overflow();
+
   Kernel &get_snode_reader(SNode *snode);
 
   Kernel &get_snode_writer(SNode *snode);
@@ -240,6 +258,10 @@ class Program {
 
   void finalize();
 
+  bool is_finalized() const {
+    return finalized_;
+  }
+
   static int get_kernel_id() {
     static int id = 0;
     TI_ASSERT(id < 100000);
@@ -310,6 +332,10 @@ class Program {
   std::unordered_map<FunctionKey, Function *> function_map_;
 
   std::unique_ptr<ProgramImpl> program_impl_;
+  // Created on the first call to compile_kernels().
+  std::unique_ptr<ParallelExecutor> compilation_workers_;
+  // Guards |total_compilation_time_| against compile_kernels() workers.
+  std::mutex compilation_time_mut_;
   float64 total_compilation_time_{0.0};
   static std::atomic<int> num_instances_;
   bool finalized_{false};
@@ -1,5 +1,8 @@
 #include "taichi/program/sparse_matrix.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <sstream>
 
 #include "Eigen/Dense"
@@ -10,113 +13,352 @@ namespace lang {
 
 SparseMatrixBuilder::SparseMatrixBuilder(int rows,
                                          int cols,
-                                         int max_num_triplets)
-    : rows_(rows), cols_(cols), max_num_triplets_(max_num_triplets) {
-  data_.reserve(max_num_triplets * 3);
-  data_base_ptr_ = get_data_base_ptr();
+                                         int max_num_triplets,
+                                         DataType dtype,
+                                         ThreadPool *thread_pool)
+    : rows_(rows),
+      cols_(cols),
+      max_num_triplets_(max_num_triplets),
+      dtype_(dtype),
+      thread_pool_(thread_pool) {
+  TI_ERROR_IF(!dtype->is_primitive(PrimitiveTypeID::f32) &&
+                  !dtype->is_primitive(PrimitiveTypeID::f64),
+              "SparseMatrix only supports f32 and f64, but got {}.",
+              dtype->to_string());
+  // |thread_pool| has cpu_max_num_threads threads. The thread pools of the
+  // async engine use thread ids below that as well, see AsyncEngine.
+  const int num_threads =
+      thread_pool ? thread_pool->get_max_num_threads() : 1;
+  // Each thread may leave a partially filled chunk behind.
+  const int64 max_num_chunks =
+      (max_num_triplets + taichi_sparse_matrix_chunk_size - 1) /
+          taichi_sparse_matrix_chunk_size +
+      num_threads;
+  const std::size_t capacity =
+      (std::size_t)max_num_chunks * taichi_sparse_matrix_chunk_size;
+  thread_chunks_.resize(num_threads * taichi_sparse_matrix_thread_chunk_stride,
+                        -1);
+  chunk_sizes_.resize(max_num_chunks, 0);
+  rows_data_.resize(capacity);
+  cols_data_.resize(capacity);
+
+  triplets_.num_chunks = 0;
+  triplets_.max_num_chunks = max_num_chunks;
+  triplets_.num_dropped = 0;
+  triplets_.num_threads = num_threads;
+  triplets_.thread_chunks = thread_chunks_.data();
+  triplets_.chunk_sizes = chunk_sizes_.data();
+  triplets_.rows = rows_data_.data();
+  triplets_.cols = cols_data_.data();
+  if (dtype->is_primitive(PrimitiveTypeID::f64)) {
+    values_f64_.resize(capacity);
+    triplets_.is_f64 = 1;
+    triplets_.values = values_f64_.data();
+  } else {
+    values_f32_.resize(capacity);
+    triplets_.is_f64 = 0;
+    triplets_.values = values_f32_.data();
+  }
 }
 
 void *SparseMatrixBuilder::get_data_base_ptr() {
-  return data_.data();
+  return &triplets_;
+}
+
+int64 SparseMatrixBuilder::get_num_chunks() const {
+  return std::min(triplets_.num_chunks, triplets_.max_num_chunks);
 }
 
 void SparseMatrixBuilder::print_triplets() {
+  const auto num_chunks = get_num_chunks();
+  int64 num_triplets = 0;
+  for (int64 c = 0; c < num_chunks; c++) {
+    num_triplets += chunk_sizes_[c];
+  }
   fmt::print("n={}, m={}, num_triplets={} (max={})", rows_, cols_,
-             num_triplets_, max_num_triplets_);
-  for (int64 i = 0; i < num_triplets_; i++) {
-    fmt::print("({}, {}) val={}", data_[i * 3], data_[i * 3 + 1],
-               taichi_union_cast<float32>(data_[i * 3 + 2]));
+             num_triplets, max_num_triplets_);
+  for (int64 c = 0; c < num_chunks; c++) {
+    for (int64 k = c * taichi_sparse_matrix_chunk_size;
+         k < c * taichi_sparse_matrix_chunk_size + chunk_sizes_[c]; k++) {
+      fmt::print("({}, {}) val={}", rows_data_[k], cols_data_[k],
+                 triplets_.is_f64 ? values_f64_[k] : values_f32_[k]);
+    }
   }
   fmt::print("\n");
 }
 
-SparseMatrix SparseMatrixBuilder::build() {
+void SparseMatrixBuilder::reset() {
+  std::fill(chunk_sizes_.begin(), chunk_sizes_.begin() + get_num_chunks(), 0);
+  std::fill(thread_chunks_.begin(), thread_chunks_.end(), -1);
+  triplets_.num_chunks = 0;
+  triplets_.num_dropped = 0;
+  built_ = false;
+}
+
+template <typename Func>
+void SparseMatrixBuilder::parallel_for_columns(const Func &func) {
+  const int num_threads =
+      thread_pool_ ? thread_pool_->get_max_num_threads() : 1;
+  const int num_column_blocks = std::min(cols_, num_threads * 16);
+  parallel_for(thread_pool_, num_column_blocks, [&](int b) {
+    const int begin = (int)((int64)cols_ * b / num_column_blocks);
+    const int end = (int)((int64)cols_ * (b + 1) / num_column_blocks);
+    for (int j = begin; j < end; j++) {
+      func(j);
+    }
+  });
+}
+
+// 1. Count the triplets of each column.
+// 2. Scatter the triplets into the segments of their columns.
+template <typename T>
+void SparseMatrixBuilder::scatter_by_column(
+    std::vector<ColumnEntry<T>> &entries,
+    std::vector<int64> &segment_begin) {
   TI_ASSERT(built_ == false);
+  TI_ASSERT(((bool)triplets_.is_f64 == std::is_same_v<T, float64>));
   built_ = true;
-  using T = Eigen::Triplet<float32>;
-  std::vector<T> triplets;
-  for (int i = 0; i < num_triplets_; i++) {
-    triplets.push_back(T(data_[i * 3], data_[i * 3 + 1],
-                         taichi_union_cast<float32>(data_[i * 3 + 2])));
+  TI_ERROR_IF(triplets_.num_dropped > 0,
+              "{} triplets were dropped since the sparse matrix builder is "
+              "full. Please increase max_num_triplets (currently {}).",
+              triplets_.num_dropped, max_num_triplets_);
+
+  const T *values = (const T *)triplets_.values;
+  const int num_chunks = (int)get_num_chunks();
+  auto for_each_triplet_in_chunk = [&](int c, const auto &func) {
+    const int64 begin = (int64)c * taichi_sparse_matrix_chunk_size;
+    for (int64 k = begin; k < begin + chunk_sizes_[c]; k++) {
+      func(k);
+    }
+  };
+
+  // Step 1
+  std::vector<std::atomic<int64>> counts(cols_ + 1);
+  std::atomic<bool> out_of_range{false};
+  parallel_for(thread_pool_, num_chunks, [&](int c) {
+    for_each_triplet_in_chunk(c, [&](int64 k) {
+      const auto row = rows_data_[k];
+      const auto col = cols_data_[k];
+      if (row < 0 || row >= rows_ || col < 0 || col >= cols_) {
+        out_of_range.store(true, std::memory_order_relaxed);
+        return;
+      }
+      counts[col].fetch_add(1, std::memory_order_relaxed);
+    });
+  });
+  TI_ERROR_IF(out_of_range, "Triplet index out of the range of ({}, {}).",
+              rows_, cols_);
+
+  segment_begin.resize(cols_ + 1);
+  segment_begin[0] = 0;
+  for (int j = 0; j < cols_; j++) {
+    segment_begin[j + 1] = segment_begin[j] + counts[j];
+    counts[j] = segment_begin[j];
   }
-  SparseMatrix sm(rows_, cols_);
-  sm.get_matrix().setFromTriplets(triplets.begin(), triplets.end());
+  const int64 num_triplets = segment_begin[cols_];
+  TI_ERROR_IF(num_triplets > std::numeric_limits<int>::max(),
+              "Too many triplets ({}) for a sparse matrix.", num_triplets);
+
+  // Step 2
+  entries.resize(num_triplets);
+  parallel_for(thread_pool_, num_chunks, [&](int c) {
+    for_each_triplet_in_chunk(c, [&](int64 k) {
+      auto pos =
+          counts[cols_data_[k]].fetch_add(1, std::memory_order_relaxed);
+      entries[pos] = ColumnEntry<T>{rows_data_[k], values[k]};
+    });
+  });
+}
+
+// Assembles the compressed column storage of the matrix directly:
+//  1-2. Group the triplets by column, see scatter_by_column().
+//  3. Sort each segment by row and sum up the duplicates.
+//  4. Compact the segments into the Eigen matrix.
+// All steps except the prefix sums run in parallel on |thread_pool_|.
+template <typename T>
+SparseMatrix<T> SparseMatrixBuilder::build() {
+  std::vector<ColumnEntry<T>> entries;
+  std::vector<int64> segment_begin;
+  scatter_by_column(entries, segment_begin);
+
+  // Step 3
+  std::vector<int64> num_nonzeros(cols_ + 1, 0);
+  parallel_for_columns([&](int j) {
+    auto begin = entries.begin() + segment_begin[j];
+    auto end = entries.begin() + segment_begin[j + 1];
+    std::sort(begin, end, [](const ColumnEntry<T> &a, const ColumnEntry<T> &b) {
+      return a.row < b.row;
+    });
+    // Sum up the duplicates in place.
+    int64 n = 0;
+    for (auto it = begin; it != end; ++it) {
+      if (n > 0 && begin[n - 1].row == it->row) {
+        begin[n - 1].value += it->value;
+      } else {
+        begin[n++] = *it;
+      }
+    }
+    num_nonzeros[j] = n;
+  });
+
+  // Step 4
+  SparseMatrix<T> sm(rows_, cols_);
+  auto &matrix = sm.get_matrix();
+  auto outer_index = matrix.outerIndexPtr();
+  outer_index[0] = 0;
+  for (int j = 0; j < cols_; j++) {
+    outer_index[j + 1] = outer_index[j] + (int)num_nonzeros[j];
+  }
+  matrix.resizeNonZeros(outer_index[cols_]);
+  auto inner_index = matrix.innerIndexPtr();
+  auto value_ptr = matrix.valuePtr();
+  parallel_for_columns([&](int j) {
+    for (int64 k = 0; k < num_nonzeros[j]; k++) {
+      const auto &entry = entries[segment_begin[j] + k];
+      inner_index[outer_index[j] + k] = entry.row;
+      value_ptr[outer_index[j] + k] = entry.value;
+    }
+  });
   return sm;
 }
 
-SparseMatrix::SparseMatrix(Eigen::SparseMatrix<float32> &matrix) {
-  this->matrix_ = matrix;
+// Instead of sorting, each triplet finds its position by a binary search in
+// the (sorted) rows of its column.
+template <typename T>
+void SparseMatrixBuilder::refill(SparseMatrix<T> &sm) {
+  TI_ERROR_IF(sm.num_rows() != rows_ || sm.num_cols() != cols_,
+              "Cannot refill a ({}, {}) sparse matrix with a ({}, {}) "
+              "builder.",
+              sm.num_rows(), sm.num_cols(), rows_, cols_);
+  TI_ERROR_IF(((bool)triplets_.is_f64 != std::is_same_v<T, float64>),
+              "Cannot refill a sparse matrix of a different dtype.");
+  std::vector<ColumnEntry<T>> entries;
+  std::vector<int64> segment_begin;
+  scatter_by_column(entries, segment_begin);
+
+  auto &matrix = sm.get_matrix();
+  matrix.makeCompressed();
+  const auto outer_index = matrix.outerIndexPtr();
+  const auto inner_index = matrix.innerIndexPtr();
+  auto value_ptr = matrix.valuePtr();
+  std::atomic<bool> not_in_pattern{false};
+  parallel_for_columns([&](int j) {
+    const auto rows_begin = inner_index + outer_index[j];
+    const auto rows_end = inner_index + outer_index[j + 1];
+    std::fill(value_ptr + outer_index[j], value_ptr + outer_index[j + 1],
+              T(0));
+    for (int64 k = segment_begin[j]; k < segment_begin[j + 1]; k++) {
+      const auto &entry = entries[k];
+      auto it = std::lower_bound(rows_begin, rows_end, entry.row);
+      if (it == rows_end || *it != entry.row) {
+        not_in_pattern.store(true, std::memory_order_relaxed);
+        continue;
+      }
+      value_ptr[it - inner_index] += entry.value;
+    }
+  });
+  TI_ERROR_IF(not_in_pattern,
+              "Some triplets are not in the pattern of the sparse matrix to "
+              "refill.");
 }
 
-SparseMatrix::SparseMatrix(int rows, int cols) : matrix_(rows, cols) {
+template SparseMatrix<float32> SparseMatrixBuilder::build<float32>();
+template SparseMatrix<float64> SparseMatrixBuilder::build<float64>();
+template void SparseMatrixBuilder::refill<float32>(SparseMatrix<float32> &sm);
+template void SparseMatrixBuilder::refill<float64>(SparseMatrix<float64> &sm);
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(const EigenMatrix &matrix) : matrix_(matrix) {
+}
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(EigenMatrix &&matrix)
+    : matrix_(std::move(matrix)) {
+}
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(int rows, int cols) : matrix_(rows, cols) {
 }
 
-const std::string SparseMatrix::to_string() const {
+template <typename T>
+const std::string SparseMatrix<T>::to_string() const {
   Eigen::IOFormat clean_fmt(4, 0, ", ", "\n", "[", "]");
   // Note that the code below first converts the sparse matrix into a dense one.
   // https://stackoverflow.com/questions/38553335/how-can-i-print-in-console-a-formatted-sparse-matrix-with-eigen
   std::ostringstream ostr;
-  ostr << Eigen::MatrixXf(matrix_).format(clean_fmt);
+  ostr << Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>(matrix_).format(
+      clean_fmt);
   return ostr.str();
 }
 
-const int SparseMatrix::num_rows() const {
+template <typename T>
+const int SparseMatrix<T>::num_rows() const {
   return matrix_.rows();
 }
-const int SparseMatrix::num_cols() const {
+
+template <typename T>
+const int SparseMatrix<T>::num_cols() const {
   return matrix_.cols();
 }
 
-Eigen::SparseMatrix<float32> &SparseMatrix::get_matrix() {
+template <typename T>
+typename SparseMatrix<T>::EigenMatrix &SparseMatrix<T>::get_matrix() {
   return matrix_;
 }
 
-const Eigen::SparseMatrix<float32> &SparseMatrix::get_matrix() const {
+template <typename T>
+const typename SparseMatrix<T>::EigenMatrix &SparseMatrix<T>::get_matrix()
+    const {
   return matrix_;
 }
 
-SparseMatrix operator+(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_ + sm2.matrix_);
-  return SparseMatrix(res);
-}
-
-SparseMatrix operator-(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_ - sm2.matrix_);
-  return SparseMatrix(res);
-}
-
-SparseMatrix operator*(float scale, const SparseMatrix &sm) {
-  Eigen::SparseMatrix<float32> res(scale * sm.matrix_);
-  return SparseMatrix(res);
-}
-
-SparseMatrix operator*(const SparseMatrix &sm, float scale) {
-  return scale * sm;
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::matmul(const SparseMatrix &sm) {
+  return SparseMatrix(EigenMatrix(matrix_ * sm.matrix_));
 }
 
-SparseMatrix operator*(const SparseMatrix &sm1, const SparseMatrix &sm2) {
-  Eigen::SparseMatrix<float32> res(sm1.matrix_.cwiseProduct(sm2.matrix_));
-  return SparseMatrix(res);
+template <typename T>
+typename SparseMatrix<T>::EigenVector SparseMatrix<T>::mat_vec_mul(
+    const Eigen::Ref<const EigenVector> &b) {
+  return matrix_ * b;
 }
 
-SparseMatrix SparseMatrix::matmul(const SparseMatrix &sm) {
-  Eigen::SparseMatrix<float32> res(matrix_ * sm.matrix_);
-  return SparseMatrix(res);
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::transpose() {
+  return SparseMatrix(EigenMatrix(matrix_.transpose()));
 }
 
-Eigen::VectorXf SparseMatrix::mat_vec_mul(
-    const Eigen::Ref<const Eigen::VectorXf> &b) {
-  return matrix_ * b;
+template <typename T>
+T SparseMatrix<T>::get_element(int row, int col) {
+  return matrix_.coeff(row, col);
 }
 
-SparseMatrix SparseMatrix::transpose() {
-  Eigen::SparseMatrix<float32> res(matrix_.transpose());
-  return SparseMatrix(res);
+template <typename T>
+uint64 SparseMatrix<T>::pattern_fingerprint() const {
+  // FNV-1a over 32-bit words.
+  uint64 hash = 14695981039346656037ULL;
+  auto combine = [&](uint32 word) {
+    hash = (hash ^ word) * 1099511628211ULL;
+  };
+  combine(matrix_.rows());
+  combine(matrix_.cols());
+  const auto outer_index = matrix_.outerIndexPtr();
+  const auto inner_index = matrix_.innerIndexPtr();
+  const auto inner_nonzeros = matrix_.innerNonZeroPtr();
+  for (int j = 0; j < matrix_.outerSize(); j++) {
+    const int begin = outer_index[j];
+    const int end =
+        inner_nonzeros ? begin + inner_nonzeros[j] : outer_index[j + 1];
+    combine(end - begin);
+    for (int k = begin; k < end; k++) {
+      combine(inner_index[k]);
+    }
+  }
+  return hash;
 }
 
-float32 SparseMatrix::get_element(int row, int col) {
-  return matrix_.coeff(row, col);
-}
+template class SparseMatrix<float32>;
+template class SparseMatrix<float64>;
 
 }  // namespace lang
 }  // namespace taichi
@@ -2,61 +2,158 @@
 
 #include "taichi/common/core.h"
 #include "taichi/inc/constants.h"
+#include "taichi/ir/type.h"
+#include "taichi/system/threading.h"
 #include "Eigen/Sparse"
 
+#define TI_RUNTIME_HOST
+#include "taichi/runtime/llvm/sparse_matrix_triplets.h"
+#undef TI_RUNTIME_HOST
+
 namespace taichi {
 namespace lang {
 
+template <typename T>
 class SparseMatrix;
 
+/**
+ * Collects the triplets (row, col, value) inserted by kernels, and assembles
+ * them into a SparseMatrix. Triplets at the same position are summed up.
+ */
 class SparseMatrixBuilder {
  public:
-  SparseMatrixBuilder(int rows, int cols, int max_num_triplets);
+  /**
+   * @param dtype The value type of the matrix, f32 or f64.
+   * @param thread_pool The pool running the kernels that insert triplets,
+   * which is also used to assemble the matrix. Triplets can only be inserted
+   * by serial kernels without a pool.
+   */
+  SparseMatrixBuilder(int rows,
+                      int cols,
+                      int max_num_triplets,
+                      DataType dtype,
+                      ThreadPool *thread_pool = nullptr);
+
+  SparseMatrixBuilder(const SparseMatrixBuilder &) = delete;
+  SparseMatrixBuilder(SparseMatrixBuilder &&) = default;
 
+  // Returns the SparseMatrixTriplets passed to insert_triplet.
   void *get_data_base_ptr();
 
   void print_triplets();
 
-  SparseMatrix build();
+  DataType get_dtype() const {
+    return dtype_;
+  }
+
+  template <typename T>
+  SparseMatrix<T> build();
+
+  // Writes the sums of the triplets into the values of |sm| in place, keeping
+  // its structure. Every triplet must be at a stored position of |sm|, and the
+  // other stored values become zero. This skips sorting the triplets, and
+  // keeps the pattern fingerprint of |sm|.
+  template <typename T>
+  void refill(SparseMatrix<T> &sm);
+
+  // Discards the triplets so that kernels can fill the builder again.
+  void reset();
 
  private:
-  uint64 num_triplets_{0};
-  void *data_base_ptr_{nullptr};
-  std::vector<uint32> data_;
+  template <typename T>
+  struct ColumnEntry {
+    int32 row;
+    T value;
+  };
+
+  // Returns the number of chunks holding triplets.
+  int64 get_num_chunks() const;
+
+  // Groups the triplets by column: the ones of column j end up in
+  // entries[segment_begin[j], segment_begin[j + 1]), in no particular order.
+  template <typename T>
+  void scatter_by_column(std::vector<ColumnEntry<T>> &entries,
+                         std::vector<int64> &segment_begin);
+
+  // Runs |func|(j) for every column j, in parallel over blocks of columns.
+  template <typename Func>
+  void parallel_for_columns(const Func &func);
+
   int rows_{0};
   int cols_{0};
   uint64 max_num_triplets_{0};
+  DataType dtype_;
+  ThreadPool *thread_pool_{nullptr};
   bool built_{false};
+
+  SparseMatrixTriplets triplets_;
+  std::vector<int64> thread_chunks_;
+  std::vector<int32> chunk_sizes_;
+  std::vector<int32> rows_data_;
+  std::vector<int32> cols_data_;
+  std::vector<float32> values_f32_;
+  std::vector<float64> values_f64_;
 };
 
+template <typename T>
 class SparseMatrix {
  public:
+  using EigenMatrix = Eigen::SparseMatrix<T>;
+  using EigenVector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
   SparseMatrix() = delete;
   SparseMatrix(int rows, int cols);
-  SparseMatrix(Eigen::SparseMatrix<float32> &matrix);
+  SparseMatrix(const EigenMatrix &matrix);
+  SparseMatrix(EigenMatrix &&matrix);
 
   const int num_rows() const;
   const int num_cols() const;
   const std::string to_string() const;
-  Eigen::SparseMatrix<float32> &get_matrix();
-  const Eigen::SparseMatrix<float32> &get_matrix() const;
-  float32 get_element(int row, int col);
-
-  friend SparseMatrix operator+(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
-  friend SparseMatrix operator-(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
-  friend SparseMatrix operator*(float scale, const SparseMatrix &sm);
-  friend SparseMatrix operator*(const SparseMatrix &sm, float scale);
-  friend SparseMatrix operator*(const SparseMatrix &sm1,
-                                const SparseMatrix &sm2);
+  EigenMatrix &get_matrix();
+  const EigenMatrix &get_matrix() const;
+  T get_element(int row, int col);
+
+  // A hash of the dimensions and the positions of the stored entries. Solvers
+  // take matrices with equal fingerprints as having the same pattern.
+  uint64 pattern_fingerprint() const;
+
   SparseMatrix matmul(const SparseMatrix &sm);
-  Eigen::VectorXf mat_vec_mul(const Eigen::Ref<const Eigen::VectorXf> &b);
+  EigenVector mat_vec_mul(const Eigen::Ref<const EigenVector> &b);
 
   SparseMatrix transpose();
 
  private:
-  Eigen::SparseMatrix<float32> matrix_;
+  EigenMatrix matrix_;
 };
+
+template <typename T>
+SparseMatrix<T> operator+(const SparseMatrix<T> &sm1,
+                          const SparseMatrix<T> &sm2) {
+  return SparseMatrix<T>(sm1.get_matrix() + sm2.get_matrix());
+}
+
+template <typename T>
+SparseMatrix<T> operator-(const SparseMatrix<T> &sm1,
+                          const SparseMatrix<T> &sm2) {
+  return SparseMatrix<T>(sm1.get_matrix() - sm2.get_matrix());
+}
+
+template <typename T>
+SparseMatrix<T> operator*(T scale, const SparseMatrix<T> &sm) {
+  return SparseMatrix<T>(scale * sm.get_matrix());
+}
+
+template <typename T>
+SparseMatrix<T> operator*(const SparseMatrix<T> &sm, T scale) {
+  return scale * sm;
+}
+
+// Element-wise product.
+template <typename T>
+SparseMatrix<T> operator*(const SparseMatrix<T> &sm1,
+                          const SparseMatrix<T> &sm2) {
+  return SparseMatrix<T>(sm1.get_matrix().cwiseProduct(sm2.get_matrix()));
+}
+
 }  // namespace lang
 }  // namespace taichi
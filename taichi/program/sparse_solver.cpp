@@ -1,51 +1,495 @@
 #include "sparse_solver.h"
 
+#include <cmath>
+#include <limits>
+
 namespace taichi {
 namespace lang {
 
-template <class EigenSolver>
-bool EigenSparseSolver<EigenSolver>::compute(const SparseMatrix &sm) {
-  solver_.compute(sm.get_matrix());
+template <class EigenSolver, typename T>
+bool EigenSparseSolver<EigenSolver, T>::compute(const SparseMatrix<T> &sm) {
+  factorize(sm);
   if (solver_.info() != Eigen::Success) {
     return false;
   } else
     return true;
 }
-template <class EigenSolver>
-void EigenSparseSolver<EigenSolver>::analyze_pattern(const SparseMatrix &sm) {
-  solver_.analyzePattern(sm.get_matrix());
+template <class EigenSolver, typename T>
+void EigenSparseSolver<EigenSolver, T>::analyze_pattern(
+    const SparseMatrix<T> &sm) {
+  if (this->update_pattern(sm)) {
+    solver_.analyzePattern(sm.get_matrix());
+  }
 }
 
-template <class EigenSolver>
-void EigenSparseSolver<EigenSolver>::factorize(const SparseMatrix &sm) {
+template <class EigenSolver, typename T>
+void EigenSparseSolver<EigenSolver, T>::factorize(const SparseMatrix<T> &sm) {
+  analyze_pattern(sm);
   solver_.factorize(sm.get_matrix());
 }
 
-template <class EigenSolver>
-Eigen::VectorXf EigenSparseSolver<EigenSolver>::solve(
-    const Eigen::Ref<const Eigen::VectorXf> &b) {
+template <class EigenSolver, typename T>
+typename EigenSparseSolver<EigenSolver, T>::EigenVector
+EigenSparseSolver<EigenSolver, T>::solve(
+    const Eigen::Ref<const EigenVector> &b) {
   return solver_.solve(b);
 }
 
-template <class EigenSolver>
-bool EigenSparseSolver<EigenSolver>::info() {
+template <class EigenSolver, typename T>
+bool EigenSparseSolver<EigenSolver, T>::info() {
   return solver_.info() == Eigen::Success;
 }
 
-std::unique_ptr<SparseSolver> get_sparse_solver(
-    const std::string &solver_type) {
+namespace {
+
+// Rows (or entries) per task of the iterative solvers. The blocks do not
+// depend on the number of threads, which keeps the dot products
+// deterministic.
+constexpr int kIterativeSolverBlockSize = 4096;
+
+}  // namespace
+
+template <typename T>
+IterativeSparseSolver<T>::IterativeSparseSolver(Method method,
+                                                ThreadPool *thread_pool)
+    : method_(method),
+      thread_pool_(thread_pool),
+      tolerance_(std::is_same_v<T, float64> ? 1e-10 : 1e-6) {
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::set_preconditioner(
+    const std::string &preconditioner) {
+  if (preconditioner == "none") {
+    preconditioner_ = Preconditioner::none;
+  } else if (preconditioner == "jacobi") {
+    preconditioner_ = Preconditioner::jacobi;
+  } else if (preconditioner == "ic0") {
+    TI_ERROR_IF(method_ != Method::cg,
+                "The ic0 preconditioner is only supported by CG.");
+    preconditioner_ = Preconditioner::ic0;
+  } else {
+    TI_ERROR("Not supported preconditioner: {}", preconditioner);
+  }
+  factorized_ = false;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::set_max_iterations(int max_iterations) {
+  TI_ERROR_IF(max_iterations < 0, "max_iterations must be non-negative.");
+  max_iterations_ = max_iterations;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::set_tolerance(T tolerance) {
+  tolerance_ = tolerance;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::set_warm_start(bool warm_start) {
+  warm_start_ = warm_start;
+}
+
+template <typename T>
+template <typename Func>
+void IterativeSparseSolver<T>::for_each_block(int n, const Func &func) {
+  const int num_blocks =
+      (n + kIterativeSolverBlockSize - 1) / kIterativeSolverBlockSize;
+  parallel_for(thread_pool_, num_blocks, [&](int block) {
+    func(block, block * kIterativeSolverBlockSize,
+         std::min(n, (block + 1) * kIterativeSolverBlockSize));
+  });
+}
+
+template <typename T>
+float64 IterativeSparseSolver<T>::dot(const T *a, const T *b) {
+  for_each_block(n_, [&](int block, int begin, int end) {
+    float64 sum = 0;
+    for (int i = begin; i < end; i++) {
+      sum += (float64)a[i] * b[i];
+    }
+    partial_sums_[block] = sum;
+  });
+  float64 sum = 0;
+  for (auto partial_sum : partial_sums_) {
+    sum += partial_sum;
+  }
+  return sum;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::spmv(const T *x, T *y) {
+  for_each_block(n_, [&](int, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      T sum = 0;
+      for (int k = row_begin_[i]; k < row_begin_[i + 1]; k++) {
+        sum += values_[k] * x[col_index_[k]];
+      }
+      y[i] = sum;
+    }
+  });
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::precondition(const T *r, T *z) {
+  if (preconditioner_ == Preconditioner::ic0) {
+    // Solve L L^T z = r. The triangular solves are sequential.
+    for (int i = 0; i < n_; i++) {
+      T sum = r[i];
+      for (int k = row_begin_[i]; k < diag_index_[i]; k++) {
+        sum -= factor_[k] * z[col_index_[k]];
+      }
+      z[i] = sum / factor_[diag_index_[i]];
+    }
+    for (int i = n_ - 1; i >= 0; i--) {
+      z[i] /= factor_[diag_index_[i]];
+      for (int k = row_begin_[i]; k < diag_index_[i]; k++) {
+        z[col_index_[k]] -= factor_[k] * z[i];
+      }
+    }
+    return;
+  }
+  const bool jacobi = preconditioner_ == Preconditioner::jacobi;
+  for_each_block(n_, [&](int, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      z[i] = jacobi ? inv_diag_[i] * r[i] : r[i];
+    }
+  });
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::analyze_pattern(const SparseMatrix<T> &sm) {
+  if (!this->update_pattern(sm)) {
+    return;
+  }
+  const auto &matrix = sm.get_matrix();
+  TI_ERROR_IF(matrix.rows() != matrix.cols(),
+              "Iterative solvers only support square matrices, but got a "
+              "({}, {}) one.",
+              matrix.rows(), matrix.cols());
+  TI_ASSERT(matrix.isCompressed());
+  n_ = matrix.rows();
+  nnz_ = matrix.nonZeros();
+  const auto outer_index = matrix.outerIndexPtr();
+  const auto inner_index = matrix.innerIndexPtr();
+
+  // Transpose the pattern. Since the columns are visited in order, the
+  // columns of each row come out sorted.
+  row_begin_.assign(n_ + 1, 0);
+  for (int k = 0; k < nnz_; k++) {
+    row_begin_[inner_index[k] + 1]++;
+  }
+  for (int i = 0; i < n_; i++) {
+    row_begin_[i + 1] += row_begin_[i];
+  }
+  std::vector<int> cursor(row_begin_.begin(), row_begin_.end() - 1);
+  col_index_.resize(nnz_);
+  csc_to_csr_.resize(nnz_);
+  for (int j = 0; j < n_; j++) {
+    for (int k = outer_index[j]; k < outer_index[j + 1]; k++) {
+      const int pos = cursor[inner_index[k]]++;
+      col_index_[pos] = j;
+      csc_to_csr_[k] = pos;
+    }
+  }
+  diag_index_.assign(n_, -1);
+  for (int i = 0; i < n_; i++) {
+    for (int k = row_begin_[i]; k < row_begin_[i + 1]; k++) {
+      if (col_index_[k] == i) {
+        diag_index_[i] = k;
+      }
+    }
+  }
+  values_.resize(nnz_);
+
+  x_.setZero(n_);
+  r_.resize(n_);
+  p_.resize(n_);
+  v_.resize(n_);
+  z_.resize(n_);
+  if (method_ == Method::bicgstab) {
+    r_hat_.resize(n_);
+    s_.resize(n_);
+    t_.resize(n_);
+    y_.resize(n_);
+  }
+  partial_sums_.resize((n_ + kIterativeSolverBlockSize - 1) /
+                       kIterativeSolverBlockSize);
+  factorized_ = false;
+  has_solution_ = false;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::factorize_ic0() {
+  factor_.resize(nnz_);
+  for (int i = 0; i < n_; i++) {
+    if (diag_index_[i] == -1) {
+      factorize_success_ = false;
+      return;
+    }
+    // L_ij = (A_ij - sum_{m < j} L_im L_jm) / L_jj
+    for (int k = row_begin_[i]; k < diag_index_[i]; k++) {
+      const int j = col_index_[k];
+      T sum = values_[k];
+      int a = row_begin_[i], b = row_begin_[j];
+      while (a < k && b < diag_index_[j]) {
+        if (col_index_[a] == col_index_[b]) {
+          sum -= factor_[a++] * factor_[b++];
+        } else if (col_index_[a] < col_index_[b]) {
+          a++;
+        } else {
+          b++;
+        }
+      }
+      factor_[k] = sum / factor_[diag_index_[j]];
+    }
+    // L_ii = sqrt(A_ii - sum_{m < i} L_im^2)
+    const T diag = values_[diag_index_[i]];
+    T pivot = diag;
+    for (int k = row_begin_[i]; k < diag_index_[i]; k++) {
+      pivot -= factor_[k] * factor_[k];
+    }
+    if (!(pivot > 0)) {
+      // The incomplete factorization broke down. Falling back to the diagonal
+      // of A keeps the preconditioner positive definite.
+      pivot = diag != 0 ? std::abs(diag) : T(1);
+    }
+    factor_[diag_index_[i]] = std::sqrt(pivot);
+  }
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::factorize(const SparseMatrix<T> &sm) {
+  analyze_pattern(sm);
+  const T *values = sm.get_matrix().valuePtr();
+  for_each_block(nnz_, [&](int, int begin, int end) {
+    for (int k = begin; k < end; k++) {
+      values_[csc_to_csr_[k]] = values[k];
+    }
+  });
+
+  factorize_success_ = true;
+  converged_ = true;
+  if (preconditioner_ == Preconditioner::jacobi) {
+    inv_diag_.resize(n_);
+    for_each_block(n_, [&](int, int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        const T diag = diag_index_[i] == -1 ? T(0) : values_[diag_index_[i]];
+        inv_diag_[i] = diag != 0 ? T(1) / diag : T(1);
+      }
+    });
+  } else if (preconditioner_ == Preconditioner::ic0) {
+    factorize_ic0();
+  }
+  factorized_ = true;
+}
+
+template <typename T>
+bool IterativeSparseSolver<T>::compute(const SparseMatrix<T> &sm) {
+  factorize(sm);
+  return factorize_success_;
+}
+
+template <typename T>
+typename IterativeSparseSolver<T>::EigenVector IterativeSparseSolver<T>::solve(
+    const Eigen::Ref<const EigenVector> &b) {
+  TI_ERROR_IF(!factorized_, "Please call factorize() before solve().");
+  TI_ERROR_IF(b.size() != n_,
+              "The right-hand side has {} entries, but the matrix has {} "
+              "rows.",
+              b.size(), n_);
+  if (!factorize_success_) {
+    converged_ = false;
+    return EigenVector::Zero(n_);
+  }
+  if (!warm_start_ || !has_solution_) {
+    x_.setZero();
+  }
+  if (method_ == Method::cg) {
+    solve_cg(b.data());
+  } else {
+    solve_bicgstab(b.data());
+  }
+  has_solution_ = true;
+  return x_;
+}
+
+template <typename T>
+void IterativeSparseSolver<T>::solve_cg(const T *b) {
+  T *x = x_.data(), *r = r_.data(), *p = p_.data(), *q = v_.data(),
+    *z = z_.data();
+  const float64 norm_b = std::sqrt(dot(b, b));
+  num_iterations_ = 0;
+  if (norm_b == 0) {
+    x_.setZero();
+    relative_residual_ = 0;
+    converged_ = true;
+    return;
+  }
+
+  spmv(x, q);
+  for_each_block(n_, [&](int, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      r[i] = b[i] - q[i];
+    }
+  });
+  precondition(r, z);
+  for_each_block(n_, [&](int, int begin, int end) {
+    std::copy(z + begin, z + end, p + begin);
+  });
+  float64 rz = dot(r, z);
+  float64 residual = std::sqrt(dot(r, r)) / norm_b;
+
+  while (num_iterations_ < max_iterations_ && residual > tolerance_) {
+    spmv(p, q);
+    const float64 pq = dot(p, q);
+    if (pq == 0) {
+      break;
+    }
+    const T alpha = rz / pq;
+    for_each_block(n_, [&](int, int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        x[i] += alpha * p[i];
+        r[i] -= alpha * q[i];
+      }
+    });
+    precondition(r, z);
+    const float64 rz_new = dot(r, z);
+    const T beta = rz_new / rz;
+    rz = rz_new;
+    for_each_block(n_, [&](int, int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        p[i] = z[i] + beta * p[i];
+      }
+    });
+    residual = std::sqrt(dot(r, r)) / norm_b;
+    num_iterations_++;
+  }
+  relative_residual_ = residual;
+  converged_ = residual <= tolerance_;
+}
+
+// The right-preconditioned BiCGSTAB of van der Vorst, restarted when r_hat
+// becomes orthogonal to the residual.
+template <typename T>
+void IterativeSparseSolver<T>::solve_bicgstab(const T *b) {
+  T *x = x_.data(), *r = r_.data(), *r_hat = r_hat_.data(), *p = p_.data(),
+    *v = v_.data(), *s = s_.data(), *t = t_.data(), *y = y_.data(),
+    *z = z_.data();
+  const float64 norm_b = std::sqrt(dot(b, b));
+  num_iterations_ = 0;
+  if (norm_b == 0) {
+    x_.setZero();
+    relative_residual_ = 0;
+    converged_ = true;
+    return;
+  }
+
+  spmv(x, v);
+  for_each_block(n_, [&](int, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      r[i] = b[i] - v[i];
+    }
+  });
+  float64 rho = 1, alpha = 1, omega = 1, r_hat_norm2 = 0;
+  auto restart = [&]() {
+    for_each_block(n_, [&](int, int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        r_hat[i] = r[i];
+        p[i] = 0;
+        v[i] = 0;
+      }
+    });
+    rho = alpha = omega = 1;
+    r_hat_norm2 = dot(r_hat, r_hat);
+  };
+  restart();
+  float64 residual = std::sqrt(r_hat_norm2) / norm_b;
+  const float64 eps = std::numeric_limits<T>::epsilon();
+
+  while (num_iterations_ < max_iterations_ && residual > tolerance_) {
+    float64 rho_new = dot(r_hat, r);
+    if (std::abs(rho_new) <= eps * eps * r_hat_norm2) {
+      restart();
+      rho_new = r_hat_norm2;
+    }
+    const T beta = (rho_new / rho) * (alpha / omega);
+    for_each_block(n_, [&](int, int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        p[i] = r[i] + beta * (p[i] - (T)omega * v[i]);
+      }
+    });
+    precondition(p, y);
+    spmv(y, v);
+    const float64 r_hat_v = dot(r_hat, v);
+    if (r_hat_v == 0) {
+      break;
+    }
+    alpha = rho_new / r_hat_v;
+    for_each_block(n_, [&](int, int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        s[i] = r[i] - (T)alpha * v[i];
+      }
+    });
+    precondition(s, z);
+    spmv(z, t);
+    const float64 tt = dot(t, t);
+    omega = tt > 0 ? dot(t, s) / tt : 0;
+    for_each_block(n_, [&](int, int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        x[i] += (T)alpha * y[i] + (T)omega * z[i];
+        r[i] = s[i] - (T)omega * t[i];
+      }
+    });
+    rho = rho_new;
+    residual = std::sqrt(dot(r, r)) / norm_b;
+    num_iterations_++;
+    if (omega == 0) {
+      break;
+    }
+  }
+  relative_residual_ = residual;
+  converged_ = residual <= tolerance_;
+}
+
+template <typename T>
+bool IterativeSparseSolver<T>::info() {
+  return factorize_success_ && converged_;
+}
+
+template class IterativeSparseSolver<float32>;
+template class IterativeSparseSolver<float64>;
+
+template <typename T>
+std::unique_ptr<SparseSolver<T>> get_sparse_solver(
+    const std::string &solver_type,
+    ThreadPool *thread_pool) {
+  using EigenMatrix = typename SparseMatrix<T>::EigenMatrix;
   if (solver_type == "LU") {
-    using LU = Eigen::SparseLU<Eigen::SparseMatrix<float32>>;
-    return std::make_unique<EigenSparseSolver<LU>>();
+    using LU = Eigen::SparseLU<EigenMatrix>;
+    return std::make_unique<EigenSparseSolver<LU, T>>();
   } else if (solver_type == "LDLT") {
-    using LDLT = Eigen::SimplicialLDLT<Eigen::SparseMatrix<float32>>;
-    return std::make_unique<EigenSparseSolver<LDLT>>();
+    using LDLT = Eigen::SimplicialLDLT<EigenMatrix>;
+    return std::make_unique<EigenSparseSolver<LDLT, T>>();
   } else if (solver_type == "LLT") {
-    using LLT = Eigen::SimplicialLLT<Eigen::SparseMatrix<float32>>;
-    return std::make_unique<EigenSparseSolver<LLT>>();
+    using LLT = Eigen::SimplicialLLT<EigenMatrix>;
+    return std::make_unique<EigenSparseSolver<LLT, T>>();
+  } else if (solver_type == "CG") {
+    return std::make_unique<IterativeSparseSolver<T>>(
+        IterativeSparseSolver<T>::Method::cg, thread_pool);
+  } else if (solver_type == "BICGSTAB") {
+    return std::make_unique<IterativeSparseSolver<T>>(
+        IterativeSparseSolver<T>::Method::bicgstab, thread_pool);
   } else
     TI_ERROR("Not supported sparse solver type: {}", solver_type);
 }
 
+template std::unique_ptr<SparseSolver<float32>> get_sparse_solver<float32>(
+    const std::string &solver_type,
+    ThreadPool *thread_pool);
+template std::unique_ptr<SparseSolver<float64>> get_sparse_solver<float64>(
+    const std::string &solver_type,
+    ThreadPool *thread_pool);
+
 }  // namespace lang
 }  // namespace taichi
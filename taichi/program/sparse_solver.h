@@ -5,32 +5,162 @@
 namespace taichi {
 namespace lang {
 
+template <typename T>
 class SparseSolver {
  public:
+  using EigenVector = typename SparseMatrix<T>::EigenVector;
+
   virtual ~SparseSolver(){};
-  virtual bool compute(const SparseMatrix &sm) = 0;
-  virtual void analyze_pattern(const SparseMatrix &sm) = 0;
-  virtual void factorize(const SparseMatrix &sm) = 0;
-  virtual Eigen::VectorXf solve(const Eigen::Ref<const Eigen::VectorXf> &b) = 0;
+  virtual bool compute(const SparseMatrix<T> &sm) = 0;
+  virtual void analyze_pattern(const SparseMatrix<T> &sm) = 0;
+  virtual void factorize(const SparseMatrix<T> &sm) = 0;
+  virtual EigenVector solve(const Eigen::Ref<const EigenVector> &b) = 0;
   virtual bool info() = 0;
+
+  // Number of times the symbolic analysis actually ran. It is skipped for
+  // matrices with the pattern analyzed last, see pattern_fingerprint().
+  int get_num_pattern_analyses() const {
+    return num_pattern_analyses_;
+  }
+
+ protected:
+  // Returns whether the pattern of |sm| differs from the one analyzed last,
+  // in which case |sm| becomes the one analyzed last.
+  bool update_pattern(const SparseMatrix<T> &sm) {
+    const auto fingerprint = sm.pattern_fingerprint();
+    if (num_pattern_analyses_ > 0 && fingerprint == pattern_fingerprint_) {
+      return false;
+    }
+    pattern_fingerprint_ = fingerprint;
+    num_pattern_analyses_++;
+    return true;
+  }
+
+ private:
+  uint64 pattern_fingerprint_{0};
+  int num_pattern_analyses_{0};
 };
 
-template <class EigenSolver>
-class EigenSparseSolver : public SparseSolver {
+template <class EigenSolver, typename T>
+class EigenSparseSolver : public SparseSolver<T> {
  private:
   EigenSolver solver_;
 
  public:
+  using EigenVector = typename SparseSolver<T>::EigenVector;
+
   virtual ~EigenSparseSolver(){};
-  virtual bool compute(const SparseMatrix &sm) override;
-  virtual void analyze_pattern(const SparseMatrix &sm) override;
-  virtual void factorize(const SparseMatrix &sm) override;
-  virtual Eigen::VectorXf solve(
-      const Eigen::Ref<const Eigen::VectorXf> &b) override;
+  virtual bool compute(const SparseMatrix<T> &sm) override;
+  // Skipped if |sm| has the pattern analyzed last.
+  virtual void analyze_pattern(const SparseMatrix<T> &sm) override;
+  // Analyzes the pattern of |sm| first if it has changed.
+  virtual void factorize(const SparseMatrix<T> &sm) override;
+  virtual EigenVector solve(const Eigen::Ref<const EigenVector> &b) override;
   virtual bool info() override;
 };
 
-std::unique_ptr<SparseSolver> get_sparse_solver(const std::string &solver_type);
+/**
+ * Conjugate gradient (CG, for symmetric positive definite matrices) and
+ * BiCGSTAB solvers with an optional preconditioner.
+ *
+ * analyze_pattern() keeps a row-major copy of the sparsity pattern and
+ * allocates all the vectors used by the iterations, so that a sequence of
+ * factorize() / solve() calls on matrices of the same pattern does not
+ * allocate. Matrix-vector products, dot products and vector updates run on
+ * |thread_pool| if there is one. Dot products are summed in a fixed order, so
+ * the results do not depend on the scheduling.
+ */
+template <typename T>
+class IterativeSparseSolver : public SparseSolver<T> {
+ public:
+  using EigenVector = typename SparseSolver<T>::EigenVector;
+
+  enum class Method { cg, bicgstab };
+  // ic0 is the incomplete Cholesky factorization without fill-in, which is
+  // only available to CG.
+  enum class Preconditioner { none, jacobi, ic0 };
+
+  IterativeSparseSolver(Method method, ThreadPool *thread_pool = nullptr);
+
+  bool compute(const SparseMatrix<T> &sm) override;
+  // Skipped if |sm| has the pattern analyzed last.
+  void analyze_pattern(const SparseMatrix<T> &sm) override;
+  // Copies the values of |sm| and computes the preconditioner. Analyzes the
+  // pattern of |sm| first if it has changed.
+  void factorize(const SparseMatrix<T> &sm) override;
+  EigenVector solve(const Eigen::Ref<const EigenVector> &b) override;
+  // Whether the last factorize() succeeded and the last solve() converged.
+  bool info() override;
+
+  // One of "none", "jacobi" and "ic0". Takes effect at the next factorize().
+  void set_preconditioner(const std::string &preconditioner);
+  void set_max_iterations(int max_iterations);
+  // Iterations stop when |b - Ax| <= tolerance * |b|.
+  void set_tolerance(T tolerance);
+  // Starts each solve() from the solution of the previous one, which pays
+  // off when the right-hand side changes little between solves.
+  void set_warm_start(bool warm_start);
+
+  int get_num_iterations() const {
+    return num_iterations_;
+  }
+
+  // |b - Ax| / |b| after the last solve().
+  T get_relative_residual() const {
+    return relative_residual_;
+  }
+
+ private:
+  // Runs |func|(block, begin, end) on the fixed-size blocks of [0, n).
+  template <typename Func>
+  void for_each_block(int n, const Func &func);
+  float64 dot(const T *a, const T *b);
+  // y = Ax
+  void spmv(const T *x, T *y);
+  // z = M^-1 r
+  void precondition(const T *r, T *z);
+  void factorize_ic0();
+
+  // Iterate from x_ until convergence.
+  void solve_cg(const T *b);
+  void solve_bicgstab(const T *b);
+
+  Method method_;
+  Preconditioner preconditioner_{Preconditioner::none};
+  ThreadPool *thread_pool_{nullptr};
+  int max_iterations_{1000};
+  T tolerance_;
+  bool warm_start_{false};
+  bool factorized_{false};
+  bool has_solution_{false};
+  bool factorize_success_{true};
+  bool converged_{true};
+  int num_iterations_{0};
+  T relative_residual_{0};
+
+  // The matrix in compressed row storage. |csc_to_csr_| maps each entry of the
+  // compressed column storage of Eigen to its position here.
+  int n_{0};
+  int nnz_{0};
+  std::vector<int> row_begin_;
+  std::vector<int> col_index_;
+  std::vector<int> diag_index_;
+  std::vector<int> csc_to_csr_;
+  std::vector<T> values_;
+
+  // Inverse diagonal for jacobi, or the values of the incomplete factor L for
+  // ic0, which shares the row-major pattern of the lower triangle.
+  std::vector<T> inv_diag_;
+  std::vector<T> factor_;
+
+  EigenVector x_, r_, r_hat_, p_, v_, s_, t_, y_, z_;
+  std::vector<float64> partial_sums_;
+};
+
+template <typename T>
+std::unique_ptr<SparseSolver<T>> get_sparse_solver(
+    const std::string &solver_type,
+    ThreadPool *thread_pool = nullptr);
 
 }  // namespace lang
 }  // namespace taichi
@@ -904,6 +904,62 @@ std::vector<TaskLaunchRecord> StateFlowGraph::extract_to_execute() {
   return tasks;
 }
 
+std::vector<TaskLaunchRecord> StateFlowGraph::extract_to_execute(
+    std::vector<std::vector<int>> &dependencies) {
+  TI_AUTO_PROF;
+  auto nodes = get_pending_tasks();
+  // The indices of the extracted tasks that each pending node depends on,
+  // including the ones through the nodes without a task.
+  std::vector<std::vector<int>> node_deps(nodes.size());
+  std::unordered_map<Node *, int> node_indices;
+  // The global temporaries of all kernels share the same buffer, so the tasks
+  // using them are serialized.
+  int last_global_tmp_task = -1;
+  dependencies.clear();
+  for (int i = 0; i < (int)nodes.size(); i++) {
+    auto *node = nodes[i];
+    node_indices[node] = i;
+    auto &deps = node_deps[i];
+    for (const auto &edge : node->input_edges.get_all_edges()) {
+      auto *from = edge.second;
+      if (!from->pending()) {
+        // Executed in an earlier batch.
+        continue;
+      }
+      auto from_index = node_indices.find(from);
+      TI_ASSERT(from_index != node_indices.end());
+      const auto &from_deps = node_deps[from_index->second];
+      deps.insert(deps.end(), from_deps.begin(), from_deps.end());
+    }
+    if (node->rec.empty()) {
+      continue;
+    }
+    auto uses_global_tmp = [](const std::unordered_set<AsyncState> &states) {
+      for (const auto &state : states) {
+        if (!state.holds_snode()) {
+          return true;
+        }
+      }
+      return false;
+    };
+    if (uses_global_tmp(node->meta->input_states) ||
+        uses_global_tmp(node->meta->output_states)) {
+      if (last_global_tmp_task != -1) {
+        deps.push_back(last_global_tmp_task);
+      }
+      last_global_tmp_task = dependencies.size();
+    }
+    std::sort(deps.begin(), deps.end());
+    deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+    dependencies.push_back(deps);
+    // The nodes depending on this one only need to wait for this task.
+    deps = {(int)dependencies.size() - 1};
+  }
+  auto tasks = extract_to_execute();
+  TI_ASSERT(tasks.size() == dependencies.size());
+  return tasks;
+}
+
 void StateFlowGraph::print() {
   fmt::print("=== State Flow Graph ===\n");
   fmt::print("{} nodes ({} pending)\n", size(), num_pending_tasks());
@@ -300,6 +300,12 @@ class StateFlowGraph {
   // Extract all tasks to execute.
   std::vector<TaskLaunchRecord> extract_to_execute();
 
+  // Same as above, and also fills |dependencies| with the indices of the
+  // earlier extracted tasks that each extracted task has to wait for. Tasks
+  // without a path between them in the graph can run concurrently.
+  std::vector<TaskLaunchRecord> extract_to_execute(
+      std::vector<std::vector<int>> &dependencies);
+
   std::size_t size() const {
     return nodes_.size();
   }
@@ -15,6 +15,8 @@
 #include "taichi/ir/statements.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/async_engine.h"
+#include "taichi/program/compile_profiler.h"
+#include "taichi/program/launch_graph.h"
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/program/snode_rw_accessors_bank.h"
 #include "taichi/common/interface.h"
@@ -63,6 +65,48 @@ SNodeRwAccessorsBank::Accessors get_snode_rw_accessors(SNode *snode) {
   return get_current_program().get_snode_rw_accessors_bank().get(snode);
 }
 
+template <typename T>
+void export_sparse_matrix(py::module &m,
+                          const char *matrix_name,
+                          const char *solver_name,
+                          const char *iterative_solver_name) {
+  using Matrix = SparseMatrix<T>;
+  py::class_<Matrix>(m, matrix_name)
+      .def("to_string", &Matrix::to_string)
+      .def(py::self + py::self, py::return_value_policy::reference_internal)
+      .def(py::self - py::self, py::return_value_policy::reference_internal)
+      .def(T() * py::self, py::return_value_policy::reference_internal)
+      .def(py::self * T(), py::return_value_policy::reference_internal)
+      .def(py::self * py::self, py::return_value_policy::reference_internal)
+      .def("matmul", &Matrix::matmul,
+           py::return_value_policy::reference_internal)
+      .def("mat_vec_mul", &Matrix::mat_vec_mul)
+      .def("transpose", &Matrix::transpose,
+           py::return_value_policy::reference_internal)
+      .def("get_element", &Matrix::get_element)
+      .def("num_rows", &Matrix::num_rows)
+      .def("num_cols", &Matrix::num_cols)
+      .def("pattern_fingerprint", &Matrix::pattern_fingerprint);
+
+  using Solver = SparseSolver<T>;
+  py::class_<Solver>(m, solver_name)
+      .def("compute", &Solver::compute)
+      .def("analyze_pattern", &Solver::analyze_pattern)
+      .def("factorize", &Solver::factorize)
+      .def("solve", &Solver::solve)
+      .def("info", &Solver::info)
+      .def("get_num_pattern_analyses", &Solver::get_num_pattern_analyses);
+
+  using IterativeSolver = IterativeSparseSolver<T>;
+  py::class_<IterativeSolver, Solver>(m, iterative_solver_name)
+      .def("set_preconditioner", &IterativeSolver::set_preconditioner)
+      .def("set_max_iterations", &IterativeSolver::set_max_iterations)
+      .def("set_tolerance", &IterativeSolver::set_tolerance)
+      .def("set_warm_start", &IterativeSolver::set_warm_start)
+      .def("get_num_iterations", &IterativeSolver::get_num_iterations)
+      .def("get_relative_residual", &IterativeSolver::get_relative_residual);
+}
+
 TLANG_NAMESPACE_END
 
 TI_NAMESPACE_BEGIN
@@ -137,6 +181,11 @@ void export_lang(py::module &m) {
       .def_readwrite("print_kernel_llvm_ir_optimized",
                      &CompileConfig::print_kernel_llvm_ir_optimized)
       .def_readwrite("print_kernel_nvptx", &CompileConfig::print_kernel_nvptx)
+      .def_readwrite("offline_cache", &CompileConfig::offline_cache)
+      .def_readwrite("offline_cache_file_path",
+                     &CompileConfig::offline_cache_file_path)
+      .def_readwrite("offline_cache_max_size_GB",
+                     &CompileConfig::offline_cache_max_size_GB)
       .def_readwrite("simplify_before_lower_access",
                      &CompileConfig::simplify_before_lower_access)
       .def_readwrite("simplify_after_lower_access",
@@ -152,6 +201,16 @@ void export_lang(py::module &m) {
       .def_readwrite("saturating_grid_dim", &CompileConfig::saturating_grid_dim)
       .def_readwrite("max_block_dim", &CompileConfig::max_block_dim)
       .def_readwrite("cpu_max_num_threads", &CompileConfig::cpu_max_num_threads)
+      .def_readwrite("cpu_block_range_for",
+                     &CompileConfig::cpu_block_range_for)
+      .def_readwrite("cpu_privatize_atomics",
+                     &CompileConfig::cpu_privatize_atomics)
+      .def_readwrite("cpu_privatize_atomics_max_bytes",
+                     &CompileConfig::cpu_privatize_atomics_max_bytes)
+      .def_readwrite("cpu_software_f16_conversion",
+                     &CompileConfig::cpu_software_f16_conversion)
+      .def_readwrite("num_compile_threads",
+                     &CompileConfig::num_compile_threads)
       .def_readwrite("random_seed", &CompileConfig::random_seed)
       .def_readwrite("verbose_kernel_launches",
                      &CompileConfig::verbose_kernel_launches)
@@ -161,6 +220,7 @@ void export_lang(py::module &m) {
       .def_readwrite("use_unified_memory", &CompileConfig::use_unified_memory)
       .def_readwrite("kernel_profiler", &CompileConfig::kernel_profiler)
       .def_readwrite("timeline", &CompileConfig::timeline)
+      .def_readwrite("compile_profiler", &CompileConfig::compile_profiler)
       .def_readwrite("default_fp", &CompileConfig::default_fp)
       .def_readwrite("default_ip", &CompileConfig::default_ip)
       .def_readwrite("device_memory_GB", &CompileConfig::device_memory_GB)
@@ -193,6 +253,8 @@ void export_lang(py::module &m) {
       .def_readwrite("async_flush_every", &CompileConfig::async_flush_every)
       .def_readwrite("async_max_fuse_per_task",
                      &CompileConfig::async_max_fuse_per_task)
+      .def_readwrite("async_max_concurrent_tasks",
+                     &CompileConfig::async_max_concurrent_tasks)
       .def_readwrite("quant_opt_store_fusion",
                      &CompileConfig::quant_opt_store_fusion)
       .def_readwrite("quant_opt_atomic_demotion",
@@ -229,6 +291,12 @@ void export_lang(py::module &m) {
            [](Program *, const std::string &fn) {
              Timelines::get_instance().save(fn);
            })
+      .def("compile_profile_clear",
+           [](Program *) { CompileProfiler::get_instance().clear(); })
+      .def("compile_profile_save",
+           [](Program *, const std::string &fn) {
+             CompileProfiler::get_instance().save(fn);
+           })
       .def("print_memory_profiler_info", &Program::print_memory_profiler_info)
       .def("finalize", &Program::finalize)
       .def("get_total_compilation_time", &Program::get_total_compilation_time)
@@ -239,6 +307,33 @@ void export_lang(py::module &m) {
            [](Program *program) {
              program->async_engine->sfg->benchmark_rebuild_graph();
            })
+      .def("get_jit_module_stats",
+           [](Program *program) {
+             TI_ASSERT(arch_uses_llvm(program->config.arch));
+             const auto stats =
+                 program->get_llvm_program_impl()->get_jit_module_stats();
+             return std::make_pair(stats.num_modules, stats.num_bytes);
+           })
+      .def("get_offline_cache_stats",
+           [](Program *program) {
+             TI_ASSERT(arch_uses_llvm(program->config.arch));
+             const auto *cache =
+                 program->get_llvm_program_impl()->get_offline_cache();
+             if (cache == nullptr) {
+               return std::make_pair(std::size_t(0), std::size_t(0));
+             }
+             return std::make_pair(cache->get_num_hits(),
+                                   cache->get_num_misses());
+           })
+      .def("benchmark_ir_hash",
+           [](Program *program) {
+             program->async_engine->benchmark_ir_hash();
+           })
+      .def("compile_kernels",
+           [](Program *program, const std::vector<Kernel *> &kernels) {
+             py::gil_scoped_release release;
+             program->compile_kernels(kernels);
+           })
       .def("synchronize", &Program::synchronize)
       .def("async_flush", &Program::async_flush)
       .def("materialize_runtime", &Program::materialize_runtime)
@@ -278,7 +373,8 @@ void export_lang(py::module &m) {
           py::return_value_policy::reference)
       .def("hash",
            (SNode & (SNode::*)(const std::vector<Axis> &,
-                               const std::vector<int> &, bool))(&SNode::hash),
+                               const std::vector<int> &, int,
+                               bool))(&SNode::hash),
            py::return_value_policy::reference)
       .def("dynamic", &SNode::dynamic, py::return_value_policy::reference)
       .def("bitmasked",
@@ -371,6 +467,19 @@ void export_lang(py::module &m) {
       .def("set_extra_arg_int",
            &Kernel::LaunchContextBuilder::set_extra_arg_int);
 
+  py::class_<LaunchGraph>(m, "LaunchGraph")
+      .def(py::init<Program *>(), py::keep_alive<1, 2>())
+      .def("begin_capture", &LaunchGraph::begin_capture)
+      .def("end_capture", &LaunchGraph::end_capture)
+      .def("is_capturing", &LaunchGraph::is_capturing)
+      .def("num_launches", &LaunchGraph::num_launches)
+      .def("set_arg_int", &LaunchGraph::set_arg_int)
+      .def("set_arg_float", &LaunchGraph::set_arg_float)
+      .def("run", [](LaunchGraph *graph) {
+        py::gil_scoped_release release;
+        graph->run();
+      });
+
   py::class_<Function>(m, "Function")
       .def("set_function_body",
            py::overload_cast<const std::function<void()> &>(
@@ -957,46 +1066,57 @@ void export_lang(py::module &m) {
 
   py::class_<SparseMatrixBuilder>(m, "SparseMatrixBuilder")
       .def("print_triplets", &SparseMatrixBuilder::print_triplets)
-      .def("build", &SparseMatrixBuilder::build)
-      .def("get_addr", [](SparseMatrixBuilder *mat) { return uint64(mat); });
+      .def("build",
+           [](SparseMatrixBuilder *builder) -> py::object {
+             if (builder->get_dtype()->is_primitive(PrimitiveTypeID::f64)) {
+               return py::cast(builder->build<float64>());
+             }
+             return py::cast(builder->build<float32>());
+           })
+      .def("refill", &SparseMatrixBuilder::refill<float32>)
+      .def("refill", &SparseMatrixBuilder::refill<float64>)
+      .def("reset", &SparseMatrixBuilder::reset)
+      .def("get_addr", [](SparseMatrixBuilder *mat) {
+        return uint64(mat->get_data_base_ptr());
+      });
 
   m.def("create_sparse_matrix_builder",
-        [](int n, int m, uint64 max_num_entries) {
-          TI_ERROR_IF(!arch_is_cpu(get_current_program().config.arch),
+        [](int n, int m, uint64 max_num_entries, DataType dtype) {
+          auto &program = get_current_program();
+          TI_ERROR_IF(!arch_is_cpu(program.config.arch),
                       "SparseMatrix only supports CPU for now.");
-          return SparseMatrixBuilder(n, m, max_num_entries);
+          return SparseMatrixBuilder(
+              n, m, max_num_entries, dtype,
+              program.get_llvm_program_impl()->get_thread_pool());
         });
 
-  py::class_<SparseMatrix>(m, "SparseMatrix")
-      .def("to_string", &SparseMatrix::to_string)
-      .def(py::self + py::self, py::return_value_policy::reference_internal)
-      .def(py::self - py::self, py::return_value_policy::reference_internal)
-      .def(float() * py::self, py::return_value_policy::reference_internal)
-      .def(py::self * float(), py::return_value_policy::reference_internal)
-      .def(py::self * py::self, py::return_value_policy::reference_internal)
-      .def("matmul", &SparseMatrix::matmul,
-           py::return_value_policy::reference_internal)
-      .def("mat_vec_mul", &SparseMatrix::mat_vec_mul)
-      .def("transpose", &SparseMatrix::transpose,
-           py::return_value_policy::reference_internal)
-      .def("get_element", &SparseMatrix::get_element)
-      .def("num_rows", &SparseMatrix::num_rows)
-      .def("num_cols", &SparseMatrix::num_cols);
+  export_sparse_matrix<float32>(m, "SparseMatrix", "SparseSolver",
+                                "IterativeSparseSolver");
+  export_sparse_matrix<float64>(m, "SparseMatrixF64", "SparseSolverF64",
+                                "IterativeSparseSolverF64");
 
-  m.def("create_sparse_matrix", [](int n, int m) {
+  m.def("create_sparse_matrix", [](int n, int m, DataType dtype) {
     TI_ERROR_IF(!arch_is_cpu(get_current_program().config.arch),
                 "SparseMatrix only supports CPU for now.");
-    return SparseMatrix(n, m);
+    if (dtype->is_primitive(PrimitiveTypeID::f64)) {
+      return py::cast(SparseMatrix<float64>(n, m));
+    }
+    TI_ERROR_IF(!dtype->is_primitive(PrimitiveTypeID::f32),
+                "SparseMatrix only supports f32 and f64, but got {}.",
+                dtype->to_string());
+    return py::cast(SparseMatrix<float32>(n, m));
   });
 
-  py::class_<SparseSolver>(m, "SparseSolver")
-      .def("compute", &SparseSolver::compute)
-      .def("analyze_pattern", &SparseSolver::analyze_pattern)
-      .def("factorize", &SparseSolver::factorize)
-      .def("solve", &SparseSolver::solve)
-      .def("info", &SparseSolver::info);
-
-  m.def("get_sparse_solver", &get_sparse_solver);
+  m.def("get_sparse_solver",
+        [](const std::string &solver_type, DataType dtype) -> py::object {
+          auto thread_pool =
+              get_current_program().get_llvm_program_impl()->get_thread_pool();
+          if (dtype->is_primitive(PrimitiveTypeID::f64)) {
+            return py::cast(
+                get_sparse_solver<float64>(solver_type, thread_pool));
+          }
+          return py::cast(get_sparse_solver<float32>(solver_type, thread_pool));
+        });
 }
 
 TI_NAMESPACE_END
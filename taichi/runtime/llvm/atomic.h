@@ -74,6 +74,25 @@ inline f64 max_f64(f64 a, f64 b) {
     return old_val;                                                           \
   }
 
+// f16 values are stored as u16 bits and computed in f32.
+#define DEFINE_ATOMIC_OP_F16(OP)                                              \
+  f32 atomic_##OP##_f16(volatile u16 *dest, f32 inc) {                        \
+    u16 old_val;                                                              \
+    u16 new_val;                                                              \
+    do {                                                                      \
+      old_val = *dest;                                                        \
+      new_val = f32_to_f16(OP##_f32(f16_to_f32(old_val), inc));               \
+    } while (                                                                 \
+        !__atomic_compare_exchange(dest, &old_val, &new_val, true,            \
+                                   std::memory_order::memory_order_seq_cst,   \
+                                   std::memory_order::memory_order_seq_cst)); \
+    return f16_to_f32(old_val);                                               \
+  }
+
+DEFINE_ATOMIC_OP_F16(add)
+DEFINE_ATOMIC_OP_F16(min)
+DEFINE_ATOMIC_OP_F16(max)
+
 DEFINE_ATOMIC_OP_COMP_EXCH(add, f32)
 DEFINE_ATOMIC_OP_COMP_EXCH(add, f64)
 DEFINE_ATOMIC_OP_COMP_EXCH(min, f32)
@@ -20,20 +20,37 @@ i32 refresh_counter(Context *context) {
   return 0;
 }
 
+// See SparseMatrixTriplets. Values are passed as float64 so that the same
+// kernel works with builders of both precisions.
 i32 insert_triplet(Context *context,
                    int64 base_ptr_,
                    int i,
                    int j,
-                   float value) {
-  auto base_ptr = (int64 *)base_ptr_;
-
-  int64 *num_triplets = base_ptr;
-  auto data_base_ptr = *(int32 **)(base_ptr + 1);
-
-  auto triplet_id = atomic_add_i64(num_triplets, 1);
-  data_base_ptr[triplet_id * 3] = i;
-  data_base_ptr[triplet_id * 3 + 1] = j;
-  data_base_ptr[triplet_id * 3 + 2] = taichi_union_cast<int32>(value);
+                   float64 value,
+                   int thread_id) {
+  auto triplets = (SparseMatrixTriplets *)base_ptr_;
+  // Only this thread accesses its own chunk.
+  auto &chunk =
+      triplets->thread_chunks[thread_id *
+                              taichi_sparse_matrix_thread_chunk_stride];
+  if (chunk < 0 ||
+      triplets->chunk_sizes[chunk] == taichi_sparse_matrix_chunk_size) {
+    chunk = atomic_add_i64(&triplets->num_chunks, 1);
+    if (chunk >= triplets->max_num_chunks) {
+      chunk = -1;
+      atomic_add_i64(&triplets->num_dropped, 1);
+      return 0;
+    }
+  }
+  auto k = chunk * taichi_sparse_matrix_chunk_size +
+           triplets->chunk_sizes[chunk]++;
+  triplets->rows[k] = i;
+  triplets->cols[k] = j;
+  if (triplets->is_f64) {
+    ((float64 *)triplets->values)[k] = value;
+  } else {
+    ((float32 *)triplets->values)[k] = (float32)value;
+  }
   return 0;
 }
 
@@ -142,6 +159,44 @@ i32 test_node_allocator_gc_cpu(Context *context) {
   return 0;
 }
 
+i32 test_node_allocator_thread_cache(Context *context) {
+  auto runtime = context->runtime;
+  auto nodes = context->runtime->create<NodeManager>(runtime, sizeof(i64), 4);
+  constexpr int kN = 100;
+  Ptr ptrs[kN];
+  for (int i = 0; i < kN; i++) {
+    ptrs[i] = nodes->allocate(/*thread_id=*/0);
+    *(i64 *)ptrs[i] = i + 1;
+  }
+  // Elements are handed out in batches, and every index is unique.
+  for (int i = 0; i < kN; i++) {
+    auto idx = nodes->locate(ptrs[i]);
+    TI_TEST_CHECK(nodes->data_list->get_element_ptr(idx) == ptrs[i], runtime);
+    for (int j = 0; j < i; j++) {
+      TI_TEST_CHECK(ptrs[i] != ptrs[j], runtime);
+    }
+  }
+  for (int i = 0; i < kN; i++) {
+    nodes->recycle(/*thread_id=*/0, ptrs[i]);
+  }
+  // GC must also collect the elements still held by the thread caches.
+  nodes->gc_serial();
+  TI_TEST_CHECK(nodes->recycled_list->size() == 0, runtime);
+  auto num_elements = nodes->data_list->size();
+  for (int i = 0; i < kN; i++) {
+    ptrs[i] = nodes->allocate(/*thread_id=*/0);
+    TI_TEST_CHECK(*(i64 *)ptrs[i] == 0, runtime);
+  }
+  // All elements are reused.
+  TI_TEST_CHECK(nodes->data_list->size() == num_elements, runtime);
+  auto num_allocations = nodes->reduce_thread_caches(
+      [](NodeManager::ThreadCache &cache) -> i64 {
+        return cache.num_allocations;
+      });
+  TI_TEST_CHECK(num_allocations == 2 * kN, runtime);
+  return 0;
+}
+
 i32 test_active_mask(Context *context) {
   auto rt = context->runtime;
   taichi_printf(rt, "%d activemask %x\n", thread_idx(), cuda_active_mask());
@@ -28,7 +28,7 @@ void Dynamic_activate(Ptr meta_, Ptr node_, int i) {
         if (*p_chunk_ptr == nullptr) {
           auto rt = meta->context->runtime;
           auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
+          *p_chunk_ptr = alloc->allocate(meta->thread_id);
         }
       });
     }
@@ -50,7 +50,7 @@ void Dynamic_deactivate(Ptr meta_, Ptr node_) {
       auto rt = meta->context->runtime;
       auto alloc = rt->node_allocators[meta->snode_id];
       while (*p_chunk_ptr) {
-        alloc->recycle(*p_chunk_ptr);
+        alloc->recycle(meta->thread_id, *p_chunk_ptr);
         p_chunk_ptr = (Ptr *)*p_chunk_ptr;
       }
       node->ptr = nullptr;
@@ -71,7 +71,7 @@ i32 Dynamic_append(Ptr meta_, Ptr node_, i32 data) {
         if (*p_chunk_ptr == nullptr) {
           auto rt = meta->context->runtime;
           auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
+          *p_chunk_ptr = alloc->allocate(meta->thread_id);
         }
       });
     }
@@ -0,0 +1,222 @@
+#pragma once
+
+// A hash node is an open-addressing hash table with linear probing. The node
+// holds |num_slots| i32 keys followed by |num_slots| pointers to the children.
+// The key of a child is its index plus one, so that a zero-filled node is an
+// empty table.
+//
+// Lookups take no lock. Activations of new children and deactivations take
+// one of LLVMRuntime::hash_locks, picked by the address of the node, so that
+// a child is never inserted twice. Deactivating a child replaces its key by a
+// tombstone, which probes skip and insertions reuse, so the capacity bounds
+// the number of children active at the same time.
+//
+// Listgen iterates over the slots instead of the indices, therefore the
+// StructMeta functions of a hash node are the Hash_*_slot ones. See
+// CodeGenLLVM::emit_struct_meta_base.
+
+// Specialized Attributes and functions
+struct HashMeta : public StructMeta {
+  i32 num_slots;
+};
+
+STRUCT_FIELD(HashMeta, num_slots);
+
+i32 Hash_get_num_elements(Ptr meta, Ptr node) {
+  return ((HashMeta *)meta)->num_slots;
+}
+
+i32 *Hash_get_keys(Ptr meta, Ptr node) {
+  return (i32 *)node;
+}
+
+Ptr *Hash_get_values(Ptr meta, Ptr node) {
+  auto num_slots = Hash_get_num_elements(meta, node);
+  return (Ptr *)(node + sizeof(i32) * num_slots);
+}
+
+u32 Hash_hash_key(u32 key) {
+  // The finalizer of MurmurHash3
+  key ^= key >> 16;
+  key *= 0x85ebca6bu;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35u;
+  key ^= key >> 16;
+  return key;
+}
+
+constexpr i32 Hash_tombstone = -1;
+
+Ptr Hash_get_lock(LLVMRuntime *runtime, Ptr node) {
+  auto h = Hash_hash_key((u32)((u64)node >> 6));
+  return (Ptr)&runtime->hash_locks[h % LLVMRuntime::num_hash_locks];
+}
+
+// Returns the slot of the child |i|, or -1 if it is not in the table.
+i32 Hash_find_slot(Ptr meta, Ptr node, int i) {
+  auto num_slots = Hash_get_num_elements(meta, node);
+  auto keys = Hash_get_keys(meta, node);
+  i32 key = i + 1;
+  u32 mask = (u32)num_slots - 1;
+  u32 slot = Hash_hash_key((u32)key) & mask;
+  for (int probe = 0; probe < num_slots; probe++) {
+    auto k = __atomic_load_n(&keys[slot],
+                             std::memory_order::memory_order_seq_cst);
+    if (k == key) {
+      return slot;
+    }
+    if (k == 0) {
+      // |key| would have been inserted here or before.
+      return -1;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
+
+// Returns the slot of the child |i|, inserting it into the first free slot on
+// its probe sequence if it is not in the table. Returns -1 if the table is
+// full. Must be called with the lock of the node held.
+i32 Hash_insert_slot(Ptr meta, Ptr node, int i) {
+  auto num_slots = Hash_get_num_elements(meta, node);
+  auto keys = Hash_get_keys(meta, node);
+  i32 key = i + 1;
+  u32 mask = (u32)num_slots - 1;
+  u32 slot = Hash_hash_key((u32)key) & mask;
+  i32 free_slot = -1;
+  for (int probe = 0; probe < num_slots; probe++) {
+    auto k = keys[slot];
+    if (k == key) {
+      return slot;
+    }
+    if (k == Hash_tombstone && free_slot == -1) {
+      free_slot = slot;
+    }
+    if (k == 0) {
+      if (free_slot == -1) {
+        free_slot = slot;
+      }
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  if (free_slot != -1) {
+    __atomic_store_n(&keys[free_slot], key,
+                     std::memory_order::memory_order_seq_cst);
+  }
+  return free_slot;
+}
+
+// Returns the slot of the activated child |i|, or -1 if the table is full.
+i32 Hash_activate_slot(Ptr meta_, Ptr node, int i) {
+  auto meta = (StructMeta *)meta_;
+  auto rt = meta->context->runtime;
+  auto values = Hash_get_values(meta_, node);
+  auto slot = Hash_find_slot(meta_, node, i);
+  if (slot != -1 && __atomic_load_n(&values[slot],
+                                    std::memory_order::memory_order_seq_cst)) {
+    return slot;
+  }
+  locked_task(Hash_get_lock(rt, node), [&] {
+    slot = Hash_insert_slot(meta_, node, i);
+    if (slot != -1 && values[slot] == nullptr) {
+      auto alloc = rt->node_allocators[meta->snode_id];
+      __atomic_store_n(&values[slot], alloc->allocate(meta->thread_id),
+                       std::memory_order::memory_order_seq_cst);
+    }
+  });
+  if (slot == -1) {
+    // Counted in all modes, see LlvmProgramImpl::check_hash_overflow. Only
+    // raised as an error in debug mode, see Program::check_runtime_error.
+    atomic_add_i64(&rt->num_hash_overflows, 1);
+    taichi_assert_runtime(rt, 0, "Hash SNode is full.");
+  }
+  return slot;
+}
+
+void Hash_activate(Ptr meta, Ptr node, int i) {
+  Hash_activate_slot(meta, node, i);
+}
+
+void Hash_deactivate(Ptr meta_, Ptr node, int i) {
+  auto meta = (StructMeta *)meta_;
+  auto rt = meta->context->runtime;
+  if (Hash_find_slot(meta_, node, i) == -1) {
+    return;
+  }
+  locked_task(Hash_get_lock(rt, node), [&] {
+    auto slot = Hash_find_slot(meta_, node, i);
+    if (slot == -1) {
+      return;
+    }
+    auto num_slots = Hash_get_num_elements(meta_, node);
+    auto keys = Hash_get_keys(meta_, node);
+    auto values = Hash_get_values(meta_, node);
+    auto old = values[slot];
+    __atomic_store_n(&values[slot], nullptr,
+                     std::memory_order::memory_order_seq_cst);
+    if (old != nullptr) {
+      rt->node_allocators[meta->snode_id]->recycle(meta->thread_id, old);
+    }
+    u32 mask = (u32)num_slots - 1;
+    if (keys[(slot + 1) & mask] == 0) {
+      // No probe sequence passes this slot, nor the tombstones right before
+      // it, so they can become empty again.
+      u32 s = slot;
+      do {
+        __atomic_store_n(&keys[s], 0, std::memory_order::memory_order_seq_cst);
+        s = (s - 1) & mask;
+      } while (keys[s] == Hash_tombstone && s != (u32)slot);
+    } else {
+      __atomic_store_n(&keys[slot], Hash_tombstone,
+                       std::memory_order::memory_order_seq_cst);
+    }
+  });
+}
+
+i32 Hash_is_slot_active(Ptr meta, Ptr node, int slot) {
+  return Hash_get_values(meta, node)[slot] != nullptr;
+}
+
+Ptr Hash_lookup_slot(Ptr meta, Ptr node, int slot) {
+  auto data_ptr = Hash_get_values(meta, node)[slot];
+  if (data_ptr == nullptr) {
+    auto smeta = (StructMeta *)meta;
+    auto context = smeta->context;
+    data_ptr = (context->runtime)->ambient_elements[smeta->snode_id];
+  }
+  return data_ptr;
+}
+
+// Returns the index of the child in |slot|. Only meaningful for active slots,
+// whose keys are never tombstones.
+i32 Hash_get_element_index(Ptr meta, Ptr node, int slot) {
+  return Hash_get_keys(meta, node)[slot] - 1;
+}
+
+i32 Hash_is_active(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  return slot != -1 && Hash_is_slot_active(meta, node, slot);
+}
+
+Ptr Hash_lookup_element(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i);
+  if (slot == -1) {
+    auto smeta = (StructMeta *)meta;
+    return (smeta->context->runtime)->ambient_elements[smeta->snode_id];
+  }
+  return Hash_lookup_slot(meta, node, slot);
+}
+
+// Activates the child |i| and returns it. If the table is full, returns the
+// overflow element of the SNode instead, so that the writes to the child are
+// dropped rather than changing the ambient element, which is what the
+// inactive cells read.
+Ptr Hash_activate_and_lookup_element(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_activate_slot(meta, node, i);
+  if (slot == -1) {
+    auto smeta = (StructMeta *)meta;
+    return (smeta->context->runtime)->hash_overflow_elements[smeta->snode_id];
+  }
+  return Hash_lookup_slot(meta, node, slot);
+}
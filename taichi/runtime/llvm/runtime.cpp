@@ -34,7 +34,18 @@ using host_vsnprintf_type = int (*)(char *,
                                     const char *,
                                     std::va_list);
 using vm_allocator_type = void *(*)(void *, std::size_t, std::size_t);
-using RangeForTaskFunc = void(Context *, const char *tls, int i);
+// Task functions called from parallel loops take the id of the thread
+// running them as the last argument, so that the shared Context can stay
+// read-only.
+using RangeForTaskFunc = void(Context *,
+                              const char *tls,
+                              int i,
+                              int thread_id);
+using RangeForBlockFunc = void(Context *,
+                               const char *tls,
+                               int block_begin,
+                               int block_end,
+                               int thread_id);
 using parallel_for_type = void (*)(void *thread_pool,
                                    int splits,
                                    int num_desired_threads,
@@ -320,14 +331,79 @@ STRUCT_FIELD_ARRAY(PhysicalCoordinates, val);
 
 #include "taichi/program/context.h"
 #include "taichi/runtime/llvm/mem_request.h"
+#include "taichi/runtime/llvm/sparse_matrix_triplets.h"
 
 STRUCT_FIELD_ARRAY(Context, args);
 STRUCT_FIELD(Context, runtime);
+STRUCT_FIELD(Context, cpu_thread_id_offset);
 
 int32 Context_get_extra_args(Context *ctx, int32 i, int32 j) {
   return ctx->extra_args[i][j];
 }
 
+// Conversions between f16 (as u16 bits) and f32, for targets without
+// conversion instructions, e.g. x64 CPUs without F16C.
+f32 f16_to_f32(u16 h) {
+  u32 sign = (u32)(h & 0x8000) << 16;
+  u32 exponent = (h >> 10) & 0x1f;
+  u32 mantissa = h & 0x3ff;
+  u32 bits;
+  if (exponent == 0x1f) {
+    // inf or nan
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign;
+  } else {
+    // Normalize the subnormal.
+    exponent = 113;
+    while ((mantissa & 0x400) == 0) {
+      mantissa <<= 1;
+      exponent--;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+  return taichi_union_cast<f32>(bits);
+}
+
+// Rounds to the nearest even.
+u16 f32_to_f16(f32 f) {
+  u32 bits = taichi_union_cast<u32>(f);
+  u32 sign = (bits >> 16) & 0x8000;
+  i32 exponent = (i32)((bits >> 23) & 0xff) - 127 + 15;
+  u32 mantissa = bits & 0x7fffff;
+  if (((bits >> 23) & 0xff) == 0xff) {
+    // inf or nan
+    return (u16)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+  }
+  if (exponent >= 0x1f) {
+    return (u16)(sign | 0x7c00);
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return (u16)sign;
+    }
+    // A subnormal f16.
+    mantissa |= 0x800000;
+    u32 shift = (u32)(14 - exponent);
+    u32 result = mantissa >> shift;
+    u32 remainder = mantissa & ((1u << shift) - 1);
+    u32 halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (result & 1))) {
+      result++;
+    }
+    return (u16)(sign | result);
+  }
+  // A carry out of the mantissa correctly bumps the exponent, up to inf.
+  u32 result = ((u32)exponent << 10) | (mantissa >> 13);
+  u32 remainder = mantissa & 0x1fff;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1))) {
+    result++;
+  }
+  return (u16)(sign | result);
+}
+
 #include "taichi/runtime/llvm/atomic.h"
 
 // These structures are accessible by both the LLVM backend and this C++ runtime
@@ -353,7 +429,15 @@ struct StructMeta {
                              PhysicalCoordinates *refined_coord,
                              int index);
 
+  // Maps the j-th element of a container to the index of that child, for
+  // SNodes (hash) whose elements are not stored in index order. Null if the
+  // two are the same.
+  i32 (*get_element_index)(Ptr, Ptr, int j);
+
   Context *context;
+
+  // The id of the CPU thread accessing the SNode. See linear_thread_idx.
+  i32 thread_id;
 };
 
 STRUCT_FIELD(StructMeta, snode_id)
@@ -364,7 +448,9 @@ STRUCT_FIELD(StructMeta, lookup_element);
 STRUCT_FIELD(StructMeta, from_parent_element);
 STRUCT_FIELD(StructMeta, refine_coordinates);
 STRUCT_FIELD(StructMeta, is_active);
+STRUCT_FIELD(StructMeta, get_element_index);
 STRUCT_FIELD(StructMeta, context);
+STRUCT_FIELD(StructMeta, thread_id);
 
 struct LLVMRuntime;
 
@@ -403,6 +489,11 @@ struct ListManager {
   i32 lock;
   i32 num_elements;
   LLVMRuntime *runtime;
+  // When non-zero, every chunk is placed at the end of a header storing its
+  // id, and the header is aligned to |chunk_alignment|. This makes
+  // ptr2index O(1) at the cost of (untouched) virtual address space.
+  std::size_t chunk_alignment{0};
+  static constexpr std::size_t chunk_header_size = 64;
 
   ListManager(LLVMRuntime *runtime,
               std::size_t element_size,
@@ -426,6 +517,25 @@ struct ListManager {
     return i;
   }
 
+  // Reserves |n| consecutive elements with a single atomic operation.
+  i32 reserve_new_elements(i32 n) {
+    auto i = atomic_add_i32(&num_elements, n);
+    for (int c = i >> log2chunk_num_elements;
+         c <= (i + n - 1) >> log2chunk_num_elements; c++) {
+      touch_chunk(c);
+    }
+    return i;
+  }
+
+  // Must be called before any chunk is allocated.
+  void use_aligned_chunks() {
+    auto size = chunk_header_size + max_num_elements_per_chunk * element_size;
+    chunk_alignment = taichi_page_size;
+    while (chunk_alignment < size) {
+      chunk_alignment *= 2;
+    }
+  }
+
   template <typename T>
   void push_back(const T &t) {
     this->append((void *)&t);
@@ -471,6 +581,12 @@ struct ListManager {
   }
 
   i32 ptr2index(Ptr ptr) {
+    if (chunk_alignment) {
+      auto header = (Ptr)((u64)ptr & ~(u64)(chunk_alignment - 1));
+      auto chunk_id = *(i32 *)header;
+      return (chunk_id << log2chunk_num_elements) +
+             i32((ptr - header - chunk_header_size) / element_size);
+    }
     auto chunk_size = max_num_elements_per_chunk * element_size;
     for (int i = 0; i < max_num_chunks; i++) {
       taichi_assert_runtime(runtime, chunks[i] != nullptr, "ptr not found.");
@@ -532,9 +648,24 @@ struct LLVMRuntime {
 
   Ptr thread_pool;
   parallel_for_type parallel_for;
+  // The number of CPU threads, including those of the thread pools of the
+  // async engine. Thread ids passed to the tasks are less than it.
+  i32 num_cpu_threads;
+  // The TLS buffers of the CPU threads and their sizes, indexed by thread id.
+  // See cpu_thread_local_storage.
+  Ptr *cpu_tls_buffers;
+  std::size_t *cpu_tls_buffer_sizes;
   ListManager *element_lists[taichi_max_num_snodes];
   NodeManager *node_allocators[taichi_max_num_snodes];
   Ptr ambient_elements[taichi_max_num_snodes];
+  // Where the cells that do not fit into a full hash SNode are written to.
+  Ptr hash_overflow_elements[taichi_max_num_snodes];
+  // The number of such writes since it was last retrieved by the host.
+  i64 num_hash_overflows;
+  // Lock the insertions into and the removals from hash nodes, see
+  // node_hash.h.
+  static constexpr int num_hash_locks = 1024;
+  i32 hash_locks[num_hash_locks];
   Ptr temporaries;
   RandState *rand_states;
   MemRequestQueue *mem_req_queue;
@@ -588,6 +719,12 @@ STRUCT_FIELD(LLVMRuntime, profiler_stop);
 
 // NodeManager of node S (hash, pointer) managers the memory allocation of S_ch
 // It makes use of three ListManagers.
+//
+// On CPUs, each thread additionally owns a small cache of free and recycled
+// element indices. Allocations and recycles only touch the cache of the
+// calling thread, which exchanges elements with the shared lists in batches
+// of |thread_cache_batch_size|, so that threads rarely contend on
+// |free_list_used| and |recycled_list|.
 struct NodeManager {
   LLVMRuntime *runtime;
   i32 lock;
@@ -601,6 +738,31 @@ struct NodeManager {
 
   using list_data_type = i32;
 
+  static constexpr int num_thread_caches = 64;
+  static constexpr int thread_cache_capacity = 32;
+  static constexpr int thread_cache_batch_size = thread_cache_capacity / 2;
+
+  struct alignas(64) ThreadCache {
+    i32 lock;
+    i32 num_free;
+    i32 num_recycled;
+    // Zero-filled elements, ready to be handed out.
+    list_data_type free[thread_cache_capacity];
+    // Elements to be zero-filled by the next GC.
+    list_data_type recycled[thread_cache_capacity];
+
+    // Statistics
+    i64 num_allocations;
+    i64 num_recycles;
+    // Number of batches exchanged with the shared lists.
+    i64 num_batches;
+    // Number of times the cache was locked by another thread.
+    i64 num_contentions;
+  };
+
+  // nullptr when thread caches are not used (e.g. on CUDA).
+  ThreadCache *thread_caches{nullptr};
+
   NodeManager(LLVMRuntime *runtime,
               i32 element_size,
               i32 chunk_num_elements = -1)
@@ -622,6 +784,13 @@ struct NodeManager {
         runtime, sizeof(list_data_type), chunk_num_elements);
     data_list =
         runtime->create<ListManager>(runtime, element_size, chunk_num_elements);
+#if !ARCH_cuda
+    // Over-aligning chunks costs only virtual address space on CPUs.
+    data_list->use_aligned_chunks();
+    thread_caches = (ThreadCache *)runtime->request_allocate_aligned(
+        sizeof(ThreadCache) * num_thread_caches, 64);
+    std::memset(thread_caches, 0, sizeof(ThreadCache) * num_thread_caches);
+#endif
   }
 
   Ptr allocate() {
@@ -637,6 +806,21 @@ struct NodeManager {
     return data_list->get_element_ptr(l);
   }
 
+  // Allocates from the cache of thread |thread_id|, if any.
+  Ptr allocate(i32 thread_id) {
+    if (!thread_caches) {
+      return allocate();
+    }
+    auto cache = acquire_thread_cache(thread_id);
+    if (cache->num_free == 0) {
+      refill(cache);
+    }
+    auto l = cache->free[--cache->num_free];
+    cache->num_allocations++;
+    release_thread_cache(cache);
+    return data_list->get_element_ptr(l);
+  }
+
   i32 locate(Ptr ptr) {
     return data_list->ptr2index(ptr);
   }
@@ -646,7 +830,87 @@ struct NodeManager {
     recycled_list->append(&index);
   }
 
+  void recycle(i32 thread_id, Ptr ptr) {
+    if (!thread_caches) {
+      recycle(ptr);
+      return;
+    }
+    auto index = locate(ptr);
+    auto cache = acquire_thread_cache(thread_id);
+    if (cache->num_recycled == thread_cache_capacity) {
+      flush_recycled(cache);
+    }
+    cache->recycled[cache->num_recycled++] = index;
+    cache->num_recycles++;
+    release_thread_cache(cache);
+  }
+
+  ThreadCache *acquire_thread_cache(i32 thread_id) {
+    // |thread_id| is not meaningful in serial tasks, so threads may share a
+    // cache and we still need the lock. It is uncontended in parallel tasks.
+    auto cache = &thread_caches[(u32)thread_id % num_thread_caches];
+    if (atomic_exchange_i32(&cache->lock, 1) == 1) {
+      cache->num_contentions++;
+      while (atomic_exchange_i32(&cache->lock, 1) == 1)
+        ;
+    }
+    return cache;
+  }
+
+  void release_thread_cache(ThreadCache *cache) {
+    atomic_exchange_i32(&cache->lock, 0);
+  }
+
+  // Takes a batch of elements from |free_list|, and reserves new elements
+  // when it runs out.
+  void refill(ThreadCache *cache) {
+    constexpr int n = thread_cache_batch_size;
+    auto begin = atomic_add_i32(&free_list_used, n);
+    auto num_reused = min_i32(max_i32(free_list->size() - begin, 0), n);
+    for (int i = 0; i < num_reused; i++) {
+      cache->free[cache->num_free++] =
+          free_list->get<list_data_type>(begin + i);
+    }
+    if (num_reused < n) {
+      auto l = data_list->reserve_new_elements(n - num_reused);
+      for (int i = 0; i < n - num_reused; i++) {
+        cache->free[cache->num_free++] = l + i;
+      }
+    }
+    cache->num_batches++;
+  }
+
+  void flush_recycled(ThreadCache *cache) {
+    if (cache->num_recycled == 0)
+      return;
+    auto begin = recycled_list->reserve_new_elements(cache->num_recycled);
+    for (int i = 0; i < cache->num_recycled; i++) {
+      recycled_list->get<list_data_type>(begin + i) = cache->recycled[i];
+    }
+    cache->num_recycled = 0;
+    cache->num_batches++;
+  }
+
+  template <typename F>
+  i64 reduce_thread_caches(const F &f) {
+    i64 sum = 0;
+    if (thread_caches) {
+      for (int i = 0; i < num_thread_caches; i++) {
+        sum += f(thread_caches[i]);
+      }
+    }
+    return sum;
+  }
+
   void gc_serial() {
+    // GC runs when no other task is running, so the thread caches can be
+    // accessed without locking.
+    if (thread_caches) {
+      for (int i = 0; i < num_thread_caches; i++) {
+        flush_recycled(&thread_caches[i]);
+      }
+    }
+
     // compact free list
     for (int i = free_list_used; i < free_list->size(); i++) {
       free_list->get<list_data_type>(i - free_list_used) =
@@ -690,6 +954,12 @@ void runtime_retrieve_and_reset_error_code(LLVMRuntime *runtime) {
   runtime->error_code = 0;
 }
 
+void runtime_retrieve_and_reset_hash_overflows(LLVMRuntime *runtime) {
+  runtime->set_result(taichi_result_buffer_runtime_query_id,
+                      (i64)atomic_exchange_u64(
+                          (u64 *)&runtime->num_hash_overflows, 0));
+}
+
 void runtime_retrieve_error_message(LLVMRuntime *runtime, int i) {
   runtime->set_result(taichi_result_buffer_error_id,
                       runtime->error_message_template[i]);
@@ -716,6 +986,25 @@ RUNTIME_STRUCT_FIELD(NodeManager, recycled_list);
 RUNTIME_STRUCT_FIELD(NodeManager, data_list);
 RUNTIME_STRUCT_FIELD(NodeManager, free_list_used);
 
+#define NODE_MANAGER_THREAD_CACHE_STAT(name)                              \
+  void runtime_NodeManager_get_##name(LLVMRuntime *runtime,               \
+                                      NodeManager *node_manager) {        \
+    runtime->set_result(taichi_result_buffer_runtime_query_id,            \
+                        node_manager->reduce_thread_caches(               \
+                            [](NodeManager::ThreadCache &cache) -> i64 {  \
+                              return cache.name;                          \
+                            }));                                          \
+  }
+
+NODE_MANAGER_THREAD_CACHE_STAT(num_allocations);
+NODE_MANAGER_THREAD_CACHE_STAT(num_recycles);
+NODE_MANAGER_THREAD_CACHE_STAT(num_batches);
+NODE_MANAGER_THREAD_CACHE_STAT(num_contentions);
+NODE_MANAGER_THREAD_CACHE_STAT(num_free);
+NODE_MANAGER_THREAD_CACHE_STAT(num_recycled);
+
+#undef NODE_MANAGER_THREAD_CACHE_STAT
+
 RUNTIME_STRUCT_FIELD(ListManager, num_elements);
 RUNTIME_STRUCT_FIELD(ListManager, max_num_elements_per_chunk);
 RUNTIME_STRUCT_FIELD(ListManager, element_size);
@@ -820,6 +1109,11 @@ Ptr LLVMRuntime::request_allocate_aligned(std::size_t size,
   atomic_add_i64(&total_requested_memory, size);
   if (preallocated)
     return allocate_from_buffer(size, alignment);
+#if !ARCH_cuda
+  // CPU kernels can call the host allocator directly, which avoids waiting for
+  // the memory pool daemon.
+  return (Ptr)vm_allocator(memory_pool, size, alignment);
+#else
   else {
     auto i = atomic_add_i32(&mem_req_queue->tail, 1);
     taichi_assert_runtime(this, i <= taichi_max_num_mem_requests,
@@ -830,12 +1124,11 @@ Ptr LLVMRuntime::request_allocate_aligned(std::size_t size,
 
     // wait for host to allocate
     while (r->ptr == nullptr) {
-#if defined(ARCH_cuda)
       system_memfence();
-#endif
     };
     return r->ptr;
   }
+#endif
 }
 
 void runtime_snode_tree_allocate_aligned(LLVMRuntime *runtime,
@@ -888,6 +1181,9 @@ void runtime_initialize(
   runtime->memory_pool = memory_pool;
 
   runtime->total_requested_memory = 0;
+  runtime->num_hash_overflows = 0;
+  for (int i = 0; i < LLVMRuntime::num_hash_locks; i++)
+    runtime->hash_locks[i] = 0;
 
   // runtime->allocate ready to use
   runtime->mem_req_queue = (MemRequestQueue *)runtime->allocate_aligned(
@@ -934,9 +1230,19 @@ void runtime_initialize_snodes(LLVMRuntime *runtime,
 
 void LLVMRuntime_initialize_thread_pool(LLVMRuntime *runtime,
                                         void *thread_pool,
-                                        void *parallel_for) {
+                                        void *parallel_for,
+                                        i32 num_threads) {
   runtime->thread_pool = (Ptr)thread_pool;
   runtime->parallel_for = (parallel_for_type)parallel_for;
+  runtime->num_cpu_threads = num_threads;
+  runtime->cpu_tls_buffers =
+      (Ptr *)runtime->allocate_aligned(sizeof(Ptr) * num_threads, 64);
+  runtime->cpu_tls_buffer_sizes = (std::size_t *)runtime->allocate_aligned(
+      sizeof(std::size_t) * num_threads, 64);
+  for (int i = 0; i < num_threads; i++) {
+    runtime->cpu_tls_buffers[i] = nullptr;
+    runtime->cpu_tls_buffer_sizes[i] = 0;
+  }
 }
 
 void runtime_NodeAllocator_initialize(LLVMRuntime *runtime,
@@ -955,6 +1261,13 @@ void runtime_allocate_ambient(LLVMRuntime *runtime,
       runtime->request_allocate_aligned(size, 128);
 }
 
+void runtime_allocate_hash_overflow_element(LLVMRuntime *runtime,
+                                            int snode_id,
+                                            std::size_t size) {
+  runtime->hash_overflow_elements[snode_id] =
+      runtime->request_allocate_aligned(size, 128);
+}
+
 void mutex_lock_i32(Ptr mutex) {
   while (atomic_exchange_i32((i32 *)mutex, 1) == 1)
     ;
@@ -1163,16 +1476,159 @@ void element_listgen_root(LLVMRuntime *runtime,
   }
 }
 
+#if !ARCH_cuda
+// Generates the child elements of parent elements [begin, end), in the same
+// order as the serial listgen. If |output| is non-negative, the elements are
+// stored to the child list starting at index |output|; otherwise they are
+// only counted. Returns the number of child elements.
+i32 cpu_element_listgen_nonroot_range(ListManager *parent_list,
+                                      ListManager *child_list,
+                                      StructMeta *parent,
+                                      StructMeta *child,
+                                      int begin,
+                                      int end,
+                                      i32 output) {
+  // Cache the func pointers here for better compiler optimization
+  auto parent_refine_coordinates = parent->refine_coordinates;
+  auto parent_is_active = parent->is_active;
+  auto parent_lookup_element = parent->lookup_element;
+  auto parent_get_element_index = parent->get_element_index;
+  auto child_get_num_elements = child->get_num_elements;
+  auto child_from_parent_element = child->from_parent_element;
+  i32 count = 0;
+  for (int i = begin; i < end; i++) {
+    auto &element = parent_list->get<Element>(i);
+    for (int j = element.loop_bounds[0]; j < element.loop_bounds[1]; j++) {
+      if (!parent_is_active((Ptr)parent, element.element, j)) {
+        continue;
+      }
+      auto ch_element = parent_lookup_element((Ptr)parent, element.element, j);
+      ch_element = child_from_parent_element((Ptr)ch_element);
+      auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+      auto ch_element_size =
+          std::min(ch_num_elements, taichi_listgen_max_element_size);
+      if (output < 0) {
+        for (int ch_lower = 0; ch_lower < ch_num_elements;
+             ch_lower += ch_element_size) {
+          count++;
+        }
+        continue;
+      }
+      auto index =
+          parent_get_element_index
+              ? parent_get_element_index((Ptr)parent, element.element, j)
+              : j;
+      PhysicalCoordinates refined_coord;
+      parent_refine_coordinates(&element.pcoord, &refined_coord, index);
+      for (int ch_lower = 0; ch_lower < ch_num_elements;
+           ch_lower += ch_element_size) {
+        auto &elem = child_list->get<Element>(output + count);
+        elem.element = ch_element;
+        elem.loop_bounds[0] = ch_lower;
+        elem.loop_bounds[1] =
+            std::min(ch_lower + ch_element_size, ch_num_elements);
+        elem.pcoord = refined_coord;
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+constexpr int cpu_listgen_max_num_partitions = 1024;
+
+struct cpu_listgen_helper_context {
+  ListManager *parent_list;
+  ListManager *child_list;
+  StructMeta *parent;
+  StructMeta *child;
+  int num_parent_elements;
+  int num_partitions;
+  // offsets[p] is the index in the child list of the first element generated
+  // by partition p. During the counting pass, offsets[p + 1] holds the number
+  // of elements generated by partition p.
+  i32 *offsets;
+  bool counting;
+};
+
+void cpu_listgen_helper(void *ctx_, int thread_id, int p) {
+  auto ctx = (cpu_listgen_helper_context *)ctx_;
+  int begin = (int)((i64)ctx->num_parent_elements * p / ctx->num_partitions);
+  int end =
+      (int)((i64)ctx->num_parent_elements * (p + 1) / ctx->num_partitions);
+  if (ctx->counting) {
+    ctx->offsets[p + 1] = cpu_element_listgen_nonroot_range(
+        ctx->parent_list, ctx->child_list, ctx->parent, ctx->child, begin, end,
+        /*output=*/-1);
+  } else {
+    cpu_element_listgen_nonroot_range(ctx->parent_list, ctx->child_list,
+                                      ctx->parent, ctx->child, begin, end,
+                                      ctx->offsets[p]);
+  }
+}
+
+// Partitions the parent list into contiguous ranges processed by the thread
+// pool. Every range is first scanned to count its child elements, and an
+// exclusive prefix sum of the counts then assigns each range a disjoint slice
+// of the child list to fill. Therefore the child list has the same order as
+// with serial listgen, and only a single atomic is needed to reserve it.
+void cpu_parallel_element_listgen_nonroot(LLVMRuntime *runtime,
+                                          StructMeta *parent,
+                                          StructMeta *child,
+                                          int num_threads) {
+  i32 offsets[cpu_listgen_max_num_partitions + 1];
+  cpu_listgen_helper_context ctx;
+  ctx.parent_list = runtime->element_lists[parent->snode_id];
+  ctx.child_list = runtime->element_lists[child->snode_id];
+  ctx.parent = parent;
+  ctx.child = child;
+  ctx.num_parent_elements = ctx.parent_list->size();
+  // A few partitions per thread for load balancing.
+  ctx.num_partitions =
+      std::min(std::min(ctx.num_parent_elements, num_threads * 8),
+               cpu_listgen_max_num_partitions);
+  ctx.offsets = offsets;
+
+  ctx.counting = true;
+  runtime->parallel_for(runtime->thread_pool, ctx.num_partitions, num_threads,
+                        &ctx, cpu_listgen_helper);
+
+  i32 total = 0;
+  for (int p = 0; p < ctx.num_partitions; p++) {
+    total += offsets[p + 1];
+  }
+  if (total == 0) {
+    return;
+  }
+  offsets[0] = ctx.child_list->reserve_new_elements(total);
+  for (int p = 0; p < ctx.num_partitions; p++) {
+    offsets[p + 1] += offsets[p];
+  }
+
+  ctx.counting = false;
+  runtime->parallel_for(runtime->thread_pool, ctx.num_partitions, num_threads,
+                        &ctx, cpu_listgen_helper);
+}
+#endif
+
 void element_listgen_nonroot(LLVMRuntime *runtime,
                              StructMeta *parent,
-                             StructMeta *child) {
+                             StructMeta *child,
+                             int num_threads) {
   auto parent_list = runtime->element_lists[parent->snode_id];
   int num_parent_elements = parent_list->size();
+#if !ARCH_cuda
+  if (num_threads > 1 && num_parent_elements > 1) {
+    cpu_parallel_element_listgen_nonroot(runtime, parent, child, num_threads);
+    return;
+  }
+#endif
   auto child_list = runtime->element_lists[child->snode_id];
   // Cache the func pointers here for better compiler optimization
   auto parent_refine_coordinates = parent->refine_coordinates;
   auto parent_is_active = parent->is_active;
   auto parent_lookup_element = parent->lookup_element;
+  auto parent_get_element_index = parent->get_element_index;
   auto child_get_num_elements = child->get_num_elements;
   auto child_from_parent_element = child->from_parent_element;
 #if ARCH_cuda
@@ -1193,9 +1649,13 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
     int j_lower = element.loop_bounds[0] + j_start;
     int j_higher = element.loop_bounds[1];
     for (int j = j_lower; j < j_higher; j += j_step) {
-      PhysicalCoordinates refined_coord;
-      parent_refine_coordinates(&element.pcoord, &refined_coord, j);
       if (parent_is_active((Ptr)parent, element.element, j)) {
+        auto index =
+            parent_get_element_index
+                ? parent_get_element_index((Ptr)parent, element.element, j)
+                : j;
+        PhysicalCoordinates refined_coord;
+        parent_refine_coordinates(&element.pcoord, &refined_coord, index);
         auto ch_element =
             parent_lookup_element((Ptr)parent, element.element, j);
         ch_element = child_from_parent_element((Ptr)ch_element);
@@ -1217,7 +1677,144 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
   }
 }
 
-using BlockTask = void(Context *, char *, Element *, int, int);
+using BlockTask = void(Context *, char *, Element *, int, int, int);
+
+using range_for_xlogue = void (*)(Context *,
+                                  /*TLS*/ char *tls_base,
+                                  int thread_id);
+
+// Combines the TLS buffer |src| into |dst|.
+using tls_combine_func = void (*)(Context *,
+                                  char *dst,
+                                  char *src,
+                                  int thread_id);
+
+// The TLS of a parallel task on CPUs, which lives with the threads instead of
+// the blocks: each thread initializes its own buffer with |prologue| before
+// running its first block, and the buffers are flushed by |epilogue| after
+// all blocks are done.
+//
+// If |combine| is not null, the buffers are first combined pairwise in
+// parallel, so that |epilogue| only runs once. This pays off when the TLS
+// holds per-thread copies of fields. See make_thread_local.
+//
+// The buffers can be as large as cpu_privatize_atomics_max_bytes, so they are
+// not put on the stack of the launching thread. Each thread keeps a buffer in
+// LLVMRuntime::cpu_tls_buffers instead, which is reallocated only when a task
+// needs a larger one. Tasks running concurrently use disjoint thread ids, see
+// ThreadPool, so they never share a buffer.
+struct cpu_thread_local_storage {
+  Context *context;
+  range_for_xlogue prologue;
+  range_for_xlogue epilogue;
+  tls_combine_func combine;
+  // The number of threads running the task.
+  int num_threads;
+  std::size_t size;
+  // Whether the prologue has run on the buffer of each thread. The task may
+  // run on a thread pool of the async engine, whose thread ids start after
+  // those of the other pools, so there is a flag for every CPU thread of the
+  // runtime.
+  i32 *initialized;
+
+  // |initialized| is allocated by the caller, since it lives on its stack. It
+  // must hold LLVMRuntime::num_cpu_threads flags.
+  void init(Context *context,
+            range_for_xlogue prologue,
+            range_for_xlogue epilogue,
+            tls_combine_func combine,
+            int num_threads,
+            std::size_t size,
+            i32 *initialized) {
+    this->context = context;
+    this->prologue = prologue;
+    this->epilogue = epilogue;
+    this->combine = combine;
+    this->num_threads = num_threads;
+    this->size = size;
+    this->initialized = initialized;
+    for (int i = 0; i < context->runtime->num_cpu_threads; i++) {
+      initialized[i] = 0;
+    }
+  }
+
+  char *get_buffer(int thread_id) {
+    return (char *)context->runtime->cpu_tls_buffers[thread_id];
+  }
+
+  // Only thread |thread_id| accesses its own buffer during the task.
+  char *get(int thread_id) {
+    if (!initialized[thread_id]) {
+      initialized[thread_id] = 1;
+      auto runtime = context->runtime;
+      auto old_size = runtime->cpu_tls_buffer_sizes[thread_id];
+      if (old_size < size) {
+        // The old buffer is not reclaimed, so we at least double the size to
+        // bound the waste. Buffers are padded to cache lines to avoid false
+        // sharing.
+        auto new_size = (std::max(size, old_size * 2) + 63) / 64 * 64;
+        runtime->cpu_tls_buffers[thread_id] =
+            runtime->allocate_aligned(new_size, 64);
+        runtime->cpu_tls_buffer_sizes[thread_id] = new_size;
+      }
+      if (prologue)
+        prologue(context, get_buffer(thread_id), thread_id);
+    }
+    return get_buffer(thread_id);
+  }
+
+  void finalize();
+};
+
+struct cpu_tls_combine_helper_context {
+  cpu_thread_local_storage *tls;
+  // The ids of the threads whose buffers are being combined.
+  int *thread_ids;
+  int stride;
+};
+
+// Combines the buffer of the (2i+1)-th group of |stride| threads into that of
+// the (2i)-th group.
+void cpu_tls_combine_helper(void *ctx_, int thread_id, int i) {
+  auto ctx = (cpu_tls_combine_helper_context *)ctx_;
+  auto tls = ctx->tls;
+  int dst = ctx->thread_ids[i * 2 * ctx->stride];
+  int src = ctx->thread_ids[i * 2 * ctx->stride + ctx->stride];
+  tls->combine(tls->context, tls->get_buffer(dst), tls->get_buffer(src),
+               thread_id);
+}
+
+void cpu_thread_local_storage::finalize() {
+  const int num_cpu_threads = context->runtime->num_cpu_threads;
+  int thread_ids[num_cpu_threads];
+  int n = 0;
+  for (int i = 0; i < num_cpu_threads; i++) {
+    if (initialized[i])
+      thread_ids[n++] = i;
+  }
+  if (combine && n > 1) {
+    // A tree reduction into the buffer of thread_ids[0].
+    auto runtime = context->runtime;
+    cpu_tls_combine_helper_context ctx;
+    ctx.tls = this;
+    ctx.thread_ids = thread_ids;
+    for (ctx.stride = 1; ctx.stride < n; ctx.stride *= 2) {
+      int num_pairs = (n - ctx.stride + 2 * ctx.stride - 1) / (2 * ctx.stride);
+      if (num_pairs == 1) {
+        cpu_tls_combine_helper(&ctx, /*thread_id=*/0, 0);
+      } else {
+        runtime->parallel_for(runtime->thread_pool, num_pairs, num_threads,
+                              &ctx, cpu_tls_combine_helper);
+      }
+    }
+    n = 1;
+  }
+  if (epilogue) {
+    for (int i = 0; i < n; i++) {
+      epilogue(context, get_buffer(thread_ids[i]), thread_ids[i]);
+    }
+  }
+}
 
 struct cpu_block_task_helper_context {
   Context *context;
@@ -1225,16 +1822,13 @@ struct cpu_block_task_helper_context {
   ListManager *list;
   int element_size;
   int element_split;
-  std::size_t tls_buffer_size;
+  cpu_thread_local_storage tls;
 };
 
 // TODO: To enforce inlining, we need to create in LLVM a new function that
 // calls block_helper and the BLS xlogues, and pass that function to the
 // scheduler.
 
-// TODO: TLS should be directly passed to the scheduler, so that it lives
-// with the threads (instead of blocks).
-
 void cpu_struct_for_block_helper(void *ctx_, int thread_id, int i) {
   auto ctx = (cpu_block_task_helper_context *)(ctx_);
   int element_id = i / ctx->element_split;
@@ -1244,21 +1838,24 @@ void cpu_struct_for_block_helper(void *ctx_, int thread_id, int i) {
   int lower = e.loop_bounds[0] + part_id * part_size;
   int upper = e.loop_bounds[0] + (part_id + 1) * part_size;
   upper = std::min(upper, e.loop_bounds[1]);
-  alignas(8) char tls_buffer[ctx->tls_buffer_size];
 
-  Context this_thread_context = *ctx->context;
-  this_thread_context.cpu_thread_id = thread_id;
   if (lower < upper) {
-    (*ctx->task)(&this_thread_context, tls_buffer,
-                 &ctx->list->get<Element>(element_id), lower, upper);
+    (*ctx->task)(ctx->context, ctx->tls.get(thread_id),
+                 &ctx->list->get<Element>(element_id), lower, upper,
+                 thread_id);
   }
 }
 
+// |tls_prologue|, |tls_epilogue| and |tls_combine| are only used on CPUs. See
+// cpu_thread_local_storage. On GPUs, |task| handles the TLS by itself.
 void parallel_struct_for(Context *context,
                          int snode_id,
                          int element_size,
                          int element_split,
                          BlockTask *task,
+                         range_for_xlogue tls_prologue,
+                         range_for_xlogue tls_epilogue,
+                         tls_combine_func tls_combine,
                          std::size_t tls_buffer_size,
                          int num_threads) {
   auto list = (context->runtime)->element_lists[snode_id];
@@ -1281,7 +1878,8 @@ void parallel_struct_for(Context *context,
     int upper = e.loop_bounds[0] + (part_id + 1) * part_size;
     upper = std::min(upper, e.loop_bounds[1]);
     if (lower < upper)
-      task(context, tls_buffer, &list->get<Element>(element_id), lower, upper);
+      task(context, tls_buffer, &list->get<Element>(element_id), lower, upper,
+           /*thread_id=*/0);
     i += grid_dim();
   }
 #else
@@ -1291,21 +1889,30 @@ void parallel_struct_for(Context *context,
   ctx.list = list;
   ctx.element_size = element_size;
   ctx.element_split = element_split;
-  ctx.tls_buffer_size = tls_buffer_size;
+  i32 tls_initialized[context->runtime->num_cpu_threads];
+  ctx.tls.init(context, tls_prologue, tls_epilogue, tls_combine, num_threads,
+               tls_buffer_size, tls_initialized);
   auto runtime = context->runtime;
   runtime->parallel_for(runtime->thread_pool, list_tail * element_split,
                         num_threads, &ctx, cpu_struct_for_block_helper);
+  ctx.tls.finalize();
 #endif
 }
 
-using range_for_xlogue = void (*)(Context *, /*TLS*/ char *tls_base);
+int get_cpu_range_for_block_dim(int num_items, int num_threads, int block_dim) {
+  if (block_dim == 0) {
+    // adaptive block dim
+    // ensure each thread has at least ~32 tasks for load balancing
+    // and each task has at least 512 items to amortize scheduler overhead
+    block_dim = std::min(512, std::max(1, num_items / (num_threads * 32)));
+  }
+  return block_dim;
+}
 
 struct range_task_helper_context {
   Context *context;
-  range_for_xlogue prologue{nullptr};
   RangeForTaskFunc *body{nullptr};
-  range_for_xlogue epilogue{nullptr};
-  std::size_t tls_size{1};
+  cpu_thread_local_storage tls;
   int begin;
   int end;
   int block_size;
@@ -1315,29 +1922,22 @@ struct range_task_helper_context {
 void cpu_parallel_range_for_task(void *range_context,
                                  int thread_id,
                                  int task_id) {
-  auto ctx = *(range_task_helper_context *)range_context;
-  alignas(8) char tls_buffer[ctx.tls_size];
-  auto tls_ptr = &tls_buffer[0];
-  if (ctx.prologue)
-    ctx.prologue(ctx.context, tls_ptr);
-
-  Context this_thread_context = *ctx.context;
-  this_thread_context.cpu_thread_id = thread_id;
-  if (ctx.step == 1) {
-    int block_start = ctx.begin + task_id * ctx.block_size;
-    int block_end = std::min(block_start + ctx.block_size, ctx.end);
+  auto ctx = (range_task_helper_context *)range_context;
+  auto tls_ptr = ctx->tls.get(thread_id);
+
+  if (ctx->step == 1) {
+    int block_start = ctx->begin + task_id * ctx->block_size;
+    int block_end = std::min(block_start + ctx->block_size, ctx->end);
     for (int i = block_start; i < block_end; i++) {
-      ctx.body(&this_thread_context, tls_ptr, i);
+      ctx->body(ctx->context, tls_ptr, i, thread_id);
     }
-  } else if (ctx.step == -1) {
-    int block_start = ctx.end - task_id * ctx.block_size;
-    int block_end = std::max(ctx.begin, block_start * ctx.block_size);
+  } else if (ctx->step == -1) {
+    int block_start = ctx->end - task_id * ctx->block_size;
+    int block_end = std::max(ctx->begin, block_start * ctx->block_size);
     for (int i = block_start - 1; i >= block_end; i--) {
-      ctx.body(&this_thread_context, tls_ptr, i);
+      ctx->body(ctx->context, tls_ptr, i, thread_id);
     }
   }
-  if (ctx.epilogue)
-    ctx.epilogue(ctx.context, tls_ptr);
 }
 
 void cpu_parallel_range_for(Context *context,
@@ -1349,13 +1949,11 @@ void cpu_parallel_range_for(Context *context,
                             range_for_xlogue prologue,
                             RangeForTaskFunc *body,
                             range_for_xlogue epilogue,
+                            tls_combine_func combine,
                             std::size_t tls_size) {
   range_task_helper_context ctx;
   ctx.context = context;
-  ctx.prologue = prologue;
-  ctx.tls_size = tls_size;
   ctx.body = body;
-  ctx.epilogue = epilogue;
   ctx.begin = begin;
   ctx.end = end;
   ctx.step = step;
@@ -1363,18 +1961,69 @@ void cpu_parallel_range_for(Context *context,
     taichi_printf(context->runtime, "step must not be %d\n", step);
     exit(-1);
   }
-  if (block_dim == 0) {
-    // adaptive block dim
-    auto num_items = (ctx.end - ctx.begin) / std::abs(step);
-    // ensure each thread has at least ~32 tasks for load balancing
-    // and each task has at least 512 items to amortize scheduler overhead
-    block_dim = std::min(512, std::max(1, num_items / (num_threads * 32)));
-  }
-  ctx.block_size = block_dim;
+  ctx.block_size = get_cpu_range_for_block_dim(
+      (ctx.end - ctx.begin) / std::abs(step), num_threads, block_dim);
+  i32 tls_initialized[context->runtime->num_cpu_threads];
+  ctx.tls.init(context, prologue, epilogue, combine, num_threads, tls_size,
+               tls_initialized);
   auto runtime = context->runtime;
-  runtime->parallel_for(runtime->thread_pool,
-                        (end - begin + block_dim - 1) / block_dim, num_threads,
-                        &ctx, cpu_parallel_range_for_task);
+  runtime->parallel_for(
+      runtime->thread_pool,
+      (end - begin + ctx.block_size - 1) / ctx.block_size, num_threads, &ctx,
+      cpu_parallel_range_for_task);
+  ctx.tls.finalize();
+}
+
+struct range_block_task_helper_context {
+  Context *context;
+  RangeForBlockFunc *body{nullptr};
+  cpu_thread_local_storage tls;
+  int begin;
+  int end;
+  int block_size;
+};
+
+void cpu_parallel_range_for_block_task(void *range_context,
+                                       int thread_id,
+                                       int task_id) {
+  auto ctx = (range_block_task_helper_context *)range_context;
+  int block_begin = ctx->begin + task_id * ctx->block_size;
+  int block_end = std::min(block_begin + ctx->block_size, ctx->end);
+  ctx->body(ctx->context, ctx->tls.get(thread_id), block_begin, block_end,
+            thread_id);
+}
+
+// Unlike cpu_parallel_range_for, |body| runs a whole block of iterations per
+// call, so that the loop is visible to LLVM. The direction of iteration is
+// handled by |body|.
+void cpu_parallel_range_for_block(Context *context,
+                                  int num_threads,
+                                  int begin,
+                                  int end,
+                                  int block_dim,
+                                  range_for_xlogue prologue,
+                                  RangeForBlockFunc *body,
+                                  range_for_xlogue epilogue,
+                                  tls_combine_func combine,
+                                  std::size_t tls_size) {
+  if (end <= begin)
+    return;
+  range_block_task_helper_context ctx;
+  ctx.context = context;
+  ctx.body = body;
+  ctx.begin = begin;
+  ctx.end = end;
+  ctx.block_size =
+      get_cpu_range_for_block_dim(end - begin, num_threads, block_dim);
+  i32 tls_initialized[context->runtime->num_cpu_threads];
+  ctx.tls.init(context, prologue, epilogue, combine, num_threads, tls_size,
+               tls_initialized);
+  auto runtime = context->runtime;
+  runtime->parallel_for(
+      runtime->thread_pool,
+      (end - begin + ctx.block_size - 1) / ctx.block_size, num_threads, &ctx,
+      cpu_parallel_range_for_block_task);
+  ctx.tls.finalize();
 }
 
 void gpu_parallel_range_for(Context *context,
@@ -1387,21 +2036,25 @@ void gpu_parallel_range_for(Context *context,
   int idx = thread_idx() + block_dim() * block_idx() + begin;
   alignas(8) char tls_buffer[tls_size];
   auto tls_ptr = &tls_buffer[0];
+  // The thread id is only used on CPUs. See linear_thread_idx.
   if (prologue)
-    prologue(context, tls_ptr);
+    prologue(context, tls_ptr, 0);
   while (idx < end) {
-    func(context, tls_ptr, idx);
+    func(context, tls_ptr, idx, 0);
     idx += block_dim() * grid_dim();
   }
   if (epilogue)
-    epilogue(context, tls_ptr);
+    epilogue(context, tls_ptr, 0);
 }
 
-i32 linear_thread_idx(Context *context) {
+// |cpu_thread_id| is the id of the thread running the current task function,
+// which is passed to the function by the CPU scheduler. It is 0 in serial
+// tasks.
+i32 linear_thread_idx(i32 cpu_thread_id) {
 #if ARCH_cuda
   return block_idx() * block_dim() + thread_idx();
 #else
-  return context->cpu_thread_id;
+  return cpu_thread_id;
 #endif
 }
 
@@ -1410,6 +2063,7 @@ i32 linear_thread_idx(Context *context) {
 #include "node_pointer.h"
 #include "node_root.h"
 #include "node_bitmasked.h"
+#include "node_hash.h"
 
 void ListManager::touch_chunk(int chunk_id) {
   taichi_assert_runtime(runtime, chunk_id < max_num_chunks,
@@ -1419,8 +2073,17 @@ void ListManager::touch_chunk(int chunk_id) {
       // may have been allocated during lock contention
       if (!chunks[chunk_id]) {
         grid_memfence();
-        auto chunk_ptr = runtime->request_allocate_aligned(
-            max_num_elements_per_chunk * element_size, 4096);
+        Ptr chunk_ptr;
+        if (chunk_alignment) {
+          auto header = runtime->request_allocate_aligned(
+              chunk_header_size + max_num_elements_per_chunk * element_size,
+              chunk_alignment);
+          *(i32 *)header = chunk_id;
+          chunk_ptr = header + chunk_header_size;
+        } else {
+          chunk_ptr = runtime->request_allocate_aligned(
+              max_num_elements_per_chunk * element_size, 4096);
+        }
         atomic_exchange_u64((u64 *)&chunks[chunk_id], (u64)chunk_ptr);
       }
     });
@@ -1450,7 +2113,7 @@ void gc_parallel_0(Context *context, int snode_id) {
   using T = NodeManager::list_data_type;
 
   // Move unused elements to the beginning of the free_list
-  int i = linear_thread_idx(context);
+  int i = linear_thread_idx(0);
   if (free_list_used * 2 > free_list_size) {
     // Directly copy. Dst and src does not overlap
     auto items_to_copy = free_list_size - free_list_used;
@@ -1527,9 +2190,9 @@ void gc_parallel_2(Context *context, int snode_id) {
 
 extern "C" {
 
-u32 rand_u32(Context *context) {
+u32 rand_u32(Context *context, i32 cpu_thread_id) {
   auto state = &((LLVMRuntime *)context->runtime)
-                    ->rand_states[linear_thread_idx(context)];
+                    ->rand_states[linear_thread_idx(cpu_thread_id)];
 
   auto &x = state->x;
   auto &y = state->y;
@@ -1546,24 +2209,25 @@ u32 rand_u32(Context *context) {
                           // it decorrelates streams of PRNGs.
 }
 
-uint64 rand_u64(Context *context) {
-  return ((u64)rand_u32(context) << 32) + rand_u32(context);
+uint64 rand_u64(Context *context, i32 cpu_thread_id) {
+  return ((u64)rand_u32(context, cpu_thread_id) << 32) +
+         rand_u32(context, cpu_thread_id);
 }
 
-f32 rand_f32(Context *context) {
-  return rand_u32(context) * (1.0f / 4294967296.0f);
+f32 rand_f32(Context *context, i32 cpu_thread_id) {
+  return rand_u32(context, cpu_thread_id) * (1.0f / 4294967296.0f);
 }
 
-f64 rand_f64(Context *context) {
-  return rand_u64(context) * (1.0 / 18446744073709551616.0);
+f64 rand_f64(Context *context, i32 cpu_thread_id) {
+  return rand_u64(context, cpu_thread_id) * (1.0 / 18446744073709551616.0);
 }
 
-i32 rand_i32(Context *context) {
-  return rand_u32(context);
+i32 rand_i32(Context *context, i32 cpu_thread_id) {
+  return rand_u32(context, cpu_thread_id);
 }
 
-i64 rand_i64(Context *context) {
-  return rand_u64(context);
+i64 rand_i64(Context *context, i32 cpu_thread_id) {
+  return rand_u64(context, cpu_thread_id);
 }
 };
 
@@ -0,0 +1,40 @@
+#pragma once
+
+// Use relative path here for runtime compilation
+#include "taichi/inc/constants.h"
+
+#if defined(TI_RUNTIME_HOST)
+namespace taichi {
+namespace lang {
+#endif
+
+// Triplets inserted into a SparseMatrixBuilder, shared between the builder on
+// the host and insert_triplet in the runtime.
+//
+// Triplets are stored in chunks of taichi_sparse_matrix_chunk_size entries.
+// Each CPU thread appends to a chunk of its own, so that the threads only
+// contend on |num_chunks| once per chunk instead of once per triplet.
+struct SparseMatrixTriplets {
+  // The number of chunks taken so far, which may exceed |max_num_chunks|.
+  int64 num_chunks;
+  int64 max_num_chunks;
+  // The number of triplets dropped since all chunks were taken.
+  int64 num_dropped;
+  // Whether |values| are float64 instead of float32.
+  int32 is_f64;
+  int32 num_threads;
+  // The chunk being filled by each thread, or -1. The entry of thread i is
+  // thread_chunks[i * taichi_sparse_matrix_thread_chunk_stride] to avoid
+  // false sharing.
+  int64 *thread_chunks;
+  // The number of triplets in each chunk.
+  int32 *chunk_sizes;
+  int32 *rows;
+  int32 *cols;
+  void *values;
+};
+
+#if defined(TI_RUNTIME_HOST)
+}  // namespace lang
+}  // namespace taichi
+#endif
@@ -126,6 +126,14 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
                                     snode.max_num_elements());
     body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
                                      snode.max_num_elements());
+  } else if (type == SNodeType::hash) {
+    TI_ERROR_IF(!arch_is_cpu(arch_),
+                "Hash SNodes are only supported on CPUs.");
+    // keys (child index + 1, or 0 if the slot is empty)
+    aux_type = llvm::ArrayType::get(llvm::PointerType::getInt32Ty(*ctx),
+                                    snode.hash_table_size);
+    body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
+                                     snode.hash_table_size);
   } else if (type == SNodeType::dynamic) {
     // mutex and n (number of elements)
     aux_type =
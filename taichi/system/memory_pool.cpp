@@ -9,6 +9,7 @@ MemoryPool::MemoryPool(Arch arch) : arch_(arch) {
            default_allocator_size / 1024 / 1024);
   terminating = false;
   killed = false;
+  woken = false;
   processed_tail = 0;
   queue = nullptr;
 #if defined(TI_WITH_CUDA)
@@ -21,15 +22,34 @@ MemoryPool::MemoryPool(Arch arch) : arch_(arch) {
                                              CU_STREAM_NON_BLOCKING);
   }
 #endif
-  th = std::make_unique<std::thread>([this] { this->daemon(); });
 }
 
 void MemoryPool::set_queue(MemRequestQueue *queue) {
   std::lock_guard<std::mutex> _(mut);
   this->queue = queue;
+  if (queue && !th) {
+    th = std::make_unique<std::thread>([this] { this->daemon(); });
+  }
+}
+
+void MemoryPool::wake() {
+  {
+    std::lock_guard<std::mutex> _(mut);
+    if (!th) {
+      return;
+    }
+    woken = true;
+  }
+  cv.notify_one();
 }
 
 void *MemoryPool::allocate(std::size_t size, std::size_t alignment) {
+  return allocate_requested(size, alignment, Time::get_time());
+}
+
+void *MemoryPool::allocate_requested(std::size_t size,
+                                     std::size_t alignment,
+                                     float64 request_time) {
   std::lock_guard<std::mutex> _(mut_allocators);
   void *ret = nullptr;
   if (!allocators.empty()) {
@@ -43,9 +63,19 @@ void *MemoryPool::allocate(std::size_t size, std::size_t alignment) {
     ret = allocators.back()->allocate(size, alignment);
   }
   TI_ASSERT(ret);
+  const auto latency = Time::get_time() - request_time;
+  stats_.num_requests++;
+  stats_.num_bytes += size;
+  stats_.total_latency += latency;
+  stats_.max_latency = std::max(stats_.max_latency, latency);
   return ret;
 }
 
+MemoryPool::AllocationStats MemoryPool::get_stats() {
+  std::lock_guard<std::mutex> _(mut_allocators);
+  return stats_;
+}
+
 template <typename T>
 T MemoryPool::fetch(volatile void *ptr) {
   T ret;
@@ -80,32 +110,46 @@ void MemoryPool::push(volatile T *dest, const T &val) {
 }
 
 void MemoryPool::daemon() {
+  int poll_interval_us = min_poll_interval_us;
+  auto last_poll_time = Time::get_time();
   while (1) {
-    Time::usleep(1000);
-    std::lock_guard<std::mutex> _(mut);
+    std::unique_lock<std::mutex> lock(mut);
+    cv.wait_for(lock, std::chrono::microseconds(poll_interval_us),
+                [this] { return terminating || woken; });
     if (terminating) {
       killed = true;
       break;
     }
-    if (!queue) {
-      continue;
+    if (woken) {
+      woken = false;
+      poll_interval_us = min_poll_interval_us;
     }
+    // Requests posted since the last poll have waited for half of the
+    // interval on average.
+    const auto poll_time = Time::get_time();
+    const auto request_time = (last_poll_time + poll_time) / 2;
+    last_poll_time = poll_time;
 
     // poll allocation requests.
     using tail_type = decltype(MemRequestQueue::tail);
     auto tail = fetch<tail_type>(&queue->tail);
-    if (tail > processed_tail) {
+    if (tail <= processed_tail) {
+      poll_interval_us = std::min(poll_interval_us * 2, max_poll_interval_us);
+      continue;
+    }
+    poll_interval_us = min_poll_interval_us;
+    while (processed_tail < tail) {
       // allocate new buffer
       auto i = processed_tail;
       TI_DEBUG("Processing memory alloc request {}", i);
       auto req = fetch<MemRequest>(&queue->requests[i]);
       if (req.size == 0 || req.alignment == 0) {
         TI_DEBUG(" Incomplete memory alloc request {} fetched. Skipping", i);
-        continue;
+        break;
       }
       TI_DEBUG("  Allocating memory {} B (alignment {}B) ", req.size,
                req.alignment);
-      auto ptr = allocate(req.size, req.alignment);
+      auto ptr = allocate_requested(req.size, req.alignment, request_time);
       TI_DEBUG("  Allocated. Ptr = {:p}", ptr);
       push(&queue->requests[i].ptr, (uint8 *)ptr);
       processed_tail += 1;
@@ -118,8 +162,13 @@ void MemoryPool::terminate() {
     std::lock_guard<std::mutex> _(mut);
     terminating = true;
   }
-  th->join();
-  TI_ASSERT(killed);
+  cv.notify_one();
+  if (th) {
+    th->join();
+    TI_ASSERT(killed);
+  } else {
+    killed = true;
+  }
 #if 0 && defined(TI_WITH_CUDA)
   if (arch_ == Arch::cuda)
     CUDADriver::get_instance().cudaStreamDestroy(cuda_stream);
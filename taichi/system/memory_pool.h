@@ -4,6 +4,7 @@
 #define TI_RUNTIME_HOST
 #include "taichi/runtime/llvm/mem_request.h"
 
+#include <condition_variable>
 #include <mutex>
 #include <vector>
 #include <memory>
@@ -12,15 +13,35 @@
 TLANG_NAMESPACE_BEGIN
 
 // A memory pool that runs on the host
+//
+// CPU kernels call allocate() directly through the runtime. Only kernels that
+// cannot call into the host (i.e. CUDA with unified memory) post requests to
+// a MemRequestQueue, which is served by a daemon thread started on
+// set_queue().
 
 class MemoryPool {
  public:
+  struct AllocationStats {
+    uint64 num_requests{0};
+    uint64 num_bytes{0};
+    // Seconds from a request to its completion. For queued requests, this
+    // includes an estimate of the time before the daemon noticed them.
+    float64 total_latency{0};
+    float64 max_latency{0};
+  };
+
   std::vector<std::unique_ptr<UnifiedAllocator>> allocators;
   static constexpr std::size_t default_allocator_size =
       1 << 30;  // 1 GB per allocator
-  bool terminating, killed;
+  // The daemon polls the queue every |min_poll_interval_us| after serving a
+  // request or being woken by wake(), and backs off exponentially to
+  // |max_poll_interval_us| when idle.
+  static constexpr int min_poll_interval_us = 10;
+  static constexpr int max_poll_interval_us = 1000;
+  bool terminating, killed, woken;
   std::mutex mut;
   std::mutex mut_allocators;
+  std::condition_variable cv;
   std::unique_ptr<std::thread> th;
   int processed_tail;
 
@@ -39,15 +60,26 @@ class MemoryPool {
 
   void set_queue(MemRequestQueue *queue);
 
+  // Called before launching kernels that may post requests to the queue, so
+  // that the daemon polls it quickly instead of after an idle back-off.
+  void wake();
+
   void daemon();
 
   void terminate();
 
+  AllocationStats get_stats();
+
   ~MemoryPool();
 
  private:
+  void *allocate_requested(std::size_t size,
+                           std::size_t alignment,
+                           float64 request_time);
+
   static constexpr bool use_cuda_stream = false;
   Arch arch_;
+  AllocationStats stats_;
 };
 
 TLANG_NAMESPACE_END
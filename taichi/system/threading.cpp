@@ -10,8 +10,24 @@
 #include <thread>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 TI_NAMESPACE_BEGIN
 
+namespace {
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#else
+  std::this_thread::yield();
+#endif
+}
+}  // namespace
+
 bool test_threading() {
   auto tp = ThreadPool(20);
   for (int j = 0; j < 100; j++) {
@@ -26,18 +42,14 @@ bool test_threading() {
   return true;
 }
 
-ThreadPool::ThreadPool(int max_num_threads) : max_num_threads(max_num_threads) {
-  exiting = false;
-  started = false;
-  running_threads = 0;
-  timestamp = 1;
-  last_finished = 0;
-  task_head = 0;
-  task_tail = 0;
-  thread_counter = 0;
-  threads.resize((std::size_t)max_num_threads);
-  for (int i = 0; i < max_num_threads; i++) {
-    threads[i] = std::thread([this] { this->target(); });
+ThreadPool::ThreadPool(int max_num_threads, int thread_id_offset)
+    : max_num_threads(std::max(max_num_threads, 1)),
+      thread_id_offset(thread_id_offset) {
+  queues = std::make_unique<TaskQueue[]>(this->max_num_threads);
+  // Thread 0 is the thread calling run().
+  threads.resize((std::size_t)this->max_num_threads - 1);
+  for (int i = 1; i < this->max_num_threads; i++) {
+    threads[i - 1] = std::thread([this, i] { this->target(i); });
   }
 }
 
@@ -45,91 +57,168 @@ void ThreadPool::run(int splits,
                      int desired_num_threads,
                      void *range_for_task_context,
                      RangeForTaskFunc *func) {
-  {
-    std::lock_guard _(mutex);
-    this->range_for_task_context = range_for_task_context;
-    this->func = func;
-    this->desired_num_threads = std::min(desired_num_threads, max_num_threads);
-    TI_ASSERT(this->desired_num_threads > 0);
-    // TI_P(this->desired_num_threads);
-    started = false;
-    task_head = 0;
-    task_tail = splits;
-    timestamp++;
-    TI_ASSERT(timestamp < (1LL << 62));  // avoid overflowing here
+  if (splits <= 0)
+    return;
+  const int n = std::max(1, std::min(desired_num_threads, max_num_threads));
+
+  // No thread can be working on the previous launch at this point: all its
+  // tasks have finished, and its queues are tagged with an older generation.
+  this->range_for_task_context = range_for_task_context;
+  this->func = func;
+  num_participants.store(n, std::memory_order_relaxed);
+  pending_tasks.store(splits, std::memory_order_relaxed);
+
+  const uint64 new_generation = generation.load(std::memory_order_relaxed) + 1;
+  for (int i = 0; i < n; i++) {
+    auto &q = queues[i];
+    q.acquire();
+    q.generation = new_generation;
+    q.begin = (int)((int64)splits * i / n);
+    q.end = (int)((int64)splits * (i + 1) / n);
+    q.release();
   }
+  generation.store(new_generation);
 
-  // wake up all slaves
-  slave_cv.notify_all();
-  {
+  if (n > 1 && num_parked_workers.load() > 0) {
+    // Taking the mutex makes sure that a worker is either already waiting on
+    // |slave_cv|, or will observe the new generation before it waits.
+    { std::lock_guard<std::mutex> _(mutex); }
+    slave_cv.notify_all();
+  }
+
+  work(0, new_generation);
+
+  for (int i = 0; pending_tasks.load(std::memory_order_acquire) != 0; i++) {
+    if (i < kSpinIterations) {
+      cpu_relax();
+      continue;
+    }
     std::unique_lock<std::mutex> lock(mutex);
-    // TODO: the workers may have finished before master waiting on master_cv
-    master_cv.wait(lock, [this] { return started && running_threads == 0; });
+    master_parked.store(true);
+    master_cv.wait(lock, [this] {
+      return pending_tasks.load(std::memory_order_acquire) == 0;
+    });
+    master_parked.store(false);
+    break;
   }
-  TI_ASSERT(task_head >= task_tail);
 }
 
-void ThreadPool::target() {
-  uint64 last_timestamp = 0;
-  int thread_id;
-  {
-    std::lock_guard<std::mutex> lock(mutex);
-    thread_id = thread_counter++;
+bool ThreadPool::pop(int thread_id, uint64 generation, int &task_id) {
+  auto &q = queues[thread_id];
+  bool success = false;
+  q.acquire();
+  if (q.generation == generation && q.begin < q.end) {
+    task_id = q.begin++;
+    success = true;
   }
-  while (true) {
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      slave_cv.wait(lock, [this, last_timestamp, thread_id] {
-        return (timestamp > last_timestamp &&
-                thread_id < desired_num_threads) ||
-               this->exiting;
-      });
-      last_timestamp = timestamp;
-      if (exiting) {
-        break;
-      } else {
-        if (last_finished >= last_timestamp) {
-          continue;
-          // This could happen when part of the desired threads wake up and
-          // finish all the task, and then this thread wake up finding nothing
-          // to do. Should skip this task directly.
-        } else {
-          started = true;
-          running_threads++;
-        }
-      }
+  q.release();
+  return success;
+}
+
+bool ThreadPool::steal(int thread_id, uint64 generation) {
+  const int n = num_participants.load(std::memory_order_relaxed);
+  for (int k = 1; k < n; k++) {
+    auto &victim = queues[(thread_id + k) % n];
+    int begin = 0, end = 0;
+    victim.acquire();
+    if (victim.generation == generation && victim.begin < victim.end) {
+      // Split the remaining range and take the back half (rounded up), so
+      // that a single remaining task can still be stolen.
+      end = victim.end;
+      begin = end - (victim.end - victim.begin + 1) / 2;
+      victim.end = begin;
+    }
+    victim.release();
+    if (begin < end) {
+      auto &q = queues[thread_id];
+      q.acquire();
+      q.generation = generation;
+      q.begin = begin;
+      q.end = end;
+      q.release();
+      num_steals.fetch_add(1, std::memory_order_relaxed);
+      return true;
     }
+  }
+  return false;
+}
 
-    while (true) {
-      // For a single parallel task
-      int task_id;
-      {
-        task_id = task_head.fetch_add(1, std::memory_order_relaxed);
-        if (task_id >= task_tail)
-          break;
-      }
+void ThreadPool::finish_tasks(int num_tasks) {
+  if (num_tasks == 0)
+    return;
+  if (pending_tasks.fetch_sub(num_tasks) == num_tasks) {
+    if (master_parked.load()) {
+      { std::lock_guard<std::mutex> _(mutex); }
+      master_cv.notify_one();
+    }
+  }
+}
 
-      func(this->range_for_task_context, thread_id, task_id);
+void ThreadPool::work(int thread_id, uint64 generation) {
+  while (true) {
+    int task_id;
+    int num_finished = 0;
+    while (pop(thread_id, generation, task_id)) {
+      // |func| and |range_for_task_context| are published before the queues
+      // are tagged with |generation|, so reading them after a successful pop
+      // always sees the values of this launch.
+      func(range_for_task_context, thread_id_offset + thread_id, task_id);
+      num_finished++;
     }
+    // Completions are reported once per drained queue instead of once per
+    // task, so that threads do not fight over |pending_tasks|.
+    finish_tasks(num_finished);
+    if (!steal(thread_id, generation))
+      break;
+  }
+}
 
-    bool all_finished = false;
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-      running_threads--;
-      if (running_threads == 0) {
-        all_finished = true;
-        last_finished = last_timestamp;
+void ThreadPool::target(int thread_id) {
+  uint64 last_generation = 0;
+  while (true) {
+    uint64 current_generation;
+    int spins = 0;
+    while ((current_generation = generation.load(std::memory_order_acquire)) ==
+               last_generation &&
+           !exiting.load(std::memory_order_relaxed)) {
+      if (spins++ < kSpinIterations) {
+        cpu_relax();
+        continue;
       }
+      std::unique_lock<std::mutex> lock(mutex);
+      num_parked_workers++;
+      slave_cv.wait(lock, [this, last_generation] {
+        return generation.load() != last_generation || exiting.load();
+      });
+      num_parked_workers--;
     }
-    if (all_finished)
-      master_cv.notify_one();
+    if (exiting.load())
+      break;
+    last_generation = current_generation;
+    if (thread_id >= num_participants.load(std::memory_order_relaxed))
+      continue;
+    work(thread_id, current_generation);
   }
 }
 
+ThreadPool *&ThreadPool::get_launch_pool() {
+  thread_local ThreadPool *pool = nullptr;
+  return pool;
+}
+
+ThreadPool::LaunchGuard::LaunchGuard(ThreadPool *pool)
+    : old_pool_(get_launch_pool()) {
+  get_launch_pool() = pool;
+}
+
+ThreadPool::LaunchGuard::~LaunchGuard() {
+  get_launch_pool() = old_pool_;
+}
+
 ThreadPool::~ThreadPool() {
   {
     std::lock_guard<std::mutex> lg(mutex);
-    exiting = true;
+    exiting.store(true);
   }
   slave_cv.notify_all();
   for (auto &th : threads)
@@ -10,6 +10,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <thread>
 
 TI_NAMESPACE_BEGIN
@@ -17,29 +18,29 @@ TI_NAMESPACE_BEGIN
 using RangeForTaskFunc = void(void *, int thread_id, int i);
 using ParallelFor = void(int n, int num_threads, void *, RangeForTaskFunc func);
 
+/**
+ * A work-stealing thread pool.
+ *
+ * Each participating thread owns a range of task ids [begin, end). The owner
+ * takes tasks from the front of its range, while idle threads steal the back
+ * half of a victim's remaining range. The calling thread of run() takes part
+ * as thread 0, so that a launch with a single desired thread never wakes up a
+ * worker. Idle workers spin for a short while before parking on a condition
+ * variable, which makes back-to-back launches of small kernels cheap.
+ *
+ * The pool is driven by LLVMRuntime::parallel_for, see static_run().
+ *
+ * Several pools can partition the CPU threads to run kernels concurrently. The
+ * thread ids passed to the tasks then start from |thread_id_offset|, so that
+ * the pools do not share per-thread states, e.g., the random states of the
+ * runtime.
+ */
 class ThreadPool {
  public:
-  std::vector<std::thread> threads;
-  std::condition_variable slave_cv;
-  std::condition_variable master_cv;
-  std::mutex mutex;
-  std::atomic<int> task_head;
-  int task_tail;
-  int running_threads;
-  int max_num_threads;
-  int desired_num_threads;
-  uint64 timestamp;
-  uint64 last_finished;
-  bool started;
-  bool exiting;
-  RangeForTaskFunc *func;
-  void *range_for_task_context;  // Note: this is a pointer to a
-                                 // range_task_helper_context defined in the
-                                 // LLVM runtime, which is different from
-                                 // taichi::lang::Context.
-  int thread_counter;
-
-  ThreadPool(int max_num_threads);
+  // Number of spin iterations before an idle thread parks.
+  static constexpr int kSpinIterations = 1 << 12;
+
+  explicit ThreadPool(int max_num_threads, int thread_id_offset = 0);
 
   void run(int splits,
            int desired_num_threads,
@@ -51,12 +52,115 @@ class ThreadPool {
                          int desired_num_threads,
                          void *range_for_task_context,
                          RangeForTaskFunc *func) {
+    if (auto *launch_pool = get_launch_pool()) {
+      pool = launch_pool;
+    }
     return pool->run(splits, desired_num_threads, range_for_task_context, func);
   }
 
-  void target();
+  // Makes the kernels launched on the calling thread run on |pool| instead of
+  // the pool of the runtime, while the guard is alive.
+  class LaunchGuard {
+   public:
+    explicit LaunchGuard(ThreadPool *pool);
+
+    ~LaunchGuard();
+
+   private:
+    ThreadPool *old_pool_;
+  };
+
+  // The first thread id of the pool that kernels launched on the calling
+  // thread run on, see LaunchGuard. Serial tasks take it as their thread id.
+  static int get_launch_thread_id_offset() {
+    auto *pool = get_launch_pool();
+    return pool ? pool->thread_id_offset : 0;
+  }
+
+  int get_max_num_threads() const {
+    return max_num_threads;
+  }
+
+  // Number of tasks taken from another thread's queue since construction.
+  uint64 get_num_steals() const {
+    return num_steals.load(std::memory_order_relaxed);
+  }
 
   ~ThreadPool();
+
+ private:
+  // The task queue of a single thread. |generation| tags which run() the
+  // range belongs to, so that a late thread never executes tasks of a newer
+  // launch with the stale state of an older one.
+  struct alignas(64) TaskQueue {
+    std::atomic<bool> lock{false};
+    uint64 generation{0};
+    int begin{0};
+    int end{0};
+
+    void acquire() {
+      while (lock.exchange(true, std::memory_order_acquire))
+        ;
+    }
+
+    void release() {
+      lock.store(false, std::memory_order_release);
+    }
+  };
+
+  static ThreadPool *&get_launch_pool();
+
+  void target(int thread_id);
+
+  // Executes tasks of |generation| until no queue has work left.
+  void work(int thread_id, uint64 generation);
+
+  bool pop(int thread_id, uint64 generation, int &task_id);
+
+  bool steal(int thread_id, uint64 generation);
+
+  void finish_tasks(int num_tasks);
+
+  int max_num_threads;
+  int thread_id_offset;
+  std::vector<std::thread> threads;
+  std::unique_ptr<TaskQueue[]> queues;
+
+  // State of the current launch, published by |generation|.
+  RangeForTaskFunc *func{nullptr};
+  void *range_for_task_context{nullptr};  // Note: this is a pointer to a
+                                          // range_task_helper_context defined
+                                          // in the LLVM runtime, which is
+                                          // different from
+                                          // taichi::lang::Context.
+  std::atomic<int> num_participants{0};
+  std::atomic<uint64> generation{0};
+  std::atomic<int64> pending_tasks{0};
+
+  std::mutex mutex;
+  std::condition_variable slave_cv;
+  std::condition_variable master_cv;
+  std::atomic<int> num_parked_workers{0};
+  std::atomic<bool> master_parked{false};
+  std::atomic<bool> exiting{false};
+
+  std::atomic<uint64> num_steals{0};
 };
 
+// Runs |func|(i) for i in [0, n) on |thread_pool| from host code, or serially
+// without one.
+template <typename Func>
+void parallel_for(ThreadPool *thread_pool, int n, const Func &func) {
+  if (thread_pool == nullptr || n <= 1) {
+    for (int i = 0; i < n; i++) {
+      func(i);
+    }
+    return;
+  }
+  thread_pool->run(n, thread_pool->get_max_num_threads(), (void *)&func,
+                   [](void *ctx, int thread_id, int i) {
+                     (*(const Func *)ctx)(i);
+                   });
+}
+
 TI_NAMESPACE_END
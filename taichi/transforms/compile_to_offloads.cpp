@@ -4,6 +4,7 @@
 #include "taichi/ir/pass.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/program/compile_config.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
@@ -27,6 +28,35 @@ make_pass_printer(bool verbose, const std::string &kernel_name, IRNode *ir) {
   };
 }
 
+std::unique_ptr<PassManager> make_pass_manager(Kernel *kernel, IRNode *ir) {
+  auto pass_manager = std::make_unique<PassManager>(kernel->get_name());
+  if (CompileProfiler::get_instance().get_enabled()) {
+    pass_manager->set_profiled_ir(ir);
+  }
+  return pass_manager;
+}
+
+// Logs the time spent in the passes, and reports them to the compile profiler.
+void report_passes(const PassManager &pass_manager) {
+  TI_DEBUG("{}", pass_manager.get_timing_summary());
+  auto &profiler = CompileProfiler::get_instance();
+  if (!profiler.get_enabled()) {
+    return;
+  }
+  for (const auto &record : pass_manager.get_records()) {
+    CompileProfiler::Event event;
+    event.kernel = pass_manager.get_name();
+    event.name = record.name;
+    event.category = "ir_pass";
+    event.begin = record.begin;
+    event.seconds = record.seconds;
+    event.stmts_before = record.stmts_before;
+    event.stmts_after = record.stmts_after;
+    event.skipped = record.skipped;
+    profiler.insert_event(event);
+  }
+}
+
 }  // namespace
 
 void compile_to_offloads(IRNode *ir,
@@ -36,109 +66,143 @@ void compile_to_offloads(IRNode *ir,
                          bool vectorize,
                          bool grad,
                          bool ad_use_stack,
-                         bool start_from_ast) {
+                         bool start_from_ast,
+                         PassManager *pass_manager) {
   TI_AUTO_PROF;
 
   auto print = make_pass_printer(verbose, kernel->get_name(), ir);
   print("Initial IR");
 
+  std::unique_ptr<PassManager> local_pass_manager;
+  if (!pass_manager) {
+    local_pass_manager = make_pass_manager(kernel, ir);
+    pass_manager = local_pass_manager.get();
+  }
+  auto &pm = *pass_manager;
+  auto verify = [&] {
+    pm.run_analysis("verify", [&] { irpass::analysis::verify(ir); });
+  };
+  auto simplify = [&](bool after_lower_access) {
+    return pm.run_if_modified(
+        after_lower_access ? "full_simplify_after_lower_access"
+                           : "full_simplify",
+        [&] {
+          return irpass::full_simplify(
+              ir, config, {after_lower_access, kernel->program});
+        });
+  };
+
   if (grad) {
-    irpass::reverse_segments(ir);
+    pm.run("reverse_segments", [&] { irpass::reverse_segments(ir); });
     print("Segment reversed (for autodiff)");
   }
 
   if (start_from_ast) {
-    irpass::lower_ast(ir);
+    pm.run("lower_ast", [&] { irpass::lower_ast(ir); });
     print("Lowered");
   }
 
-  irpass::type_check(ir, config);
+  pm.run("type_check", [&] { return irpass::type_check(ir, config); });
   print("Typechecked");
-  irpass::analysis::verify(ir);
+  verify();
 
   if (kernel->is_evaluator) {
     TI_ASSERT(!grad);
 
-    irpass::demote_operations(ir, config);
+    pm.run("demote_operations",
+           [&] { return irpass::demote_operations(ir, config); });
     print("Operations demoted");
 
-    irpass::offload(ir, config);
+    pm.run("offload", [&] { irpass::offload(ir, config); });
     print("Offloaded");
-    irpass::analysis::verify(ir);
+    verify();
+    if (local_pass_manager) {
+      report_passes(pm);
+    }
     return;
   }
 
   if (vectorize) {
-    irpass::loop_vectorize(ir, config);
+    pm.run("loop_vectorize", [&] { irpass::loop_vectorize(ir, config); });
     print("Loop Vectorized");
-    irpass::analysis::verify(ir);
+    verify();
 
-    irpass::vector_split(ir, config.max_vector_width, config.serial_schedule);
+    pm.run("vector_split", [&] {
+      irpass::vector_split(ir, config.max_vector_width, config.serial_schedule);
+    });
     print("Loop Split");
-    irpass::analysis::verify(ir);
+    verify();
   }
 
   // TODO: strictly enforce bit vectorization for x86 cpu and CUDA now
   //       create a separate CompileConfig flag for the new pass
   if (arch_is_cpu(config.arch) || config.arch == Arch::cuda) {
-    irpass::bit_loop_vectorize(ir);
-    irpass::type_check(ir, config);
+    pm.run("bit_loop_vectorize", [&] { irpass::bit_loop_vectorize(ir); });
+    pm.run("type_check", [&] { return irpass::type_check(ir, config); });
     print("Bit Loop Vectorized");
-    irpass::analysis::verify(ir);
+    verify();
   }
 
-  irpass::full_simplify(ir, config, {false, kernel->program});
+  simplify(/*after_lower_access=*/false);
   print("Simplified I");
-  irpass::analysis::verify(ir);
+  verify();
 
-  if (irpass::inlining(ir, config, {})) {
+  if (pm.run("inlining", [&] { return irpass::inlining(ir, config, {}); })) {
     print("Functions inlined");
-    irpass::analysis::verify(ir);
+    verify();
   }
 
   if (grad) {
     // Remove local atomics here so that we don't have to handle their gradients
-    irpass::demote_atomics(ir, config);
+    pm.run("demote_atomics",
+           [&] { return irpass::demote_atomics(ir, config); });
 
-    irpass::full_simplify(ir, config, {false, kernel->program});
-    irpass::auto_diff(ir, config, ad_use_stack);
-    irpass::full_simplify(ir, config, {false, kernel->program});
+    simplify(/*after_lower_access=*/false);
+    pm.run("auto_diff", [&] { irpass::auto_diff(ir, config, ad_use_stack); });
+    simplify(/*after_lower_access=*/false);
     print("Gradient");
-    irpass::analysis::verify(ir);
+    verify();
   }
 
   if (config.check_out_of_bound) {
-    irpass::check_out_of_bound(ir, config, {kernel->get_name()});
+    pm.run("check_out_of_bound", [&] {
+      return irpass::check_out_of_bound(ir, config, {kernel->get_name()});
+    });
     print("Bound checked");
-    irpass::analysis::verify(ir);
+    verify();
   }
 
-  irpass::flag_access(ir);
+  pm.run("flag_access", [&] { return irpass::flag_access(ir); });
   print("Access flagged I");
-  irpass::analysis::verify(ir);
+  verify();
 
-  irpass::full_simplify(ir, config, {false, kernel->program});
+  simplify(/*after_lower_access=*/false);
   print("Simplified II");
-  irpass::analysis::verify(ir);
+  verify();
 
-  irpass::offload(ir, config);
+  pm.run("offload", [&] { irpass::offload(ir, config); });
   print("Offloaded");
-  irpass::analysis::verify(ir);
+  verify();
 
   // TODO: This pass may be redundant as cfg_optimization() is already called
   //  in full_simplify().
   if (config.cfg_optimization) {
-    irpass::cfg_optimization(ir, false);
+    pm.run("cfg_optimization",
+           [&] { return irpass::cfg_optimization(ir, false); });
     print("Optimized by CFG");
-    irpass::analysis::verify(ir);
+    verify();
   }
 
-  irpass::flag_access(ir);
+  pm.run("flag_access", [&] { return irpass::flag_access(ir); });
   print("Access flagged II");
 
-  irpass::full_simplify(ir, config, {false, kernel->program});
+  simplify(/*after_lower_access=*/false);
   print("Simplified III");
-  irpass::analysis::verify(ir);
+  verify();
+
+  if (local_pass_manager) {
+    report_passes(pm);
+  }
 }
 
 void offload_to_executable(IRNode *ir,
@@ -148,7 +212,8 @@ void offload_to_executable(IRNode *ir,
                            bool determine_ad_stack_size,
                            bool lower_global_access,
                            bool make_thread_local,
-                           bool make_block_local) {
+                           bool make_block_local,
+                           PassManager *pass_manager) {
   TI_AUTO_PROF;
 
   auto print = make_pass_printer(verbose, kernel->get_name(), ir);
@@ -158,86 +223,116 @@ void offload_to_executable(IRNode *ir,
   // For now, putting this after TLS will disable TLS, because it can only
   // handle range-fors at this point.
 
-  auto amgr = std::make_unique<AnalysisManager>();
+  std::unique_ptr<PassManager> local_pass_manager;
+  if (!pass_manager) {
+    local_pass_manager = make_pass_manager(kernel, ir);
+    pass_manager = local_pass_manager.get();
+  }
+  auto &pm = *pass_manager;
+  auto amgr = pm.get_analysis_manager();
+  auto verify = [&] {
+    pm.run_analysis("verify", [&] { irpass::analysis::verify(ir); });
+  };
 
   print("Start offload_to_executable");
-  irpass::analysis::verify(ir);
+  verify();
 
   if (config.detect_read_only) {
-    irpass::detect_read_only(ir);
+    pm.run("detect_read_only", [&] { irpass::detect_read_only(ir); });
     print("Detect read-only accesses");
   }
 
-  irpass::demote_atomics(ir, config);
+  pm.run("demote_atomics", [&] { return irpass::demote_atomics(ir, config); });
   print("Atomics demoted I");
-  irpass::analysis::verify(ir);
+  verify();
 
   if (config.demote_dense_struct_fors) {
-    irpass::demote_dense_struct_fors(ir, config.packed);
-    irpass::type_check(ir, config);
+    pm.run("demote_dense_struct_fors",
+           [&] { irpass::demote_dense_struct_fors(ir, config.packed); });
+    pm.run("type_check", [&] { return irpass::type_check(ir, config); });
     print("Dense struct-for demoted");
-    irpass::analysis::verify(ir);
+    verify();
   }
 
   if (make_thread_local) {
-    irpass::make_thread_local(ir, config);
+    pm.run("make_thread_local",
+           [&] { irpass::make_thread_local(ir, config); });
     print("Make thread local");
   }
 
   if (make_block_local) {
-    irpass::make_block_local(ir, config, {kernel->get_name()});
+    pm.run("make_block_local", [&] {
+      irpass::make_block_local(ir, config, {kernel->get_name()});
+    });
     print("Make block local");
   }
 
-  irpass::demote_atomics(ir, config);
+  pm.run("demote_atomics", [&] { return irpass::demote_atomics(ir, config); });
   print("Atomics demoted II");
-  irpass::analysis::verify(ir);
+  verify();
 
   if (is_extension_supported(config.arch, Extension::quant) &&
       ir->get_config().quant_opt_atomic_demotion) {
-    irpass::analysis::gather_uniquely_accessed_bit_structs(ir, amgr.get());
+    pm.run_analysis("gather_uniquely_accessed_bit_structs", [&] {
+      irpass::analysis::gather_uniquely_accessed_bit_structs(ir, amgr);
+    });
   }
 
-  irpass::remove_range_assumption(ir);
+  pm.run("remove_range_assumption",
+         [&] { return irpass::remove_range_assumption(ir); });
   print("Remove range assumption");
 
-  irpass::remove_loop_unique(ir);
+  pm.run("remove_loop_unique", [&] { return irpass::remove_loop_unique(ir); });
   print("Remove loop_unique");
-  irpass::analysis::verify(ir);
+  verify();
 
   if (lower_global_access) {
-    irpass::lower_access(ir, config, {kernel->no_activate, true});
+    pm.run("lower_access", [&] {
+      return irpass::lower_access(ir, config, {kernel->no_activate, true});
+    });
     print("Access lowered");
-    irpass::analysis::verify(ir);
+    verify();
 
-    irpass::die(ir);
+    pm.run("die", [&] { return irpass::die(ir); });
     print("DIE");
-    irpass::analysis::verify(ir);
+    verify();
 
-    irpass::flag_access(ir);
+    pm.run("flag_access", [&] { return irpass::flag_access(ir); });
     print("Access flagged III");
-    irpass::analysis::verify(ir);
+    verify();
   }
 
-  irpass::demote_operations(ir, config);
+  pm.run("demote_operations",
+         [&] { return irpass::demote_operations(ir, config); });
   print("Operations demoted");
 
-  irpass::full_simplify(ir, config, {lower_global_access, kernel->program});
+  pm.run_if_modified(lower_global_access ? "full_simplify_after_lower_access"
+                                         : "full_simplify",
+                     [&] {
+                       return irpass::full_simplify(
+                           ir, config, {lower_global_access, kernel->program});
+                     });
   print("Simplified IV");
 
   if (determine_ad_stack_size) {
-    irpass::determine_ad_stack_size(ir, config);
+    pm.run("determine_ad_stack_size",
+           [&] { return irpass::determine_ad_stack_size(ir, config); });
     print("Autodiff stack size determined");
   }
 
   if (is_extension_supported(config.arch, Extension::quant)) {
-    irpass::optimize_bit_struct_stores(ir, config, amgr.get());
+    pm.run("optimize_bit_struct_stores", [&] {
+      irpass::optimize_bit_struct_stores(ir, config, amgr);
+    });
     print("Bit struct stores optimized");
   }
 
   // Final field registration correctness & type checking
-  irpass::type_check(ir, config);
-  irpass::analysis::verify(ir);
+  pm.run_if_modified("type_check",
+                     [&] { return irpass::type_check(ir, config); });
+  verify();
+
+  report_passes(pm);
 }
 
 void compile_to_executable(IRNode *ir,
@@ -253,13 +348,17 @@ void compile_to_executable(IRNode *ir,
                            bool start_from_ast) {
   TI_AUTO_PROF;
 
+  // Shared by both stages, so that the passes at the beginning of
+  // offload_to_executable can be skipped if the IR is not modified.
+  auto pass_manager = make_pass_manager(kernel, ir);
+
   compile_to_offloads(ir, config, kernel, verbose, vectorize, grad,
-                      ad_use_stack, start_from_ast);
+                      ad_use_stack, start_from_ast, pass_manager.get());
 
   offload_to_executable(ir, config, kernel, verbose,
                         /*determine_ad_stack_size=*/grad && ad_use_stack,
                         lower_global_access, make_thread_local,
-                        make_block_local);
+                        make_block_local, pass_manager.get());
 }
 
 void compile_inline_function(IRNode *ir,
@@ -32,7 +32,14 @@ class DemoteAtomics : public BasicStmtVisitor {
           current_offloaded->num_cpu_threads == 1) {
         demote = true;
       }
-      if (stmt->dest->is<ThreadLocalPtrStmt>()) {
+      if (stmt->dest->is<ThreadLocalPtrStmt>() ||
+          (stmt->dest->is<PtrOffsetStmt>() &&
+           stmt->dest->as<PtrOffsetStmt>()->is_thread_local_ptr())) {
+        demote = true;
+      }
+      if (stmt->dest->is<BlockLocalPtrStmt>() &&
+          arch_is_cpu(current_offloaded->device)) {
+        // On CPUs, each block and its BLS are owned by a single thread.
         demote = true;
       }
       if (current_offloaded->task_type == OffloadedTaskType::serial) {
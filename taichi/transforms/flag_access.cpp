@@ -1,4 +1,5 @@
 #include "taichi/ir/ir.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/visitors.h"
@@ -166,10 +167,23 @@ class WeakenAccess : public BasicStmtVisitor {
 
 namespace irpass {
 
-void flag_access(IRNode *root) {
+bool flag_access(IRNode *root) {
   TI_AUTO_PROF;
+  auto global_ptrs = analysis::gather_statements(
+      root, [](Stmt *stmt) { return stmt->is<GlobalPtrStmt>(); });
+  std::vector<bool> old_activate;
+  old_activate.reserve(global_ptrs.size());
+  for (auto stmt : global_ptrs) {
+    old_activate.push_back(stmt->as<GlobalPtrStmt>()->activate);
+  }
   FlagAccess flag_access(root);
   WeakenAccess weaken_access(root);
+  for (int i = 0; i < (int)global_ptrs.size(); i++) {
+    if (global_ptrs[i]->as<GlobalPtrStmt>()->activate != old_activate[i]) {
+      return true;
+    }
+  }
+  return false;
 }
 
 }  // namespace irpass
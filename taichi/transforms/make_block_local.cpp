@@ -58,6 +58,56 @@ void make_block_local_offload(OffloadedStmt *offload,
     bls_offset_in_bytes +=
         (dtype_size - bls_offset_in_bytes % dtype_size) % dtype_size;
 
+    // Computes the offset of BLS element |bls_element_id| in the BLS buffer
+    auto create_bls_element_offset_bytes = [&](Block *block,
+                                               Stmt *bls_element_id) {
+      auto bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
+          BinaryOpType::mul, bls_element_id,
+          block->push_back<ConstStmt>(TypedConstant(dtype_size)));
+
+      return block->push_back<BinaryOpStmt>(
+          BinaryOpType::add, bls_element_offset_bytes,
+          block->push_back<ConstStmt>(
+              TypedConstant((int32)bls_offset_in_bytes)));
+    };
+
+    // Converts |bls_element_id| to global indices via a series of % and /.
+    auto create_global_indices = [&](Block *element_block,
+                                     Stmt *bls_element_id) {
+      std::vector<Stmt *> global_indices(dim);
+
+      auto bls_element_id_partial = bls_element_id;
+      for (int i = dim - 1; i >= 0; i--) {
+        auto pad_size_stmt = element_block->push_back<ConstStmt>(
+            TypedConstant(pad.second.pad_size[i]));
+
+        auto bls_coord = element_block->push_back<BinaryOpStmt>(
+            BinaryOpType::mod, bls_element_id_partial, pad_size_stmt);
+        bls_element_id_partial = element_block->push_back<BinaryOpStmt>(
+            BinaryOpType::div, bls_element_id_partial, pad_size_stmt);
+
+        auto global_index_this_dim = element_block->push_back<BinaryOpStmt>(
+            BinaryOpType::add, bls_coord,
+            element_block->push_back<ConstStmt>(
+                TypedConstant(pad.second.bounds[i].low)));
+
+        auto block_corner =
+            element_block->push_back<BlockCornerIndexStmt>(offload, i);
+        if (pad.second.coefficients[i] > 1) {
+          block_corner = element_block->push_back<BinaryOpStmt>(
+              BinaryOpType::mul, block_corner,
+              element_block->push_back<ConstStmt>(
+                  TypedConstant(pad.second.coefficients[i])));
+        }
+
+        global_index_this_dim = element_block->push_back<BinaryOpStmt>(
+            BinaryOpType::add, global_index_this_dim, block_corner);
+
+        global_indices[i] = global_index_this_dim;
+      }
+      return global_indices;
+    };
+
     // This lambda is used for both BLS prologue and epilogue creation
     auto create_xlogue =
         [&](std::unique_ptr<Block> &block,
@@ -68,6 +118,35 @@ void make_block_local_offload(OffloadedStmt *offload,
             block = std::make_unique<Block>();
             block->parent_stmt = offload;
           }
+
+          if (arch_is_cpu(config.arch)) {
+            // On CPUs, a block is processed by a single thread, which visits
+            // all the BLS elements in a serial loop:
+            //
+            // for bls_element_id in range(bls_num_elements):
+            //   i, j, k = bls_to_global(bls_element_id)
+            //   bls[bls_element_id] = x[i, j, k]
+            auto loop_begin = block->push_back<ConstStmt>(TypedConstant(0));
+            auto loop_end =
+                block->push_back<ConstStmt>(TypedConstant(bls_num_elements));
+            auto loop = block
+                            ->push_back<RangeForStmt>(
+                                loop_begin, loop_end, std::make_unique<Block>(),
+                                /*vectorize=*/1, /*bit_vectorize=*/1,
+                                /*num_cpu_threads=*/1, /*block_dim=*/1,
+                                /*strictly_serialized=*/true)
+                            ->as<RangeForStmt>();
+            auto element_block = loop->body.get();
+            auto bls_element_id =
+                element_block->push_back<LoopIndexStmt>(loop, 0);
+            auto bls_element_offset_bytes =
+                create_bls_element_offset_bytes(element_block, bls_element_id);
+            operation(element_block,
+                      create_global_indices(element_block, bls_element_id),
+                      bls_element_offset_bytes);
+            return;
+          }
+
           // Equivalent to CUDA threadIdx
           Stmt *thread_idx_stmt =
               block->push_back<LoopLinearIndexStmt>(offload);
@@ -112,14 +191,8 @@ void make_block_local_offload(OffloadedStmt *offload,
             auto bls_element_id_this_iteration = block->push_back<BinaryOpStmt>(
                 BinaryOpType::add, loop_offset_stmt, thread_idx_stmt);
 
-            auto bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
-                BinaryOpType::mul, bls_element_id_this_iteration,
-                block->push_back<ConstStmt>(TypedConstant(dtype_size)));
-
-            bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
-                BinaryOpType::add, bls_element_offset_bytes,
-                block->push_back<ConstStmt>(
-                    TypedConstant((int32)bls_offset_in_bytes)));
+            auto bls_element_offset_bytes = create_bls_element_offset_bytes(
+                block.get(), bls_element_id_this_iteration);
 
             if (loop_offset + block_dim > bls_num_elements) {
               // Need to create an IfStmt to safeguard since bls size may not be
@@ -138,42 +211,10 @@ void make_block_local_offload(OffloadedStmt *offload,
               element_block = block.get();
             }
 
-            std::vector<Stmt *> global_indices(dim);
-
-            // Convert bls_element_id to global indices
-            // via a series of % and /.
-            auto bls_element_id_partial = bls_element_id_this_iteration;
-            for (int i = dim - 1; i >= 0; i--) {
-              auto pad_size_stmt = element_block->push_back<ConstStmt>(
-                  TypedConstant(pad.second.pad_size[i]));
-
-              auto bls_coord = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::mod, bls_element_id_partial, pad_size_stmt);
-              bls_element_id_partial = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::div, bls_element_id_partial, pad_size_stmt);
-
-              auto global_index_this_dim =
-                  element_block->push_back<BinaryOpStmt>(
-                      BinaryOpType::add, bls_coord,
-                      element_block->push_back<ConstStmt>(
-                          TypedConstant(pad.second.bounds[i].low)));
-
-              auto block_corner =
-                  element_block->push_back<BlockCornerIndexStmt>(offload, i);
-              if (pad.second.coefficients[i] > 1) {
-                block_corner = element_block->push_back<BinaryOpStmt>(
-                    BinaryOpType::mul, block_corner,
-                    element_block->push_back<ConstStmt>(
-                        TypedConstant(pad.second.coefficients[i])));
-              }
-
-              global_index_this_dim = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::add, global_index_this_dim, block_corner);
-
-              global_indices[i] = global_index_this_dim;
-            }
-
-            operation(element_block, global_indices, bls_element_offset_bytes);
+            operation(element_block,
+                      create_global_indices(element_block,
+                                            bls_element_id_this_iteration),
+                      bls_element_offset_bytes);
             // TODO: do not use GlobalStore for BLS ptr.
 
             loop_offset += block_dim;
@@ -1,7 +1,9 @@
 #include <algorithm>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <type_traits>
+#include <unordered_map>
 
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/ir.h"
@@ -86,7 +88,293 @@ std::vector<T *> find_global_reduction_destinations(
   return valid_reduction_values;
 }
 
-void make_thread_local_offload(OffloadedStmt *offload) {
+template <typename T>
+TypedConstant get_reduction_identity(DataType dt, AtomicOpType op) {
+  if (op == AtomicOpType::min || op == AtomicOpType::max) {
+    constexpr bool has_infinity = std::numeric_limits<T>::has_infinity;
+    if (op == AtomicOpType::min) {
+      return TypedConstant(dt, has_infinity
+                                   ? std::numeric_limits<T>::infinity()
+                                   : std::numeric_limits<T>::max());
+    }
+    return TypedConstant(dt, has_infinity
+                                 ? -std::numeric_limits<T>::infinity()
+                                 : std::numeric_limits<T>::lowest());
+  }
+  if constexpr (std::is_integral_v<T>) {
+    if (op == AtomicOpType::bit_and) {
+      return TypedConstant(dt, ~T(0));
+    }
+  }
+  return TypedConstant(dt, T(0));
+}
+
+TypedConstant get_reduction_identity(DataType dt, AtomicOpType op) {
+  if (dt->is_primitive(PrimitiveTypeID::i32)) {
+    return get_reduction_identity<int32>(dt, op);
+  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+    return get_reduction_identity<int64>(dt, op);
+  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
+    return get_reduction_identity<uint32>(dt, op);
+  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
+    return get_reduction_identity<uint64>(dt, op);
+  } else if (dt->is_primitive(PrimitiveTypeID::f32)) {
+    return get_reduction_identity<float32>(dt, op);
+  } else if (dt->is_primitive(PrimitiveTypeID::f64)) {
+    return get_reduction_identity<float64>(dt, op);
+  }
+  TI_NOT_IMPLEMENTED
+}
+
+bool is_privatizable(AtomicOpType op, DataType dt) {
+  if (!dt->is_primitive(PrimitiveTypeID::i32) &&
+      !dt->is_primitive(PrimitiveTypeID::i64) &&
+      !dt->is_primitive(PrimitiveTypeID::u32) &&
+      !dt->is_primitive(PrimitiveTypeID::u64) &&
+      !dt->is_primitive(PrimitiveTypeID::f32) &&
+      !dt->is_primitive(PrimitiveTypeID::f64)) {
+    return false;
+  }
+  if (op == AtomicOpType::bit_and || op == AtomicOpType::bit_or ||
+      op == AtomicOpType::bit_xor) {
+    return is_integral(dt);
+  }
+  return true;
+}
+
+// The operation combining the partial results of an atomic operation.
+AtomicOpType get_combining_op(AtomicOpType op) {
+  return op == AtomicOpType::sub ? AtomicOpType::add : op;
+}
+
+// Builds the linear index of |indices| in a row-major array of |snode|.
+Stmt *build_linear_index(VecStatement &stmts,
+                         SNode *snode,
+                         const std::vector<Stmt *> &indices) {
+  Stmt *linear = indices[0];
+  for (int i = 1; i < (int)indices.size(); i++) {
+    auto shape = stmts.push_back<ConstStmt>(
+        TypedConstant(snode->shape_along_axis(i)));
+    auto scaled =
+        stmts.push_back<BinaryOpStmt>(BinaryOpType::mul, linear, shape);
+    linear = stmts.push_back<BinaryOpStmt>(BinaryOpType::add, scaled,
+                                           indices[i]);
+  }
+  return linear;
+}
+
+// Pushes a serial loop over [0, |n|) to |block|, and returns the loop index
+// and the body of the loop.
+std::pair<Stmt *, Block *> push_back_serial_loop(Block *block, int n) {
+  auto begin = block->push_back<ConstStmt>(TypedConstant(0));
+  auto end = block->push_back<ConstStmt>(TypedConstant(n));
+  auto loop = block->push_back<RangeForStmt>(
+      begin, end, std::make_unique<Block>(), /*vectorize=*/1,
+      /*bit_vectorize=*/1, /*num_cpu_threads=*/1, /*block_dim=*/1,
+      /*strictly_serialized=*/true);
+  auto body = loop->as<RangeForStmt>()->body.get();
+  auto index = body->push_back<LoopIndexStmt>(loop, 0);
+  return {index, body};
+}
+
+// Returns a pointer to the |index|-th element of type |data_type| in the
+// array at |tls_offset| in the TLS buffer.
+Stmt *push_back_tls_element_ptr(VecStatement &stmts,
+                                std::size_t tls_offset,
+                                DataType data_type,
+                                Stmt *index) {
+  auto tls_ptr = stmts.push_back<ThreadLocalPtrStmt>(
+      tls_offset,
+      TypeFactory::create_vector_or_scalar_type(1, data_type, true));
+  auto element_size = stmts.push_back<ConstStmt>(
+      TypedConstant((int32)data_type_size(data_type)));
+  auto byte_offset =
+      stmts.push_back<BinaryOpStmt>(BinaryOpType::mul, index, element_size);
+  return stmts.push_back<PtrOffsetStmt>(tls_ptr, byte_offset);
+}
+
+// Privatizes atomic operations scattered into small dense fields, e.g.,
+// histograms and particle-to-grid transfers. Each thread accumulates into its
+// own copy of the field in the TLS buffer, initialized to the identity of the
+// operation. The copies of different threads are combined element-wise with
+// the |tls_reductions| of |offload|, and the TLS epilogue then applies the
+// combined values different from the identity to the field.
+void privatize_scattered_atomics(OffloadedStmt *offload,
+                                 const CompileConfig &config,
+                                 std::size_t &tls_offset) {
+  // We use std::vector instead of std::set to keep an deterministic order here.
+  std::vector<SNode *> candidates;
+  std::unordered_map<SNode *, AtomicOpType> ops;
+  std::unordered_map<SNode *, bool> valid;
+  irpass::analysis::gather_statements(offload->body.get(), [&](Stmt *stmt) {
+    auto atomic = stmt->cast<AtomicOpStmt>();
+    if (!atomic || !atomic->dest->is<GlobalPtrStmt>())
+      return false;
+    auto dest = atomic->dest->as<GlobalPtrStmt>();
+    auto snode = dest->snodes[0];
+    if (dest->width() != 1 || snode->type != SNodeType::place ||
+        dest->indices.empty() || !snode->is_path_all_dense ||
+        offload->mem_access_opt.has_flag(snode,
+                                         SNodeAccessFlag::block_local)) {
+      return false;
+    }
+    const auto op = get_combining_op(atomic->op_type);
+    auto it = ops.find(snode);
+    if (it == ops.end()) {
+      candidates.push_back(snode);
+      ops[snode] = op;
+      valid[snode] = is_privatizable(op, snode->dt);
+    } else if (it->second != op) {
+      valid[snode] = false;
+    }
+    return false;
+  });
+  if (candidates.empty())
+    return;
+
+  // The fields must only be accessed by the atomics, whose results must not
+  // be used.
+  std::unordered_map<SNode *, std::vector<GlobalPtrStmt *>> ptrs;
+  irpass::analysis::gather_statements(offload, [&](Stmt *stmt) {
+    if (auto ptr = stmt->cast<GlobalPtrStmt>()) {
+      auto snode = ptr->snodes[0];
+      if (valid.count(snode)) {
+        ptrs[snode].push_back(ptr);
+      }
+    } else if (auto snode_op = stmt->cast<SNodeOpStmt>()) {
+      for (auto snode : candidates) {
+        if (snode->parent == snode_op->snode || snode == snode_op->snode) {
+          valid[snode] = false;
+        }
+      }
+    }
+    for (auto operand : stmt->get_operands()) {
+      if (!operand)
+        continue;
+      if (auto ptr = operand->cast<GlobalPtrStmt>()) {
+        auto snode = ptr->snodes[0];
+        if (!valid.count(snode))
+          continue;
+        auto atomic = stmt->cast<AtomicOpStmt>();
+        if (!atomic || atomic->dest != ptr || atomic->val == ptr ||
+            get_combining_op(atomic->op_type) != ops[snode]) {
+          valid[snode] = false;
+        }
+      } else if (auto atomic = operand->cast<AtomicOpStmt>()) {
+        if (auto dest = atomic->dest->cast<GlobalPtrStmt>()) {
+          if (valid.count(dest->snodes[0])) {
+            valid[dest->snodes[0]] = false;
+          }
+        }
+      }
+    }
+    return false;
+  });
+
+  std::size_t privatized_bytes = 0;
+  for (auto snode : candidates) {
+    if (!valid[snode])
+      continue;
+    // All the pointers are in the body of the offloaded task.
+    const auto &snode_ptrs = ptrs[snode];
+    if (std::any_of(snode_ptrs.begin(), snode_ptrs.end(),
+                    [&](GlobalPtrStmt *ptr) {
+                      return (int)ptr->indices.size() !=
+                             snode->num_active_indices;
+                    })) {
+      continue;
+    }
+    const int num_indices = snode->num_active_indices;
+    int64 num_elements = 1;
+    for (int i = 0; i < num_indices; i++) {
+      num_elements *= snode->shape_along_axis(i);
+    }
+    const auto data_type = snode->dt;
+    const auto dtype_size = data_type_size(data_type);
+    if (privatized_bytes + num_elements * dtype_size >
+        (std::size_t)config.cpu_privatize_atomics_max_bytes) {
+      continue;
+    }
+    privatized_bytes += num_elements * dtype_size;
+    const auto op = ops[snode];
+    const auto identity = get_reduction_identity(data_type, op);
+    tls_offset += (dtype_size - tls_offset % dtype_size) % dtype_size;
+
+    // Step 1:
+    // Fill the private copy with the identity
+    {
+      if (offload->tls_prologue == nullptr) {
+        offload->tls_prologue = std::make_unique<Block>();
+        offload->tls_prologue->parent_stmt = offload;
+      }
+      auto [index, loop_body] =
+          push_back_serial_loop(offload->tls_prologue.get(), num_elements);
+      VecStatement stmts;
+      auto element_ptr =
+          push_back_tls_element_ptr(stmts, tls_offset, data_type, index);
+      auto value = stmts.push_back<ConstStmt>(identity);
+      stmts.push_back<GlobalStoreStmt>(element_ptr, value);
+      loop_body->insert(std::move(stmts));
+    }
+
+    // Step 2:
+    // Make the atomics accumulate to the private copy
+    for (auto ptr : snode_ptrs) {
+      VecStatement stmts;
+      auto linear = build_linear_index(stmts, snode, ptr->indices);
+      push_back_tls_element_ptr(stmts, tls_offset, data_type, linear);
+      ptr->replace_with(std::move(stmts));
+    }
+
+    // Step 3:
+    // Apply the combined private copy to the field
+    {
+      if (offload->tls_epilogue == nullptr) {
+        offload->tls_epilogue = std::make_unique<Block>();
+        offload->tls_epilogue->parent_stmt = offload;
+      }
+      auto [index, loop_body] =
+          push_back_serial_loop(offload->tls_epilogue.get(), num_elements);
+      VecStatement stmts;
+      auto element_ptr =
+          push_back_tls_element_ptr(stmts, tls_offset, data_type, index);
+      auto value = stmts.push_back<GlobalLoadStmt>(element_ptr);
+      auto identity_value = stmts.push_back<ConstStmt>(identity);
+      auto changed = stmts.push_back<BinaryOpStmt>(BinaryOpType::cmp_ne,
+                                                   value, identity_value);
+      auto if_stmt = stmts.push_back<IfStmt>(changed)->as<IfStmt>();
+      loop_body->insert(std::move(stmts));
+
+      auto apply = std::make_unique<Block>();
+      std::vector<Stmt *> indices(num_indices);
+      Stmt *remaining = index;
+      for (int i = num_indices - 1; i >= 0; i--) {
+        if (i == 0) {
+          indices[i] = remaining;
+          break;
+        }
+        auto shape = apply->push_back<ConstStmt>(
+            TypedConstant(snode->shape_along_axis(i)));
+        indices[i] =
+            apply->push_back<BinaryOpStmt>(BinaryOpType::mod, remaining, shape);
+        remaining = apply->push_back<BinaryOpStmt>(BinaryOpType::div,
+                                                   remaining, shape);
+      }
+      auto global_ptr =
+          apply->push_back<GlobalPtrStmt>(LaneAttribute<SNode *>(snode),
+                                          indices);
+      apply->insert(AtomicOpStmt::make_for_reduction(op, global_ptr, value));
+      if_stmt->set_true_statements(std::move(apply));
+    }
+
+    offload->tls_reductions.push_back(
+        {tls_offset, (int)num_elements, data_type, op});
+    tls_offset += num_elements * dtype_size;
+  }
+}
+
+void make_thread_local_offload(OffloadedStmt *offload,
+                               const CompileConfig &config) {
   if (offload->task_type != OffloadedTaskType::range_for &&
       offload->task_type != OffloadedTaskType::struct_for)
     return;
@@ -97,10 +385,11 @@ void make_thread_local_offload(OffloadedStmt *offload) {
         offload, [](GlobalPtrStmt *dest) {
           // We can only optimized reductions to global ptrs with form like
           // loss[None] (0-D fields) for now.
-          // No TLS on CustomInt/FloatType.
+          // No TLS on CustomInt/FloatType or f16.
           return (dest->snodes[0]->type == SNodeType::place) &&
                  dest->indices.empty() &&
-                 dest->snodes[0]->dt->is<PrimitiveType>();
+                 dest->snodes[0]->dt->is<PrimitiveType>() &&
+                 !dest->snodes[0]->dt->is_primitive(PrimitiveTypeID::f16);
         });
     auto valid_global_tmps =
         find_global_reduction_destinations<GlobalTemporaryStmt>(
@@ -173,10 +462,16 @@ void make_thread_local_offload(OffloadedStmt *offload) {
           -1);
     }
 
+    offload->tls_reductions.push_back(
+        {tls_offset, 1, data_type, AtomicOpType::add});
     // allocate storage for the TLS variable
     tls_offset += dtype_size;
   }
 
+  if (config.cpu_privatize_atomics && arch_is_cpu(offload->device)) {
+    privatize_scattered_atomics(offload, config, tls_offset);
+  }
+
   offload->tls_size = std::max(std::size_t(1), tls_offset);
 }
 
@@ -189,10 +484,10 @@ void make_thread_local(IRNode *root, const CompileConfig &config) {
   TI_AUTO_PROF;
   if (auto root_block = root->cast<Block>()) {
     for (auto &offload : root_block->statements) {
-      make_thread_local_offload(offload->cast<OffloadedStmt>());
+      make_thread_local_offload(offload->cast<OffloadedStmt>(), config);
     }
   } else {
-    make_thread_local_offload(root->as<OffloadedStmt>());
+    make_thread_local_offload(root->as<OffloadedStmt>(), config);
   }
   type_check(root, config);
 }
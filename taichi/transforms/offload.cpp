@@ -164,6 +164,8 @@ class Offloader {
             std::min(snode_child->max_num_elements(),
                      (int64)std::min(Program::default_block_dim(config),
                                      config.max_block_dim));
+        offloaded_listgen->num_cpu_threads =
+            std::min(for_stmt->num_cpu_threads, config.cpu_max_num_threads);
         root_block->insert(std::move(offloaded_listgen));
       }
     }
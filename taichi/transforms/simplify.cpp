@@ -610,12 +610,13 @@ bool simplify(IRNode *root, const CompileConfig &config) {
   return modified;
 }
 
-void full_simplify(IRNode *root,
+bool full_simplify(IRNode *root,
                    const CompileConfig &config,
                    const FullSimplifyPass::Args &args) {
   TI_AUTO_PROF;
   if (config.advanced_optimization) {
     bool first_iteration = true;
+    bool ever_modified = false;
     while (true) {
       bool modified = false;
       if (extract_constant(root, config))
@@ -648,13 +649,20 @@ void full_simplify(IRNode *root,
       first_iteration = false;
       if (!modified)
         break;
+      ever_modified = true;
     }
-    return;
+    return ever_modified;
   }
-  constant_fold(root, config, {args.program});
-  die(root);
-  simplify(root, config);
-  die(root);
+  bool modified = false;
+  if (constant_fold(root, config, {args.program}))
+    modified = true;
+  if (die(root))
+    modified = true;
+  if (simplify(root, config))
+    modified = true;
+  if (die(root))
+    modified = true;
+  return modified;
 }
 
 }  // namespace irpass
@@ -16,13 +16,16 @@ class TypeCheck : public IRVisitor {
   CompileConfig config;
 
  public:
+  bool modified{false};
+
   explicit TypeCheck(const CompileConfig &config) : config(config) {
     allow_undefined_visitor = true;
   }
 
-  static void mark_as_if_const(Stmt *stmt, DataType t) {
-    if (stmt->is<ConstStmt>()) {
+  void mark_as_if_const(Stmt *stmt, DataType t) {
+    if (stmt->is<ConstStmt>() && stmt->ret_type != t) {
       stmt->ret_type = t;
+      modified = true;
     }
   }
 
@@ -52,8 +55,13 @@ class TypeCheck : public IRVisitor {
     for (auto &stmt : stmt_list->statements) {
       stmts.push_back(stmt.get());
     }
-    for (auto stmt : stmts)
+    for (auto stmt : stmts) {
+      auto old_ret_type = stmt->ret_type;
       stmt->accept(this);
+      if (stmt->ret_type != old_ret_type) {
+        modified = true;
+      }
+    }
   }
 
   void visit(AtomicOpStmt *stmt) override {
@@ -64,6 +72,8 @@ class TypeCheck : public IRVisitor {
       dst_type = cit->get_compute_type();
     } else if (auto cft = dst_type->cast<CustomFloatType>()) {
       dst_type = cft->get_compute_type();
+    } else if (dst_type->is_primitive(PrimitiveTypeID::f16)) {
+      dst_type = dst_type->get_compute_type();
     }
     if (stmt->val->ret_type != dst_type) {
       TI_WARN("[{}] Atomic add ({} to {}) may lose precision, at", stmt->name(),
@@ -129,6 +139,7 @@ class TypeCheck : public IRVisitor {
     if (stmt->dest->ret_type->is_primitive(PrimitiveTypeID::unknown)) {
       // Infer data type for alloca
       stmt->dest->ret_type = stmt->val->ret_type;
+      modified = true;
     }
     auto common_container_type =
         promoted_type(stmt->dest->ret_type, stmt->val->ret_type);
@@ -247,6 +258,11 @@ class TypeCheck : public IRVisitor {
   }
 
   void visit(UnaryOpStmt *stmt) override {
+    if (!stmt->is_cast() &&
+        stmt->operand->ret_type->is_primitive(PrimitiveTypeID::f16)) {
+      stmt->operand = insert_type_cast_before(stmt, stmt->operand,
+                                              PrimitiveType::f32);
+    }
     stmt->ret_type = stmt->operand->ret_type;
     if (stmt->is_cast()) {
       stmt->ret_type = stmt->cast_type;
@@ -276,6 +292,7 @@ class TypeCheck : public IRVisitor {
     cast_stmt->accept(this);
     auto stmt = cast_stmt.get();
     anchor->insert_before_me(std::move(cast_stmt));
+    modified = true;
     return stmt;
   }
 
@@ -288,6 +305,7 @@ class TypeCheck : public IRVisitor {
     cast_stmt->accept(this);
     auto stmt = cast_stmt.get();
     anchor->insert_after_me(std::move(cast_stmt));
+    modified = true;
     return stmt;
   }
 
@@ -326,6 +344,7 @@ class TypeCheck : public IRVisitor {
         cast(stmt->rhs, default_fp);
       }
       stmt->op_type = BinaryOpType::div;
+      modified = true;
     }
 
     if (stmt->lhs->ret_type != stmt->rhs->ret_type) {
@@ -423,11 +442,20 @@ class TypeCheck : public IRVisitor {
     // verification, without modifying any types.
     TI_ASSERT(rt != PrimitiveType::unknown);
     TI_ASSERT(rt->vector_width() == 1);
+    if (!stmt->is_ptr && rt->is_primitive(PrimitiveTypeID::f16)) {
+      // f16 arguments are passed as f32, see Callable::insert_arg().
+      stmt->ret_type = PrimitiveType::f32;
+    }
     stmt->ret_type.set_is_pointer(stmt->is_ptr);
   }
 
   void visit(ReturnStmt *stmt) override {
     // TODO: Support stmt->ret_id?
+    if (stmt->value->ret_type->is_primitive(PrimitiveTypeID::f16)) {
+      // f16 values are returned as f32, see Callable::insert_ret().
+      stmt->value =
+          insert_type_cast_before(stmt, stmt->value, PrimitiveType::f32);
+    }
     stmt->ret_type = stmt->value->ret_type;
     TI_ASSERT(stmt->ret_type->vector_width() == 1);
   }
@@ -561,11 +589,12 @@ class TypeCheck : public IRVisitor {
 
 namespace irpass {
 
-void type_check(IRNode *root, const CompileConfig &config) {
+bool type_check(IRNode *root, const CompileConfig &config) {
   TI_AUTO_PROF;
   analysis::check_fields_registered(root);
   TypeCheck inst(config);
   root->accept(&inst);
+  return inst.modified;
 }
 
 }  // namespace irpass
@@ -179,6 +179,9 @@ class Bitset {
   bool any() const;
   bool none() const;
   reference operator[](int x);
+  bool test(int x) const;
+  bool operator==(const Bitset &other) const;
+  bool operator!=(const Bitset &other) const;
   Bitset &operator&=(const Bitset &other);
   Bitset operator&(const Bitset &other) const;
   Bitset &operator|=(const Bitset &other);
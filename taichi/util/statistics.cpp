@@ -5,6 +5,7 @@ TI_NAMESPACE_BEGIN
 Statistics stat;
 
 void Statistics::add(std::string key, Statistics::value_type value) {
+  std::lock_guard<std::mutex> _(mut_);
   counters_[key] += value;
 }
 
@@ -27,6 +28,7 @@ void Statistics::print(std::string *output) {
 }
 
 void Statistics::clear() {
+  std::lock_guard<std::mutex> _(mut_);
   counters_.clear();
 }
 
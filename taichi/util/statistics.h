@@ -1,3 +1,4 @@
+#include <mutex>
 #include <unordered_map>
 
 #include "taichi/common/core.h"
@@ -23,6 +24,8 @@ class Statistics {
 
  private:
   counters_map counters_;
+  // Kernels may be compiled on multiple threads.
+  std::mutex mut_;
 };
 
 extern Statistics stat;
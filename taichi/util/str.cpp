@@ -6,6 +6,22 @@
 
 TLANG_NAMESPACE_BEGIN
 
+namespace {
+
+constexpr uint64 kFnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64 kFnvPrime = 1099511628211ULL;
+
+uint64 fnv1a(const std::string &data, uint64 seed) {
+  uint64 ret = seed;
+  for (auto c : data) {
+    ret ^= (uint64)(uint8)c;
+    ret *= kFnvPrime;
+  }
+  return ret;
+}
+
+}  // namespace
+
 std::string c_quoted(std::string const &str) {
   // https://zh.cppreference.com/w/cpp/language/escape
   std::stringstream ss;
@@ -34,6 +50,37 @@ std::string c_quoted(std::string const &str) {
   return ss.str();
 }
 
+std::string json_quoted(std::string const &str) {
+  std::string ret = "\"";
+  for (auto c : str) {
+    switch (c) {
+      case '"':
+        ret += "\\\"";
+        break;
+      case '\\':
+        ret += "\\\\";
+        break;
+      case '\n':
+        ret += "\\n";
+        break;
+      case '\r':
+        ret += "\\r";
+        break;
+      case '\t':
+        ret += "\\t";
+        break;
+      default:
+        if ((uint8)c < 0x20) {
+          ret += fmt::format("\\u{:04x}", (int)c);
+        } else {
+          ret += c;
+        }
+    }
+  }
+  ret += '"';
+  return ret;
+}
+
 std::string format_error_message(const std::string &error_message_template,
                                  const std::function<uint64(int)> &fetcher) {
   std::string error_message_formatted;
@@ -60,4 +107,10 @@ std::string format_error_message(const std::string &error_message_template,
   return error_message_formatted;
 }
 
+std::string content_digest(const std::string &data) {
+  // Two independent 64-bit hashes.
+  return fmt::format("{:016x}{:016x}", fnv1a(data, kFnvOffsetBasis),
+                     fnv1a(data, kFnvOffsetBasis ^ 0x9e3779b97f4a7c15ULL));
+}
+
 TLANG_NAMESPACE_END
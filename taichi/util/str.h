@@ -10,7 +10,15 @@ TLANG_NAMESPACE_BEGIN
 // Quote |str| with a pair of ". Escape special characters like \n, \t etc.
 std::string c_quoted(std::string const &str);
 
+// Quote |str| as a JSON string. Escape ", \ and control characters.
+std::string json_quoted(std::string const &str);
+
 std::string format_error_message(const std::string &error_message_template,
                                  const std::function<uint64(int)> &fetcher);
 
+// Returns a 128-bit hex digest of |data|, which is stable across processes
+// and platforms. Not cryptographic: callers keying on-disk caches with it
+// should also guard against collisions.
+std::string content_digest(const std::string &data);
+
 TLANG_NAMESPACE_END
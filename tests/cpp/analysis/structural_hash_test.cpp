@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+struct TestBlock {
+  std::unique_ptr<Block> block;
+  IfStmt *if_stmt{nullptr};
+};
+
+// Builds
+//   $0 = global tmp 0
+//   $1 = load $0
+//   $2 = const |c|
+//   if $2 { $1 |op| const 1 } else { $1 |op| const 1 }
+TestBlock make_block(int c, BinaryOpType op = BinaryOpType::add) {
+  TestBlock ret;
+  ret.block = std::make_unique<Block>();
+  auto &block = ret.block;
+  auto addr = block->push_back<GlobalTemporaryStmt>(
+      0, TypeFactory::create_vector_or_scalar_type(1, PrimitiveType::i32));
+  auto load = block->push_back<GlobalLoadStmt>(addr);
+  auto cond = block->push_back<ConstStmt>(TypedConstant(c));
+  ret.if_stmt = block->push_back<IfStmt>(cond)->as<IfStmt>();
+
+  auto make_clause = [&]() {
+    auto clause = std::make_unique<Block>();
+    auto one = clause->push_back<ConstStmt>(TypedConstant(1));
+    clause->push_back<BinaryOpStmt>(op, load, one);
+    return clause;
+  };
+  ret.if_stmt->set_true_statements(make_clause());
+  ret.if_stmt->set_false_statements(make_clause());
+
+  irpass::type_check(block.get(), CompileConfig());
+  return ret;
+}
+
+}  // namespace
+
+TEST(StructuralHash, SameStructure) {
+  auto a = make_block(1);
+  auto b = make_block(1);
+  const auto hash_a = irpass::analysis::structural_hash(a.block.get());
+  EXPECT_EQ(hash_a, irpass::analysis::structural_hash(b.block.get()));
+
+  // Statement ids do not matter.
+  irpass::re_id(a.block.get());
+  EXPECT_EQ(hash_a, irpass::analysis::structural_hash(a.block.get()));
+  auto cloned = irpass::analysis::clone(a.block.get());
+  EXPECT_EQ(hash_a, irpass::analysis::structural_hash(cloned.get()));
+
+  // Both clauses refer to the same outer statement.
+  EXPECT_EQ(
+      irpass::analysis::structural_hash(a.if_stmt->true_statements.get()),
+      irpass::analysis::structural_hash(a.if_stmt->false_statements.get()));
+}
+
+TEST(StructuralHash, DifferentStructure) {
+  const auto hash =
+      irpass::analysis::structural_hash(make_block(1).block.get());
+  // Different constant
+  EXPECT_NE(hash, irpass::analysis::structural_hash(make_block(2).block.get()));
+  // Different field
+  EXPECT_NE(hash, irpass::analysis::structural_hash(
+                      make_block(1, BinaryOpType::mul).block.get()));
+
+  // Different operand
+  auto a = make_block(1);
+  auto clause = a.if_stmt->false_statements.get();
+  auto add = clause->statements[1]->as<BinaryOpStmt>();
+  add->rhs = add->lhs;
+  EXPECT_NE(hash, irpass::analysis::structural_hash(a.block.get()));
+}
+
+TEST(StructuralHash, BlockHashCache) {
+  auto a = make_block(1);
+  std::unordered_map<const Block *, uint64> cache;
+  const auto hash = irpass::analysis::structural_hash(a.block.get(), &cache);
+  EXPECT_EQ(hash, irpass::analysis::structural_hash(a.block.get()));
+  EXPECT_EQ(cache.size(), 3);
+  EXPECT_EQ(cache.at(a.if_stmt->true_statements.get()),
+            cache.at(a.if_stmt->false_statements.get()));
+  EXPECT_EQ(hash, irpass::analysis::structural_hash(a.block.get(), &cache));
+}
+
+TEST(StructuralHash, TypedConstantHash) {
+  // Bits beyond the size of the type do not change the hash.
+  TypedConstant a(PrimitiveType::u8), b(PrimitiveType::u8);
+  a.val_u64 = 0x1234;
+  b.val_u64 = 0x5634;
+  EXPECT_TRUE(a.equal_type_and_value(b));
+  EXPECT_EQ(a.hash(), b.hash());
+  b.val_u8 = 0x35;
+  EXPECT_NE(a.hash(), b.hash());
+
+  // Types without a dedicated case are hashed by value as well.
+  TypedConstant h0(PrimitiveType::f16), h1(PrimitiveType::f16);
+  h0.val_u16 = 0x3c00;
+  h1.val_u16 = 0x4000;
+  EXPECT_NE(h0.hash(), h1.hash());
+
+  EXPECT_EQ(TypedConstant(0.0f).hash(), TypedConstant(-0.0f).hash());
+  EXPECT_EQ(TypedConstant(0.0).hash(), TypedConstant(-0.0).hash());
+  EXPECT_NE(TypedConstant(1.0f).hash(), TypedConstant(2.0f).hash());
+}
+
+}  // namespace lang
+}  // namespace taichi
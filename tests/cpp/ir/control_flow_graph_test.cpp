@@ -0,0 +1,135 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/control_flow_graph.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+CFGNode *find_node(ControlFlowGraph *cfg, Stmt *stmt) {
+  for (auto &node : cfg->nodes) {
+    if (node->block == stmt->parent) {
+      const int location = stmt->parent->locate(stmt);
+      if (location >= node->begin_location && location < node->end_location) {
+        return node.get();
+      }
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(StmtBitSet, Basic) {
+  IRBuilder builder;
+  auto *a = builder.get_int32(1);
+  auto *b = builder.get_int32(2);
+  auto *c = builder.get_int32(3);
+
+  StmtNumbering numbering;
+  EXPECT_EQ(numbering.insert(a), 0);
+  EXPECT_EQ(numbering.insert(b), 1);
+  EXPECT_EQ(numbering.insert(a), 0);
+  EXPECT_EQ(numbering.find(c), -1);
+  EXPECT_EQ(numbering.size(), 2);
+
+  StmtBitSet set(&numbering);
+  EXPECT_TRUE(set.empty());
+  set.insert(b);
+  EXPECT_FALSE(set.empty());
+  EXPECT_EQ(set.count(a), 0);
+  EXPECT_EQ(set.count(b), 1);
+  EXPECT_EQ(set.count(c), 0);
+  std::vector<Stmt *> stmts(set.begin(), set.end());
+  EXPECT_EQ(stmts, std::vector<Stmt *>{b});
+  set.clear();
+  EXPECT_TRUE(set.empty());
+}
+
+TEST(ControlFlowGraph, ReachingDefinitions) {
+  IRBuilder builder;
+  auto *x = builder.create_local_var(PrimitiveType::i32);
+  auto *y = builder.create_local_var(PrimitiveType::i32);
+  builder.create_local_store(x, builder.get_int32(1));
+  auto *if_stmt = builder.create_if(builder.get_int32(1));
+  {
+    auto _ = builder.get_if_guard(if_stmt, /*true_branch=*/true);
+    builder.create_local_store(x, builder.get_int32(2));
+  }
+  {
+    auto _ = builder.get_if_guard(if_stmt, /*true_branch=*/false);
+    builder.create_local_store(y, builder.get_int32(3));
+  }
+  auto *load = builder.create_local_load(x);
+
+  auto ir = builder.extract_ir();
+  auto stores = irpass::analysis::gather_statements(
+      ir.get(), [](Stmt *stmt) { return stmt->is<LocalStoreStmt>(); });
+  ASSERT_EQ(stores.size(), 3);
+  auto *store_x1 = stores[0];
+  auto *store_x2 = stores[1];
+  auto *store_y3 = stores[2];
+  ASSERT_EQ(store_x2->parent, if_stmt->true_statements.get());
+
+  auto cfg = irpass::analysis::build_cfg(ir.get());
+  cfg->reaching_definition_analysis(/*after_lower_access=*/true);
+
+  auto *true_branch = find_node(cfg.get(), store_x2);
+  ASSERT_NE(true_branch, nullptr);
+  EXPECT_EQ(true_branch->reach_in.count(store_x1), 1);
+  EXPECT_EQ(true_branch->reach_out.count(store_x1), 0);
+  EXPECT_EQ(true_branch->reach_out.count(store_x2), 1);
+
+  auto *load_node = find_node(cfg.get(), load);
+  ASSERT_NE(load_node, nullptr);
+  std::vector<Stmt *> reach_in(load_node->reach_in.begin(),
+                               load_node->reach_in.end());
+  // y is initialized by its alloca when the true branch is taken.
+  EXPECT_EQ(reach_in.size(), 4);
+  EXPECT_EQ(load_node->reach_in.count(store_x1), 1);
+  EXPECT_EQ(load_node->reach_in.count(store_x2), 1);
+  EXPECT_EQ(load_node->reach_in.count(store_y3), 1);
+  EXPECT_EQ(load_node->reach_in.count(y), 1);
+  EXPECT_EQ(load_node->reach_in.count(x), 0);
+}
+
+TEST(ControlFlowGraph, LiveVariables) {
+  IRBuilder builder;
+  auto *x = builder.create_local_var(PrimitiveType::i32);
+  auto *y = builder.create_local_var(PrimitiveType::i32);
+  builder.create_local_store(x, builder.get_int32(1));
+  builder.create_local_store(y, builder.get_int32(1));
+  auto *if_stmt = builder.create_if(builder.get_int32(1));
+  {
+    auto _ = builder.get_if_guard(if_stmt, /*true_branch=*/true);
+    builder.create_local_load(x);
+    builder.create_local_store(y, builder.get_int32(2));
+  }
+  auto *load_y = builder.create_local_load(y);
+
+  auto ir = builder.extract_ir();
+  auto cfg = irpass::analysis::build_cfg(ir.get());
+  cfg->live_variable_analysis(/*after_lower_access=*/true,
+                              /*config_opt=*/std::nullopt);
+
+  auto *entry = find_node(cfg.get(), x);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->live_out.count(x), 1);
+  EXPECT_EQ(entry->live_out.count(y), 1);
+
+  auto *true_branch =
+      find_node(cfg.get(), if_stmt->true_statements->statements[0].get());
+  ASSERT_NE(true_branch, nullptr);
+  // y is stored before it is loaded.
+  EXPECT_EQ(true_branch->live_in.count(x), 1);
+  EXPECT_EQ(true_branch->live_in.count(y), 0);
+  EXPECT_EQ(true_branch->live_out.count(x), 0);
+  EXPECT_EQ(true_branch->live_out.count(y), 1);
+  EXPECT_EQ(find_node(cfg.get(), load_y)->live_out.count(y), 0);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/pass.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+class TestAnalysisPass : public Pass {
+ public:
+  static const PassID id;
+
+  using Result = int;
+};
+
+const PassID TestAnalysisPass::id = "TestAnalysisPass";
+
+class TestPreservedAnalysisPass : public Pass {
+ public:
+  static const PassID id;
+
+  using Result = int;
+};
+
+const PassID TestPreservedAnalysisPass::id = "TestPreservedAnalysisPass";
+
+}  // namespace
+
+TEST(PassManager, SkipIfUnmodified) {
+  PassManager pm("test");
+  int runs = 0;
+  auto idempotent = [&]() {
+    runs++;
+    return runs == 1;
+  };
+  EXPECT_TRUE(pm.run_if_modified("idempotent", idempotent));
+  EXPECT_EQ(runs, 1);
+  // Modified the IR itself, and the IR is not modified since then.
+  EXPECT_FALSE(pm.run_if_modified("idempotent", idempotent));
+  EXPECT_EQ(runs, 1);
+
+  // A pass returning false does not modify the IR.
+  EXPECT_FALSE(pm.run("unmodified", []() { return false; }));
+  EXPECT_FALSE(pm.run_if_modified("idempotent", idempotent));
+  EXPECT_EQ(runs, 1);
+
+  // A pass returning void is assumed to modify the IR.
+  EXPECT_TRUE(pm.run("void", []() {}));
+  EXPECT_FALSE(pm.run_if_modified("idempotent", idempotent));
+  EXPECT_EQ(runs, 2);
+
+  pm.invalidate();
+  EXPECT_FALSE(pm.run_if_modified("idempotent", idempotent));
+  EXPECT_EQ(runs, 3);
+
+  const auto &records = pm.get_records();
+  ASSERT_EQ(records.size(), 7);
+  EXPECT_TRUE(records[1].skipped);
+  EXPECT_FALSE(records[2].modified);
+  EXPECT_TRUE(records[4].modified);
+  EXPECT_FALSE(records[5].skipped);
+}
+
+TEST(PassManager, RunAnalysis) {
+  PassManager pm("test");
+  int runs = 0;
+  auto analysis = [&]() { runs++; };
+  pm.run_analysis("analysis", analysis);
+  pm.run_analysis("analysis", analysis);
+  EXPECT_EQ(runs, 1);
+  pm.run("void", []() {});
+  pm.run_analysis("analysis", analysis);
+  EXPECT_EQ(runs, 2);
+}
+
+TEST(PassManager, InvalidateAnalyses) {
+  PassManager pm("test");
+  auto *amgr = pm.get_analysis_manager();
+  amgr->put_pass_result<TestAnalysisPass>(1);
+  amgr->put_pass_result<TestPreservedAnalysisPass>(2);
+  amgr->preserve<TestPreservedAnalysisPass>();
+
+  pm.run("unmodified", []() { return false; });
+  ASSERT_NE(amgr->get_pass_result<TestAnalysisPass>(), nullptr);
+  EXPECT_EQ(*amgr->get_pass_result<TestAnalysisPass>(), 1);
+
+  pm.run("modified", []() { return true; });
+  EXPECT_EQ(amgr->get_pass_result<TestAnalysisPass>(), nullptr);
+  ASSERT_NE(amgr->get_pass_result<TestPreservedAnalysisPass>(), nullptr);
+  EXPECT_EQ(*amgr->get_pass_result<TestPreservedAnalysisPass>(), 2);
+}
+
+TEST(PassManager, ProfiledIRSize) {
+  IRBuilder builder;
+  builder.get_int32(1);
+  auto ir = builder.extract_ir();
+  auto *block = ir->as<Block>();
+
+  PassManager pm("test");
+  pm.set_profiled_ir(ir.get());
+  pm.run("insert", [&]() {
+    block->insert(Stmt::make<ConstStmt>(TypedConstant(2)));
+  });
+  pm.run("unmodified", []() { return false; });
+
+  const auto &records = pm.get_records();
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(records[0].stmts_before, 1);
+  EXPECT_EQ(records[0].stmts_after, 2);
+  EXPECT_EQ(records[1].stmts_before, 2);
+  EXPECT_EQ(records[1].stmts_after, 2);
+}
+
+TEST(PassManager, TypeCheckReportsTruedivLowering) {
+  IRBuilder builder;
+  auto *lhs = builder.get_float32(1.0f);
+  auto *rhs = builder.get_float32(2.0f);
+  auto *div = builder.create_truediv(lhs, rhs);
+  auto ir = builder.extract_ir();
+
+  CompileConfig config;
+  irpass::type_check(ir.get(), config);
+  EXPECT_EQ(div->op_type, BinaryOpType::div);
+  EXPECT_FALSE(irpass::type_check(ir.get(), config));
+
+  // Only the op type changes here, since the operands and the result are
+  // already f32.
+  div->op_type = BinaryOpType::truediv;
+  EXPECT_TRUE(irpass::type_check(ir.get(), config));
+  EXPECT_EQ(div->op_type, BinaryOpType::div);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "taichi/program/compile_profiler.h"
+
+namespace taichi {
+namespace lang {
+
+TEST(CompileProfiler, SaveEscapesNames) {
+  auto &profiler = CompileProfiler::get_instance();
+  const bool enabled = profiler.get_enabled();
+  profiler.set_enabled(true);
+  profiler.clear();
+
+  CompileProfiler::Event event;
+  event.kernel = "k\"1\\";
+  event.name = "pass\n";
+  event.category = "ir_pass";
+  event.seconds = 0.5;
+  profiler.insert_event(event);
+
+  const std::string filename = "compile_profiler_test.json";
+  profiler.save(filename);
+  profiler.clear();
+  profiler.set_enabled(enabled);
+
+  std::ifstream fin(filename);
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  fin.close();
+  std::remove(filename.c_str());
+  const auto content = ss.str();
+  EXPECT_NE(content.find(R"("name":"k\"1\\")"), std::string::npos);
+  EXPECT_NE(content.find(R"("name":"pass\n")"), std::string::npos);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+
+#include "taichi/program/async_engine.h"
+
+namespace taichi {
+namespace lang {
+
+TEST(DagExecutor, CreateAndDestruct) {
+  DagExecutor exec("test", 4, /*num_threads_per_slot=*/0);
+  EXPECT_EQ(exec.get_num_slots(), 4);
+}
+
+TEST(DagExecutor, Dependencies) {
+  // A diamond repeated in a chain: 3i -> {3i+1, 3i+2} -> 3i+3 -> ...
+  constexpr int n = 30;
+  std::vector<int> finish_order;
+  std::mutex mut;
+  std::vector<DagExecutor::Task> tasks(n);
+  for (int i = 0; i < n; i++) {
+    tasks[i].name = fmt::format("task_{}", i);
+    tasks[i].func = [i, &finish_order, &mut]() {
+      std::lock_guard<std::mutex> _(mut);
+      finish_order.push_back(i);
+    };
+    if (i % 3 == 0 && i > 0) {
+      tasks[i].deps = {i - 2, i - 1};
+    } else if (i % 3 != 0) {
+      tasks[i].deps = {i - i % 3};
+    }
+  }
+  DagExecutor exec("test", 4, /*num_threads_per_slot=*/0);
+  exec.run(tasks);
+  ASSERT_EQ(finish_order.size(), n);
+  std::vector<int> position(n);
+  for (int i = 0; i < n; i++) {
+    position[finish_order[i]] = i;
+  }
+  for (int i = 0; i < n; i++) {
+    for (int dep : tasks[i].deps) {
+      EXPECT_LT(position[dep], position[i]);
+    }
+  }
+}
+
+TEST(DagExecutor, Concurrency) {
+  // Independent tasks that can only finish if all of them run at once.
+  constexpr int n = 4;
+  std::atomic<int> num_started{0};
+  std::vector<DagExecutor::Task> tasks(n);
+  for (int i = 0; i < n; i++) {
+    tasks[i].name = fmt::format("task_{}", i);
+    tasks[i].func = [&num_started]() {
+      num_started++;
+      while (num_started < n) {
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+      }
+    };
+  }
+  DagExecutor exec("test", n, /*num_threads_per_slot=*/1);
+  exec.run(tasks);
+  EXPECT_EQ(exec.get_peak_concurrency(), n);
+
+  // A chain never runs two tasks at once.
+  for (int i = 1; i < n; i++) {
+    tasks[i].deps = {i - 1};
+    tasks[i].func = []() {};
+  }
+  tasks[0].func = []() {};
+  exec.run(tasks);
+  EXPECT_EQ(exec.get_peak_concurrency(), 1);
+}
+
+TEST(DagExecutor, ThreadPoolPartitions) {
+  constexpr int num_slots = 2;
+  constexpr int num_threads_per_slot = 3;
+  std::atomic<int> num_started{0};
+  std::vector<std::set<int>> thread_ids(num_slots);
+  std::vector<DagExecutor::Task> tasks(num_slots);
+  ThreadPool default_pool(num_slots * num_threads_per_slot);
+  for (int i = 0; i < num_slots; i++) {
+    tasks[i].name = fmt::format("task_{}", i);
+    tasks[i].func = [&, i]() {
+      // Makes sure that the tasks run on different slots.
+      num_started++;
+      while (num_started < num_slots) {
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+      }
+      // Kernels reach the pool through LLVMRuntime::parallel_for.
+      ThreadPool::static_run(
+          &default_pool, 64, num_slots * num_threads_per_slot, &thread_ids[i],
+          [](void *ctx, int thread_id, int) {
+            static std::mutex m;
+            std::lock_guard<std::mutex> _(m);
+            ((std::set<int> *)ctx)->insert(thread_id);
+          });
+    };
+  }
+  DagExecutor exec("test", num_slots, num_threads_per_slot);
+  exec.run(tasks);
+  std::set<int> all_ids;
+  for (auto &ids : thread_ids) {
+    for (int id : ids) {
+      EXPECT_GE(id, 0);
+      EXPECT_LT(id, num_slots * num_threads_per_slot);
+      // The partitions never share a thread id.
+      EXPECT_TRUE(all_ids.insert(id).second);
+    }
+  }
+}
+
+}  // namespace lang
+}  // namespace taichi
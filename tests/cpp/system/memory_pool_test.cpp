@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <thread>
+
+#include "taichi/system/memory_pool.h"
+
+namespace taichi {
+namespace lang {
+
+TEST(MemoryPool, DirectAllocation) {
+  MemoryPool pool(Arch::x64);
+  auto *a = (uint8 *)pool.allocate(100, 64);
+  auto *b = (uint8 *)pool.allocate(1000, 4096);
+  EXPECT_EQ((std::size_t)a % 64, 0);
+  EXPECT_EQ((std::size_t)b % 4096, 0);
+  EXPECT_GE(b, a + 100);
+  // No daemon is needed without a request queue.
+  EXPECT_EQ(pool.th, nullptr);
+  pool.wake();
+  EXPECT_FALSE(pool.woken);
+  const auto stats = pool.get_stats();
+  EXPECT_EQ(stats.num_requests, 2);
+  EXPECT_EQ(stats.num_bytes, 1100);
+  EXPECT_GE(stats.max_latency, 0);
+  pool.terminate();
+}
+
+TEST(MemoryPool, QueuedRequests) {
+  MemoryPool pool(Arch::x64);
+  auto queue = std::make_unique<MemRequestQueue>();
+  std::memset(queue.get(), 0, sizeof(MemRequestQueue));
+  pool.set_queue(queue.get());
+  ASSERT_NE(pool.th, nullptr);
+
+  constexpr int kNumRequests = 10;
+  for (int i = 0; i < kNumRequests; i++) {
+    // Mimic LLVMRuntime::request_allocate_aligned.
+    auto *r = (volatile MemRequest *)&queue->requests[i];
+    r->size = 128 * (i + 1);
+    r->alignment = 128;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    ((volatile MemRequestQueue *)queue.get())->tail = i + 1;
+    while (r->ptr == nullptr) {
+      std::this_thread::yield();
+    }
+    EXPECT_EQ((std::size_t)r->ptr % 128, 0);
+  }
+  const auto stats = pool.get_stats();
+  EXPECT_EQ(stats.num_requests, kNumRequests);
+  // The daemon polls quickly right after serving a request.
+  EXPECT_LT(stats.total_latency / kNumRequests, 0.1);
+
+  // Let the daemon back off, then wake it up as a kernel launch does.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  pool.wake();
+  auto *r = (volatile MemRequest *)&queue->requests[kNumRequests];
+  r->size = 128;
+  r->alignment = 128;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  ((volatile MemRequestQueue *)queue.get())->tail = kNumRequests + 1;
+  while (r->ptr == nullptr) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(pool.get_stats().num_requests, kNumRequests + 1);
+  pool.terminate();
+  EXPECT_TRUE(pool.killed);
+}
+
+}  // namespace lang
+}  // namespace taichi
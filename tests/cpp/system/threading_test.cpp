@@ -0,0 +1,75 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <vector>
+
+#include "taichi/system/threading.h"
+
+namespace taichi {
+
+namespace {
+struct CountContext {
+  std::vector<std::atomic<int>> hits;
+  std::atomic<int> max_thread_id{-1};
+
+  explicit CountContext(int n) : hits(n) {
+    for (auto &h : hits)
+      h = 0;
+  }
+};
+
+void count_task(void *ctx_, int thread_id, int i) {
+  auto ctx = (CountContext *)ctx_;
+  ctx->hits[i]++;
+  int old = ctx->max_thread_id.load();
+  while (old < thread_id &&
+         !ctx->max_thread_id.compare_exchange_weak(old, thread_id))
+    ;
+}
+}  // namespace
+
+TEST(ThreadPool, EveryTaskRunsOnce) {
+  ThreadPool pool(8);
+  for (int splits : {0, 1, 7, 64, 1000}) {
+    for (int num_threads : {1, 3, 8, 16}) {
+      CountContext ctx(splits);
+      pool.run(splits, num_threads, &ctx, count_task);
+      for (int i = 0; i < splits; i++) {
+        EXPECT_EQ(ctx.hits[i].load(), 1);
+      }
+      EXPECT_LT(ctx.max_thread_id.load(), std::min(num_threads, 8));
+    }
+  }
+}
+
+TEST(ThreadPool, SkewedTasks) {
+  // All the expensive tasks land in the range of thread 0, so they can only
+  // be balanced by stealing.
+  ThreadPool pool(4);
+  const int n = 256;
+  CountContext ctx(n);
+  pool.run(n, 4, &ctx, [](void *ctx_, int thread_id, int i) {
+    if (i < 16) {
+      volatile double x = 0;
+      for (int t = 0; t < 100000; t++)
+        x = x + t * 1e-9;
+    }
+    count_task(ctx_, thread_id, i);
+  });
+  for (int i = 0; i < n; i++) {
+    EXPECT_EQ(ctx.hits[i].load(), 1);
+  }
+}
+
+TEST(ThreadPool, ManySmallLaunches) {
+  ThreadPool pool(4);
+  std::atomic<int> sum{0};
+  for (int j = 0; j < 10000; j++) {
+    pool.run(4, 4, &sum, [](void *sum, int, int i) {
+      ((std::atomic<int> *)sum)->fetch_add(i);
+    });
+  }
+  EXPECT_EQ(sum.load(), 10000 * 6);
+}
+
+}  // namespace taichi
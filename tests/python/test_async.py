@@ -1,4 +1,5 @@
 import numpy as np
+import pytest
 
 import taichi as ti
 
@@ -53,3 +54,91 @@ def test_listgen_opt_with_offsets():
 
     ti.sync()
     assert ti.get_kernel_stats().get_counters()['launched_tasks_list_gen'] <= 2
+
+
+@ti.test(arch=ti.cpu, async_mode=True, async_max_concurrent_tasks=4)
+def test_concurrent_tasks():
+    n = 1024
+    fields = [ti.field(dtype=ti.i32, shape=n) for _ in range(4)]
+    total = ti.field(dtype=ti.i32, shape=n)
+
+    @ti.kernel
+    def fill(x: ti.template(), k: ti.i32):
+        for i in x:
+            x[i] = i * k
+
+    @ti.kernel
+    def accumulate(x: ti.template()):
+        for i in x:
+            total[i] += x[i]
+
+    # The fills are independent, and each accumulation depends on one fill
+    # and the previous accumulation.
+    for k in range(3):
+        for j, x in enumerate(fields):
+            fill(x, j + k)
+        for x in fields:
+            accumulate(x)
+
+    ti.sync()
+    for i in range(n):
+        assert total[i] == i * sum(j + k for j in range(4) for k in range(3))
+
+
+@pytest.mark.parametrize('num_slots,num_threads', [(4, 8), (8, 2)])
+def test_concurrent_tls_reductions(num_slots, num_threads):
+    # The thread ids of a slot start after those of the previous slots, and
+    # there are never more slots than threads.
+    ti.init(arch=ti.cpu,
+            async_mode=True,
+            async_max_concurrent_tasks=num_slots,
+            cpu_max_num_threads=num_threads)
+    n = 10000
+    fields = [ti.field(dtype=ti.i32, shape=n) for _ in range(num_slots)]
+    sums = ti.field(dtype=ti.i32, shape=num_slots)
+
+    @ti.kernel
+    def fill(x: ti.template(), k: ti.i32):
+        for i in x:
+            x[i] = i % 7 + k
+
+    @ti.kernel
+    def reduce(x: ti.template(), j: ti.i32):
+        ti.parallelize(8)
+        for i in range(n):
+            sums[j] += x[i]
+
+    for j, x in enumerate(fields):
+        fill(x, j)
+    # The reductions are independent, so they run concurrently.
+    for j, x in enumerate(fields):
+        reduce(x, j)
+    ti.sync()
+    for j in range(num_slots):
+        assert sums[j] == sum(i % 7 + j for i in range(n))
+    ti.reset()
+
+
+@ti.test(arch=ti.cpu,
+         async_mode=True,
+         async_max_concurrent_tasks=4,
+         cpu_max_num_threads=4)
+def test_concurrent_serial_random():
+    num_tasks = 4
+    m = 500
+    fields = [ti.field(dtype=ti.i32, shape=m) for _ in range(num_tasks)]
+
+    @ti.kernel
+    def draw(x: ti.template()):
+        # A serial task, which runs on the first thread of its slot.
+        j = 0
+        while j < m:
+            x[j] = ti.random(ti.i32)
+            j += 1
+
+    for x in fields:
+        draw(x)
+    ti.sync()
+    # Tasks sharing a random state at the same time would draw the same values.
+    values = np.concatenate([x.to_numpy() for x in fields])
+    assert len(np.unique(values)) == len(values)
@@ -53,6 +53,38 @@ def test_simple_1d():
         assert y[i] == i
 
 
+@ti.test(arch=ti.cpu, dynamic_index=False)
+def test_stencil_1d_cpu():
+    x, y = ti.field(ti.f32), ti.field(ti.f32)
+
+    N = 64
+    bs = 16
+
+    ti.root.pointer(ti.i, N // bs).dense(ti.i, bs).place(x, y)
+
+    # Leave the outer blocks inactive so that the stencil stays in bounds.
+    @ti.kernel
+    def populate():
+        for i in range(bs, N - bs):
+            x[i] = i * i
+
+    @ti.kernel
+    def stencil():
+        ti.block_local(x)
+        for i in x:
+            y[i] = x[i - 1] + x[i] + x[i + 1]
+
+    populate()
+    stats = ti.get_kernel_stats()
+    stats.clear()
+    stencil()
+    assert stats.get_counters()['launched_tasks_bls'] == 1
+
+    for i in range(bs, N - bs):
+        expected = sum(j * j for j in (i - 1, i, i + 1) if bs <= j < N - bs)
+        assert y[i] == expected
+
+
 @ti.test(require=ti.extension.bls, dynamic_index=False)
 def test_simple_2d():
     x, y = ti.field(ti.f32), ti.field(ti.f32)
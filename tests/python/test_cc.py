@@ -0,0 +1,95 @@
+import subprocess
+
+import pytest
+from taichi.cc_compose import main as compose
+from taichi.core.record import start_recording, stop_recording
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cc, cpu_max_num_threads=4)
+def test_parallel_range_for():
+    n = 100000
+    x = ti.field(ti.i32, shape=n)
+    total = ti.field(ti.f32, shape=())
+    largest = ti.field(ti.i32, shape=())
+    count = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def run():
+        for i in range(n):
+            x[i] += i
+            total[None] += 0.5
+            ti.atomic_max(largest[None], i)
+            count[None] += 1
+
+    run()
+    assert x[n - 1] == n - 1
+    assert total[None] == n * 0.5
+    assert largest[None] == n - 1
+    assert count[None] == n
+
+
+@ti.test(arch=ti.cc, cpu_max_num_threads=4)
+def test_parallel_random():
+    n = 100000
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            x[i] = ti.random()
+
+    fill()
+    values = x.to_numpy()
+    assert 0 <= values.min() and values.max() < 1
+    assert abs(values.mean() - 0.5) < 0.01
+    # The threads have independent states instead of sharing one.
+    assert len(set(values.tolist())) > n * 0.9
+
+
+def test_cc_compose(tmp_path):
+    if not ti.is_arch_supported(ti.cc):
+        pytest.skip('The C backend is not available')
+    record = str(tmp_path / 'record.yml')
+    start_recording(record)
+    try:
+        ti.init(arch=ti.cc, cpu_max_num_threads=4)
+        n = 1000
+        x = ti.field(ti.f32, shape=n)
+
+        @ti.kernel
+        def fill() -> ti.f32:
+            for i in range(n):
+                x[i] = ti.random()
+            s = 0.0
+            for i in range(n):
+                s += x[i]
+            return s
+
+        fill()
+    finally:
+        stop_recording()
+        ti.reset()
+
+    source, header = str(tmp_path / 'out.c'), str(tmp_path / 'out.h')
+    compose(record, source, header)
+    with open(header) as f:
+        entries = [
+            line[len('extern '):].split('(')[0].split()[-1] for line in f
+            if line.startswith('extern void Tk_')
+        ]
+    assert len(entries) == 1
+    main = str(tmp_path / 'main.c')
+    with open(main, 'w') as f:
+        f.write('#include <stdio.h>\n#include "out.h"\n'
+                'int main(void) {\n'
+                f'  {entries[0]}(&Ti_ctx);\n'
+                '  printf("%f\\n", Ti_ctx.args[0].val_f32);\n'
+                '  return 0;\n'
+                '}\n')
+    binary = str(tmp_path / 'composed')
+    subprocess.check_call(['cc', '-o', binary, source, main, '-lm'])
+    total = float(subprocess.check_output([binary]))
+    # The mean of n uniform random numbers.
+    assert 0.4 * n < total < 0.6 * n
@@ -0,0 +1,67 @@
+import taichi as ti
+
+
+def get_num_jit_modules():
+    return ti.get_runtime().prog.get_jit_module_stats()[0]
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], num_compile_threads=4)
+def test_compile_kernels():
+    n = 16
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    @ti.kernel
+    def scale(k: ti.i32):
+        for i in x:
+            x[i] *= k
+
+    @ti.kernel
+    def add(y: ti.template(), v: ti.i32):
+        for i in y:
+            y[i] += v
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    fill()
+    num_modules = get_num_jit_modules()
+    compilation_time = ti.get_runtime().prog.get_total_compilation_time()
+    ti.compile_kernels(fill, (scale, 2), (add, x, 1), total)
+    # |fill| has been compiled already.
+    assert get_num_jit_modules() == num_modules + 3
+    assert ti.get_runtime().prog.get_total_compilation_time(
+    ) > compilation_time
+
+    scale(3)
+    add(x, 1)
+    assert total() == 3 * (n - 1) * n // 2 + n
+    assert get_num_jit_modules() == num_modules + 3
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_compile_kernels_data_oriented():
+    @ti.data_oriented
+    class Counter:
+        def __init__(self):
+            self.c = ti.field(ti.i32, shape=())
+
+        @ti.kernel
+        def inc(self, v: ti.i32):
+            self.c[None] += v
+
+    counter = Counter()
+    counter.inc(0)
+    num_modules = get_num_jit_modules()
+    ti.compile_kernels((counter.inc, 1))
+    assert get_num_jit_modules() == num_modules
+    counter.inc(2)
+    assert counter.c[None] == 2
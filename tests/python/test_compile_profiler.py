@@ -0,0 +1,55 @@
+import json
+
+import taichi as ti
+
+
+def _compile_kernel():
+    x = ti.field(ti.f32, shape=16)
+
+    @ti.kernel
+    def fill(k: ti.f32):
+        for i in x:
+            x[i] = i * k
+
+    fill(2.0)
+    assert x[3] == 6.0
+
+
+def _kernel_events(report, kernel):
+    for k in report['kernels']:
+        if k['name'].startswith(kernel):
+            return k['events']
+    assert False, f'Kernel {kernel} not found'
+
+
+@ti.test(arch=ti.cpu, compile_profiler=True)
+def test_compile_profile(tmp_path):
+    ti.compile_profile_clear()
+    _compile_kernel()
+    filename = str(tmp_path / 'compile_profile.json')
+    ti.compile_profile_save(filename)
+    with open(filename) as f:
+        report = json.load(f)
+
+    events = _kernel_events(report, 'fill')
+    passes = [e for e in events if e['category'] == 'ir_pass']
+    assert any(e['name'] == 'full_simplify' for e in passes)
+    for e in passes:
+        if not e['skipped']:
+            assert e['stmts_before'] > 0
+            assert e['stmts_after'] > 0
+    phases = {e['name'] for e in events if e['category'] == 'llvm'}
+    assert {'llvm_emit_ir', 'llvm_jit_link'} <= phases
+
+
+@ti.test(arch=ti.cpu, compile_profiler=True, timeline=True)
+def test_compile_profile_timeline(tmp_path):
+    ti.timeline_clear()
+    _compile_kernel()
+    filename = str(tmp_path / 'timeline.json')
+    ti.timeline_save(filename)
+    with open(filename) as f:
+        trace = json.load(f)
+    names = {e['name'] for e in trace}
+    assert any(n.startswith('fill') and n.endswith(':full_simplify')
+               for n in names)
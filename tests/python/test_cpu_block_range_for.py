@@ -0,0 +1,64 @@
+import pytest
+
+import taichi as ti
+
+
+@pytest.mark.parametrize('block_range_for', [True, False])
+def test_fill_and_stencil(block_range_for):
+    ti.init(arch=ti.cpu, cpu_block_range_for=block_range_for)
+    n = 1000
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            x[i] = i
+
+    @ti.kernel
+    def stencil():
+        for i in range(1, n - 1):
+            y[i] = x[i - 1] + x[i] + x[i + 1]
+
+    fill()
+    stencil()
+    for i in range(1, n - 1):
+        assert y[i] == 3 * i
+    assert y[0] == 0 and y[n - 1] == 0
+
+
+@pytest.mark.parametrize('block_range_for', [True, False])
+def test_top_level_continue(block_range_for):
+    ti.init(arch=ti.cpu, cpu_block_range_for=block_range_for)
+    n = 777
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def run():
+        for i in range(n):
+            if i % 3 == 0:
+                continue
+            x[i] = i
+
+    run()
+    for i in range(n):
+        assert x[i] == (0 if i % 3 == 0 else i)
+
+
+@pytest.mark.parametrize('block_range_for', [True, False])
+def test_tls_reduction(block_range_for):
+    ti.init(arch=ti.cpu, cpu_block_range_for=block_range_for)
+    n = 12345
+    s = ti.field(ti.i64, shape=())
+
+    @ti.kernel
+    def reduce(begin: ti.i32, end: ti.i32):
+        for i in range(begin, end):
+            s[None] += i
+
+    reduce(0, n)
+    assert s[None] == n * (n - 1) // 2
+    # Empty ranges must not run the epilogue with garbage.
+    reduce(10, 10)
+    reduce(10, 5)
+    assert s[None] == n * (n - 1) // 2
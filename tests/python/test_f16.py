@@ -0,0 +1,146 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu)
+def test_f16_field():
+    x = ti.field(ti.f16, shape=4)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i * 0.5 + 0.25
+
+    fill()
+    for i in range(4):
+        assert x[i] == i * 0.5 + 0.25
+
+    x[1] = 1.0 / 3
+    assert x[1] == float(np.float16(1.0 / 3))
+
+
+@ti.test(arch=ti.cpu)
+def test_f16_rounding():
+    x = ti.field(ti.f16, shape=3)
+    y = ti.field(ti.f32, shape=3)
+    values = [2049.0, 65519.0, 1e-7]
+
+    @ti.kernel
+    def store():
+        for i in x:
+            x[i] = y[i]
+
+    for i in range(3):
+        y[i] = values[i]
+    store()
+    for i in range(3):
+        assert x[i] == float(np.float16(values[i]))
+
+
+@ti.test(arch=ti.cpu)
+def test_f16_arithmetic():
+    x = ti.field(ti.f16, shape=())
+    y = ti.field(ti.f16, shape=())
+    z = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def compute():
+        # Computed in f32: 2048 + 1 is not representable in f16.
+        z[None] = x[None] + y[None] + 1.0
+        y[None] = ti.sqrt(x[None])
+
+    x[None] = 2048
+    y[None] = 0
+    compute()
+    assert z[None] == 2049
+    assert y[None] == float(np.float16(np.sqrt(np.float32(2048))))
+
+
+@ti.test(arch=ti.cpu)
+def test_f16_numpy():
+    n = 16
+    x = ti.field(ti.f16, shape=n)
+    a = (np.arange(n) * 0.1).astype(np.float16)
+    x.from_numpy(a)
+    b = x.to_numpy()
+    assert b.dtype == np.float16
+    assert np.array_equal(a, b)
+
+
+@ti.test(arch=ti.cpu)
+def test_f16_atomic_add():
+    x = ti.field(ti.f16, shape=())
+    n = 64
+
+    @ti.kernel
+    def accumulate():
+        for i in range(n):
+            x[None] += 0.5
+            ti.atomic_max(x[None], -1.0)
+
+    accumulate()
+    assert x[None] == n * 0.5
+
+
+@ti.test(arch=ti.cpu)
+def test_f16_kernel_arg_and_return():
+    @ti.kernel
+    def halve(a: ti.f16) -> ti.f16:
+        return a * 0.5
+
+    assert halve(3.0) == 1.5
+    # Arguments and return values are passed as f32.
+    assert halve(1.0 / 3) == ti.approx(1.0 / 6, rel=1e-6)
+
+
+@pytest.mark.parametrize('software', [False, True])
+def test_f16_conversion_edge_cases(software):
+    ti.init(arch=ti.cpu, cpu_software_f16_conversion=software)
+    values = [
+        # Ties round to the nearest even.
+        2049.0,
+        2051.0,
+        1 + 2**-11,
+        1 + 3 * 2**-11,
+        # The largest finite value, and overflows to inf.
+        65504.0,
+        65519.0,
+        65520.0,
+        1e10,
+        # Subnormals, including ties and underflows to zero.
+        2**-24,
+        3 * 2**-25,
+        2**-25,
+        2**-26,
+        1e-7,
+        -5e-6,
+        2**-14 - 2**-25,
+        0.0,
+        -0.0,
+        float('inf'),
+        float('-inf'),
+        float('nan'),
+    ]
+    n = len(values)
+    x = ti.field(ti.f16, shape=n)
+    y = ti.field(ti.f32, shape=n)
+    z = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def convert():
+        for i in x:
+            x[i] = y[i]
+        for i in x:
+            z[i] = x[i]
+
+    y.from_numpy(np.array(values, dtype=np.float32))
+    convert()
+    expected = np.array(values, dtype=np.float32).astype(np.float16)
+    assert np.array_equal(x.to_numpy().view(np.uint16)[:-1],
+                          expected.view(np.uint16)[:-1])
+    assert np.array_equal(z.to_numpy()[:-1],
+                          expected[:-1].astype(np.float32))
+    assert np.isnan(x.to_numpy()[-1]) and np.isnan(z.to_numpy()[-1])
+    ti.reset()
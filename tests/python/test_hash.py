@@ -0,0 +1,183 @@
+import pytest
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu)
+def test_hash_activate():
+    x = ti.field(ti.i32)
+    n = 1 << 20
+    ti.root.hash(ti.i, n, capacity=64).place(x)
+
+    s = ti.field(ti.i32, shape=())
+    largest = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in range(32):
+            x[i * 32749] = i + 1
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += x[i]
+            ti.atomic_max(largest[None], i)
+
+    fill()
+    count()
+    assert s[None] == 32 * 33 // 2
+    assert largest[None] == 31 * 32749
+    assert x[31 * 32749] == 32
+    assert x[1] == 0
+
+
+@ti.test(arch=ti.cpu)
+def test_hash_is_active_and_deactivate():
+    x = ti.field(ti.f32)
+    block = ti.root.hash(ti.ij, (1024, 1024), capacity=16)
+    block.dense(ti.ij, 4).place(x)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def activate():
+        x[5, 7] = 1
+        x[4000, 10] = 2
+
+    @ti.kernel
+    def count():
+        for i, j in x:
+            s[None] += 1
+
+    @ti.kernel
+    def is_active(i: ti.i32, j: ti.i32) -> ti.i32:
+        return ti.is_active(block, [i, j])
+
+    @ti.kernel
+    def deactivate(i: ti.i32, j: ti.i32):
+        ti.deactivate(block, [i, j])
+
+    activate()
+    count()
+    assert s[None] == 32
+    assert is_active(1, 1)
+    assert is_active(1000, 2)
+    assert not is_active(2, 2)
+
+    deactivate(1, 1)
+    s[None] = 0
+    count()
+    assert s[None] == 16
+    assert x[5, 7] == 0
+    assert x[4000, 10] == 2
+
+    # Reactivating reuses the slot of the deactivated cell.
+    activate()
+    s[None] = 0
+    count()
+    assert s[None] == 32
+
+    block.deactivate_all()
+    s[None] = 0
+    count()
+    assert s[None] == 0
+
+
+@ti.test(arch=ti.cpu)
+def test_hash_nested():
+    x = ti.field(ti.i32)
+    ti.root.dense(ti.i, 4).hash(ti.i, 1 << 16, capacity=8).place(x)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in range(4):
+            x[i * (1 << 16) + 12345] = i + 1
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += i % (1 << 16) == 12345
+
+    fill()
+    count()
+    assert s[None] == 4
+    assert x[3 * (1 << 16) + 12345] == 4
+
+
+@ti.test(arch=ti.cpu, debug=True)
+def test_hash_full():
+    x = ti.field(ti.i32)
+    ti.root.hash(ti.i, 1024, capacity=4).place(x)
+
+    @ti.kernel
+    def fill():
+        for i in range(64):
+            x[i] = 1
+
+    with pytest.raises(RuntimeError):
+        fill()
+
+
+@ti.test(arch=ti.cpu)
+def test_hash_overflow_keeps_inactive_cells(capfd):
+    x = ti.field(ti.i32)
+    ti.root.hash(ti.i, 1024, capacity=4).place(x)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in range(64):
+            x[i] = 1
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += x[i]
+
+    @ti.kernel
+    def read(i: ti.i32) -> ti.i32:
+        return x[i]
+
+    fill()
+    assert 'dropped' in capfd.readouterr().out
+    count()
+    # Only the cells that fit into the 8 slots of the table are stored.
+    assert s[None] == 8
+    assert x[1000] == 0
+    assert read(1000) == 0
+
+
+@ti.test(arch=ti.cpu)
+def test_hash_reuses_deactivated_slots(capfd):
+    x = ti.field(ti.i32)
+    block = ti.root.hash(ti.i, 1 << 20, capacity=4)
+    block.place(x)
+    s = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def move(k: ti.i32):
+        # Deactivates the previous window of cells and activates the next one.
+        for i in range(6):
+            ti.deactivate(block, [k * 997 + i])
+        for i in range(6):
+            x[(k + 1) * 997 + i] = k + 1
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += x[i]
+
+    # Over time, far more cells are activated than the 8 slots of the table.
+    for k in range(100):
+        move(k)
+        s[None] = 0
+        count()
+        assert s[None] == 6 * (k + 1)
+    assert x[100 * 997 + 5] == 100
+    assert x[99 * 997] == 0
+    assert 'dropped' not in capfd.readouterr().out
+
+    block.deactivate_all()
+    s[None] = 0
+    count()
+    assert s[None] == 0
@@ -0,0 +1,54 @@
+import taichi as ti
+
+
+def get_jit_module_stats():
+    return ti.get_runtime().prog.get_jit_module_stats()
+
+
+@ti.test(arch=ti.cpu)
+def test_jit_module_stats():
+    x = ti.field(ti.i32, shape=4)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    fill()
+    num_modules, num_bytes = get_jit_module_stats()
+
+    @ti.kernel
+    def double():
+        for i in x:
+            x[i] *= 2
+
+    double()
+    assert x[3] == 6
+    new_num_modules, new_num_bytes = get_jit_module_stats()
+    assert new_num_modules == num_modules + 1
+    assert new_num_bytes > num_bytes
+
+
+@ti.test(arch=ti.cpu)
+def test_runtime_module_unloaded_with_new_snode_trees():
+    n = 8
+    x = ti.field(ti.f32, shape=n)
+    x[0] = 1
+    num_modules, _ = get_jit_module_stats()
+
+    for _ in range(4):
+        fb = ti.FieldsBuilder()
+        y = ti.field(ti.f32)
+        fb.dense(ti.i, n).place(y)
+        fb.finalize()
+
+    # Each SNode tree supersedes the runtime module of the previous one.
+    assert get_jit_module_stats()[0] == num_modules
+
+    @ti.kernel
+    def copy():
+        for i in range(n):
+            y[i] = x[i] + 1
+
+    copy()
+    assert y[0] == 2
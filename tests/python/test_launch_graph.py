@@ -0,0 +1,102 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu)
+def test_replay():
+    n = 16
+    x = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def add(k: ti.f32):
+        for i in x:
+            x[i] += k
+
+    @ti.kernel
+    def double():
+        for i in x:
+            x[i] *= 2
+
+    graph = ti.LaunchGraph()
+    with graph.capture():
+        add(1.0)
+        double()
+    assert len(graph) == 2
+    assert x[0] == 2.0
+
+    graph.replay()
+    assert x[0] == 6.0
+
+    graph.set_arg(0, 0, 0.5)
+    graph.replay()
+    graph.replay()
+    # ((6 + 0.5) * 2 + 0.5) * 2
+    assert x[n - 1] == 27.0
+
+
+@ti.test(arch=ti.cpu)
+def test_int_arg():
+    x = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def inc(k: ti.i32):
+        x[None] += k
+
+    graph = ti.LaunchGraph()
+    with graph.capture():
+        inc(1)
+    graph.set_arg(0, 0, 10)
+    for _ in range(3):
+        graph.replay()
+    assert x[None] == 31
+    with pytest.raises(RuntimeError):
+        graph.set_arg(0, 1, 10)
+
+
+@ti.test(arch=ti.cpu, require=ti.extension.async_mode, async_mode=True)
+def test_replay_async():
+    x = ti.field(ti.i32, shape=8)
+
+    @ti.kernel
+    def inc():
+        for i in x:
+            x[i] += 1
+
+    graph = ti.LaunchGraph()
+    with graph.capture():
+        inc()
+        inc()
+    for _ in range(10):
+        graph.replay()
+    assert x[3] == 22
+
+
+@ti.test(arch=ti.cpu)
+def test_external_array_rejected():
+    @ti.kernel
+    def fill(a: ti.ext_arr()):
+        for i in range(4):
+            a[i] = i
+
+    graph = ti.LaunchGraph()
+    with pytest.raises(RuntimeError):
+        with graph.capture():
+            fill(np.zeros(4, dtype=np.float32))
+
+
+@ti.test(arch=ti.cpu)
+def test_replay_after_reset():
+    x = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def inc():
+        x[None] += 1
+
+    graph = ti.LaunchGraph()
+    with graph.capture():
+        inc()
+    ti.reset()
+    with pytest.raises(RuntimeError):
+        graph.replay()
@@ -59,3 +59,38 @@ def test_nested_3d():
     for _ in range(1000):
         i, j, k = randrange(n), randrange(n), randrange(n)
         assert x[i, j, k] == (i * n + j) * n + k
+
+
+@ti.test(require=ti.extension.sparse)
+def test_listgen_many_parent_elements():
+    x = ti.field(ti.i32)
+    n = 1024
+    block = ti.root.pointer(ti.ij, n // 4)
+    block.bitmasked(ti.ij, 4).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(n, n):
+            if (i * 7 + j * 3) % 11 == 0:
+                x[i, j] = i - j
+
+    s = ti.field(ti.i64, shape=())
+    c = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def reduce():
+        for i, j in x:
+            s[None] += x[i, j] + n
+            c[None] += 1
+
+    activate()
+    reduce()
+    expected_s = 0
+    expected_c = 0
+    for i in range(n):
+        for j in range(n):
+            if (i * 7 + j * 3) % 11 == 0:
+                expected_s += i - j + n
+                expected_c += 1
+    assert c[None] == expected_c
+    assert s[None] == expected_s
@@ -0,0 +1,103 @@
+import os
+
+import pytest
+
+import taichi as ti
+
+
+def _run_kernels():
+    x = ti.field(ti.f32, shape=16)
+    y = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill(k: ti.f32):
+        for i in x:
+            x[i] = i * k
+
+    @ti.kernel
+    def total() -> ti.f32:
+        s = 0.0
+        for i in x:
+            s += x[i]
+        y[None] = 1
+        return s
+
+    fill(2.0)
+    assert total() == 2.0 * 15 * 16 / 2
+    assert y[None] == 1
+
+
+def _cache_entries(path):
+    return [f for f in os.listdir(path) if f.endswith('.tcb')]
+
+
+def _cache_stats():
+    return ti.get_runtime().prog.get_offline_cache_stats()
+
+
+def test_offline_cache(tmp_path):
+    for arch in ti.get_host_arch_list():
+        path = str(tmp_path / str(arch))
+        # The first run populates the cache.
+        ti.init(arch=arch, offline_cache=True, offline_cache_file_path=path)
+        _run_kernels()
+        hits, misses = _cache_stats()
+        assert hits == 0 and misses > 0
+        assert len(_cache_entries(path)) > 0
+        # The second one loads every kernel from it and compiles none.
+        ti.init(arch=arch, offline_cache=True, offline_cache_file_path=path)
+        _run_kernels()
+        assert _cache_stats() == (misses, 0)
+    ti.reset()
+
+
+def test_offline_cache_eviction(tmp_path):
+    for arch in ti.get_host_arch_list():
+        path = str(tmp_path / str(arch))
+        ti.init(arch=arch,
+                offline_cache=True,
+                offline_cache_file_path=path,
+                offline_cache_max_size_GB=1e-9)
+        _run_kernels()
+        # Every entry is larger than the limit, so at most the last one stays.
+        assert len(_cache_entries(path)) <= 1
+    ti.reset()
+
+
+@pytest.mark.skipif(not ti.is_arch_supported(ti.cc),
+                    reason='The C backend is not available')
+def test_offline_cache_cc(tmp_path):
+    path = str(tmp_path)
+    ti.init(arch=ti.cc, offline_cache=True, offline_cache_file_path=path)
+    _run_kernels()
+    cc_path = os.path.join(path, 'cc')
+    assert any(f.endswith('.so') for f in os.listdir(cc_path))
+
+    def runtime_objects():
+        # A rebuilt file is renamed over the old one, which changes its inode.
+        return {
+            f: os.stat(os.path.join(cc_path, f)).st_ino
+            for f in os.listdir(cc_path) if '_rti_' in f
+        }
+
+    objects = runtime_objects()
+    assert len(objects) > 0
+    # The runtime and the root struct are neither compiled nor linked again.
+    ti.init(arch=ti.cc, offline_cache=True, offline_cache_file_path=path)
+    _run_kernels()
+    assert runtime_objects() == objects
+    ti.reset()
+
+
+@pytest.mark.skipif(not ti.is_arch_supported(ti.cc),
+                    reason='The C backend is not available')
+def test_offline_cache_cc_eviction(tmp_path):
+    path = str(tmp_path)
+    ti.init(arch=ti.cc,
+            offline_cache=True,
+            offline_cache_file_path=path,
+            offline_cache_max_size_GB=1e-9)
+    _run_kernels()
+    # Only the runtime object and the last shared object are kept.
+    assert len(os.listdir(os.path.join(path, 'cc'))) <= 2
+    ti.reset()
@@ -66,6 +66,35 @@ def test_random_independent_product():
         assert X.mean() == approx(1 / 4, rel=1e-2)
 
 
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_random_in_struct_for():
+    n = 256
+    x = ti.field(ti.f32)
+    y = ti.field(ti.f32)
+    ti.root.pointer(ti.i, n).dense(ti.j, n).place(x)
+    ti.root.pointer(ti.i, n).dense(ti.j, n).place(y)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(n, n):
+            x[i, j] = 0
+
+    @ti.kernel
+    def fill() -> ti.f32:
+        s = 0.0
+        for i, j in x:
+            # Activates the cells of |y| from all threads.
+            y[i, j] = ti.random()
+            s += y[i, j]
+        return s
+
+    activate()
+    assert fill() / (n * n) == approx(1 / 2, rel=1e-2)
+    Y = y.to_numpy()
+    for i in range(1, 4):
+        assert (Y**i).mean() == approx(1 / (i + 1), rel=1e-2)
+
+
 @ti.test(exclude=ti.metal)
 def test_random_2d_dist():
     n = 8192
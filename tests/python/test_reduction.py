@@ -127,3 +127,151 @@ def test_reduction_different_scale():
     # 1024 and 100000 since OpenGL max threads per group ~= 1792
     for n in [1, 10, 60, 1024, 100000]:
         assert n == func(n)
+
+
+@ti.test(require=ti.extension.sparse)
+def test_reduction_struct_for_small_blocks():
+    n = 1024 * 16
+    x = ti.field(ti.i32)
+    ti.root.pointer(ti.i, n // 4).bitmasked(ti.i, 4).place(x)
+    s = ti.field(ti.i32, shape=())
+    m = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def activate():
+        for i in range(n):
+            if i % 3 == 0:
+                x[i] = i % 1000
+
+    @ti.kernel
+    def reduce():
+        for i in x:
+            s[None] += x[i]
+            ti.atomic_max(m[None], x[i])
+
+    activate()
+    for _ in range(2):
+        s[None] = 0
+        m[None] = 0
+        reduce()
+        assert s[None] == sum(i % 1000 for i in range(0, n, 3))
+        assert m[None] == 999
+
+
+@pytest.mark.parametrize('block_range_for', [False, True])
+def test_privatized_histogram(block_range_for):
+    ti.init(arch=ti.cpu,
+            cpu_privatize_atomics=True,
+            cpu_block_range_for=block_range_for)
+    n = 100000
+    num_bins = 37
+    data = ti.field(ti.i32, shape=n)
+    hist = ti.field(ti.i32, shape=num_bins)
+    hist_2d = ti.field(ti.f32, shape=(5, 7))
+
+    @ti.kernel
+    def fill():
+        for i in data:
+            data[i] = (i * 7919) % 1000
+
+    @ti.kernel
+    def count():
+        for i in range(n):
+            hist[data[i] % num_bins] += 1
+            hist_2d[data[i] % 5, data[i] % 7] += 0.5
+
+    fill()
+    hist[3] = 10
+    count()
+    count()
+    expected = np.zeros(num_bins, dtype=np.int32)
+    expected_2d = np.zeros((5, 7), dtype=np.float32)
+    for v in data.to_numpy():
+        expected[v % num_bins] += 2
+        expected_2d[v % 5, v % 7] += 1
+    expected[3] += 10
+    assert np.all(hist.to_numpy() == expected)
+    assert np.allclose(hist_2d.to_numpy(), expected_2d)
+
+
+@ti.test(arch=ti.cpu, cpu_privatize_atomics=True)
+def test_privatized_min_max_bit_or():
+    n = 4096
+    num_bins = 16
+    lo = ti.field(ti.f32, shape=num_bins)
+    hi = ti.field(ti.i32, shape=num_bins)
+    bits = ti.field(ti.i32, shape=num_bins)
+    x = ti.field(ti.i32)
+    ti.root.pointer(ti.i, n // 8).dense(ti.i, 8).place(x)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            x[i] = (i * 31) % 997
+
+    @ti.kernel
+    def reduce():
+        for i in x:
+            b = i % num_bins
+            ti.atomic_min(lo[b], ti.cast(x[i], ti.f32))
+            ti.atomic_max(hi[b], x[i])
+            bits[b] |= 1 << (x[i] % 31)
+
+    fill()
+    for b in range(num_bins):
+        lo[b] = 1e9
+        hi[b] = -1
+    reduce()
+    values = [(i * 31) % 997 for i in range(n)]
+    for b in range(num_bins):
+        group = values[b::num_bins]
+        assert lo[b] == min(group)
+        assert hi[b] == max(group)
+        expected_bits = 0
+        for v in group:
+            expected_bits |= 1 << (v % 31)
+        assert bits[b] == expected_bits
+
+
+@ti.test(arch=ti.cpu, cpu_privatize_atomics=True)
+def test_privatized_atomics_not_applicable():
+    n = 1000
+    counter = ti.field(ti.i32, shape=4)
+    out = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def run():
+        for i in range(n):
+            # The old values are used, so the atomics must stay global.
+            out[i] = ti.atomic_add(counter[i % 4], 1)
+
+    run()
+    assert np.all(counter.to_numpy() == n // 4)
+    assert sorted(out.to_numpy().tolist()) == sorted(
+        [k for _ in range(4) for k in range(n // 4)])
+
+
+@ti.test(arch=ti.cpu, cpu_privatize_atomics=True, cpu_max_num_threads=64)
+def test_privatized_large_histograms():
+    n = 100000
+    small = ti.field(ti.i32, shape=16)
+    # Close to cpu_privatize_atomics_max_bytes per thread, so that the TLS
+    # buffers of the threads are reallocated for this kernel.
+    large = ti.field(ti.i32, shape=8000)
+
+    @ti.kernel
+    def count_small():
+        for i in range(n):
+            small[i % 16] += 1
+
+    @ti.kernel
+    def count_large():
+        for i in range(n):
+            large[(i * 7919) % 8000] += 1
+
+    count_small()
+    count_large()
+    count_small()
+    assert np.all(small.to_numpy() == 2 * n // 16)
+    expected = np.bincount((np.arange(n) * 7919) % 8000, minlength=8000)
+    assert np.all(large.to_numpy() == expected)
@@ -52,3 +52,146 @@ def test_sparse_LLT_solver(solver_type):
     x = solver.solve(b)
     for i in range(n):
         assert x[i] == ti.approx(res[i])
+
+
+@pytest.mark.parametrize("solver_type", ["LLT", "LDLT", "LU"])
+@ti.test(arch=ti.cpu, require=ti.extension.data64)
+def test_sparse_solver_f64(solver_type):
+    n = 4
+    Abuilder = ti.SparseMatrixBuilder(n,
+                                      n,
+                                      max_num_triplets=100,
+                                      dtype=ti.f64)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder(), InputArray: ti.ext_arr()):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j]
+
+    fill(Abuilder, Aarray)
+    A = Abuilder.build()
+    solver = ti.SparseSolver(solver_type=solver_type, dtype=ti.f64)
+    solver.analyze_pattern(A)
+    solver.factorize(A)
+    x = solver.solve(np.arange(1, n + 1, dtype=np.float64))
+    for i in range(n):
+        assert x[i] == ti.approx(res[i], rel=1e-10)
+
+
+@pytest.mark.parametrize("preconditioner", ["none", "jacobi", "ic0"])
+@ti.test(arch=ti.cpu, require=ti.extension.data64)
+def test_sparse_cg_solver(preconditioner):
+    n = 4
+    Abuilder = ti.SparseMatrixBuilder(n,
+                                      n,
+                                      max_num_triplets=100,
+                                      dtype=ti.f64)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder(), InputArray: ti.ext_arr()):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j]
+
+    fill(Abuilder, Aarray)
+    A = Abuilder.build()
+    solver = ti.SparseSolver(solver_type="CG",
+                             dtype=ti.f64,
+                             preconditioner=preconditioner,
+                             tolerance=1e-12)
+    solver.analyze_pattern(A)
+    solver.factorize(A)
+    x = solver.solve(np.arange(1, n + 1, dtype=np.float64))
+    assert solver.info()
+    assert solver.num_iterations() <= n
+    for i in range(n):
+        assert x[i] == ti.approx(res[i], rel=1e-8)
+
+
+@pytest.mark.parametrize("preconditioner", ["none", "jacobi"])
+@ti.test(arch=ti.cpu)
+def test_sparse_bicgstab_solver(preconditioner):
+    n = 64
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=n * 3)
+
+    # A nonsymmetric, diagonally dominant matrix.
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder()):
+        for i in range(n):
+            Abuilder[i, i] += 4.0 + i % 3
+            if i > 0:
+                Abuilder[i, i - 1] += -1.5
+            if i < n - 1:
+                Abuilder[i, i + 1] += -0.5
+
+    fill(Abuilder)
+    A = Abuilder.build()
+    solver = ti.SparseSolver(solver_type="BICGSTAB",
+                             preconditioner=preconditioner)
+    solver.compute(A)
+    b = np.linspace(-1, 1, n).astype(np.float32)
+    x = solver.solve(b)
+    assert solver.info()
+    assert solver.relative_residual() <= 1e-6
+    assert np.allclose(A @ x, b, atol=1e-4)
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_cg_solver_warm_start():
+    n = 4
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=100)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder(), InputArray: ti.ext_arr()):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j]
+
+    fill(Abuilder, Aarray)
+    A = Abuilder.build()
+    solver = ti.SparseSolver(solver_type="CG", warm_start=True)
+    solver.analyze_pattern(A)
+    solver.factorize(A)
+    b = np.arange(1, n + 1, dtype=np.float32)
+    solver.solve(b)
+    assert solver.num_iterations() > 0
+    x = solver.solve(b)
+    assert solver.num_iterations() == 0
+    for i in range(n):
+        assert x[i] == ti.approx(res[i])
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_iterative_solver_invalid_options():
+    with pytest.raises(RuntimeError):
+        ti.SparseSolver(solver_type="BICGSTAB", preconditioner="ic0")
+    with pytest.raises(RuntimeError):
+        ti.SparseSolver(solver_type="CG", preconditioner="ilu")
+
+
+@pytest.mark.parametrize("solver_type", ["LLT", "CG"])
+@ti.test(arch=ti.cpu)
+def test_sparse_solver_reuses_pattern_analysis(solver_type):
+    n = 4
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=100)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder(), InputArray: ti.ext_arr(),
+             scale: ti.f32):
+        for i, j in ti.ndrange(n, n):
+            Abuilder[i, j] += InputArray[i, j] * scale
+
+    fill(Abuilder, Aarray, 1)
+    A = Abuilder.build()
+    solver = ti.SparseSolver(solver_type=solver_type)
+    solver.analyze_pattern(A)
+    solver.factorize(A)
+    b = np.arange(1, n + 1, dtype=np.float32)
+    for scale in [2, 4]:
+        Abuilder.reset()
+        fill(Abuilder, Aarray, scale)
+        Abuilder.refill(A)
+        solver.analyze_pattern(A)
+        solver.factorize(A)
+        x = solver.solve(b)
+        for i in range(n):
+            assert x[i] == ti.approx(res[i] / scale, rel=1e-4)
+    assert solver.num_pattern_analyses() == 1
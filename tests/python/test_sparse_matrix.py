@@ -1,3 +1,6 @@
+import numpy as np
+import pytest
+
 import taichi as ti
 
 
@@ -181,3 +184,132 @@ def test_sparse_matrix_nonsymmetric_multiplication():
     for i in range(n):
         for j in range(m):
             assert C[i, j] == GT[i][j]
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_builder_duplicates():
+    n = 64
+    num_repeats = 100
+    Abuilder = ti.SparseMatrixBuilder(n,
+                                      n,
+                                      max_num_triplets=n * 3 * num_repeats)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder()):
+        for r, i in ti.ndrange(num_repeats, n):
+            Abuilder[i, i] += 2
+            if i > 0:
+                Abuilder[i, i - 1] -= 1
+            if i < n - 1:
+                Abuilder[i, i + 1] -= 1
+
+    fill(Abuilder)
+    A = Abuilder.build()
+    for i in range(n):
+        for j in range(n):
+            expected = 0
+            if i == j:
+                expected = 2 * num_repeats
+            elif abs(i - j) == 1:
+                expected = -num_repeats
+            assert A[i, j] == expected
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_builder_full():
+    n = 8
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=10)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder()):
+        for i in range(n * 10000):
+            Abuilder[i % n, i % n] += 1
+
+    fill(Abuilder)
+    with pytest.raises(RuntimeError):
+        Abuilder.build()
+
+
+@ti.test(arch=ti.cpu, require=ti.extension.data64)
+def test_sparse_matrix_f64():
+    n = 8
+    Abuilder = ti.SparseMatrixBuilder(n,
+                                      n,
+                                      max_num_triplets=100,
+                                      dtype=ti.f64)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder()):
+        for i in range(n):
+            Abuilder[i, i] += 1.0 + 1e-10 * i
+
+    fill(Abuilder)
+    A = Abuilder.build()
+    B = A.transpose() * 2.0
+    for i in range(n):
+        # Not representable in f32.
+        assert A[i, i] == 1.0 + 1e-10 * i
+        assert B[i, i] == 2.0 * (1.0 + 1e-10 * i)
+    x = A @ np.ones(n)
+    assert x.dtype == np.float64
+    assert x[n - 1] == 1.0 + 1e-10 * (n - 1)
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_builder_refill():
+    n = 8
+    Abuilder = ti.SparseMatrixBuilder(n, n, max_num_triplets=100)
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder(), scale: ti.f32):
+        for i in range(n):
+            Abuilder[i, i] += 2 * scale
+            if i > 0:
+                Abuilder[i, i - 1] -= scale
+
+    fill(Abuilder, 1)
+    A = Abuilder.build()
+    fingerprint = A.pattern_fingerprint()
+    Abuilder.reset()
+    fill(Abuilder, 3)
+    assert Abuilder.refill(A) is A
+    assert A.pattern_fingerprint() == fingerprint
+    for i in range(n):
+        for j in range(n):
+            expected = 0
+            if i == j:
+                expected = 6
+            elif i == j + 1:
+                expected = -3
+            assert A[i, j] == expected
+
+    @ti.kernel
+    def fill_outside(Abuilder: ti.sparse_matrix_builder()):
+        Abuilder[0, n - 1] += 1
+
+    Abuilder.reset()
+    fill_outside(Abuilder)
+    with pytest.raises(RuntimeError):
+        Abuilder.refill(A)
+
+
+@ti.test(arch=ti.cpu)
+def test_sparse_matrix_pattern_fingerprint():
+    n = 8
+    builders = [
+        ti.SparseMatrixBuilder(n, n, max_num_triplets=100) for _ in range(3)
+    ]
+
+    @ti.kernel
+    def fill(Abuilder: ti.sparse_matrix_builder(), scale: ti.f32,
+             offset: ti.i32):
+        for i in range(n):
+            Abuilder[i, i] += scale
+            Abuilder[i, (i + offset) % n] += scale
+
+    fill(builders[0], 1, 1)
+    fill(builders[1], 2, 1)
+    fill(builders[2], 1, 2)
+    A, B, C = [builder.build() for builder in builders]
+    assert A.pattern_fingerprint() == B.pattern_fingerprint()
+    assert A.pattern_fingerprint() != C.pattern_fingerprint()